@@ -140,6 +140,7 @@ int main(void)
 	int img_width;
 	int img_height;
 	int standardize = 0;
+	int preview = 0;
 
 	r = fp_init();
 	if (r < 0) {
@@ -183,6 +184,9 @@ int main(void)
 	if (!framebuffer)
 		goto out_close;
 
+	/* captures follow each other, keep the sensor armed in between */
+	fp_dev_set_warm_session(dev, 2000);
+
 	/* make the window */
 	display = XOpenDisplay(getenv("DISPLAY"));
 	if(display == NULL) {
@@ -206,7 +210,8 @@ int main(void)
 
 	gc = XCreateGC(display, window, 0, &xgcv);
 
-	printf("Press S to toggle standardized mode, Q to quit\n");
+	printf("Press S to toggle standardized mode, P to toggle print preview, "
+		"Q to quit\n");
 	
 	while (1) { /* event loop */
 		struct fp_img *img;
@@ -216,8 +221,17 @@ int main(void)
 			fprintf(stderr, "image capture failed, code %d\n", r);
 			goto out_close;
 		}
-		if (standardize)
+		if (standardize || preview)
 			fp_img_standardize(img);
+		if (preview) {
+			int offset_x, offset_y;
+			int estimate = fp_img_get_preview(img, &offset_x, &offset_y);
+
+			if (estimate >= 0)
+				printf("\rabout %d minutiae, finger off centre by %d,%d    ",
+					estimate, offset_x, offset_y);
+			fflush(stdout);
+		}
 
 		display_frame(img);
 		fp_img_free(img);
@@ -238,6 +252,12 @@ int main(void)
 			case XK_S:
 				standardize = !standardize;
 				break;
+			case XK_p:
+			case XK_P:
+				preview = !preview;
+				if (!preview)
+					printf("\n");
+				break;
 			}
 		} /* XPending */
 	}
@@ -50,6 +50,8 @@ static void continue_write_regv(struct write_regv_data *wdata);
 static void write_regv_trf_complete(struct libusb_transfer *transfer)
 {
 	struct write_regv_data *wdata = transfer->user_data;
+	/* wdata is gone once the caller has been called back */
+	struct fp_dev *dev = wdata->imgdev->dev;
 
 	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
 		wdata->callback(wdata->imgdev, -EIO, wdata->user_data);
@@ -58,8 +60,7 @@ static void write_regv_trf_complete(struct libusb_transfer *transfer)
 	else
 		continue_write_regv(wdata);
 
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev, transfer);
 }
 
 /* write from wdata->offset to upper_bound (inclusive) of wdata->regs */
@@ -68,16 +69,17 @@ static int do_write_regv(struct write_regv_data *wdata, int upper_bound)
 	unsigned int offset = wdata->offset;
 	unsigned int num = upper_bound - offset + 1;
 	size_t alloc_size = num * 2;
-	unsigned char *data = g_malloc(alloc_size);
+	unsigned char *data;
 	unsigned int i;
 	size_t data_offset = 0;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	int r;
 
-	if (!transfer) {
-		g_free(data);
+	transfer = fpi_usb_alloc_transfer(wdata->imgdev->dev, alloc_size);
+	if (!transfer)
 		return -ENOMEM;
-	}
+
+	data = transfer->buffer;
 
 	for (i = offset; i < offset + num; i++) {
 		const struct aes_regwrite *regwrite = &wdata->regs[i];
@@ -87,11 +89,9 @@ static int do_write_regv(struct write_regv_data *wdata, int upper_bound)
 
 	libusb_fill_bulk_transfer(transfer, wdata->imgdev->udev, EP_OUT, data,
 		alloc_size, write_regv_trf_complete, wdata, BULK_TIMEOUT);
-	r = libusb_submit_transfer(transfer);
-	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
-	}
+	r = fpi_usb_submit_transfer(transfer);
+	if (r < 0)
+		fpi_usb_free_transfer(wdata->imgdev->dev, transfer);
 
 	return r;
 }
@@ -158,20 +158,6 @@ void aes_write_regv(struct fp_img_dev *dev, const struct aes_regwrite *regs,
 	continue_write_regv(wdata);
 }
 
-void aes_assemble_image(unsigned char *input, size_t width, size_t height,
-	unsigned char *output)
-{
-	size_t row, column;
-
-	for (column = 0; column < width; column++) {
-		for (row = 0; row < height; row += 2) {
-			output[width * row + column] = (*input & 0x0f) * 17;
-			output[width * (row + 1) + column] = ((*input & 0xf0) >> 4) * 17;
-			input++;
-		}
-	}
-}
-
 /* find overlapping parts of  frames */
 static unsigned int find_overlap(unsigned char *first_frame,
 	unsigned char *second_frame, unsigned int *min_error,
@@ -219,7 +205,12 @@ static unsigned int assemble(GSList *list_entry, size_t num_stripes,
 	if (reverse)
 		output += (num_stripes - 1) * frame_size;
 	for (frame = 0; frame < num_stripes; frame++) {
-		aes_assemble_image(list_entry->data, frame_width, frame_height, output);
+		/* inverting here does not affect the overlap detection below,
+		 * which only looks at differences between pixels */
+		fpi_img_unpack_4bpp(output, list_entry->data, frame_width,
+			frame_height,
+			FPI_4BPP_COLUMN_MAJOR | FPI_4BPP_LOW_NIBBLE_FIRST,
+			FP_IMG_COLORS_INVERTED);
 
 		if (reverse)
 		    output -= frame_size;
@@ -244,20 +235,20 @@ static unsigned int assemble(GSList *list_entry, size_t num_stripes,
 	return image_height;
 }
 
-struct fp_img *aes_assemble(GSList *stripes, size_t stripes_len,
-	unsigned int frame_width, unsigned int frame_height)
+struct fp_img *aes_assemble(struct fp_img_dev *dev, GSList *stripes,
+	size_t stripes_len, unsigned int frame_width, unsigned int frame_height)
 {
 	size_t final_size;
 	struct fp_img *img;
 	unsigned int frame_size = frame_width * frame_height;
 	unsigned int errors_sum, r_errors_sum;
+	gint64 start = fpi_stats_start();
 
 	BUG_ON(stripes_len == 0);
 
 	/* create buffer big enough for max image */
 	img = fpi_img_new(stripes_len * frame_size);
 
-	img->flags = FP_IMG_COLORS_INVERTED;
 	img->height = assemble(stripes, stripes_len,
 		frame_width, frame_height,
 		img->data, FALSE, &errors_sum);
@@ -280,5 +271,6 @@ struct fp_img *aes_assemble(GSList *stripes, size_t stripes_len,
 	img = fpi_img_resize(img, final_size);
 	img->width = frame_width;
 
+	fpi_stats_add(dev->dev, FP_STATS_STAGE_ASSEMBLE, start);
 	return img;
 }
@@ -33,11 +33,8 @@ typedef void (*aes_write_regv_cb)(struct fp_img_dev *dev, int result,
 void aes_write_regv(struct fp_img_dev *dev, const struct aes_regwrite *regs,
 	unsigned int num_regs, aes_write_regv_cb callback, void *user_data);
 
-void aes_assemble_image(unsigned char *input, size_t width, size_t height,
-	unsigned char *output);
-
-struct fp_img *aes_assemble(GSList *stripes, size_t stripes_len,
-	unsigned int frame_width, unsigned int frame_height);
+struct fp_img *aes_assemble(struct fp_img_dev *dev, GSList *stripes,
+	size_t stripes_len, unsigned int frame_width, unsigned int frame_height);
 
 #endif
 
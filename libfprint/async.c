@@ -25,13 +25,35 @@
 
 #include "fp_internal.h"
 
+/* Account a result reported to the application against the operation that
+ * is in progress, and restart the clock for the next scan of that operation
+ * (e.g. the next enroll stage, or a retried verify scan). */
+static void stats_report_result(struct fp_dev *dev, enum fp_stats_stage stage,
+	int result)
+{
+	fpi_stats_add(dev, stage, dev->op_start);
+	if (result < 0)
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
+	else if (result >= FP_ENROLL_RETRY)
+		fpi_stats_inc(dev, FP_STATS_RETRIES);
+	else if (stage == FP_STATS_STAGE_VERIFY
+			|| stage == FP_STATS_STAGE_IDENTIFY)
+		fpi_stats_inc(dev, result == FP_VERIFY_MATCH
+			? FP_STATS_MATCHES : FP_STATS_NO_MATCHES);
+	dev->op_start = fpi_stats_start();
+}
+
 /* Drivers call this when device initialisation has completed */
 void fpi_drvcb_open_complete(struct fp_dev *dev, int status)
 {
 	fp_dbg("status %d", status);
 	BUG_ON(dev->state != DEV_STATE_INITIALIZING);
 	dev->state = (status) ? DEV_STATE_ERROR : DEV_STATE_INITIALIZED;
-	opened_devices = g_slist_prepend(opened_devices, dev);
+	if (status)
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
+	else
+		fpi_stats_add(dev, FP_STATS_STAGE_OPEN, dev->op_start);
+	dev->ctx->opened_devices = g_slist_prepend(dev->ctx->opened_devices, dev);
 	if (dev->open_cb)
 		dev->open_cb(dev, status, dev->open_cb_data);
 }
@@ -45,19 +67,26 @@ API_EXPORTED int fp_async_dev_open(struct fp_dscv_dev *ddev, fp_dev_open_cb cb,
 	int r;
 
 	fp_dbg("");
-	r = libusb_open(ddev->udev, &udevh);
-	if (r < 0) {
-		fp_err("usb_open failed, error %d", r);
-		return r;
+	if (fpi_usb_replaying()) {
+		udevh = NULL;
+	} else {
+		r = libusb_open(ddev->udev, &udevh);
+		if (r < 0) {
+			fp_err("usb_open failed, error %d", r);
+			return r;
+		}
 	}
 
 	dev = g_malloc0(sizeof(*dev));
+	dev->ctx = ddev->ctx;
 	dev->drv = drv;
 	dev->udev = udevh;
 	dev->__enroll_stage = -1;
 	dev->state = DEV_STATE_INITIALIZING;
 	dev->open_cb = cb;
 	dev->open_cb_data = user_data;
+	dev->op_start = fpi_stats_start();
+	fpi_usbtrace_dev_opened(dev, ddev);
 
 	if (!drv->open) {
 		fpi_drvcb_open_complete(dev, 0);
@@ -68,7 +97,11 @@ API_EXPORTED int fp_async_dev_open(struct fp_dscv_dev *ddev, fp_dev_open_cb cb,
 	r = drv->open(dev, ddev->driver_data);
 	if (r) {
 		fp_err("device initialisation failed, driver=%s", drv->name);
-		libusb_close(udevh);
+		fpi_stats_inc(NULL, FP_STATS_ERRORS);
+		fpi_usbtrace_dev_closed(dev);
+		fpi_usb_pool_exit(dev);
+		if (udevh)
+			libusb_close(udevh);
 		g_free(dev);
 	}
 
@@ -81,7 +114,10 @@ void fpi_drvcb_close_complete(struct fp_dev *dev)
 	fp_dbg("");
 	BUG_ON(dev->state != DEV_STATE_DEINITIALIZING);
 	dev->state = DEV_STATE_DEINITIALIZED;
-	libusb_close(dev->udev);
+	fpi_usbtrace_dev_closed(dev);
+	fpi_usb_pool_exit(dev);
+	if (dev->udev)
+		libusb_close(dev->udev);
 	if (dev->close_cb)
 		dev->close_cb(dev, dev->close_cb_data);
 	g_free(dev);
@@ -92,9 +128,10 @@ API_EXPORTED void fp_async_dev_close(struct fp_dev *dev,
 {
 	struct fp_driver *drv = dev->drv;
 
-	if (g_slist_index(opened_devices, (gconstpointer) dev) == -1)
+	if (g_slist_index(dev->ctx->opened_devices, (gconstpointer) dev) == -1)
 		fp_err("device %p not in opened list!", dev);
-	opened_devices = g_slist_remove(opened_devices, (gconstpointer) dev);
+	dev->ctx->opened_devices = g_slist_remove(dev->ctx->opened_devices,
+		(gconstpointer) dev);
 
 	dev->close_cb = callback;
 	dev->close_cb_data = user_data;
@@ -119,6 +156,7 @@ void fpi_drvcb_enroll_started(struct fp_dev *dev, int status)
 			fp_dbg("adjusted to %d", status);
 		}
 		dev->state = DEV_STATE_ERROR;
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
 		if (dev->enroll_stage_cb)
 			dev->enroll_stage_cb(dev, status, NULL, NULL,
 				dev->enroll_stage_cb_data);
@@ -142,6 +180,7 @@ API_EXPORTED int fp_async_enroll_start(struct fp_dev *dev,
 	fp_dbg("starting enrollment");
 	dev->enroll_stage_cb = callback;
 	dev->enroll_stage_cb_data = user_data;
+	dev->op_start = fpi_stats_start();
 
 	dev->state = DEV_STATE_ENROLL_STARTING;
 	r = drv->enroll_start(dev);
@@ -168,6 +207,7 @@ void fpi_drvcb_enroll_stage_completed(struct fp_dev *dev, int result,
 		fp_err("BUG: complete but no data?");
 		result = FP_ENROLL_FAIL;
 	}
+	stats_report_result(dev, FP_STATS_STAGE_ENROLL, result);
 	dev->enroll_stage_cb(dev, result, data, img, dev->enroll_stage_cb_data);
 }
 
@@ -224,6 +264,7 @@ API_EXPORTED int fp_async_verify_start(struct fp_dev *dev,
 	dev->verify_cb = callback;
 	dev->verify_cb_data = user_data;
 	dev->verify_data = data;
+	dev->op_start = fpi_stats_start();
 
 	r = drv->verify_start(dev);
 	if (r < 0) {
@@ -245,6 +286,7 @@ void fpi_drvcb_verify_started(struct fp_dev *dev, int status)
 			fp_dbg("adjusted to %d", status);
 		}
 		dev->state = DEV_STATE_ERROR;
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
 		if (dev->verify_cb)
 			dev->verify_cb(dev, status, NULL, dev->verify_cb_data);
 	} else {
@@ -261,6 +303,7 @@ void fpi_drvcb_report_verify_result(struct fp_dev *dev, int result,
 	if (result < 0 || result == FP_VERIFY_NO_MATCH
 			|| result == FP_VERIFY_MATCH)
 		dev->state = DEV_STATE_VERIFY_DONE;
+	stats_report_result(dev, FP_STATS_STAGE_VERIFY, result);
 
 	if (dev->verify_cb)
 		dev->verify_cb(dev, result, img, dev->verify_cb_data);
@@ -324,6 +367,7 @@ API_EXPORTED int fp_async_identify_start(struct fp_dev *dev,
 	dev->identify_cb = callback;
 	dev->identify_cb_data = user_data;
 	dev->identify_gallery = gallery;
+	dev->op_start = fpi_stats_start();
 
 	r = drv->identify_start(dev);
 	if (r < 0) {
@@ -345,6 +389,7 @@ void fpi_drvcb_identify_started(struct fp_dev *dev, int status)
 			fp_dbg("adjusted to %d", status);
 		}
 		dev->state = DEV_STATE_ERROR;
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
 		if (dev->identify_cb)
 			dev->identify_cb(dev, status, 0, NULL, dev->identify_cb_data);
 	} else {
@@ -362,6 +407,7 @@ void fpi_drvcb_report_identify_result(struct fp_dev *dev, int result,
 	if (result < 0 || result == FP_VERIFY_NO_MATCH
 			|| result == FP_VERIFY_MATCH)
 		dev->state = DEV_STATE_IDENTIFY_DONE;
+	stats_report_result(dev, FP_STATS_STAGE_IDENTIFY, result);
 
 	if (dev->identify_cb)
 		dev->identify_cb(dev, result, match_offset, img, dev->identify_cb_data);
@@ -426,6 +472,7 @@ API_EXPORTED int fp_async_capture_start(struct fp_dev *dev, int unconditional,
 	dev->capture_cb = callback;
 	dev->capture_cb_data = user_data;
 	dev->unconditional_capture = unconditional;
+	dev->op_start = fpi_stats_start();
 
 	r = drv->capture_start(dev);
 	if (r < 0) {
@@ -447,6 +494,7 @@ void fpi_drvcb_capture_started(struct fp_dev *dev, int status)
 			fp_dbg("adjusted to %d", status);
 		}
 		dev->state = DEV_STATE_ERROR;
+		fpi_stats_inc(dev, FP_STATS_ERRORS);
 		if (dev->capture_cb)
 			dev->capture_cb(dev, status, NULL, dev->capture_cb_data);
 	} else {
@@ -462,6 +510,7 @@ void fpi_drvcb_report_capture_result(struct fp_dev *dev, int result,
 	BUG_ON(dev->state != DEV_STATE_CAPTURING);
 	if (result < 0 || result == FP_CAPTURE_COMPLETE)
 		dev->state = DEV_STATE_CAPTURE_DONE;
+	stats_report_result(dev, FP_STATS_STAGE_CAPTURE, result);
 
 	if (dev->capture_cb)
 		dev->capture_cb(dev, result, img, dev->capture_cb_data);
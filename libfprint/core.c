@@ -30,8 +30,20 @@
 static int log_level = 0;
 static int log_level_fixed = 0;
 
-libusb_context *fpi_usb_ctx = NULL;
-GSList *opened_devices = NULL;
+struct fp_context *fpi_default_ctx = NULL;
+
+/* every context in existence, for fp_set_debug() */
+static GSList *contexts = NULL;
+static GMutex contexts_lock;
+
+/* The context that the calls without a context argument operate on. It only
+ * exists between fp_init() and fp_exit(). */
+struct fp_context *fpi_get_default_ctx(void)
+{
+	if (!fpi_default_ctx)
+		fp_err("libfprint is not initialized, call fp_init() first");
+	return fpi_default_ctx;
+}
 
 /**
  * \mainpage libfprint API Reference
@@ -156,6 +168,25 @@ GSList *opened_devices = NULL;
  * Alternative asynchronous/non-blocking functionality will be offered in
  * future but has not been implemented yet.
  *
+ * \section threads Contexts and threads
+ *
+ * All library state lives in a \ref core "context". fp_init() sets up a
+ * default context which is used by all functions that do not take a context
+ * parameter. Additional, independent contexts can be created with
+ * fp_context_new(); devices discovered through fp_context_discover_devs()
+ * belong to that context, and so does everything derived from them (opened
+ * devices, their timeouts and USB I/O).
+ *
+ * libfprint does not lock the contents of a context. A context, and any
+ * discovered device, device or print data obtained through it, must only be
+ * used by one thread at a time. Different contexts may be used from
+ * different threads at the same time, which allows operating several
+ * readers concurrently. fp_init() and fp_exit() must not be called while
+ * other contexts are in use.
+ *
+ * Images and print data that are not tied to a device may be used from any
+ * thread, as long as each object is only used by one thread at a time.
+ *
  * \section getting_started Getting started
  *
  * libfprint includes several simple functional examples under the examples/
@@ -175,7 +206,10 @@ GSList *opened_devices = NULL;
  * page).
  */
 
-/** @defgroup core Core library operations */
+/** @defgroup core Core library operations
+ * Library initialization, contexts and logging. See \ref threads for the
+ * rules on using libfprint from multiple threads.
+ */
 
 /**
  * @defgroup dev Device operations
@@ -251,6 +285,18 @@ GSList *opened_devices = NULL;
  * you can open it with fp_dev_open(). Note that discovered devices may no
  * longer be available at the time when you want to open them, for example
  * the user may have unplugged the device.
+ *
+ * \section hotplug Hotplug
+ * Rather than calling fp_discover_devs() over and over to notice readers
+ * being plugged in or out, applications can call fp_set_hotplug_notifiers()
+ * (or fp_context_set_hotplug_notifiers()) on systems where libusb supports
+ * hotplug events. libfprint then keeps a list of the readers present,
+ * updated as devices come and go, and calls your functions when that
+ * happens. Hotplug events are processed while
+ * \ref poll "handling events", so applications using hotplug need to run
+ * an event loop, and must only use the asynchronous functions from within
+ * the hotplug functions. fp_discover_devs() then simply returns the
+ * readers in the list without scanning the system.
  */
 
 /** @defgroup drv Driver operations
@@ -279,14 +325,26 @@ GSList *opened_devices = NULL;
  * circumstances, you don't have to worry about driver IDs at all.
  */
 
+/* built once per process and read-only afterwards, shared by all contexts */
 static GSList *registered_drivers = NULL;
+static GOnce drivers_once = G_ONCE_INIT;
+
+/* maps a USB (vendor, product) pair to the drivers claiming it, as a list of
+ * struct usb_id_match in the order find_supporting_driver() considers them */
+static GHashTable *usb_id_index = NULL;
+
+struct usb_id_match {
+	struct fp_driver *drv;
+	const struct usb_id *id;
+};
+
+#define USB_ID_KEY(vendor, product) \
+	GUINT_TO_POINTER(((guint) (vendor) << 16) | (product))
 
 void fpi_log(enum fpi_log_level level, const char *component,
 	const char *function, const char *format, ...)
 {
 	va_list args;
-	FILE *stream = stdout;
-	const char *prefix;
 
 #ifndef ENABLE_DEBUG_LOGGING
 	if (!log_level)
@@ -297,36 +355,9 @@ void fpi_log(enum fpi_log_level level, const char *component,
 		return;
 #endif
 
-	switch (level) {
-	case FPRINT_LOG_LEVEL_INFO:
-		prefix = "info";
-		break;
-	case FPRINT_LOG_LEVEL_WARNING:
-		stream = stderr;
-		prefix = "warning";
-		break;
-	case FPRINT_LOG_LEVEL_ERROR:
-		stream = stderr;
-		prefix = "error";
-		break;
-	case FPRINT_LOG_LEVEL_DEBUG:
-		stream = stderr;
-		prefix = "debug";
-		break;
-	default:
-		stream = stderr;
-		prefix = "unknown";
-		break;
-	}
-
-	fprintf(stream, "%s:%s [%s] ", component ? component : "fp", prefix,
-		function);
-
 	va_start (args, format);
-	vfprintf(stream, format, args);
+	fpi_log_write(level, component, function, format, args);
 	va_end (args);
-
-	fprintf(stream, "\n");
 }
 
 static void register_driver(struct fp_driver *drv)
@@ -404,7 +435,30 @@ static struct fp_img_driver * const img_drivers[] = {
 	*/
 };
 
-static void register_drivers(void)
+static void build_usb_id_index(void)
+{
+	GSList *elem;
+
+	usb_id_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (elem = registered_drivers; elem; elem = g_slist_next(elem)) {
+		struct fp_driver *drv = elem->data;
+		const struct usb_id *id;
+
+		for (id = drv->id_table; id->vendor; id++) {
+			gpointer key = USB_ID_KEY(id->vendor, id->product);
+			struct usb_id_match *match = g_malloc(sizeof(*match));
+			GSList *matches = g_hash_table_lookup(usb_id_index, key);
+
+			match->drv = drv;
+			match->id = id;
+			/* the lists are short, usually a single driver */
+			matches = g_slist_append(matches, match);
+			g_hash_table_insert(usb_id_index, key, matches);
+		}
+	}
+}
+
+static gpointer register_drivers(gpointer data)
 {
 	unsigned int i;
 
@@ -416,6 +470,9 @@ static void register_drivers(void)
 		fpi_img_driver_setup(imgdriver);
 		register_driver(&imgdriver->driver);
 	}
+
+	build_usb_id_index();
+	return NULL;
 }
 
 API_EXPORTED struct fp_driver **fprint_get_drivers (void)
@@ -440,11 +497,12 @@ static struct fp_driver *find_supporting_driver(libusb_device *udev,
 	const struct usb_id **usb_id, uint32_t *devtype)
 {
 	int ret;
-	GSList *elem = registered_drivers;
+	GSList *elem;
 	struct libusb_device_descriptor dsc;
 
 	const struct usb_id *best_usb_id;
 	struct fp_driver *best_drv;
+	struct fp_driver *claimed_drv = NULL;
 	uint32_t best_devtype;
 	int drv_score = 0;
 
@@ -457,39 +515,43 @@ static struct fp_driver *find_supporting_driver(libusb_device *udev,
 	best_drv = NULL;
 	best_devtype = 0;
 
-	do {
-		struct fp_driver *drv = elem->data;
+	elem = g_hash_table_lookup(usb_id_index,
+		USB_ID_KEY(dsc.idVendor, dsc.idProduct));
+	for (; elem; elem = g_slist_next(elem)) {
+		struct usb_id_match *match = elem->data;
+		struct fp_driver *drv = match->drv;
+		const struct usb_id *id = match->id;
 		uint32_t type = 0;
-		const struct usb_id *id;
 
-		for (id = drv->id_table; id->vendor; id++) {
-			if (dsc.idVendor == id->vendor && dsc.idProduct == id->product) {
-				if (drv->discover) {
-					int r = drv->discover(&dsc, &type);
-					if (r < 0)
-						fp_err("%s discover failed, code %d", drv->name, r);
-					if (r <= 0)
-						continue;
-					/* Has a discover function, and matched our device */
-					drv_score = 100;
-				} else {
-					/* Already got a driver as good */
-					if (drv_score >= 50)
-						continue;
-					drv_score = 50;
-				}
-				fp_dbg("driver %s supports USB device %04x:%04x",
-					drv->name, id->vendor, id->product);
-				best_usb_id = id;
-				best_drv = drv;
-				best_devtype = type;
-
-				/* We found the best possible driver */
-				if (drv_score == 100)
-					break;
-			}
+		/* the rest of the id_table of a driver which claimed the device
+		 * is not considered */
+		if (drv == claimed_drv)
+			continue;
+
+		if (drv->discover) {
+			int r = drv->discover(&dsc, &type);
+			if (r < 0)
+				fp_err("%s discover failed, code %d", drv->name, r);
+			if (r <= 0)
+				continue;
+			/* Has a discover function, and matched our device */
+			drv_score = 100;
+		} else {
+			/* Already got a driver as good */
+			if (drv_score >= 50)
+				continue;
+			drv_score = 50;
 		}
-	} while ((elem = g_slist_next(elem)));
+		fp_dbg("driver %s supports USB device %04x:%04x",
+			drv->name, id->vendor, id->product);
+		best_usb_id = id;
+		best_drv = drv;
+		best_devtype = type;
+
+		/* We found the best possible driver */
+		if (drv_score == 100)
+			claimed_drv = drv;
+	}
 
 	if (best_drv != NULL) {
 		fp_dbg("selected driver %s supports USB device %04x:%04x",
@@ -501,7 +563,8 @@ static struct fp_driver *find_supporting_driver(libusb_device *udev,
 	return best_drv;
 }
 
-static struct fp_dscv_dev *discover_dev(libusb_device *udev)
+static struct fp_dscv_dev *discover_dev(struct fp_context *ctx,
+	libusb_device *udev)
 {
 	const struct usb_id *usb_id;
 	struct fp_driver *drv;
@@ -514,20 +577,205 @@ static struct fp_dscv_dev *discover_dev(libusb_device *udev)
 		return NULL;
 
 	ddev = g_malloc0(sizeof(*ddev));
+	ddev->ctx = ctx;
 	ddev->drv = drv;
-	ddev->udev = udev;
+	ddev->udev = libusb_ref_device(udev);
 	ddev->driver_data = usb_id->driver_data;
 	ddev->devtype = devtype;
 	return ddev;
 }
 
+static void dscv_dev_free(struct fp_dscv_dev *ddev)
+{
+	if (ddev->udev)
+		libusb_unref_device(ddev->udev);
+	g_free(ddev);
+}
+
+static struct fp_dscv_dev *registry_find(struct fp_context *ctx,
+	libusb_device *udev)
+{
+	GSList *elem;
+
+	for (elem = ctx->dscv_devs; elem; elem = g_slist_next(elem)) {
+		struct fp_dscv_dev *ddev = elem->data;
+		if (ddev->udev == udev)
+			return ddev;
+	}
+	return NULL;
+}
+
+static int hotplug_cb(libusb_context *usb_ctx, libusb_device *udev,
+	libusb_hotplug_event event, void *user_data)
+{
+	struct fp_context *ctx = user_data;
+	struct fp_dscv_dev *ddev;
+
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+		if (registry_find(ctx, udev))
+			return 0;
+		ddev = discover_dev(ctx, udev);
+		if (!ddev)
+			return 0;
+
+		fp_dbg("%s device arrived", ddev->drv->name);
+		ctx->dscv_devs = g_slist_prepend(ctx->dscv_devs, ddev);
+		if (ctx->dscv_added_cb)
+			ctx->dscv_added_cb(ddev, ctx->hotplug_data);
+	} else if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+		ddev = registry_find(ctx, udev);
+		if (!ddev)
+			return 0;
+
+		fp_dbg("%s device left", ddev->drv->name);
+		ctx->dscv_devs = g_slist_remove(ctx->dscv_devs, ddev);
+		if (ctx->dscv_removed_cb)
+			ctx->dscv_removed_cb(ddev, ctx->hotplug_data);
+		dscv_dev_free(ddev);
+	}
+
+	/* stay registered */
+	return 0;
+}
+
+/* the devices in the registry, as a list owned by the caller */
+static struct fp_dscv_dev **registry_copy(struct fp_context *ctx)
+{
+	struct fp_dscv_dev **list;
+	GSList *elem;
+	int i = 0;
+
+	list = g_malloc(sizeof(*list) * (g_slist_length(ctx->dscv_devs) + 1));
+	for (elem = ctx->dscv_devs; elem; elem = g_slist_next(elem)) {
+		struct fp_dscv_dev *ddev = g_memdup(elem->data, sizeof(*ddev));
+		libusb_ref_device(ddev->udev);
+		list[i++] = ddev;
+	}
+	list[i] = NULL;
+	return list;
+}
+
 /** \ingroup dscv_dev
- * Scans the system and returns a list of discovered devices. This is your
- * entry point into finding a fingerprint reader to operate.
+ * Keep track of the fingerprint readers present in the system through USB
+ * hotplug events rather than by scanning, and get notified when readers
+ * are plugged in or out. See \ref hotplug.
+ *
+ * Once enabled, hotplug tracking stays active until the context is freed;
+ * calling this function again only changes the functions to call. When
+ * first enabled, the added function is called straight away for each
+ * reader already present.
+ *
+ * The discovered device passed to your functions belongs to libfprint. It
+ * can be opened any time until the removed function has returned, but must
+ * not be freed.
+ *
+ * Your functions are called from within libusb's event handling. From
+ * there, a reader may only be opened with fp_async_dev_open(): the
+ * synchronous functions, such as fp_dev_open(), handle events themselves
+ * and must not be called from the added or removed functions.
+ *
+ * \param ctx the context to track devices for
+ * \param added_cb function to call when a reader appears, or NULL
+ * \param removed_cb function to call when a reader disappears, or NULL
+ * \param user_data data to pass to both functions
+ * \returns 0 on success, -ENOTSUP if hotplug is not supported on this
+ * system, or another negative value on error
+ */
+API_EXPORTED int fp_context_set_hotplug_notifiers(struct fp_context *ctx,
+	fp_dscv_dev_added_cb added_cb, fp_dscv_dev_removed_cb removed_cb,
+	void *user_data)
+{
+	int r;
+
+	ctx->dscv_added_cb = added_cb;
+	ctx->dscv_removed_cb = removed_cb;
+	ctx->hotplug_data = user_data;
+	if (ctx->hotplug_active)
+		return 0;
+
+	if (fpi_usb_replaying() || !libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+		return -ENOTSUP;
+
+	/* the index holds every USB id that any driver supports, but libusb
+	 * only filters on a single vendor/product, so take all devices */
+	r = libusb_hotplug_register_callback(ctx->usb_ctx,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+		LIBUSB_HOTPLUG_ENUMERATE, LIBUSB_HOTPLUG_MATCH_ANY,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplug_cb, ctx,
+		&ctx->hotplug_handle);
+	if (r < 0) {
+		fp_err("couldn't register hotplug callback, error %d", r);
+		return r;
+	}
+
+	ctx->hotplug_active = 1;
+	return 0;
+}
+
+/** \ingroup dscv_dev
+ * Keep track of the fingerprint readers present in the system through USB
+ * hotplug events, see fp_context_set_hotplug_notifiers().
+ * \param added_cb function to call when a reader appears, or NULL
+ * \param removed_cb function to call when a reader disappears, or NULL
+ * \param user_data data to pass to both functions
+ * \returns 0 on success, -ENOTSUP if hotplug is not supported on this
+ * system, or another negative value on error
+ */
+API_EXPORTED int fp_set_hotplug_notifiers(fp_dscv_dev_added_cb added_cb,
+	fp_dscv_dev_removed_cb removed_cb, void *user_data)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return -EINVAL;
+	return fp_context_set_hotplug_notifiers(ctx, added_cb, removed_cb,
+		user_data);
+}
+
+/* when replaying a USB trace, the only device present is the one that was
+ * recorded. it has no libusb device behind it. */
+static struct fp_dscv_dev **discover_replay_dev(struct fp_context *ctx)
+{
+	struct fp_dscv_dev **list = g_malloc0(sizeof(*list) * 2);
+	struct fp_dscv_dev *ddev;
+	GSList *elem;
+	uint16_t driver_id;
+	uint32_t devtype;
+	unsigned long driver_data;
+
+	if (fpi_usb_replay_get_device(&driver_id, &devtype, &driver_data) < 0)
+		return list;
+
+	for (elem = registered_drivers; elem; elem = g_slist_next(elem)) {
+		struct fp_driver *drv = elem->data;
+		if (drv->id != driver_id)
+			continue;
+
+		fp_dbg("replaying trace for driver %s", drv->name);
+		ddev = g_malloc0(sizeof(*ddev));
+		ddev->ctx = ctx;
+		ddev->drv = drv;
+		ddev->driver_data = driver_data;
+		ddev->devtype = devtype;
+		list[0] = ddev;
+		return list;
+	}
+
+	fp_err("no driver with ID %d for replayed trace", driver_id);
+	return list;
+}
+
+/** \ingroup dscv_dev
+ * Scans the system and returns a list of discovered devices which will be
+ * operated through the given context. If \ref hotplug "hotplug" tracking
+ * is enabled for the context, the readers it knows about are returned
+ * without scanning.
+ * \param ctx the context to discover devices for
  * \returns a NULL-terminated list of discovered devices. Must be freed with
  * fp_dscv_devs_free() after use.
  */
-API_EXPORTED struct fp_dscv_dev **fp_discover_devs(void)
+API_EXPORTED struct fp_dscv_dev **fp_context_discover_devs(
+	struct fp_context *ctx)
 {
 	GSList *tmplist = NULL;
 	struct fp_dscv_dev **list;
@@ -540,24 +788,29 @@ API_EXPORTED struct fp_dscv_dev **fp_discover_devs(void)
 	if (registered_drivers == NULL)
 		return NULL;
 
-	r = libusb_get_device_list(fpi_usb_ctx, &devs);
+	if (fpi_usb_replaying())
+		return discover_replay_dev(ctx);
+
+	if (ctx->hotplug_active)
+		return registry_copy(ctx);
+
+	r = libusb_get_device_list(ctx->usb_ctx, &devs);
 	if (r < 0) {
 		fp_err("couldn't enumerate USB devices, error %d", r);
 		return NULL;
 	}
 
-	/* Check each device against each driver, temporarily storing successfully
-	 * discovered devices in a GSList.
-	 *
-	 * Quite inefficient but excusable as we'll only be dealing with small
-	 * sets of drivers against small sets of USB devices */
+	/* Check each device against the drivers supporting its USB id,
+	 * temporarily storing successfully discovered devices in a GSList. */
 	while ((udev = devs[i++]) != NULL) {
-		struct fp_dscv_dev *ddev = discover_dev(udev);
+		struct fp_dscv_dev *ddev = discover_dev(ctx, udev);
 		if (!ddev)
 			continue;
 		tmplist = g_slist_prepend(tmplist, (gpointer) ddev);
 		dscv_count++;
 	}
+	/* discovered devices hold their own reference */
+	libusb_free_device_list(devs, 1);
 
 	/* Convert our temporary GSList into a standard NULL-terminated pointer
 	 * array. */
@@ -575,6 +828,21 @@ API_EXPORTED struct fp_dscv_dev **fp_discover_devs(void)
 	return list;
 }
 
+/** \ingroup dscv_dev
+ * Scans the system and returns a list of discovered devices. This is your
+ * entry point into finding a fingerprint reader to operate.
+ * \returns a NULL-terminated list of discovered devices. Must be freed with
+ * fp_dscv_devs_free() after use.
+ */
+API_EXPORTED struct fp_dscv_dev **fp_discover_devs(void)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return NULL;
+	return fp_context_discover_devs(ctx);
+}
+
 /** \ingroup dscv_dev
  * Free a list of discovered devices. This function destroys the list and all
  * discovered devices that it included, so make sure you have opened your
@@ -589,7 +857,7 @@ API_EXPORTED void fp_dscv_devs_free(struct fp_dscv_dev **devs)
 		return;
 
 	for (i = 0; devs[i]; i++)
-		g_free(devs[i]);
+		dscv_dev_free(devs[i]);
 	g_free(devs);
 }
 
@@ -868,6 +1136,41 @@ API_EXPORTED int fp_dev_get_img_height(struct fp_dev *dev)
 	return fpi_imgdev_get_img_height(imgdev);
 }
 
+/** \ingroup dev
+ * Keeps an \ref imaging "imaging device" activated between operations.
+ * Normally the sensor is initialized, and armed to detect a finger, at the
+ * start of every enrollment, verification, identification or capture, and
+ * shut down again at its end. In a warm session the sensor stays armed once
+ * an operation has stopped, so that the next operation can start right
+ * away. This helps where operations follow each other closely, such as
+ * repeated verification at an entry point.
+ *
+ * The sensor is shut down once no operation has been started for
+ * idle_timeout milliseconds, or when the device is closed. Like other
+ * timeouts, the idle timeout is handled as part of libfprint's event
+ * handling.
+ *
+ * Warm sessions are off by default, as a sensor that is kept armed may draw
+ * more power, and some keep their lights on meanwhile.
+ *
+ * \param dev the device
+ * \param idle_timeout the time to keep the sensor armed for without an
+ * operation, in milliseconds, or 0 to turn warm sessions off
+ * \returns 0 on success, or -ENOTSUP for non-imaging devices
+ */
+API_EXPORTED int fp_dev_set_warm_session(struct fp_dev *dev,
+	unsigned int idle_timeout)
+{
+	struct fp_img_dev *imgdev = dev_to_img_dev(dev);
+	if (!imgdev) {
+		fp_dbg("warm session for non-imaging device");
+		return -ENOTSUP;
+	}
+
+	fpi_imgdev_set_warm_timeout(imgdev, idle_timeout);
+	return 0;
+}
+
 /** \ingroup core
  * Set message verbosity.
  *  - Level 0: no messages ever printed by the library (default)
@@ -894,16 +1197,121 @@ API_EXPORTED int fp_dev_get_img_height(struct fp_dev *dev)
  * If libfprint was compiled with verbose debug message logging, this function
  * does nothing: you'll always get messages from all levels.
  *
- * \param ctx the context to operate on, or NULL for the default context
+ * If libfprint was configured with --enable-nbis-log, the minutiae detection
+ * code also logs its intermediate results as debug messages, under the name
+ * of the NBIS source file they come from. Set the LIBFPRINT_NBIS_LOG
+ * environment variable to a comma separated list of such names (for example
+ * "remove,ridges") to only get messages from those.
+ *
+ * The level applies to the whole process, and to the USB debug level of all
+ * contexts, including those created afterwards.
+ *
  * \param level debug level to set
  */
 API_EXPORTED void fp_set_debug(int level)
 {
+	GSList *elem;
+
 	if (log_level_fixed)
 		return;
 
+	g_mutex_lock(&contexts_lock);
 	log_level = level;
-	libusb_set_debug(fpi_usb_ctx, level);
+	for (elem = contexts; elem; elem = g_slist_next(elem)) {
+		struct fp_context *ctx = elem->data;
+		libusb_set_debug(ctx->usb_ctx, level);
+	}
+	g_mutex_unlock(&contexts_lock);
+}
+
+static int context_init(struct fp_context *ctx)
+{
+	int r;
+
+	r = libusb_init(&ctx->usb_ctx);
+	if (r < 0)
+		return r;
+
+	g_mutex_lock(&contexts_lock);
+	if (log_level)
+		libusb_set_debug(ctx->usb_ctx, log_level);
+	contexts = g_slist_prepend(contexts, ctx);
+	g_mutex_unlock(&contexts_lock);
+
+	g_once(&drivers_once, register_drivers, NULL);
+	fpi_poll_init(ctx);
+	return 0;
+}
+
+static void context_exit(struct fp_context *ctx)
+{
+	if (ctx->hotplug_active) {
+		libusb_hotplug_deregister_callback(ctx->usb_ctx, ctx->hotplug_handle);
+		g_slist_free_full(ctx->dscv_devs, (GDestroyNotify) dscv_dev_free);
+		ctx->dscv_devs = NULL;
+		ctx->hotplug_active = 0;
+	}
+
+	if (ctx->opened_devices) {
+		GSList *copy = g_slist_copy(ctx->opened_devices);
+		GSList *elem = copy;
+		fp_dbg("naughty app left devices open on exit!");
+
+		do
+			fp_dev_close((struct fp_dev *) elem->data);
+		while ((elem = g_slist_next(elem)));
+
+		g_slist_free(copy);
+		g_slist_free(ctx->opened_devices);
+		ctx->opened_devices = NULL;
+	}
+
+	fpi_data_exit(ctx);
+	fpi_poll_exit(ctx);
+
+	g_mutex_lock(&contexts_lock);
+	contexts = g_slist_remove(contexts, ctx);
+	g_mutex_unlock(&contexts_lock);
+	libusb_exit(ctx->usb_ctx);
+}
+
+/** \ingroup core
+ * Create a new library context, independent from the default context and
+ * any other context. Devices discovered through the new context can be
+ * operated from a different thread than devices of other contexts, see
+ * \ref threads.
+ *
+ * fp_init() must have been called before creating contexts.
+ *
+ * \returns a new context, or NULL on error. Must be freed with
+ * fp_context_free() after use.
+ */
+API_EXPORTED struct fp_context *fp_context_new(void)
+{
+	struct fp_context *ctx = g_malloc0(sizeof(*ctx));
+
+	fp_dbg("");
+	if (context_init(ctx) < 0) {
+		g_free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/** \ingroup core
+ * Free a context created with fp_context_new(). Devices of the context that
+ * are still open are closed. Nothing obtained through the context may be
+ * used afterwards.
+ * \param ctx the context to free. If NULL, function simply returns.
+ */
+API_EXPORTED void fp_context_free(struct fp_context *ctx)
+{
+	if (!ctx)
+		return;
+
+	fp_dbg("");
+	context_exit(ctx);
+	g_free(ctx);
 }
 
 /** \ingroup core
@@ -914,23 +1322,26 @@ API_EXPORTED void fp_set_debug(int level)
 API_EXPORTED int fp_init(void)
 {
 	char *dbg = getenv("LIBFPRINT_DEBUG");
+	struct fp_context *ctx;
 	int r;
 	fp_dbg("");
 
-	r = libusb_init(&fpi_usb_ctx);
-	if (r < 0)
-		return r;
-
 	if (dbg) {
 		log_level = atoi(dbg);
-		if (log_level) {
+		if (log_level)
 			log_level_fixed = 1;
-			libusb_set_debug(fpi_usb_ctx, log_level);
-		}
 	}
 
-	register_drivers();
-	fpi_poll_init();
+	ctx = g_malloc0(sizeof(*ctx));
+	r = context_init(ctx);
+	if (r < 0) {
+		g_free(ctx);
+		return r;
+	}
+	fpi_default_ctx = ctx;
+
+	fpi_usbtrace_init();
+	fpi_stats_init();
 	return 0;
 }
 
@@ -943,24 +1354,14 @@ API_EXPORTED void fp_exit(void)
 {
 	fp_dbg("");
 
-	if (opened_devices) {
-		GSList *copy = g_slist_copy(opened_devices);
-		GSList *elem = copy;
-		fp_dbg("naughty app left devices open on exit!");
-
-		do
-			fp_dev_close((struct fp_dev *) elem->data);
-		while ((elem = g_slist_next(elem)));
+	if (!fpi_default_ctx)
+		return;
 
-		g_slist_free(copy);
-		g_slist_free(opened_devices);
-		opened_devices = NULL;
-	}
+	context_exit(fpi_default_ctx);
+	g_free(fpi_default_ctx);
+	fpi_default_ctx = NULL;
 
-	fpi_data_exit();
-	fpi_poll_exit();
-	g_slist_free(registered_drivers);
-	registered_drivers = NULL;
-	libusb_exit(fpi_usb_ctx);
+	fpi_usbtrace_exit();
+	fpi_log_exit();
 }
 
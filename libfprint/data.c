@@ -47,9 +47,7 @@
  * in any fashion that suits you.
  */
 
-static char *base_store = NULL;
-
-static void storage_setup(void)
+static void storage_setup(struct fp_context *ctx)
 {
 	const char *homedir;
 
@@ -59,14 +57,239 @@ static void storage_setup(void)
 	if (!homedir)
 		return;
 
-	base_store = g_build_filename(homedir, ".fprint/prints", NULL);
-	g_mkdir_with_parents(base_store, DIR_PERMS);
+	ctx->base_store = g_build_filename(homedir, ".fprint/prints", NULL);
+	g_mkdir_with_parents(ctx->base_store, DIR_PERMS);
 	/* FIXME handle failure */
 }
 
-void fpi_data_exit(void)
+/* the directory prints of a context are stored in, set up on first use */
+static const char *get_base_store(struct fp_context *ctx)
+{
+	if (!ctx->base_store)
+		storage_setup(ctx);
+	return ctx->base_store;
+}
+
+void fpi_data_exit(struct fp_context *ctx)
+{
+	g_free(ctx->base_store);
+	ctx->base_store = NULL;
+}
+
+/** \ingroup print_data
+ * Change the directory that prints are saved to and loaded from for a
+ * context. By default, prints are kept in a hidden directory beneath the
+ * current user's home directory.
+ * \param ctx the context to change the storage directory of
+ * \param path the directory to use. It is created if it does not exist.
+ * \returns 0 on success, negative on error
+ */
+API_EXPORTED int fp_context_set_storage_dir(struct fp_context *ctx,
+	const char *path)
 {
-	g_free(base_store);
+	int r;
+
+	r = g_mkdir_with_parents(path, DIR_PERMS);
+	if (r < 0) {
+		fp_err("couldn't create storage directory %s", path);
+		return -errno;
+	}
+
+	g_free(ctx->base_store);
+	ctx->base_store = g_strdup(path);
+	return 0;
+}
+
+/* Sensor calibration cache
+ *
+ * Some sensors need a lengthy tuning procedure (many frame captures) before
+ * they can be used, and the results only depend on the individual sensor.
+ * Drivers can keep such results on disk so that later sessions can skip the
+ * tuning. Entries live in a "calibration" subdirectory of the print store
+ * (which print discovery ignores), keyed by driver, devtype and the USB
+ * serial number of the device, and each entry carries a driver-defined
+ * format version and a checksum of its contents. */
+
+#define CALIB_DIR		"calibration"
+#define CALIB_SERIAL_MAX	64
+
+struct fpi_calib_header {
+	char magic[4];	/* "FPC1" */
+	uint16_t driver_id;
+	uint32_t devtype;
+	uint16_t version;
+	uint32_t length;
+	uint32_t checksum;
+	unsigned char data[0];
+} __attribute__((__packed__));
+
+/* FNV-1a */
+static uint32_t calib_checksum(const unsigned char *data, size_t length)
+{
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/* Identify the physical sensor by its USB serial number. Devices without
+ * one fall back to their position on the bus, which is good enough to
+ * tell apart several sensors plugged into the same machine. */
+static char *get_calib_key(struct fp_dev *dev)
+{
+	libusb_device *udev = libusb_get_device(dev->udev);
+	struct libusb_device_descriptor desc;
+	unsigned char serial[CALIB_SERIAL_MAX];
+	char *key;
+	char *c;
+	int r;
+
+	r = libusb_get_device_descriptor(udev, &desc);
+	if (r == 0 && desc.iSerialNumber) {
+		r = libusb_get_string_descriptor_ascii(dev->udev,
+			desc.iSerialNumber, serial, sizeof(serial));
+		if (r > 0) {
+			key = g_strndup((char *) serial, r);
+			/* the key becomes a file name */
+			for (c = key; *c; c++)
+				if (!g_ascii_isalnum(*c) && *c != '-' && *c != '_')
+					*c = '_';
+			return key;
+		}
+	}
+
+	return g_strdup_printf("nosn-%03d-%03d", libusb_get_bus_number(udev),
+		libusb_get_device_address(udev));
+}
+
+static char *get_path_to_calib(struct fp_dev *dev)
+{
+	char idstr[5];
+	char devtypestr[9];
+	char *key;
+	char *path;
+
+	g_snprintf(idstr, sizeof(idstr), "%04x", dev->drv->id);
+	g_snprintf(devtypestr, sizeof(devtypestr), "%08x", dev->devtype);
+	key = get_calib_key(dev);
+	path = g_build_filename(get_base_store(dev->ctx), CALIB_DIR, idstr,
+		devtypestr, key, NULL);
+	g_free(key);
+	return path;
+}
+
+/* Load the calibration data previously saved for this device. Returns 0
+ * and fills in data only if an entry exists which was saved with the same
+ * version and length, and whose contents are intact. Drivers should still
+ * sanity-check the values they get back. */
+int fpi_calib_load(struct fp_dev *dev, uint16_t version, void *data,
+	size_t length)
+{
+	struct fpi_calib_header *hdr;
+	gchar *contents;
+	gsize contents_len;
+	char *path;
+	int r = -ENOENT;
+
+	/* a replayed session has no real sensor behind it */
+	if (fpi_usb_replaying() || !get_base_store(dev->ctx))
+		return -ENOENT;
+
+	path = get_path_to_calib(dev);
+	if (!g_file_get_contents(path, &contents, &contents_len, NULL)) {
+		fp_dbg("no calibration data at %s", path);
+		g_free(path);
+		return -ENOENT;
+	}
+
+	hdr = (struct fpi_calib_header *) contents;
+	if (contents_len != sizeof(*hdr) + length
+			|| strncmp(hdr->magic, "FPC1", 4) != 0
+			|| GUINT16_FROM_LE(hdr->driver_id) != dev->drv->id
+			|| GUINT32_FROM_LE(hdr->devtype) != dev->devtype
+			|| GUINT32_FROM_LE(hdr->length) != length) {
+		fp_dbg("%s: bad calibration data", path);
+	} else if (GUINT16_FROM_LE(hdr->version) != version) {
+		fp_dbg("%s: calibration version %d, want %d", path,
+			GUINT16_FROM_LE(hdr->version), version);
+	} else if (GUINT32_FROM_LE(hdr->checksum)
+			!= calib_checksum(hdr->data, length)) {
+		fp_dbg("%s: calibration checksum mismatch", path);
+	} else {
+		fp_dbg("loaded calibration data from %s", path);
+		memcpy(data, hdr->data, length);
+		r = 0;
+	}
+
+	g_free(contents);
+	g_free(path);
+	return r;
+}
+
+/* Save calibration data for this device, replacing any previous entry.
+ * The cache is only an optimization, so callers may ignore failures. */
+int fpi_calib_save(struct fp_dev *dev, uint16_t version, const void *data,
+	size_t length)
+{
+	struct fpi_calib_header *hdr;
+	GError *err = NULL;
+	char *path;
+	char *dirpath;
+	size_t buflen = sizeof(*hdr) + length;
+	int r = 0;
+
+	if (fpi_usb_replaying() || !get_base_store(dev->ctx))
+		return -ENOENT;
+
+	hdr = g_malloc(buflen);
+	memcpy(hdr->magic, "FPC1", 4);
+	hdr->driver_id = GUINT16_TO_LE(dev->drv->id);
+	hdr->devtype = GUINT32_TO_LE(dev->devtype);
+	hdr->version = GUINT16_TO_LE(version);
+	hdr->length = GUINT32_TO_LE(length);
+	memcpy(hdr->data, data, length);
+	hdr->checksum = GUINT32_TO_LE(calib_checksum(hdr->data, length));
+
+	path = get_path_to_calib(dev);
+	dirpath = g_path_get_dirname(path);
+	if (g_mkdir_with_parents(dirpath, DIR_PERMS) < 0) {
+		fp_err("couldn't create calibration directory %s", dirpath);
+		r = -errno;
+		goto out;
+	}
+
+	fp_dbg("saving calibration data to %s", path);
+	g_file_set_contents(path, (gchar *) hdr, buflen, &err);
+	if (err) {
+		fp_err("calibration save failed: %s", err->message);
+		g_error_free(err);
+		r = -EIO;
+	}
+
+out:
+	g_free(dirpath);
+	g_free(path);
+	g_free(hdr);
+	return r;
+}
+
+/* Drop the calibration data for this device, e.g. because it turned out not
+ * to work with the sensor any more. */
+void fpi_calib_invalidate(struct fp_dev *dev)
+{
+	char *path;
+
+	if (fpi_usb_replaying() || !get_base_store(dev->ctx))
+		return;
+
+	path = get_path_to_calib(dev);
+	fp_dbg("removing calibration data %s", path);
+	g_unlink(path);
+	g_free(path);
 }
 
 #define FP_FINGER_IS_VALID(finger) \
@@ -274,7 +497,8 @@ API_EXPORTED struct fp_print_data *fp_print_data_from_data(unsigned char *buf,
 	return NULL;
 }
 
-static char *get_path_to_storedir(uint16_t driver_id, uint32_t devtype)
+static char *get_path_to_storedir(struct fp_context *ctx, uint16_t driver_id,
+	uint32_t devtype)
 {
 	char idstr[5];
 	char devtypestr[9];
@@ -282,11 +506,11 @@ static char *get_path_to_storedir(uint16_t driver_id, uint32_t devtype)
 	g_snprintf(idstr, sizeof(idstr), "%04x", driver_id);
 	g_snprintf(devtypestr, sizeof(devtypestr), "%08x", devtype);
 
-	return g_build_filename(base_store, idstr, devtypestr, NULL);
+	return g_build_filename(get_base_store(ctx), idstr, devtypestr, NULL);
 }
 
-static char *__get_path_to_print(uint16_t driver_id, uint32_t devtype,
-	enum fp_finger finger)
+static char *__get_path_to_print(struct fp_context *ctx, uint16_t driver_id,
+	uint32_t devtype, enum fp_finger finger)
 {
 	char *dirpath;
 	char *path;
@@ -294,7 +518,7 @@ static char *__get_path_to_print(uint16_t driver_id, uint32_t devtype,
 
 	g_snprintf(fingername, 2, "%x", finger);
 
-	dirpath = get_path_to_storedir(driver_id, devtype);
+	dirpath = get_path_to_storedir(ctx, driver_id, devtype);
 	path = g_build_filename(dirpath, fingername, NULL);
 	g_free(dirpath);
 	return path;
@@ -302,7 +526,7 @@ static char *__get_path_to_print(uint16_t driver_id, uint32_t devtype,
 
 static char *get_path_to_print(struct fp_dev *dev, enum fp_finger finger)
 {
-	return __get_path_to_print(dev->drv->id, dev->devtype, finger);
+	return __get_path_to_print(dev->ctx, dev->drv->id, dev->devtype, finger);
 }
 
 /** \ingroup print_data
@@ -314,32 +538,31 @@ static char *get_path_to_print(struct fp_dev *dev, enum fp_finger finger)
  * one will be automatically selected.
  *
  * This function will unconditionally overwrite a fingerprint previously
- * saved for the same finger and device type. The print is saved in a hidden
- * directory beneath the current user's home directory.
+ * saved for the same finger and device type. The print is saved in the
+ * \ref fp_context_set_storage_dir "storage directory" of the context.
+ * \param ctx the context to save the print for
  * \param data the stored print to save to disk
  * \param finger the finger that this print corresponds to
  * \returns 0 on success, non-zero on error.
  */
-API_EXPORTED int fp_print_data_save(struct fp_print_data *data,
-	enum fp_finger finger)
+API_EXPORTED int fp_context_print_data_save(struct fp_context *ctx,
+	struct fp_print_data *data, enum fp_finger finger)
 {
 	GError *err = NULL;
 	char *path;
 	char *dirpath;
 	unsigned char *buf;
 	size_t len;
+	gint64 start = fpi_stats_start();
 	int r;
 
-	if (!base_store)
-		storage_setup();
-
 	fp_dbg("save %s print from driver %04x", finger_num_to_str(finger),
 		data->driver_id);
 	len = fp_print_data_get_data(data, &buf);
 	if (!len)
 		return -ENOMEM;
 
-	path = __get_path_to_print(data->driver_id, data->devtype, finger);
+	path = __get_path_to_print(ctx, data->driver_id, data->devtype, finger);
 	dirpath = g_path_get_dirname(path);
 	r = g_mkdir_with_parents(dirpath, DIR_PERMS);
 	if (r < 0) {
@@ -362,9 +585,36 @@ API_EXPORTED int fp_print_data_save(struct fp_print_data *data,
 		return r;
 	}
 
+	fpi_stats_add(NULL, FP_STATS_STAGE_STORAGE_SAVE, start);
 	return 0;
 }
 
+/** \ingroup print_data
+ * Saves a stored print to disk, assigned to a specific finger. Even though
+ * you are limited to storing only the 10 human fingers, this is a
+ * per-device-type limit. For example, you can store the users right index
+ * finger from a DigitalPersona scanner, and you can also save the right index
+ * finger from a UPEK scanner. When you later come to load the print, the right
+ * one will be automatically selected.
+ *
+ * This function will unconditionally overwrite a fingerprint previously
+ * saved for the same finger and device type. The print is saved in a hidden
+ * directory beneath the current user's home directory, unless the storage
+ * directory of the default context was changed.
+ * \param data the stored print to save to disk
+ * \param finger the finger that this print corresponds to
+ * \returns 0 on success, non-zero on error.
+ */
+API_EXPORTED int fp_print_data_save(struct fp_print_data *data,
+	enum fp_finger finger)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return -EINVAL;
+	return fp_context_print_data_save(ctx, data, finger);
+}
+
 gboolean fpi_print_data_compatible(uint16_t driver_id1, uint32_t devtype1,
 	enum fp_print_data_type type1, uint16_t driver_id2, uint32_t devtype2,
 	enum fp_print_data_type type2)
@@ -434,16 +684,15 @@ API_EXPORTED int fp_print_data_load(struct fp_dev *dev,
 {
 	gchar *path;
 	struct fp_print_data *fdata;
+	gint64 start = fpi_stats_start();
 	int r;
 
-	if (!base_store)
-		storage_setup();
-
 	path = get_path_to_print(dev, finger);
 	r = load_from_file(path, &fdata);
 	g_free(path);
 	if (r)
 		return r;
+	fpi_stats_add(dev, FP_STATS_STAGE_STORAGE_LOAD, start);
 
 	if (!fp_dev_supports_print_data(dev, fdata)) {
 		fp_err("print data is not compatible!");
@@ -644,13 +893,16 @@ static GSList *scan_driver_store_dir(char *drvpath, uint16_t driver_id,
 }
 
 /** \ingroup dscv_print
- * Scans the users home directory and returns a list of prints that were
- * previously saved using fp_print_data_save().
+ * Scans the storage directory of a context and returns a list of prints that
+ * were previously saved using fp_context_print_data_save().
+ * \param ctx the context to discover prints for
  * \returns a NULL-terminated list of discovered prints, must be freed with
  * fp_dscv_prints_free() after use.
  */
-API_EXPORTED struct fp_dscv_print **fp_discover_prints(void)
+API_EXPORTED struct fp_dscv_print **fp_context_discover_prints(
+	struct fp_context *ctx)
 {
+	const char *base_store = get_base_store(ctx);
 	GDir *dir;
 	const gchar *ent;
 	GError *err = NULL;
@@ -660,9 +912,6 @@ API_EXPORTED struct fp_dscv_print **fp_discover_prints(void)
 	struct fp_dscv_print **list;
 	unsigned int i;
 
-	if (!base_store)
-		storage_setup();
-
 	dir = g_dir_open(base_store, 0, &err);
 	if (!dir) {
 		fp_err("opendir %s failed: %s", base_store, err->message);
@@ -704,6 +953,21 @@ API_EXPORTED struct fp_dscv_print **fp_discover_prints(void)
 	return list;
 }
 
+/** \ingroup dscv_print
+ * Scans the users home directory and returns a list of prints that were
+ * previously saved using fp_print_data_save().
+ * \returns a NULL-terminated list of discovered prints, must be freed with
+ * fp_dscv_prints_free() after use.
+ */
+API_EXPORTED struct fp_dscv_print **fp_discover_prints(void)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return NULL;
+	return fp_context_discover_prints(ctx);
+}
+
 /** \ingroup dscv_print
  * Frees a list of discovered prints. This function also frees the discovered
  * prints themselves, so make sure you do not use any discovered prints
@@ -101,16 +101,16 @@ static void stub_capture_stop_cb(struct fp_img_dev *dev, int result, void *user_
 static void generic_ignore_data_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
+	int status = transfer->status;
+	int short_read = transfer->length != transfer->actual_length;
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+	fpi_usb_free_transfer(ssm->dev, transfer);
+	if (status != LIBUSB_TRANSFER_COMPLETED)
 		fpi_ssm_mark_aborted(ssm, -EIO);
-	else if (transfer->length != transfer->actual_length)
+	else if (short_read)
 		fpi_ssm_mark_aborted(ssm, -EPROTO);
 	else
 		fpi_ssm_next_state(ssm);
-
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
 }
 
 static void generic_write_regv_cb(struct fp_img_dev *dev, int result,
@@ -127,23 +127,23 @@ static void generic_write_regv_cb(struct fp_img_dev *dev, int result,
  * away, then increment the SSM */
 static void generic_read_ignore_data(struct fpi_ssm *ssm, size_t bytes)
 {
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(ssm->dev, bytes);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(bytes);
+	data = transfer->buffer;
 	libusb_fill_bulk_transfer(transfer, ssm->dev->udev, EP_IN, data, bytes,
 		generic_ignore_data_cb, ssm, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(ssm->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -208,8 +208,7 @@ static void finger_det_data_cb(struct libusb_transfer *transfer)
 	}
 
 out:
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void finger_det_reqs_cb(struct fp_img_dev *dev, int result, void *user_data)
@@ -223,20 +222,19 @@ static void finger_det_reqs_cb(struct fp_img_dev *dev, int result, void *user_da
 		return;
 	}
 
-	transfer = libusb_alloc_transfer(0);
+	transfer = fpi_usb_alloc_transfer(dev->dev, 19);
 	if (!transfer) {
 		fpi_imgdev_session_error(dev, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(19);
+	data = transfer->buffer;
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, 19,
 		finger_det_data_cb, dev, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		fpi_imgdev_session_error(dev, r);
 	}
 
@@ -614,7 +612,7 @@ static void capture_read_strip_cb(struct libusb_transfer *transfer)
 		/* send stop capture bits */
 		aes_write_regv(dev, capture_stop, G_N_ELEMENTS(capture_stop), stub_capture_stop_cb, NULL);
 		aesdev->strips = g_slist_reverse(aesdev->strips);
-		img = aes_assemble(aesdev->strips, aesdev->strips_len,
+		img = aes_assemble(dev, aesdev->strips, aesdev->strips_len,
 			FRAME_WIDTH, FRAME_HEIGHT);
 		g_slist_free_full(aesdev->strips, g_free);
 		aesdev->strips = NULL;
@@ -632,8 +630,7 @@ static void capture_read_strip_cb(struct libusb_transfer *transfer)
 	}
 
 out:
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void capture_run_state(struct fpi_ssm *ssm)
@@ -661,22 +658,22 @@ static void capture_run_state(struct fpi_ssm *ssm)
 				generic_write_regv_cb, ssm);
 		break;
 	case CAPTURE_READ_STRIP: ;
-		struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+		struct libusb_transfer *transfer;
 		unsigned char *data;
 
+		transfer = fpi_usb_alloc_transfer(dev->dev, 665);
 		if (!transfer) {
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
 			break;
 		}
 
-		data = g_malloc(665);
+		data = transfer->buffer;
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, 665,
 			capture_read_strip_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
-			g_free(data);
-			libusb_free_transfer(transfer);
+			fpi_usb_free_transfer(dev->dev, transfer);
 			fpi_ssm_mark_aborted(ssm, r);
 		}
 		break;
@@ -796,7 +793,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	/* FIXME check endpoints */
 	int r;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -810,7 +807,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
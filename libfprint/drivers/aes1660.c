@@ -41,7 +41,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 	struct aesX660_dev *aesdev;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -67,7 +67,7 @@ static void dev_deinit(struct fp_img_dev *dev)
 	struct aesX660_dev *aesdev = dev->priv;
 	g_free(aesdev->buffer);
 	g_free(aesdev);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
@@ -98,9 +98,8 @@ static void read_regs_data_cb(struct libusb_transfer *transfer)
 	}
 
 	rdata->callback(rdata->dev, r, retdata, rdata->user_data);
+	fpi_usb_free_transfer(rdata->dev->dev, transfer);
 	g_free(rdata);
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
 }
 
 static void read_regs_rq_cb(struct fp_img_dev *dev, int result, void *user_data)
@@ -114,20 +113,19 @@ static void read_regs_rq_cb(struct fp_img_dev *dev, int result, void *user_data)
 	if (result != 0)
 		goto err;
 
-	transfer = libusb_alloc_transfer(0);
+	transfer = fpi_usb_alloc_transfer(dev->dev, 126);
 	if (!transfer) {
 		result = -ENOMEM;
 		goto err;
 	}
 
-	data = g_malloc(126);
+	data = transfer->buffer;
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, 126,
 		read_regs_data_cb, rdata, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		result = -EIO;
 		goto err;
 	}
@@ -190,39 +188,39 @@ static void generic_write_regv_cb(struct fp_img_dev *dev, int result,
 static void generic_ignore_data_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
+	int status = transfer->status;
+	int short_read = transfer->length != transfer->actual_length;
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+	fpi_usb_free_transfer(ssm->dev, transfer);
+	if (status != LIBUSB_TRANSFER_COMPLETED)
 		fpi_ssm_mark_aborted(ssm, -EIO);
-	else if (transfer->length != transfer->actual_length)
+	else if (short_read)
 		fpi_ssm_mark_aborted(ssm, -EPROTO);
 	else
 		fpi_ssm_next_state(ssm);
-
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
 }
 
 /* read the specified number of bytes from the IN endpoint but throw them
  * away, then increment the SSM */
 static void generic_read_ignore_data(struct fpi_ssm *ssm, size_t bytes)
 {
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(ssm->dev, bytes);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(bytes);
+	data = transfer->buffer;
 	libusb_fill_bulk_transfer(transfer, ssm->dev->udev, EP_IN, data, bytes,
 		generic_ignore_data_cb, ssm, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(ssm->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -308,8 +306,7 @@ static void finger_det_data_cb(struct libusb_transfer *transfer)
 	}
 
 out:
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void finger_det_reqs_cb(struct fp_img_dev *dev, int result,
@@ -324,20 +321,19 @@ static void finger_det_reqs_cb(struct fp_img_dev *dev, int result,
 		return;
 	}
 
-	transfer = libusb_alloc_transfer(0);
+	transfer = fpi_usb_alloc_transfer(dev->dev, 20);
 	if (!transfer) {
 		fpi_imgdev_session_error(dev, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(20);
+	data = transfer->buffer;
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, 20,
 		finger_det_data_cb, dev, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		fpi_imgdev_session_error(dev, r);
 	}
 }
@@ -483,7 +479,7 @@ static void capture_read_strip_cb(struct libusb_transfer *transfer)
 			struct fp_img *img;
 
 			aesdev->strips = g_slist_reverse(aesdev->strips);
-			img = aes_assemble(aesdev->strips, aesdev->strips_len,
+			img = aes_assemble(dev, aesdev->strips, aesdev->strips_len,
 				FRAME_WIDTH, FRAME_HEIGHT);
 			g_slist_free_full(aesdev->strips, g_free);
 			aesdev->strips = NULL;
@@ -508,8 +504,7 @@ static void capture_read_strip_cb(struct libusb_transfer *transfer)
 	}
 
 out:
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void capture_run_state(struct fpi_ssm *ssm)
@@ -541,22 +536,22 @@ static void capture_run_state(struct fpi_ssm *ssm)
 				generic_write_regv_cb, ssm);
 		break;
 	case CAPTURE_READ_STRIP: ;
-		struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+		struct libusb_transfer *transfer;
 		unsigned char *data;
 
+		transfer = fpi_usb_alloc_transfer(dev->dev, 1705);
 		if (!transfer) {
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
 			break;
 		}
 
-		data = g_malloc(1705);
+		data = transfer->buffer;
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, 1705,
 			capture_read_strip_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
-			g_free(data);
-			libusb_free_transfer(transfer);
+			fpi_usb_free_transfer(dev->dev, transfer);
 			fpi_ssm_mark_aborted(ssm, r);
 		}
 		break;
@@ -833,7 +828,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	/* FIXME check endpoints */
 	int r;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -847,7 +842,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
@@ -40,6 +40,8 @@ static void complete_deactivation(struct fp_img_dev *dev);
 #define EP_IN			(1 | LIBUSB_ENDPOINT_IN)
 #define EP_OUT			(2 | LIBUSB_ENDPOINT_OUT)
 #define BULK_TIMEOUT 4000
+/* bulk reads kept in flight while capturing */
+#define CAPTURE_NUM_READS	4
 
 /*
  * The AES2550 is an imaging device using a swipe-type sensor. It samples
@@ -135,7 +137,7 @@ static void finger_det_reqs_cb(struct libusb_transfer *t)
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, AES2550_EP_IN_BUF_SIZE,
 		finger_det_data_cb, dev, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(data);
 		libusb_free_transfer(transfer);
@@ -164,7 +166,7 @@ static void start_finger_detection(struct fp_img_dev *dev)
 	}
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, finger_det_reqs,
 		sizeof(finger_det_reqs), finger_det_reqs_cb, dev, BULK_TIMEOUT);
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		libusb_free_transfer(transfer);
 		fpi_imgdev_session_error(dev, r);
@@ -246,7 +248,7 @@ static void capture_set_idle_reqs_cb(struct libusb_transfer *transfer)
 		struct fp_img *img;
 
 		aesdev->strips = g_slist_reverse(aesdev->strips);
-		img = aes_assemble(aesdev->strips, aesdev->strips_len,
+		img = aes_assemble(dev, aesdev->strips, aesdev->strips_len,
 			FRAME_WIDTH, FRAME_HEIGHT);
 		g_slist_free_full(aesdev->strips, g_free);
 		aesdev->strips = NULL;
@@ -261,34 +263,26 @@ static void capture_set_idle_reqs_cb(struct libusb_transfer *transfer)
 	libusb_free_transfer(transfer);
 }
 
-static void capture_read_data_cb(struct libusb_transfer *transfer)
+static int capture_read_data_cb(unsigned char *data, int length,
+	void *user_data)
 {
-	struct fpi_ssm *ssm = transfer->user_data;
+	struct fpi_ssm *ssm = user_data;
 	struct fp_img_dev *dev = ssm->priv;
 	struct aes2550_dev *aesdev = dev->priv;
-	unsigned char *data = transfer->buffer;
 	int r;
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		fp_dbg("request is not completed, %d", transfer->status);
-		fpi_ssm_mark_aborted(ssm, -EIO);
-		goto out;
-	}
-
-	fp_dbg("request completed, len: %.4x", transfer->actual_length);
-	if (transfer->actual_length >= 2)
+	fp_dbg("request completed, len: %.4x", length);
+	if (length >= 2)
 		fp_dbg("data: %.2x %.2x", (int)data[0], (int)data[1]);
 
-	switch (transfer->actual_length) {
+	switch (length) {
 		case AES2550_STRIP_SIZE:
 			r = process_strip_data(ssm, data);
 			if (r < 0) {
 				fp_dbg("Processing strip data failed: %d", r);
-				fpi_ssm_mark_aborted(ssm, -EPROTO);
-				goto out;
+				return -EPROTO;
 			}
 			aesdev->heartbeat_cnt = 0;
-			fpi_ssm_jump_to_state(ssm, CAPTURE_READ_DATA);
 			break;
 		case AES2550_HEARTBEAT_SIZE:
 			if (data[0] == AES2550_HEARTBEAT_MAGIC) {
@@ -298,20 +292,25 @@ static void capture_read_data_cb(struct libusb_transfer *transfer)
 					/* Got 3 heartbeat message, that's enough to consider that finger was removed,
 					 * assemble image and submit it to the library */
 					fp_dbg("Got 3 heartbeats => finger removed");
-					fpi_ssm_next_state(ssm);
-				} else {
-					fpi_ssm_jump_to_state(ssm, CAPTURE_READ_DATA);
+					return 1;
 				}
 			}
 			break;
 		default:
-			fp_dbg("Short frame %d, skip", transfer->actual_length);
-			fpi_ssm_jump_to_state(ssm, CAPTURE_READ_DATA);
+			fp_dbg("Short frame %d, skip", length);
 			break;
 	}
-out:
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	return 0;
+}
+
+static void capture_read_stopped_cb(int error, void *user_data)
+{
+	struct fpi_ssm *ssm = user_data;
+
+	if (error)
+		fpi_ssm_mark_aborted(ssm, error);
+	else
+		fpi_ssm_next_state(ssm);
 }
 
 static void capture_run_state(struct fpi_ssm *ssm)
@@ -329,7 +328,7 @@ static void capture_run_state(struct fpi_ssm *ssm)
 		}
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, capture_reqs,
 			sizeof(capture_reqs), capture_reqs_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -337,26 +336,12 @@ static void capture_run_state(struct fpi_ssm *ssm)
 	}
 	break;
 	case CAPTURE_READ_DATA:
-	{
-		struct libusb_transfer *transfer = libusb_alloc_transfer(0);
-		unsigned char *data;
-
-		if (!transfer) {
-			fpi_ssm_mark_aborted(ssm, -ENOMEM);
-			break;
-		}
-
-		data = g_malloc(AES2550_EP_IN_BUF_SIZE);
-		libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, AES2550_EP_IN_BUF_SIZE,
-			capture_read_data_cb, ssm, BULK_TIMEOUT);
-
-		r = libusb_submit_transfer(transfer);
-		if (r < 0) {
-			g_free(data);
-			libusb_free_transfer(transfer);
+		/* keep reads queued so that no strips are lost on fast swipes */
+		r = fpi_usb_stream_start(dev->dev, EP_IN, AES2550_EP_IN_BUF_SIZE,
+			CAPTURE_NUM_READS, BULK_TIMEOUT, capture_read_data_cb,
+			capture_read_stopped_cb, ssm);
+		if (r < 0)
 			fpi_ssm_mark_aborted(ssm, r);
-		}
-	}
 	break;
 	case CAPTURE_SET_IDLE:
 	{
@@ -367,7 +352,7 @@ static void capture_run_state(struct fpi_ssm *ssm)
 		}
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, capture_set_idle_reqs,
 			sizeof(capture_set_idle_reqs), capture_set_idle_reqs_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -489,7 +474,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 		}
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, init_reqs,
 			sizeof(init_reqs), init_reqs_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -510,7 +495,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, AES2550_EP_IN_BUF_SIZE,
 			init_read_data_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			g_free(data);
 			libusb_free_transfer(transfer);
@@ -527,7 +512,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 		}
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, calibrate_reqs,
 			sizeof(calibrate_reqs), init_reqs_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -548,7 +533,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 		libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, data, AES2550_EP_IN_BUF_SIZE,
 			calibrate_read_data_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			g_free(data);
 			libusb_free_transfer(transfer);
@@ -603,7 +588,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	/* TODO check that device has endpoints we're using */
 	int r;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -617,7 +602,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
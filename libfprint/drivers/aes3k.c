@@ -76,17 +76,23 @@ static void img_cb(struct libusb_transfer *transfer)
 	tmp = fpi_img_new(aesdev->frame_width * aesdev->frame_width);
 	tmp->width = aesdev->frame_width;
 	tmp->height = aesdev->frame_width;
-	tmp->flags = FP_IMG_COLORS_INVERTED | FP_IMG_V_FLIPPED | FP_IMG_H_FLIPPED;
+	tmp->flags = FP_IMG_V_FLIPPED | FP_IMG_H_FLIPPED;
 	for (i = 0; i < aesdev->frame_number; i++) {
 		fp_dbg("frame header byte %02x", *ptr);
 		ptr++;
-		aes_assemble_image(ptr, aesdev->frame_width, AES3K_FRAME_HEIGHT, tmp->data + (i * aesdev->frame_width * AES3K_FRAME_HEIGHT));
+		fpi_img_unpack_4bpp(tmp->data + (i * aesdev->frame_width * AES3K_FRAME_HEIGHT),
+			ptr, aesdev->frame_width, AES3K_FRAME_HEIGHT,
+			FPI_4BPP_COLUMN_MAJOR | FPI_4BPP_LOW_NIBBLE_FIRST,
+			FP_IMG_COLORS_INVERTED);
 		ptr += aesdev->frame_size;
 	}
 
 	/* FIXME: this is an ugly hack to make the image big enough for NBIS
 	 * to process reliably */
 	img = fpi_im_resize(tmp, aesdev->enlarge_factor, aesdev->enlarge_factor);
+	if (aesdev->extract_factor)
+		fpi_img_set_lowres(img, fpi_im_resize(tmp, aesdev->extract_factor,
+			aesdev->extract_factor));
 	fp_img_free(tmp);
 	fpi_imgdev_image_captured(dev, img);
 
@@ -118,7 +124,7 @@ static void do_capture(struct fp_img_dev *dev)
 	libusb_fill_bulk_transfer(aesdev->img_trf, dev->udev, EP_IN, data,
 		aesdev->data_buflen, img_cb, dev, 0);
 
-	r = libusb_submit_transfer(aesdev->img_trf);
+	r = fpi_usb_submit_transfer(aesdev->img_trf);
 	if (r < 0) {
 		g_free(data);
 		libusb_free_transfer(aesdev->img_trf);
@@ -149,7 +155,7 @@ void aes3k_dev_deactivate(struct fp_img_dev *dev)
 	 * from deactivation, otherwise app may legally exit before we've
 	 * cleaned up */
 	if (aesdev->img_trf)
-		libusb_cancel_transfer(aesdev->img_trf);
+		fpi_usb_cancel_transfer(aesdev->img_trf);
 	fpi_imgdev_deactivate_complete(dev);
 }
 
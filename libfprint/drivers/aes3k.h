@@ -45,6 +45,8 @@ struct aes3k_dev {
 	size_t frame_size;   /* 4 bits/pixel: frame_width x AES3K_FRAME_HEIGHT / 2 */
 	size_t frame_number; /* number of frames */
 	size_t enlarge_factor;
+	/* resolution minutiae are detected at, if lower than enlarge_factor */
+	size_t extract_factor;
 
 	size_t data_buflen;             /* buffer length of usb bulk transfer */
 	struct aes_regwrite *init_reqs; /* initial values sent to device */
@@ -44,6 +44,8 @@
 #define FRAME_SIZE	(FRAME_WIDTH * AES3K_FRAME_HEIGHT / 2)
 #define FRAME_NUMBER	(FRAME_WIDTH / AES3K_FRAME_HEIGHT)
 #define ENLARGE_FACTOR 	3
+/* mindtct does as well on images enlarged by 2, in half the time */
+#define EXTRACT_FACTOR	2
 
 
 static struct aes_regwrite init_reqs[] = {
@@ -126,7 +128,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 	struct aes3k_dev *aesdev;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0)
 		fp_err("could not claim interface 0");
 
@@ -141,6 +143,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 		aesdev->frame_size = FRAME_SIZE;
 		aesdev->frame_number = FRAME_NUMBER;
 		aesdev->enlarge_factor = ENLARGE_FACTOR;
+		aesdev->extract_factor = EXTRACT_FACTOR;
 		aesdev->init_reqs = init_reqs;
 		aesdev->init_reqs_len = G_N_ELEMENTS(init_reqs);
 		fpi_imgdev_open_complete(dev, 0);
@@ -152,7 +155,7 @@ static void dev_deinit(struct fp_img_dev *dev)
 {
 	struct aes3k_dev *aesdev = dev->priv;
 	g_free(aesdev);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
@@ -41,6 +41,8 @@ static void complete_deactivation(struct fp_img_dev *dev);
 #define EP_IN			(1 | LIBUSB_ENDPOINT_IN)
 #define EP_OUT			(2 | LIBUSB_ENDPOINT_OUT)
 #define BULK_TIMEOUT		4000
+/* bulk reads kept in flight while capturing */
+#define CAPTURE_NUM_READS	4
 #define FRAME_HEIGHT		8
 
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -49,21 +51,23 @@ static void aesX660_send_cmd_timeout(struct fpi_ssm *ssm, const unsigned char *c
 	size_t cmd_len, libusb_transfer_cb_fn callback, int timeout)
 {
 	struct fp_img_dev *dev = ssm->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(dev->dev, cmd_len);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
+	memcpy(transfer->buffer, cmd, cmd_len);
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT,
-		(unsigned char *)cmd, cmd_len,
+		transfer->buffer, cmd_len,
 		callback, ssm, timeout);
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		fp_dbg("failed to submit transfer\n");
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 	}
 }
@@ -78,25 +82,23 @@ static void aesX660_read_response(struct fpi_ssm *ssm, size_t buf_len,
 	libusb_transfer_cb_fn callback)
 {
 	struct fp_img_dev *dev = ssm->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
-	unsigned char *data;
+	struct libusb_transfer *transfer;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(dev->dev, buf_len);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(buf_len);
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN,
-		data, buf_len,
+		transfer->buffer, buf_len,
 		callback, ssm, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		fp_dbg("Failed to submit rx transfer: %d\n", r);
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -104,6 +106,7 @@ static void aesX660_read_response(struct fpi_ssm *ssm, size_t buf_len,
 static void aesX660_send_cmd_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
+	struct fp_img_dev *dev = ssm->priv;
 
 	if ((transfer->status == LIBUSB_TRANSFER_COMPLETED) &&
 		(transfer->length == transfer->actual_length)) {
@@ -113,12 +116,13 @@ static void aesX660_send_cmd_cb(struct libusb_transfer *transfer)
 			transfer->status, transfer->actual_length);
 		fpi_ssm_mark_aborted(ssm, -EIO);
 	}
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void aesX660_read_calibrate_data_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
+	struct fp_img_dev *dev = ssm->priv;
 	unsigned char *data = transfer->buffer;
 
 	if ((transfer->status != LIBUSB_TRANSFER_COMPLETED) ||
@@ -135,8 +139,7 @@ static void aesX660_read_calibrate_data_cb(struct libusb_transfer *transfer)
 
 	fpi_ssm_next_state(ssm);
 out:
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 /****** FINGER PRESENCE DETECTION ******/
@@ -186,13 +189,13 @@ static void finger_det_read_fd_data_cb(struct libusb_transfer *transfer)
 		fpi_ssm_jump_to_state(ssm, FINGER_DET_SEND_FD_CMD);
 	}
 out:
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void finger_det_set_idle_cmd_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
+	struct fp_img_dev *dev = ssm->priv;
 
 	if ((transfer->status == LIBUSB_TRANSFER_COMPLETED) &&
 		(transfer->length == transfer->actual_length)) {
@@ -200,7 +203,7 @@ static void finger_det_set_idle_cmd_cb(struct libusb_transfer *transfer)
 	} else {
 		fpi_ssm_mark_aborted(ssm, -EIO);
 	}
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void finger_det_sm_complete(struct fpi_ssm *ssm)
@@ -305,7 +308,7 @@ static void capture_set_idle_cmd_cb(struct libusb_transfer *transfer)
 		struct fp_img *img, *tmp;
 
 		aesdev->strips = g_slist_reverse(aesdev->strips);
-		tmp = aes_assemble(aesdev->strips, aesdev->strips_len,
+		tmp = aes_assemble(dev, aesdev->strips, aesdev->strips_len,
 			aesdev->frame_width, FRAME_HEIGHT);
 		g_slist_foreach(aesdev->strips, (GFunc) g_free, NULL);
 		g_slist_free(aesdev->strips);
@@ -324,22 +327,17 @@ static void capture_set_idle_cmd_cb(struct libusb_transfer *transfer)
 	} else {
 		fpi_ssm_mark_aborted(ssm, -EIO);
 	}
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
-static void capture_read_stripe_data_cb(struct libusb_transfer *transfer)
+static int capture_read_stripe_data_cb(unsigned char *data, int length,
+	void *user_data)
 {
-	struct fpi_ssm *ssm = transfer->user_data;
+	struct fpi_ssm *ssm = user_data;
 	struct fp_img_dev *dev = ssm->priv;
 	struct aesX660_dev *aesdev = dev->priv;
-	unsigned char *data = transfer->buffer;
 	int finger_missing = 0;
-	size_t copied, actual_len = transfer->actual_length;
-
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		fpi_ssm_mark_aborted(ssm, -EIO);
-		goto out;
-	}
+	size_t copied, actual_len = length;
 
 	fp_dbg("Got %d bytes of data", actual_len);
 	do {
@@ -370,14 +368,17 @@ static void capture_read_stripe_data_cb(struct libusb_transfer *transfer)
 
 	fp_dbg("finger %s\n", finger_missing ? "missing" : "present");
 
-	if (finger_missing) {
+	return finger_missing ? 1 : 0;
+}
+
+static void capture_read_stripe_stopped_cb(int error, void *user_data)
+{
+	struct fpi_ssm *ssm = user_data;
+
+	if (error)
+		fpi_ssm_mark_aborted(ssm, error);
+	else
 		fpi_ssm_next_state(ssm);
-	} else {
-		fpi_ssm_jump_to_state(ssm, CAPTURE_READ_STRIPE_DATA);
-	}
-out:
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
 }
 
 static void capture_run_state(struct fpi_ssm *ssm)
@@ -398,8 +399,15 @@ static void capture_run_state(struct fpi_ssm *ssm)
 			aesX660_send_cmd_cb);
 	break;
 	case CAPTURE_READ_STRIPE_DATA:
-		aesX660_read_response(ssm, AESX660_BULK_TRANSFER_SIZE,
-			capture_read_stripe_data_cb);
+	{
+		/* keep reads queued so that no stripes are lost on fast swipes */
+		int r = fpi_usb_stream_start(dev->dev, EP_IN,
+			AESX660_BULK_TRANSFER_SIZE, CAPTURE_NUM_READS, BULK_TIMEOUT,
+			capture_read_stripe_data_cb, capture_read_stripe_stopped_cb,
+			ssm);
+		if (r < 0)
+			fpi_ssm_mark_aborted(ssm, r);
+	}
 	break;
 	case CAPTURE_SET_IDLE:
 		fp_dbg("Got %d frames\n", aesdev->strips_len);
@@ -502,8 +510,7 @@ static void activate_read_id_cb(struct libusb_transfer *transfer)
 	}
 
 out:
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void activate_read_init_cb(struct libusb_transfer *transfer)
@@ -539,8 +546,7 @@ static void activate_read_init_cb(struct libusb_transfer *transfer)
 
 	fpi_ssm_jump_to_state(ssm, ACTIVATE_SEND_INIT_CMD);
 out:
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 }
 
 static void activate_run_state(struct fpi_ssm *ssm)
@@ -615,7 +621,7 @@ void aesX660_dev_deactivate(struct fp_img_dev *dev)
 	struct aesX660_dev *aesdev = dev->priv;
 
 	if (aesdev->fd_data_transfer)
-		libusb_cancel_transfer(aesdev->fd_data_transfer);
+		fpi_usb_cancel_transfer(aesdev->fd_data_transfer);
 
 	aesdev->deactivating = TRUE;
 }
@@ -211,10 +211,24 @@ struct etes603_dev {
 	uint8_t dcoffset;
 	uint8_t vrt;
 	uint8_t vrb;
+	/* parameters come from the calibration cache and only need to be
+	 * written to the sensor */
+	unsigned int calib_restore;
 
 	unsigned int is_active;
 };
 
+/* Tuning results saved in the calibration cache, bump the version when
+ * changing the layout or the tuning procedure. */
+#define ETES603_CALIB_VERSION	1
+
+struct etes603_calib {
+	uint8_t gain;
+	uint8_t dcoffset;
+	uint8_t vrt;
+	uint8_t vrb;
+} __attribute__((__packed__));
+
 static void m_start_fingerdetect(struct fp_img_dev *idev);
 /*
  * Prepare the header of the message to be sent to the device.
@@ -518,18 +532,6 @@ static int process_frame_empty(uint8_t *frame, size_t size)
 	return 0;
 }
 
-/* Transform 4 bits image to 8 bits image */
-static void process_4to8_bpp(uint8_t *input, unsigned int input_size,
-	uint8_t *output)
-{
-	unsigned int i, j = 0;
-	for (i = 0; i < input_size; i++, j += 2) {
-		/* 16 gray levels transform to 256 levels using << 4 */
-		output[j] = input[i] & 0xF0;
-		output[j+1] = input[i] << 4;
-	}
-}
-
 /*
  * Remove duplicated lines at the end of a fingerprint.
  */
@@ -554,6 +556,48 @@ static void reset_param(struct etes603_dev *dev)
 	dev->gain = 0;
 }
 
+/*
+ * Use the tuning saved by a previous session if it looks sane. The values
+ * are only written to the sensor on activation, skipping the tuning loops.
+ */
+static void load_calib(struct fp_img_dev *idev)
+{
+	struct etes603_dev *dev = idev->priv;
+	struct etes603_calib calib;
+
+	if (fpi_calib_load(idev->dev, ETES603_CALIB_VERSION, &calib,
+			sizeof(calib)))
+		return;
+
+	if (calib.dcoffset <= DCOFFSET_MIN || calib.dcoffset > DCOFFSET_MAX
+	    || calib.gain > GAIN_SMALL_INIT || calib.vrt > VRT_MAX
+	    || calib.vrb > VRB_MAX) {
+		fp_dbg("Ignoring out of range cached tuning");
+		fpi_calib_invalidate(idev->dev);
+		return;
+	}
+
+	dev->gain = calib.gain;
+	dev->dcoffset = calib.dcoffset;
+	dev->vrt = calib.vrt;
+	dev->vrb = calib.vrb;
+	dev->calib_restore = TRUE;
+}
+
+/*
+ * Activation failed: if cached tuning was in use, do not trust it for the
+ * next attempt, which will then tune the sensor from scratch.
+ */
+static void calib_failed(struct fp_img_dev *idev)
+{
+	struct etes603_dev *dev = idev->priv;
+
+	if (!dev->calib_restore)
+		return;
+	fpi_calib_invalidate(idev->dev);
+	dev->calib_restore = FALSE;
+}
+
 
 /* Asynchronous stuff */
 
@@ -666,7 +710,7 @@ static int async_tx(struct fp_img_dev *idev, unsigned int ep, void *cb,
 	libusb_fill_bulk_transfer(transfer, idev->udev, ep, buffer, length,
 				  cb, cb_arg, BULK_TIMEOUT);
 
-	if (libusb_submit_transfer(transfer)) {
+	if (fpi_usb_submit_transfer(transfer)) {
 		libusb_free_transfer(transfer);
 		return -EIO;
 	}
@@ -814,11 +858,13 @@ static void m_capture_state(struct fpi_ssm *ssm)
 			process_remove_fp_end(dev);
 			img_size = dev->fp_height * FE_WIDTH;
 			img = fpi_img_new(img_size);
-			/* Images received are white on black, so invert it. */
-			/* TODO detect sweep direction */
-			img->flags = FP_IMG_COLORS_INVERTED | FP_IMG_V_FLIPPED;
 			img->height = dev->fp_height;
-			process_4to8_bpp(dev->fp, img_size / 2, img->data);
+			/* 16 gray levels transform to 256 levels using << 4.
+			 * Images received are white on black, so invert it. */
+			/* TODO detect sweep direction */
+			fpi_img_unpack_4bpp(img->data, dev->fp, FE_WIDTH,
+				dev->fp_height, FPI_4BPP_LEVELS_SHIFT,
+				FP_IMG_COLORS_INVERTED | FP_IMG_V_FLIPPED);
 			fp_dbg("Sending the raw fingerprint image (%dx%d)",
 				img->width, img->height);
 			fpi_imgdev_image_captured(idev, img);
@@ -1002,6 +1048,10 @@ static void m_tunevrb_state(struct fpi_ssm *ssm)
 
 	switch (ssm->cur_state) {
 	case TUNEVRB_INIT:
+		if (dev->calib_restore) {
+			fpi_ssm_jump_to_state(ssm, TUNEVRB_FINAL_SET_DCOFFSET_REQ);
+			break;
+		}
 		fp_dbg("Tuning of VRT/VRB");
 		assert(dev->dcoffset);
 		/* VRT(reg E1)=0x0A and VRB(reg E2)=0x10 are starting values */
@@ -1144,14 +1194,27 @@ err:
 static void m_tunevrb_complete(struct fpi_ssm *ssm)
 {
 	struct fp_img_dev *idev = ssm->priv;
+	struct etes603_dev *dev = idev->priv;
 
 	fpi_imgdev_activate_complete(idev, ssm->error != 0);
 	if (!ssm->error) {
+		/* don't save if tuning was cut short by a deactivation */
+		if (!dev->calib_restore && dev->is_active) {
+			struct etes603_calib calib = {
+				.gain = dev->gain,
+				.dcoffset = dev->dcoffset,
+				.vrt = dev->vrt,
+				.vrb = dev->vrb,
+			};
+			fpi_calib_save(idev->dev, ETES603_CALIB_VERSION, &calib,
+				sizeof(calib));
+		}
+		dev->calib_restore = FALSE;
 		fp_dbg("Tuning is done. Starting finger detection.");
 		m_start_fingerdetect(idev);
 	} else {
-		struct etes603_dev *dev = idev->priv;
 		fp_err("Error while tuning VRT");
+		calib_failed(idev);
 		dev->is_active = FALSE;
 		reset_param(dev);
 		fpi_imgdev_session_error(idev, -3);
@@ -1179,6 +1242,11 @@ static void m_tunedc_state(struct fpi_ssm *ssm)
 	 * this case we decrease the gain. */
 	switch (ssm->cur_state) {
 	case TUNEDC_INIT:
+		if (dev->calib_restore) {
+			fp_dbg("Restoring cached tuning");
+			fpi_ssm_jump_to_state(ssm, TUNEDC_FINAL_SET_REG2122_REQ);
+			break;
+		}
 		/* reg_e0 = 0x23 is sensor normal/small gain */
 		dev->gain = GAIN_SMALL_INIT;
 		dev->tunedc_min = DCOFFSET_MIN;
@@ -1278,6 +1346,7 @@ static void m_tunedc_complete(struct fpi_ssm *ssm)
 	} else {
 		struct etes603_dev *dev = idev->priv;
 		fp_err("Error while tuning DCOFFSET");
+		calib_failed(idev);
 		dev->is_active = FALSE;
 		reset_param(dev);
 		fpi_imgdev_session_error(idev, -2);
@@ -1398,6 +1467,7 @@ static void m_init_complete(struct fpi_ssm *ssm)
 	} else {
 		struct etes603_dev *dev = idev->priv;
 		fp_err("Error initializing the device");
+		calib_failed(idev);
 		dev->is_active = FALSE;
 		reset_param(dev);
 		fpi_imgdev_session_error(idev, -1);
@@ -1421,7 +1491,7 @@ static int dev_activate(struct fp_img_dev *idev, enum fp_imgdev_state state)
 	/* Reset info and data */
 	dev->is_active = TRUE;
 
-	if (dev->dcoffset == 0) {
+	if (dev->dcoffset == 0 || dev->calib_restore) {
 		fp_dbg("Tuning device...");
 		ssm = fpi_ssm_new(idev->dev, m_init_state, INIT_NUM_STATES);
 		ssm->priv = idev;
@@ -1463,13 +1533,15 @@ static int dev_open(struct fp_img_dev *idev, unsigned long driver_data)
 	dev->ans = g_malloc(FE_SIZE);
 	dev->fp = g_malloc(FE_SIZE * 4);
 
-	ret = libusb_claim_interface(idev->udev, 0);
+	ret = fpi_usb_claim_interface(idev->udev, 0);
 	if (ret != LIBUSB_SUCCESS) {
 		fp_err("libusb_claim_interface failed on interface 0 "
 		       "(err=%d)", ret);
 		return ret;
 	}
 
+	load_calib(idev);
+
 	fpi_imgdev_open_complete(idev, 0);
 	return 0;
 }
@@ -1483,7 +1555,7 @@ static void dev_close(struct fp_img_dev *idev)
 	g_free(dev->fp);
 	g_free(dev);
 
-	libusb_release_interface(idev->udev, 0);
+	fpi_usb_release_interface(idev->udev, 0);
 	fpi_imgdev_close_complete(idev);
 }
 
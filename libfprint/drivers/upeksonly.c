@@ -153,7 +153,7 @@ static void cancel_img_transfers(struct fp_img_dev *dev)
 		if (!idata->flying || idata->cancelling)
 			continue;
 		fp_dbg("cancelling transfer %d", i);
-		int r = libusb_cancel_transfer(sdev->img_transfer[i]);
+		int r = fpi_usb_cancel_transfer(sdev->img_transfer[i]);
 		if (r < 0)
 			fp_dbg("cancel failed error %d", r);
 		idata->cancelling = TRUE;
@@ -432,7 +432,7 @@ static void img_data_cb(struct libusb_transfer *transfer)
 	}
 
 	if (is_capturing(sdev)) {
-		int r = libusb_submit_transfer(transfer);
+		int r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			fp_warn("failed resubmit, error %d", r);
 			sdev->killing_transfers = IMG_SESSION_ERROR;
@@ -457,8 +457,7 @@ struct write_regs_data {
 
 static void write_regs_finished(struct write_regs_data *wrdata, int result)
 {
-	g_free(wrdata->transfer->buffer);
-	libusb_free_transfer(wrdata->transfer);
+	fpi_usb_free_transfer(wrdata->ssm->dev, wrdata->transfer);
 	if (result == 0)
 		fpi_ssm_next_state(wrdata->ssm);
 	else
@@ -485,7 +484,7 @@ static void write_regs_iterate(struct write_regs_data *wrdata)
 	setup->wIndex = regwrite->reg;
 	wrdata->transfer->buffer[LIBUSB_CONTROL_SETUP_SIZE] = regwrite->value;
 
-	r = libusb_submit_transfer(wrdata->transfer);
+	r = fpi_usb_submit_transfer(wrdata->transfer);
 	if (r < 0)
 		write_regs_finished(wrdata, r);
 }
@@ -508,14 +507,15 @@ static void sm_write_regs(struct fpi_ssm *ssm,
 	struct write_regs_data *wrdata = g_malloc(sizeof(*wrdata));
 	unsigned char *data;
 
-	wrdata->transfer = libusb_alloc_transfer(0);
+	wrdata->transfer = fpi_usb_alloc_transfer(ssm->dev,
+		LIBUSB_CONTROL_SETUP_SIZE + 1);
 	if (!wrdata->transfer) {
 		g_free(wrdata);
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
-	data = g_malloc(LIBUSB_CONTROL_SETUP_SIZE + 1);
+	data = wrdata->transfer->buffer;
 	libusb_fill_control_setup(data, 0x40, 0x0c, 0, 0, 1);
 	libusb_fill_control_transfer(wrdata->transfer, ssm->dev->udev, data,
 		write_regs_cb, wrdata, CTRL_TIMEOUT);
@@ -531,8 +531,10 @@ static void sm_write_regs(struct fpi_ssm *ssm,
 static void sm_write_reg_cb(struct libusb_transfer *transfer)
 {
 	struct fpi_ssm *ssm = transfer->user_data;
-	g_free(transfer->buffer);
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+	int status = transfer->status;
+
+	fpi_usb_free_transfer(ssm->dev, transfer);
+	if (status != LIBUSB_TRANSFER_COMPLETED)
 		fpi_ssm_mark_aborted(ssm, -EIO);
 	else
 		fpi_ssm_next_state(ssm);
@@ -542,29 +544,28 @@ static void sm_write_reg_cb(struct libusb_transfer *transfer)
 static void sm_write_reg(struct fpi_ssm *ssm, uint8_t reg, uint8_t value)
 {
 	struct fp_img_dev *dev = ssm->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(ssm->dev, LIBUSB_CONTROL_SETUP_SIZE + 1);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
 	fp_dbg("set %02x=%02x", reg, value);
-	data = g_malloc(LIBUSB_CONTROL_SETUP_SIZE + 1);
+	data = transfer->buffer;
 	libusb_fill_control_setup(data, 0x40, 0x0c, 0, reg, 1);
 	libusb_fill_control_transfer(transfer, dev->udev, data, sm_write_reg_cb,
 		ssm, CTRL_TIMEOUT);
 
 	data[LIBUSB_CONTROL_SETUP_SIZE] = value;
-	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK |
-		LIBUSB_TRANSFER_FREE_TRANSFER;
+	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(ssm->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -575,41 +576,43 @@ static void sm_read_reg_cb(struct libusb_transfer *transfer)
 	struct fp_img_dev *dev = ssm->priv;
 	struct sonly_dev *sdev = dev->priv;
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		fpi_ssm_mark_aborted(ssm, -EIO);
-	} else {
+	int status = transfer->status;
+
+	if (status == LIBUSB_TRANSFER_COMPLETED) {
 		sdev->read_reg_result = libusb_control_transfer_get_data(transfer)[0];
 		fp_dbg("read reg result = %02x", sdev->read_reg_result);
-		fpi_ssm_next_state(ssm);
 	}
+	fpi_usb_free_transfer(ssm->dev, transfer);
 
-	g_free(transfer->buffer);
+	if (status != LIBUSB_TRANSFER_COMPLETED)
+		fpi_ssm_mark_aborted(ssm, -EIO);
+	else
+		fpi_ssm_next_state(ssm);
 }
 
 static void sm_read_reg(struct fpi_ssm *ssm, uint8_t reg)
 {
 	struct fp_img_dev *dev = ssm->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(ssm->dev, LIBUSB_CONTROL_SETUP_SIZE + 8);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
 	fp_dbg("read reg %02x", reg);
-	data = g_malloc(LIBUSB_CONTROL_SETUP_SIZE + 8);
+	data = transfer->buffer;
 	libusb_fill_control_setup(data, 0xc0, 0x0c, 0, reg, 8);
 	libusb_fill_control_transfer(transfer, dev->udev, data, sm_read_reg_cb,
 		ssm, CTRL_TIMEOUT);
-	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK |
-		LIBUSB_TRANSFER_FREE_TRANSFER;
+	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(ssm->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -619,16 +622,18 @@ static void sm_await_intr_cb(struct libusb_transfer *transfer)
 	struct fpi_ssm *ssm = transfer->user_data;
 	struct fp_img_dev *dev = ssm->priv;
 
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		g_free(transfer->buffer);
-		fpi_ssm_mark_aborted(ssm, transfer->status);
+	int status = transfer->status;
+
+	if (status != LIBUSB_TRANSFER_COMPLETED) {
+		fpi_usb_free_transfer(ssm->dev, transfer);
+		fpi_ssm_mark_aborted(ssm, status);
 		return;
 	}
 
 	fp_dbg("interrupt received: %02x %02x %02x %02x",
 		transfer->buffer[0], transfer->buffer[1],
 		transfer->buffer[2], transfer->buffer[3]);
-	g_free(transfer->buffer);
+	fpi_usb_free_transfer(ssm->dev, transfer);
 
 	fpi_imgdev_report_finger_status(dev, TRUE);
 	fpi_ssm_next_state(ssm);
@@ -637,26 +642,23 @@ static void sm_await_intr_cb(struct libusb_transfer *transfer)
 static void sm_await_intr(struct fpi_ssm *ssm)
 {
 	struct fp_img_dev *dev = ssm->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
-	unsigned char *data;
+	struct libusb_transfer *transfer;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(ssm->dev, 4);
 	if (!transfer) {
 		fpi_ssm_mark_aborted(ssm, -ENOMEM);
 		return;
 	}
 
 	fp_dbg("");
-	data = g_malloc(4);
-	libusb_fill_interrupt_transfer(transfer, dev->udev, 0x83, data, 4,
-		sm_await_intr_cb, ssm, 0);
-	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK |
-		LIBUSB_TRANSFER_FREE_TRANSFER;
+	libusb_fill_interrupt_transfer(transfer, dev->udev, 0x83,
+		transfer->buffer, 4, sm_await_intr_cb, ssm, 0);
+	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		libusb_free_transfer(transfer);
-		g_free(data);
+		fpi_usb_free_transfer(ssm->dev, transfer);
 		fpi_ssm_mark_aborted(ssm, r);
 	}
 }
@@ -821,7 +823,7 @@ static void capsm_fire_bulk(struct fpi_ssm *ssm)
 	struct sonly_dev *sdev = dev->priv;
 	int i;
 	for (i = 0; i < NUM_BULK_TRANSFERS; i++) {
-		int r = libusb_submit_transfer(sdev->img_transfer[i]);
+		int r = fpi_usb_submit_transfer(sdev->img_transfer[i]);
 		if (r < 0) {
 			if (i == 0) {
 				/* first one failed: easy peasy */
@@ -1222,13 +1224,13 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 {
 	int r;
 
-	r = libusb_set_configuration(dev->udev, 1);
+	r = fpi_usb_set_configuration(dev->udev, 1);
 	if (r < 0) {
 		fp_err("could not set configuration 1");
 		return r;
 	}
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -1243,7 +1245,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
@@ -120,7 +120,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 		libusb_fill_bulk_transfer(transfer, dev->udev, upekdev->ep_out,
 			(unsigned char*)upekdev->setup_commands[upekdev->init_idx].cmd,
 			UPEKTC_CMD_LEN, write_init_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -142,7 +142,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 			upekdev->setup_commands[upekdev->init_idx].response_len,
 			read_init_data_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			g_free(data);
 			libusb_free_transfer(transfer);
@@ -241,7 +241,7 @@ static void finger_det_cmd_cb(struct libusb_transfer *t)
 	libusb_fill_bulk_transfer(transfer, dev->udev, upekdev->ep_in, data, IMAGE_SIZE,
 		finger_det_data_cb, dev, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(data);
 		libusb_free_transfer(transfer);
@@ -271,7 +271,7 @@ static void start_finger_detection(struct fp_img_dev *dev)
 	libusb_fill_bulk_transfer(transfer, dev->udev, upekdev->ep_out,
 		(unsigned char *)scan_cmd, UPEKTC_CMD_LEN,
 		finger_det_cmd_cb, dev, BULK_TIMEOUT);
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		libusb_free_transfer(transfer);
 		fpi_imgdev_session_error(dev, r);
@@ -343,7 +343,7 @@ static void capture_run_state(struct fpi_ssm *ssm)
 		libusb_fill_bulk_transfer(transfer, dev->udev, upekdev->ep_out,
 			(unsigned char *)scan_cmd, UPEKTC_CMD_LEN,
 			capture_cmd_cb, ssm, BULK_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			libusb_free_transfer(transfer);
 			fpi_ssm_mark_aborted(ssm, -ENOMEM);
@@ -364,7 +364,7 @@ static void capture_run_state(struct fpi_ssm *ssm)
 		libusb_fill_bulk_transfer(transfer, dev->udev, upekdev->ep_in, data, IMAGE_SIZE,
 			capture_read_data_cb, ssm, BULK_TIMEOUT);
 
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			g_free(data);
 			libusb_free_transfer(transfer);
@@ -439,7 +439,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 	struct upektc_dev *upekdev;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -475,7 +475,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
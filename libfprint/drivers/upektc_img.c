@@ -146,7 +146,7 @@ static void upektc_img_submit_req(struct fpi_ssm *ssm,
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_OUT, upekdev->cmd, buf_size,
 		cb, ssm, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		libusb_free_transfer(transfer);
 		fpi_ssm_mark_aborted(ssm, r);
@@ -172,7 +172,7 @@ static void upektc_img_read_data(struct fpi_ssm *ssm, size_t buf_size, size_t bu
 	libusb_fill_bulk_transfer(transfer, dev->udev, EP_IN, upekdev->response + buf_offset, buf_size,
 		cb, ssm, BULK_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		libusb_free_transfer(transfer);
 		fpi_ssm_mark_aborted(ssm, r);
@@ -527,7 +527,7 @@ static void activate_run_state(struct fpi_ssm *ssm)
 			LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE, 0x0c, 0x100, 0x0400, 1);
 		libusb_fill_control_transfer(transfer, ssm->dev->udev, data,
 			init_reqs_ctrl_cb, ssm, CTRL_TIMEOUT);
-		r = libusb_submit_transfer(transfer);
+		r = fpi_usb_submit_transfer(transfer);
 		if (r < 0) {
 			g_free(data);
 			libusb_free_transfer(transfer);
@@ -600,7 +600,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	/* TODO check that device has endpoints we're using */
 	int r;
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		fp_err("could not claim interface 0");
 		return r;
@@ -614,7 +614,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
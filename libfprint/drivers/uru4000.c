@@ -31,6 +31,7 @@
 #include <fp_internal.h>
 
 #include "driver_ids.h"
+#include "uru4000_decode.h"
 
 #define EP_INTR			(1 | LIBUSB_ENDPOINT_IN)
 #define EP_DATA			(2 | LIBUSB_ENDPOINT_IN)
@@ -180,8 +181,7 @@ static void write_regs_cb(struct libusb_transfer *transfer)
 	else if (transfer->actual_length != setup->wLength)
 		r = -EPROTO;
 
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(wrdata->dev->dev, transfer);
 	wrdata->callback(wrdata->dev, r, wrdata->user_data);
 	g_free(wrdata);
 }
@@ -191,10 +191,12 @@ static int write_regs(struct fp_img_dev *dev, uint16_t first_reg,
 	void *user_data)
 {
 	struct write_regs_data *wrdata;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(dev->dev,
+		LIBUSB_CONTROL_SETUP_SIZE + num_regs);
 	if (!transfer)
 		return -ENOMEM;
 
@@ -203,17 +205,16 @@ static int write_regs(struct fp_img_dev *dev, uint16_t first_reg,
 	wrdata->callback = callback;
 	wrdata->user_data = user_data;
 
-	data = g_malloc(LIBUSB_CONTROL_SETUP_SIZE + num_regs);
+	data = transfer->buffer;
 	memcpy(data + LIBUSB_CONTROL_SETUP_SIZE, values, num_regs);
 	libusb_fill_control_setup(data, CTRL_OUT, USB_RQ, first_reg, 0, num_regs);
 	libusb_fill_control_transfer(transfer, dev->udev, data, write_regs_cb,
 		wrdata, CTRL_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(wrdata);
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 	}
 	return r;
 }
@@ -249,19 +250,20 @@ static void read_regs_cb(struct libusb_transfer *transfer)
 		data = libusb_control_transfer_get_data(transfer);
 
 	rrdata->callback(rrdata->dev, r, transfer->actual_length, data, rrdata->user_data);
+	fpi_usb_free_transfer(rrdata->dev->dev, transfer);
 	g_free(rrdata);
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
 }
 
 static int read_regs(struct fp_img_dev *dev, uint16_t first_reg,
 	uint16_t num_regs, read_regs_cb_fn callback, void *user_data)
 {
 	struct read_regs_data *rrdata;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+	struct libusb_transfer *transfer;
 	unsigned char *data;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(dev->dev,
+		LIBUSB_CONTROL_SETUP_SIZE + num_regs);
 	if (!transfer)
 		return -ENOMEM;
 
@@ -270,16 +272,15 @@ static int read_regs(struct fp_img_dev *dev, uint16_t first_reg,
 	rrdata->callback = callback;
 	rrdata->user_data = user_data;
 
-	data = g_malloc(LIBUSB_CONTROL_SETUP_SIZE + num_regs);
+	data = transfer->buffer;
 	libusb_fill_control_setup(data, CTRL_IN, USB_RQ, first_reg, 0, num_regs);
 	libusb_fill_control_transfer(transfer, dev->udev, data, read_regs_cb,
 		rrdata, CTRL_TIMEOUT);
 
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(rrdata);
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 	}
 	return r;
 }
@@ -384,12 +385,16 @@ static void irq_handler(struct libusb_transfer *transfer)
 	uint16_t type;
 	int r = 0;
 
+	/* the transfer goes back to the pool before any callback runs, as
+	 * those may close the device and release the pool */
 	if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
 		fp_dbg("cancelled");
+		fpi_usb_free_transfer(dev->dev, transfer);
+		urudev->irq_transfer = NULL;
 		if (urudev->irqs_stopped_cb)
 			urudev->irqs_stopped_cb(dev);
 		urudev->irqs_stopped_cb = NULL;
-		goto out;
+		return;
 	} else if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
 		r = -EIO;
 		goto err;
@@ -401,8 +406,7 @@ static void irq_handler(struct libusb_transfer *transfer)
 
 	type = GUINT16_FROM_BE(*((uint16_t *) data));
 	fp_dbg("recv irq type %04x", type);
-	g_free(data);
-	libusb_free_transfer(transfer);
+	fpi_usb_free_transfer(dev->dev, transfer);
 
 	/* The 0800 interrupt seems to indicate imminent failure (0 bytes transfer)
 	 * of the next scan. It still appears on occasion. */
@@ -419,35 +423,30 @@ static void irq_handler(struct libusb_transfer *transfer)
 		return;
 
 	transfer = NULL;
-	data = NULL;
 err:
+	fpi_usb_free_transfer(dev->dev, transfer);
+	urudev->irq_transfer = NULL;
 	if (urudev->irq_cb)
 		urudev->irq_cb(dev, r, 0, urudev->irq_cb_data);
-out:
-	g_free(data);
-	libusb_free_transfer(transfer);
-	urudev->irq_transfer = NULL;
 }
 
 static int start_irq_handler(struct fp_img_dev *dev)
 {
 	struct uru4k_dev *urudev = dev->priv;
-	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
-	unsigned char *data;
+	struct libusb_transfer *transfer;
 	int r;
 
+	transfer = fpi_usb_alloc_transfer(dev->dev, IRQ_LENGTH);
 	if (!transfer)
 		return -ENOMEM;
-	
-	data = g_malloc(IRQ_LENGTH);
-	libusb_fill_bulk_transfer(transfer, dev->udev, EP_INTR, data, IRQ_LENGTH,
-		irq_handler, dev, 0);
+
+	libusb_fill_bulk_transfer(transfer, dev->udev, EP_INTR, transfer->buffer,
+		IRQ_LENGTH, irq_handler, dev, 0);
 
 	urudev->irq_transfer = transfer;
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
-		g_free(data);
-		libusb_free_transfer(transfer);
+		fpi_usb_free_transfer(dev->dev, transfer);
 		urudev->irq_transfer = NULL;
 	}
 	return r;
@@ -458,7 +457,7 @@ static void stop_irq_handler(struct fp_img_dev *dev, irqs_stopped_cb_fn cb)
 	struct uru4k_dev *urudev = dev->priv;
 	struct libusb_transfer *transfer = urudev->irq_transfer;
 	if (transfer) {
-		libusb_cancel_transfer(transfer);
+		fpi_usb_cancel_transfer(transfer);
 		urudev->irqs_stopped_cb = cb;
 	}
 }
@@ -625,45 +624,6 @@ struct uru4k_image {
 	uint8_t		data[IMAGE_HEIGHT][IMAGE_WIDTH];
 };
 
-static uint32_t update_key(uint32_t key)
-{
-	/* linear feedback shift register
-	 * taps at bit positions 1 3 4 7 11 13 20 23 26 29 32 */
-	uint32_t bit = key & 0x9248144d;
-	bit ^= bit << 16;
-	bit ^= bit << 8;
-	bit ^= bit << 4;
-	bit ^= bit << 2;
-	bit ^= bit << 1;
-	return (bit & 0x80000000) | (key >> 1);
-}
-
-static uint32_t do_decode(uint8_t *data, int num_bytes, uint32_t key)
-{
-	uint8_t xorbyte;
-	int i;
-
-	for (i = 0; i < num_bytes - 1; i++) {
-		/* calculate xor byte and update key */
-		xorbyte  = ((key >>  4) & 1) << 0;
-		xorbyte |= ((key >>  8) & 1) << 1;
-		xorbyte |= ((key >> 11) & 1) << 2;
-		xorbyte |= ((key >> 14) & 1) << 3;
-		xorbyte |= ((key >> 18) & 1) << 4;
-		xorbyte |= ((key >> 21) & 1) << 5;
-		xorbyte |= ((key >> 24) & 1) << 6;
-		xorbyte |= ((key >> 29) & 1) << 7;
-		key = update_key(key);
-
-		/* decrypt data */
-		data[i] = data[i+1] ^ xorbyte;
-	}
-
-	/* the final byte is implictly zero */
-	data[i] = 0;
-	return update_key(key);
-}
-
 static void imaging_run_state(struct fpi_ssm *ssm)
 {
 	struct fp_img_dev *dev = ssm->priv;
@@ -681,7 +641,7 @@ static void imaging_run_state(struct fpi_ssm *ssm)
 		urudev->img_block = 0;
 		libusb_fill_bulk_transfer(urudev->img_transfer, dev->udev, EP_DATA,
 			urudev->img_data, sizeof(struct uru4k_image), image_transfer_cb, ssm, 0);
-		r = libusb_submit_transfer(urudev->img_transfer);
+		r = fpi_usb_submit_transfer(urudev->img_transfer);
 		if (r < 0)
 			fpi_ssm_mark_aborted(ssm, -EIO);
 		break;
@@ -738,13 +698,13 @@ static void imaging_run_state(struct fpi_ssm *ssm)
 			switch (flags & (BLOCKF_NO_KEY_UPDATE | BLOCKF_ENCRYPTED)) {
 			case BLOCKF_ENCRYPTED:
 				fp_dbg("decoding %d lines", num_lines);
-				key = do_decode(&img->data[urudev->img_lines_done][0],
+				key = uru4000_decode(&img->data[urudev->img_lines_done][0],
 						IMAGE_WIDTH*num_lines, key);
 				break;
 			case 0:
 				fp_dbg("skipping %d lines", num_lines);
 				for (r = 0; r < IMAGE_WIDTH*num_lines; r++)
-					key = update_key(key);
+					key = uru4000_update_key(key);
 				break;
 			}
 			if ((flags & BLOCKF_NOT_PRESENT) == 0)
@@ -867,7 +827,7 @@ static void rebootpwr_run_state(struct fpi_ssm *ssm)
 			fpi_ssm_next_state(ssm);
 		break;
 	case REBOOTPWR_PAUSE:
-		if (fpi_timeout_add(10, rebootpwr_pause_cb, ssm) == NULL)
+		if (fpi_timeout_add(dev->dev, 10, rebootpwr_pause_cb, ssm) == NULL)
 			fpi_ssm_mark_aborted(ssm, -ETIME);
 		break;
 	}
@@ -950,7 +910,7 @@ static void powerup_run_state(struct fpi_ssm *ssm)
 			fpi_ssm_next_state(ssm);
 		break;
 	case POWERUP_PAUSE:
-		if (fpi_timeout_add(10, powerup_pause_cb, ssm) == NULL)
+		if (fpi_timeout_add(dev->dev, 10, powerup_pause_cb, ssm) == NULL)
 			fpi_ssm_mark_aborted(ssm, -ETIME);
 		break;
 	case POWERUP_CHALLENGE_RESPONSE:
@@ -1080,7 +1040,7 @@ static void init_run_state(struct fpi_ssm *ssm)
 		/* sometimes the 56aa interrupt that we are waiting for never arrives,
 		 * so we include this timeout loop to retry the whole process 3 times
 		 * if we don't get an irq any time soon. */
-		urudev->scanpwr_irq_timeout = fpi_timeout_add(300,
+		urudev->scanpwr_irq_timeout = fpi_timeout_add(dev->dev, 300,
 			init_scanpwr_timeout, ssm);
 		if (!urudev->scanpwr_irq_timeout) {
 			fpi_ssm_mark_aborted(ssm, -ETIME);
@@ -1225,9 +1185,18 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	struct uru4k_dev *urudev;
 	SECStatus rv;
 	SECItem item;
+	int iface_num;
 	int i;
 	int r;
 
+	/* A replayed USB trace has no descriptors to look at, and interface
+	 * numbers are meaningless to it */
+	if (fpi_usb_replaying()) {
+		config = NULL;
+		iface_num = 0;
+		goto claim;
+	}
+
 	/* Find fingerprint interface */
 	r = libusb_get_config_descriptor(libusb_get_device(dev->udev), 0, &config);
 	if (r < 0) {
@@ -1282,8 +1251,10 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	}
 
 	/* Device looks like a supported reader */
+	iface_num = iface_desc->bInterfaceNumber;
 
-	r = libusb_claim_interface(dev->udev, iface_desc->bInterfaceNumber);
+claim:
+	r = fpi_usb_claim_interface(dev->udev, iface_num);
 	if (r < 0) {
 		fp_err("interface claim failed");
 		goto out;
@@ -1298,7 +1269,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 
 	urudev = g_malloc0(sizeof(*urudev));
 	urudev->profile = &uru4k_dev_info[driver_data];
-	urudev->interface = iface_desc->bInterfaceNumber;
+	urudev->interface = iface_num;
 
 	/* Set up encryption */
 	urudev->cipher = CKM_AES_ECB;
@@ -1327,7 +1298,8 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	fpi_imgdev_open_complete(dev, 0);
 
 out:
-	libusb_free_config_descriptor(config);
+	if (config)
+		libusb_free_config_descriptor(config);
 	return r;
 }
 
@@ -1340,7 +1312,7 @@ static void dev_deinit(struct fp_img_dev *dev)
 		SECITEM_FreeItem(urudev->param, PR_TRUE);
 	if (urudev->slot)
 		PK11_FreeSlot(urudev->slot);
-	libusb_release_interface(dev->udev, urudev->interface);
+	fpi_usb_release_interface(dev->udev, urudev->interface);
 	g_free(urudev);
 	fpi_imgdev_close_complete(dev);
 }
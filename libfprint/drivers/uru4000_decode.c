@@ -0,0 +1,117 @@
+/*
+ * Digital Persona U.are.U 4000 image descrambling
+ * Copyright (C) 2012 Timo Teräs <timo.teras@iki.fi>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "uru4000_decode.h"
+
+uint32_t uru4000_update_key(uint32_t key)
+{
+	/* linear feedback shift register
+	 * taps at bit positions 1 3 4 7 11 13 20 23 26 29 32 */
+	uint32_t bit = key & 0x9248144d;
+	bit ^= bit << 16;
+	bit ^= bit << 8;
+	bit ^= bit << 4;
+	bit ^= bit << 2;
+	bit ^= bit << 1;
+	return (bit & 0x80000000) | (key >> 1);
+}
+
+static uint8_t key_xorbyte(uint32_t key)
+{
+	uint8_t xorbyte;
+
+	xorbyte  = ((key >>  4) & 1) << 0;
+	xorbyte |= ((key >>  8) & 1) << 1;
+	xorbyte |= ((key >> 11) & 1) << 2;
+	xorbyte |= ((key >> 14) & 1) << 3;
+	xorbyte |= ((key >> 18) & 1) << 4;
+	xorbyte |= ((key >> 21) & 1) << 5;
+	xorbyte |= ((key >> 24) & 1) << 6;
+	xorbyte |= ((key >> 29) & 1) << 7;
+	return xorbyte;
+}
+
+/* Both the LFSR and the xor byte extraction are linear (over GF(2)) in the
+ * key, so the next 8 xor bytes and the key 8 updates later are the xor of
+ * the contributions of each of the 4 key bytes, which are precomputed. */
+static uint64_t keystream_tab[4][256];
+static uint32_t next_key_tab[4][256];
+
+static gpointer init_decode_tables(gpointer data)
+{
+	unsigned int i, j, k;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 256; j++) {
+			uint32_t key = j << (8 * i);
+			uint64_t keystream = 0;
+
+			for (k = 0; k < 8; k++) {
+				keystream |= (uint64_t) key_xorbyte(key) << (8 * k);
+				key = uru4000_update_key(key);
+			}
+			keystream_tab[i][j] = keystream;
+			next_key_tab[i][j] = key;
+		}
+	}
+	return NULL;
+}
+
+uint32_t uru4000_decode(uint8_t *data, int num_bytes, uint32_t key)
+{
+	static GOnce tables_once = G_ONCE_INIT;
+	uint64_t keystream;
+	uint64_t word;
+	int i;
+
+	g_once(&tables_once, init_decode_tables, NULL);
+
+	/* decrypt 8 bytes at a time, the data is shifted by one byte */
+	for (i = 0; i + 8 < num_bytes; i += 8) {
+		keystream = keystream_tab[0][key & 0xff]
+			^ keystream_tab[1][(key >> 8) & 0xff]
+			^ keystream_tab[2][(key >> 16) & 0xff]
+			^ keystream_tab[3][key >> 24];
+		key = next_key_tab[0][key & 0xff]
+			^ next_key_tab[1][(key >> 8) & 0xff]
+			^ next_key_tab[2][(key >> 16) & 0xff]
+			^ next_key_tab[3][key >> 24];
+
+		memcpy(&word, data + i + 1, 8);
+		word ^= GUINT64_TO_LE(keystream);
+		memcpy(data + i, &word, 8);
+	}
+
+	for (; i < num_bytes - 1; i++) {
+		/* calculate xor byte and update key */
+		uint8_t xorbyte = key_xorbyte(key);
+		key = uru4000_update_key(key);
+
+		/* decrypt data */
+		data[i] = data[i+1] ^ xorbyte;
+	}
+
+	/* the final byte is implictly zero */
+	data[i] = 0;
+	return uru4000_update_key(key);
+}
@@ -0,0 +1,32 @@
+/*
+ * Digital Persona U.are.U 4000 image descrambling
+ * Copyright (C) 2012 Timo Teräs <timo.teras@iki.fi>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __URU4000_DECODE_H
+#define __URU4000_DECODE_H
+
+#include <stdint.h>
+
+/* Advance the image scrambling key by one byte. */
+uint32_t uru4000_update_key(uint32_t key);
+
+/* Descramble num_bytes of image data in place, starting with key. Returns
+ * the key for the data that follows. */
+uint32_t uru4000_decode(uint8_t *data, int num_bytes, uint32_t key);
+
+#endif
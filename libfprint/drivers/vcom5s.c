@@ -111,7 +111,7 @@ static void sm_write_reg(struct fpi_ssm *ssm, unsigned char reg,
 	libusb_fill_control_setup(data, CTRL_OUT, reg, value, 0, 0);
 	libusb_fill_control_transfer(transfer, dev->udev, data, sm_write_reg_cb,
 		ssm, CTRL_TIMEOUT);
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(data);
 		libusb_free_transfer(transfer);
@@ -150,7 +150,7 @@ static void sm_exec_cmd(struct fpi_ssm *ssm, unsigned char cmd,
 	libusb_fill_control_setup(data, CTRL_IN, cmd, param, 0, 0);
 	libusb_fill_control_transfer(transfer, dev->udev, data, sm_exec_cmd_cb,
 		ssm, CTRL_TIMEOUT);
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		g_free(data);
 		libusb_free_transfer(transfer);
@@ -243,7 +243,7 @@ static void capture_iterate(struct fpi_ssm *ssm)
 		vdev->capture_img->data + (RQ_SIZE * iteration), RQ_SIZE,
 		capture_cb, ssm, CTRL_TIMEOUT);
 	transfer->flags = LIBUSB_TRANSFER_SHORT_NOT_OK;
-	r = libusb_submit_transfer(transfer);
+	r = fpi_usb_submit_transfer(transfer);
 	if (r < 0) {
 		libusb_free_transfer(transfer);
 		fpi_ssm_mark_aborted(ssm, r);
@@ -346,7 +346,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 	dev->priv = g_malloc0(sizeof(struct v5s_dev));
 
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0)
 		fp_err("could not claim interface 0");
 
@@ -359,7 +359,7 @@ static int dev_init(struct fp_img_dev *dev, unsigned long driver_data)
 static void dev_deinit(struct fp_img_dev *dev)
 {
 	g_free(dev->priv);
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 	fpi_imgdev_close_complete(dev);
 }
 
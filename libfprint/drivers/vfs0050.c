@@ -241,34 +241,34 @@ static void state_activate(struct fpi_ssm *ssm)
         vfs_dev->activate_offset = 0;
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs0050_activate1, 64, state_activate_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_1_STEP2:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs0050_activate1 + 64, 61, state_activate_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_1_SINGLE_READ:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, state_activate_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_2_SEND:
         to_send = sizeof(vfs0050_activate2) - vfs_dev->activate_offset;
         to_send = to_send >= 64 ? 64 : to_send;
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs0050_activate2 + vfs_dev->activate_offset, to_send, state_activate_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_EP1_DRAIN:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, state_activate_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_EP3_INT1: //first interrupt, should be 5 x 0x00
         transfer = libusb_alloc_transfer(0);
         libusb_fill_interrupt_transfer(transfer, dev->udev, EP3_IN, vfs_dev->tmpbuf, 8, state_activate_cb, ssm, INTERRUPT_TIMEOUT1);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_AWAIT_FINGER:
         //this sets up infinite wait for interrupt.  When the interrupt occurs, we're ready to read data on EP2.
@@ -278,7 +278,7 @@ static void state_activate(struct fpi_ssm *ssm)
         }
         transfer = libusb_alloc_transfer(0);
         libusb_fill_interrupt_transfer(transfer, dev->udev, EP3_IN, vfs_dev->tmpbuf, 8, state_activate_cb, ssm, INTERRUPT_TIMEOUT_NONE);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_RECEIVE_FINGERPRINT:
         if (vfs_dev->scanbuf_idx + 64 >= vfs_dev->scanbuf_sz) {
@@ -287,14 +287,14 @@ static void state_activate(struct fpi_ssm *ssm)
         }
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP2_IN, vfs_dev->scanbuf + vfs_dev->scanbuf_idx, 64, state_activate_cb, ssm, 500);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_ACTIVATE_POST_RECEIVE:
         submit_image(dev);
         fpi_imgdev_report_finger_status(dev, FALSE);
         vfs_dev->activate_offset = 0;
         vfs_dev->scanbuf_idx = 0;
-        fpi_timeout_add(300, async_sleep_cb, ssm); //wait a bit and see if we're swiping again.
+        fpi_timeout_add(dev->dev, 300, async_sleep_cb, ssm); //wait a bit and see if we're swiping again.
         break;
 
     }
@@ -379,8 +379,8 @@ static void state_init(struct fpi_ssm *ssm)
     case M_INIT_START:
         //couple of synchronous transfers here in the beginning, don't think this hurts much.
         vfs_dev->tmpbuf[0] = 0x1a;
-        libusb_bulk_transfer(dev->udev, EP1_OUT, vfs_dev->tmpbuf, 1, &transferred, BULK_TIMEOUT);
-        libusb_bulk_transfer(dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, &transferred, BULK_TIMEOUT);
+        fpi_usb_bulk_transfer(dev->udev, EP1_OUT, vfs_dev->tmpbuf, 1, &transferred, BULK_TIMEOUT);
+        fpi_usb_bulk_transfer(dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, &transferred, BULK_TIMEOUT);
         fpi_ssm_next_state(ssm);
         break;
     case M_INIT_1_ONGOING:
@@ -389,23 +389,23 @@ static void state_init(struct fpi_ssm *ssm)
         assert(to_send > 0);
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs0050_init1 + vfs_dev->init1_offset, to_send, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_1_STEP2:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_1_STEP3:
         vfs_dev->tmpbuf[0] = 0x01;
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs_dev->tmpbuf, 1, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_1_STEP4:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_2_ONGOING:
         to_send = sizeof(vfs0050_init2) - vfs_dev->init2_offset;
@@ -413,12 +413,12 @@ static void state_init(struct fpi_ssm *ssm)
         assert(to_send > 0);
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_OUT, vfs0050_init2 + vfs_dev->init2_offset, to_send, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_2_RECV_EP1_ONGOING:
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     case M_INIT_2_RECV_EP2_ONGOING:
         if (vfs_dev->calbuf_idx + 64 >= vfs_dev->calbuf_sz) {
@@ -427,7 +427,7 @@ static void state_init(struct fpi_ssm *ssm)
         }
         transfer = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(transfer, dev->udev, EP2_IN, vfs_dev->calbuf + vfs_dev->calbuf_idx, 64, state_init_cb, ssm, BULK_TIMEOUT);
-        libusb_submit_transfer(transfer);
+        fpi_usb_submit_transfer(transfer);
         break;
     default:
         fpi_ssm_mark_completed(ssm);
@@ -458,45 +458,45 @@ static void dev_deactivate(struct fp_img_dev *dev)
     //EP2 IN
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP2_IN, vfs_dev->tmpbuf, 64, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //EP1_IN
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //EP1_OUT
     t = libusb_alloc_transfer(0);
     vfs_dev->tmpbuf[0] = 0x04;
     libusb_fill_bulk_transfer(t, dev->udev, EP1_OUT, vfs_dev->tmpbuf, 1, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //EP1_IN
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //EP1_OUT
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP1_OUT, vfs0050_deactivate1, 64, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //EP1_OUT
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP1_OUT, &vfs0050_deactivate1[64], 61, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     tmpoffset = 0;
     do {
         to_send = sizeof(vfs0050_activate2) - tmpoffset;
         to_send = to_send >= 64 ? 64 : to_send;
         t = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(t, dev->udev, EP1_OUT, vfs0050_activate2 + tmpoffset, to_send, generic_async_cb, NULL, 100);
-        libusb_submit_transfer(t);
+        fpi_usb_submit_transfer(t);
         tmpoffset += err;
     } while (err == 64);
     do {
         t = libusb_alloc_transfer(0);
         libusb_fill_bulk_transfer(t, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, generic_async_cb, NULL, 100);
-        libusb_submit_transfer(t);
+        fpi_usb_submit_transfer(t);
     } while(err == 64);
     t = libusb_alloc_transfer(0);
     libusb_fill_bulk_transfer(t, dev->udev, EP1_IN, vfs_dev->tmpbuf, 64, generic_async_cb, NULL, 100);
-    libusb_submit_transfer(t);
+    fpi_usb_submit_transfer(t);
     //TODO: finish this, leaves device in inconsistent state.
     fpi_imgdev_deactivate_complete(dev);
 }
@@ -521,14 +521,14 @@ static int dev_open(struct fp_img_dev *dev, unsigned long driver_data)
     // way for me to know I'm working with a clean slate and the rest of this will work.
     // Will be trying to reverse engineer more of the protocol so I can avoid resetting
     // the device each time it's opened.
-    libusb_reset_device(dev->udev);
+    fpi_usb_reset_device(dev->udev);
 
-    r = libusb_claim_interface(dev->udev, 0);
+    r = fpi_usb_claim_interface(dev->udev, 0);
     if (r < 0) {
         fp_err("could not claim interface 0");
         return r;
     }
-    libusb_control_transfer(dev->udev, 0x00, 0x09, 0x0001, 0, NULL, 0, 100);
+    fpi_usb_control_transfer(dev->udev, 0x00, 0x09, 0x0001, 0, NULL, 0, 100);
 
 
     vdev = g_malloc0(sizeof(struct vfs0050_dev));
@@ -552,7 +552,7 @@ static void dev_close(struct fp_img_dev *dev)
     g_free(((struct vfs0050_dev *)dev->priv)->scanbuf);
     g_free(dev->priv);
 
-    libusb_release_interface(dev->udev, 0);
+    fpi_usb_release_interface(dev->udev, 0);
 
     fpi_imgdev_close_complete(dev);
 }
@@ -274,7 +274,7 @@ static void async_send(struct fpi_ssm *ssm)
 	libusb_fill_bulk_transfer(vdev->transfer, dev->udev, EP_OUT(1), vdev->buffer, vdev->length, async_send_cb, ssm, BULK_TIMEOUT);
 
 	/* Submit transfer */
-	r = libusb_submit_transfer(vdev->transfer);
+	r = fpi_usb_submit_transfer(vdev->transfer);
 	if (r != 0)
 	{
 		/* Submission of transfer failed, return IO error */
@@ -356,7 +356,7 @@ static void async_recv(struct fpi_ssm *ssm)
 	libusb_fill_bulk_transfer(vdev->transfer, dev->udev, EP_IN(1), vdev->buffer, 0x0f, async_recv_cb, ssm, BULK_TIMEOUT);
 
 	/* Submit transfer */
-	r = libusb_submit_transfer(vdev->transfer);
+	r = fpi_usb_submit_transfer(vdev->transfer);
 	if (r != 0)
 	{
 		/* Submission of transfer failed, free transfer and return IO error */
@@ -461,7 +461,7 @@ static void async_load(struct fpi_ssm *ssm)
 	libusb_fill_bulk_transfer(vdev->transfer, dev->udev, EP_IN(2), buffer, VFS_BLOCK_SIZE, async_load_cb, ssm, BULK_TIMEOUT);
 
 	/* Submit transfer */
-	r = libusb_submit_transfer(vdev->transfer);
+	r = fpi_usb_submit_transfer(vdev->transfer);
 	if (r != 0)
 	{
 		/* Submission of transfer failed, return IO error */
@@ -493,7 +493,7 @@ static void async_sleep(unsigned int msec, struct fpi_ssm *ssm)
 	struct vfs101_dev *vdev = dev->priv;
 
 	/* Add timeout */
-	vdev->timeout = fpi_timeout_add(msec, async_sleep_cb, ssm);
+	vdev->timeout = fpi_timeout_add(dev->dev, msec, async_sleep_cb, ssm);
 
 	if (vdev->timeout == NULL)
 	{
@@ -1487,7 +1487,7 @@ static void dev_deactivate(struct fp_img_dev *dev)
 
 	/* Handle eventualy existing events */
 	while (vdev->transfer || vdev->timeout)
-		fp_handle_events();
+		fp_context_handle_events(dev->dev->ctx);
 
 	/* Notify deactivate complete */
 	fpi_imgdev_deactivate_complete(dev);
@@ -1500,7 +1500,7 @@ static int dev_open(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 
 	/* Claim usb interface */
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0)
 	{
 		/* Interface not claimed, return error */
@@ -1526,7 +1526,7 @@ static void dev_close(struct fp_img_dev *dev)
 	g_free(dev->priv);
 
 	/* Release usb interface */
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 
 	/* Notify close complete */
 	fpi_imgdev_close_complete(dev);
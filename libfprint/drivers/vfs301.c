@@ -53,7 +53,7 @@ static void async_sleep(unsigned int msec, struct fpi_ssm *ssm)
 	struct fpi_timeout *timeout;
 
 	/* Add timeout */
-	timeout = fpi_timeout_add(msec, async_sleep_cb, ssm);
+	timeout = fpi_timeout_add(dev->dev, msec, async_sleep_cb, ssm);
 
 	if (timeout == NULL) {
 		/* Failed to add timeout */
@@ -237,7 +237,7 @@ static int dev_open(struct fp_img_dev *dev, unsigned long driver_data)
 	int r;
 
 	/* Claim usb interface */
-	r = libusb_claim_interface(dev->udev, 0);
+	r = fpi_usb_claim_interface(dev->udev, 0);
 	if (r < 0) {
 		/* Interface not claimed, return error */
 		fp_err("could not claim interface 0");
@@ -264,7 +264,7 @@ static void dev_close(struct fp_img_dev *dev)
 	g_free(dev->priv);
 
 	/* Release usb interface */
-	libusb_release_interface(dev->udev, 0);
+	fpi_usb_release_interface(dev->udev, 0);
 
 	/* Notify close complete */
 	fpi_imgdev_close_complete(dev);
@@ -39,6 +39,8 @@
 #include "vfs301_proto_fragments.h"
 #include <unistd.h>
 
+#include <fp_internal.h>
+
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 
 /************************** USB STUFF *****************************************/
@@ -70,7 +72,7 @@ static int usb_recv(
 {
 	assert(max_bytes <= sizeof(dev->recv_buf));
 
-	int r = libusb_bulk_transfer(
+	int r = fpi_usb_bulk_transfer(
 		devh, endpoint,
 		dev->recv_buf, max_bytes,
 		&dev->recv_len, VFS301_DEFAULT_WAIT_TIMEOUT
@@ -90,7 +92,7 @@ static int usb_send(
 {
 	int transferred = 0;
 
-	int r = libusb_bulk_transfer(
+	int r = fpi_usb_bulk_transfer(
 		devh, VFS301_SEND_ENDPOINT,
 		(unsigned char *)data, length, &transferred, VFS301_DEFAULT_WAIT_TIMEOUT
 	);
@@ -461,7 +463,7 @@ static void vfs301_proto_process_event_cb(struct libusb_transfer *transfer)
 			dev->recv_buf, dev->recv_exp_amt,
 			vfs301_proto_process_event_cb, dev, VFS301_FP_RECV_TIMEOUT);
 
-		if (libusb_submit_transfer(transfer) < 0) {
+		if (fpi_usb_submit_transfer(transfer) < 0) {
 			printf("cb::continue fail\n");
 			dev->recv_progress = VFS301_FAILURE;
 			goto end;
@@ -516,7 +518,7 @@ void vfs301_proto_process_event_start(
 		dev->recv_buf, dev->recv_exp_amt,
 		vfs301_proto_process_event_cb, dev, VFS301_FP_RECV_TIMEOUT);
 
-	if (libusb_submit_transfer(transfer) < 0) {
+	if (fpi_usb_submit_transfer(transfer) < 0) {
 		libusb_free_transfer(transfer);
 		dev->recv_progress = VFS301_FAILURE;
 		return;
@@ -35,14 +35,17 @@
         (type *)( (char *)__mptr - offsetof(type,member) );})
 
 enum fpi_log_level {
-	FPRINT_LOG_LEVEL_DEBUG,
-	FPRINT_LOG_LEVEL_INFO,
-	FPRINT_LOG_LEVEL_WARNING,
-	FPRINT_LOG_LEVEL_ERROR,
+	FPRINT_LOG_LEVEL_DEBUG = FP_LOG_LEVEL_DEBUG,
+	FPRINT_LOG_LEVEL_INFO = FP_LOG_LEVEL_INFO,
+	FPRINT_LOG_LEVEL_WARNING = FP_LOG_LEVEL_WARNING,
+	FPRINT_LOG_LEVEL_ERROR = FP_LOG_LEVEL_ERROR,
 };
 
 void fpi_log(enum fpi_log_level, const char *component, const char *function,
 	const char *format, ...);
+void fpi_log_write(enum fpi_log_level level, const char *component,
+	const char *function, const char *format, va_list args);
+void fpi_log_exit(void);
 
 #ifndef FP_COMPONENT
 #define FP_COMPONENT NULL
@@ -97,6 +100,26 @@ enum fp_dev_state {
 	DEV_STATE_CAPTURE_STOPPING,
 };
 
+/* performance statistics (see stats.c) */
+
+#ifdef ENABLE_STATS
+struct fpi_stats {
+	struct fp_stats stages[FP_STATS_NR_STAGES];
+	uint64_t counters[FP_STATS_NR_COUNTERS];
+};
+
+struct fp_dev;
+void fpi_stats_init(void);
+void fpi_stats_add(struct fp_dev *dev, enum fp_stats_stage stage, gint64 start);
+void fpi_stats_inc(struct fp_dev *dev, enum fp_stats_counter counter);
+#define fpi_stats_start() g_get_monotonic_time()
+#else
+#define fpi_stats_init() ((void) 0)
+#define fpi_stats_add(dev, stage, start) ((void) (start))
+#define fpi_stats_inc(dev, counter) ((void) 0)
+#define fpi_stats_start() ((gint64) 0)
+#endif
+
 struct fp_driver **fprint_get_drivers (void);
 
 struct fp_dev {
@@ -111,6 +134,7 @@ struct fp_dev {
 	struct fp_print_data *verify_data;
 
 	/* drivers should not mess with any of the below */
+	struct fp_context *ctx;
 	enum fp_dev_state state;
 	int __enroll_stage;
 	int unconditional_capture;
@@ -140,6 +164,15 @@ struct fp_dev {
 
 	/* FIXME: better place to put this? */
 	struct fp_print_data **identify_gallery;
+
+	/* idle USB transfers for reuse (see usbpool.c) */
+	struct fpi_usb_pool *usb_pool;
+
+	/* start time of the current open/enroll/verify/identify/capture */
+	gint64 op_start;
+#ifdef ENABLE_STATS
+	struct fpi_stats stats;
+#endif
 };
 
 enum fp_imgdev_state {
@@ -167,6 +200,16 @@ enum fp_imgdev_enroll_state {
 	IMG_ACQUIRE_STATE_DEACTIVATING,
 };
 
+/* an imaging device kept activated between actions, see
+ * fp_dev_set_warm_session() */
+enum fp_imgdev_warm_state {
+	IMG_WARM_STATE_NONE = 0,
+	/* activated, waiting for the next action or the idle timeout */
+	IMG_WARM_STATE_IDLE,
+	/* deactivating after the idle timeout */
+	IMG_WARM_STATE_COOLING,
+};
+
 enum fp_imgdev_verify_state {
 	IMG_VERIFY_STATE_NONE = 0,
 	IMG_VERIFY_STATE_ACTIVATING
@@ -187,11 +230,25 @@ struct fp_img_dev {
 	/* FIXME: better place to put this? */
 	size_t identify_match_offset;
 
+	/* start times for activation and image acquisition statistics */
+	gint64 activate_start;
+	gint64 acquire_start;
+
+	/* warm session: idle timeout in ms (0 if off), and whether the device
+	 * can be left activated after the current action */
+	unsigned int warm_timeout;
+	enum fp_imgdev_warm_state warm_state;
+	struct fpi_timeout *warm_timer;
+	gboolean session_failed;
+	gboolean close_pending;
+
 	void *priv;
 };
 
 int fpi_imgdev_get_img_width(struct fp_img_dev *imgdev);
 int fpi_imgdev_get_img_height(struct fp_img_dev *imgdev);
+void fpi_imgdev_set_warm_timeout(struct fp_img_dev *imgdev,
+	unsigned int timeout);
 
 struct usb_id {
 	uint16_t vendor;
@@ -306,8 +363,35 @@ extern struct fp_img_driver etes603_driver;
 extern struct fp_img_driver vfs0050_driver;
 #endif
 
-extern libusb_context *fpi_usb_ctx;
-extern GSList *opened_devices;
+/* A library context. Everything reachable from a context (devices, timers,
+ * USB I/O) is only ever touched by one thread at a time, see fp_init() for
+ * the rules applications have to follow. Process-wide state outside of
+ * contexts is either read-only after initialization (the driver list) or
+ * synchronized where it is used (logging, statistics, NBIS matching). */
+struct fp_context {
+	libusb_context *usb_ctx;
+	GSList *opened_devices;
+
+	/* pending timeouts, sorted by expiry (see poll.c) */
+	GSList *active_timers;
+	fp_pollfd_added_cb fd_added_cb;
+	fp_pollfd_removed_cb fd_removed_cb;
+
+	/* directory that prints are saved to (see data.c) */
+	char *base_store;
+
+	/* readers present, kept up to date by hotplug events (see core.c) */
+	int hotplug_active;
+	libusb_hotplug_callback_handle hotplug_handle;
+	GSList *dscv_devs;
+	fp_dscv_dev_added_cb dscv_added_cb;
+	fp_dscv_dev_removed_cb dscv_removed_cb;
+	void *hotplug_data;
+};
+
+/* the context behind fp_init() and the context-less API functions */
+extern struct fp_context *fpi_default_ctx;
+struct fp_context *fpi_get_default_ctx(void);
 
 void fpi_img_driver_setup(struct fp_img_driver *idriver);
 
@@ -315,6 +399,7 @@ void fpi_img_driver_setup(struct fp_img_driver *idriver);
 	container_of((drv), struct fp_img_driver, driver)
 
 struct fp_dscv_dev {
+	struct fp_context *ctx;
 	struct libusb_device *udev;
 	struct fp_driver *drv;
 	unsigned long driver_data;
@@ -358,19 +443,48 @@ struct fpi_print_data_item_fp2 {
 	unsigned char data[0];
 } __attribute__((__packed__));
 
-void fpi_data_exit(void);
+void fpi_data_exit(struct fp_context *ctx);
 struct fp_print_data *fpi_print_data_new(struct fp_dev *dev);
 struct fp_print_data_item *fpi_print_data_item_new(size_t length);
 gboolean fpi_print_data_compatible(uint16_t driver_id1, uint32_t devtype1,
 	enum fp_print_data_type type1, uint16_t driver_id2, uint32_t devtype2,
 	enum fp_print_data_type type2);
 
+int fpi_calib_load(struct fp_dev *dev, uint16_t version, void *data,
+	size_t length);
+int fpi_calib_save(struct fp_dev *dev, uint16_t version, const void *data,
+	size_t length);
+void fpi_calib_invalidate(struct fp_dev *dev);
+
+/* Minutiae found by mindtct, one array per attribute. The arrays have room
+ * for alloc minutiae and are grown together by realloc_minutiae(). Once
+ * the ridges have been counted at the end of detection, the neighbour
+ * lists of all minutiae share the nbrs and ridge_counts arrays; those of
+ * minutia i start at nbrs_first[i]. */
 struct fp_minutiae {
 	int alloc;
 	int num;
-	struct fp_minutia **list;
+	int *x;
+	int *y;
+	int *ex;
+	int *ey;
+	int *direction;
+	double *reliability;
+	int *type;
+	int *appearing;
+	int *feature_id;
+	int *num_nbrs;
+	int *nbrs_first;
+	int *nbrs;
+	int *ridge_counts;
+	/* records for fp_img_get_minutiae(), built when first asked for */
+	struct fp_minutia *view;
+	struct fp_minutia **view_list;
 };
 
+void fpi_minutiae_free(struct fp_minutiae *minutiae);
+struct fp_minutia **fpi_minutiae_get_view(struct fp_minutiae *minutiae);
+
 /* bit values for fp_img.flags */
 #define FP_IMG_V_FLIPPED	(1<<0)
 #define FP_IMG_H_FLIPPED	(1<<1)
@@ -380,6 +494,8 @@ struct fp_minutiae {
 #define FP_IMG_STANDARDIZATION_FLAGS (FP_IMG_V_FLIPPED | FP_IMG_H_FLIPPED \
 	| FP_IMG_COLORS_INVERTED)
 
+struct fpi_img_maps;
+
 struct fp_img {
 	int width;
 	int height;
@@ -387,14 +503,34 @@ struct fp_img {
 	uint16_t flags;
 	struct fp_minutiae *minutiae;
 	unsigned char *binarized;
+	/* smaller copy that minutiae are detected in, see fpi_img_set_lowres() */
+	struct fp_img *lowres;
+	/* mindtct's image maps, see fp_img_get_preview() */
+	struct fpi_img_maps *maps;
+	/* contrast of the image in blocks, see block_variance() in img.c */
+	unsigned int *block_variance;
 	unsigned char data[0];
 };
 
 struct fp_img *fpi_img_new(size_t length);
 struct fp_img *fpi_img_new_for_imgdev(struct fp_img_dev *dev);
 struct fp_img *fpi_img_resize(struct fp_img *img, size_t newsize);
+void fpi_img_set_lowres(struct fp_img *img, struct fp_img *lowres);
+void fpi_img_copy_standardized(struct fp_img *img, const unsigned char *src,
+	uint16_t flags);
+
+/* 4bpp pixel formats, see fpi_img_unpack_4bpp() */
+#define FPI_4BPP_COLUMN_MAJOR		(1<<0)
+#define FPI_4BPP_LOW_NIBBLE_FIRST	(1<<1)
+/* map the 16 levels to n << 4 rather than spreading them over 0-255 */
+#define FPI_4BPP_LEVELS_SHIFT		(1<<2)
+
+void fpi_img_unpack_4bpp(unsigned char *output, const unsigned char *input,
+	unsigned int width, unsigned int height, unsigned int format,
+	uint16_t flags);
 gboolean fpi_img_is_sane(struct fp_img *img);
-int fpi_img_detect_minutiae(struct fp_img *img);
+int fpi_img_check_quality(struct fp_img *img);
+int fpi_img_detect_minutiae(struct fp_img_dev *imgdev, struct fp_img *img);
 int fpi_img_to_print_data(struct fp_img_dev *imgdev, struct fp_img *img,
 	struct fp_print_data **ret);
 int fpi_img_compare_print_data(struct fp_print_data *enrolled_print,
@@ -405,16 +541,52 @@ struct fp_img *fpi_im_resize(struct fp_img *img, unsigned int w_factor, unsigned
 
 /* polling and timeouts */
 
-void fpi_poll_init(void);
-void fpi_poll_exit(void);
+void fpi_poll_init(struct fp_context *ctx);
+void fpi_poll_exit(struct fp_context *ctx);
 
 typedef void (*fpi_timeout_fn)(void *data);
 
 struct fpi_timeout;
-struct fpi_timeout *fpi_timeout_add(unsigned int msec, fpi_timeout_fn callback,
-	void *data);
+struct fpi_timeout *fpi_timeout_add(struct fp_dev *dev, unsigned int msec,
+	fpi_timeout_fn callback, void *data);
 void fpi_timeout_cancel(struct fpi_timeout *timeout);
 
+/* USB I/O, optionally recorded or replayed (see usbtrace.c) */
+
+void fpi_usbtrace_init(void);
+void fpi_usbtrace_exit(void);
+void fpi_usbtrace_dev_opened(struct fp_dev *dev, struct fp_dscv_dev *ddev);
+void fpi_usbtrace_dev_closed(struct fp_dev *dev);
+gboolean fpi_usb_replaying(void);
+int fpi_usb_replay_get_device(uint16_t *driver_id, uint32_t *devtype,
+	unsigned long *driver_data);
+
+int fpi_usb_submit_transfer(struct libusb_transfer *transfer);
+int fpi_usb_cancel_transfer(struct libusb_transfer *transfer);
+int fpi_usb_bulk_transfer(libusb_device_handle *udev, unsigned char endpoint,
+	unsigned char *data, int length, int *transferred, unsigned int timeout);
+int fpi_usb_control_transfer(libusb_device_handle *udev, uint8_t request_type,
+	uint8_t request, uint16_t value, uint16_t index, unsigned char *data,
+	uint16_t length, unsigned int timeout);
+int fpi_usb_claim_interface(libusb_device_handle *udev, int iface);
+int fpi_usb_release_interface(libusb_device_handle *udev, int iface);
+int fpi_usb_set_configuration(libusb_device_handle *udev, int config);
+int fpi_usb_reset_device(libusb_device_handle *udev);
+
+struct libusb_transfer *fpi_usb_alloc_transfer(struct fp_dev *dev,
+	size_t length);
+void fpi_usb_free_transfer(struct fp_dev *dev,
+	struct libusb_transfer *transfer);
+void fpi_usb_pool_exit(struct fp_dev *dev);
+
+typedef int (*fpi_usb_stream_data_cb)(unsigned char *data, int length,
+	void *user_data);
+typedef void (*fpi_usb_stream_stopped_cb)(int error, void *user_data);
+int fpi_usb_stream_start(struct fp_dev *dev, unsigned char endpoint,
+	size_t length, int depth, unsigned int timeout,
+	fpi_usb_stream_data_cb data_cb, fpi_usb_stream_stopped_cb stopped_cb,
+	void *user_data);
+
 /* async drv <--> lib comms */
 
 struct fpi_ssm;
@@ -28,6 +28,7 @@ extern "C" {
 #include <sys/time.h>
 
 /* structs that applications are not allowed to peek into */
+struct fp_context;
 struct fp_dscv_dev;
 struct fp_dscv_print;
 struct fp_dev;
@@ -73,6 +74,7 @@ enum fp_scan_type fp_driver_get_scan_type(struct fp_driver *drv);
 
 /* Device discovery */
 struct fp_dscv_dev **fp_discover_devs(void);
+struct fp_dscv_dev **fp_context_discover_devs(struct fp_context *ctx);
 void fp_dscv_devs_free(struct fp_dscv_dev **devs);
 struct fp_driver *fp_dscv_dev_get_driver(struct fp_dscv_dev *dev);
 uint32_t fp_dscv_dev_get_devtype(struct fp_dscv_dev *dev);
@@ -90,8 +92,18 @@ static inline uint16_t fp_dscv_dev_get_driver_id(struct fp_dscv_dev *dev)
 	return fp_driver_get_driver_id(fp_dscv_dev_get_driver(dev));
 }
 
+typedef void (*fp_dscv_dev_added_cb)(struct fp_dscv_dev *dev, void *user_data);
+typedef void (*fp_dscv_dev_removed_cb)(struct fp_dscv_dev *dev,
+	void *user_data);
+int fp_set_hotplug_notifiers(fp_dscv_dev_added_cb added_cb,
+	fp_dscv_dev_removed_cb removed_cb, void *user_data);
+int fp_context_set_hotplug_notifiers(struct fp_context *ctx,
+	fp_dscv_dev_added_cb added_cb, fp_dscv_dev_removed_cb removed_cb,
+	void *user_data);
+
 /* Print discovery */
 struct fp_dscv_print **fp_discover_prints(void);
+struct fp_dscv_print **fp_context_discover_prints(struct fp_context *ctx);
 void fp_dscv_prints_free(struct fp_dscv_print **prints);
 uint16_t fp_dscv_print_get_driver_id(struct fp_dscv_print *print);
 uint32_t fp_dscv_print_get_devtype(struct fp_dscv_print *print);
@@ -123,6 +135,7 @@ int fp_dev_img_capture(struct fp_dev *dev, int unconditional,
 	struct fp_img **image);
 int fp_dev_get_img_width(struct fp_dev *dev);
 int fp_dev_get_img_height(struct fp_dev *dev);
+int fp_dev_set_warm_session(struct fp_dev *dev, unsigned int idle_timeout);
 
 /** \ingroup dev
  * Enrollment result codes returned from fp_enroll_finger().
@@ -257,6 +270,9 @@ int fp_print_data_load(struct fp_dev *dev, enum fp_finger finger,
 int fp_print_data_from_dscv_print(struct fp_dscv_print *print,
 	struct fp_print_data **data);
 int fp_print_data_save(struct fp_print_data *data, enum fp_finger finger);
+int fp_context_print_data_save(struct fp_context *ctx,
+	struct fp_print_data *data, enum fp_finger finger);
+int fp_context_set_storage_dir(struct fp_context *ctx, const char *path);
 int fp_print_data_delete(struct fp_dev *dev, enum fp_finger finger);
 void fp_print_data_free(struct fp_print_data *data);
 size_t fp_print_data_get_data(struct fp_print_data *data, unsigned char **ret);
@@ -290,6 +306,11 @@ int fp_img_save_to_file(struct fp_img *img, char *path);
 void fp_img_standardize(struct fp_img *img);
 struct fp_img *fp_img_binarize(struct fp_img *img);
 struct fp_minutia **fp_img_get_minutiae(struct fp_img *img, int *nr_minutiae);
+int fp_img_get_preview(struct fp_img *img, int *offset_x, int *offset_y);
+const unsigned char *fp_img_get_quality_map(struct fp_img *img, int *width,
+	int *height);
+const int *fp_img_get_direction_map(struct fp_img *img, int *width,
+	int *height);
 void fp_img_free(struct fp_img *img);
 
 /* Polling and timing */
@@ -309,11 +330,132 @@ typedef void (*fp_pollfd_removed_cb)(int fd);
 void fp_set_pollfd_notifiers(fp_pollfd_added_cb added_cb,
 	fp_pollfd_removed_cb removed_cb);
 
+int fp_context_handle_events_timeout(struct fp_context *ctx,
+	struct timeval *timeout);
+int fp_context_handle_events(struct fp_context *ctx);
+size_t fp_context_get_pollfds(struct fp_context *ctx,
+	struct fp_pollfd **pollfds);
+int fp_context_get_next_timeout(struct fp_context *ctx, struct timeval *tv);
+void fp_context_set_pollfd_notifiers(struct fp_context *ctx,
+	fp_pollfd_added_cb added_cb, fp_pollfd_removed_cb removed_cb);
+
 /* Library */
 int fp_init(void);
 void fp_exit(void);
+struct fp_context *fp_context_new(void);
+void fp_context_free(struct fp_context *ctx);
 void fp_set_debug(int level);
 
+/** \ingroup core
+ * Log message levels, in increasing order of severity.
+ */
+enum fp_log_level {
+	FP_LOG_LEVEL_DEBUG = 0,
+	FP_LOG_LEVEL_INFO,
+	FP_LOG_LEVEL_WARNING,
+	FP_LOG_LEVEL_ERROR,
+};
+
+/** \ingroup core
+ * Log message delivery modes, see fp_set_log_mode().
+ */
+enum fp_log_mode {
+	/** Deliver each message as it is logged (the default) */
+	FP_LOG_MODE_SYNC = 0,
+	/** Buffer messages until fp_log_flush() is called */
+	FP_LOG_MODE_BUFFERED,
+	/** Buffer messages and deliver them from a background thread */
+	FP_LOG_MODE_BACKGROUND,
+};
+
+typedef void (*fp_log_handler)(enum fp_log_level level, const char *component,
+	const char *function, int64_t timestamp, const char *message,
+	void *user_data);
+void fp_set_log_handler(fp_log_handler handler, void *user_data);
+int fp_set_log_mode(enum fp_log_mode mode);
+void fp_log_flush(void);
+
+/* Statistics */
+
+/** \ingroup stats
+ * Stages of operation for which timing statistics are collected.
+ */
+enum fp_stats_stage {
+	/** Opening a device, until the device is ready */
+	FP_STATS_STAGE_OPEN = 0,
+	/** Activating an imaging device, until it awaits a finger */
+	FP_STATS_STAGE_ACTIVATE,
+	/** Acquiring an image from the device, from finger detection until
+	 * the image has been received */
+	FP_STATS_STAGE_ACQUIRE,
+	/** Assembling swipe sensor stripes into a single image */
+	FP_STATS_STAGE_ASSEMBLE,
+	/** Standardizing an image (flipping, color inversion) */
+	FP_STATS_STAGE_STANDARDIZE,
+	/** Minutiae extraction */
+	FP_STATS_STAGE_EXTRACT,
+	/** Matching a print against one or more enrolled prints */
+	FP_STATS_STAGE_MATCH,
+	/** Loading a print from disk */
+	FP_STATS_STAGE_STORAGE_LOAD,
+	/** Saving a print to disk */
+	FP_STATS_STAGE_STORAGE_SAVE,
+	/** A whole enrollment stage, from start until the stage result */
+	FP_STATS_STAGE_ENROLL,
+	/** A whole verification, from start until the decision */
+	FP_STATS_STAGE_VERIFY,
+	/** A whole identification, from start until the decision */
+	FP_STATS_STAGE_IDENTIFY,
+	/** A whole image capture, from start until the image is returned */
+	FP_STATS_STAGE_CAPTURE,
+	FP_STATS_NR_STAGES,
+};
+
+/** \ingroup stats
+ * Event counters.
+ */
+enum fp_stats_counter {
+	/** Images received from imaging devices */
+	FP_STATS_IMAGES_CAPTURED = 0,
+	/** Scans which had to be retried, see \ref fp_enroll_result */
+	FP_STATS_RETRIES,
+	/** Verifications and identifications which found a match */
+	FP_STATS_MATCHES,
+	/** Verifications and identifications which did not find a match */
+	FP_STATS_NO_MATCHES,
+	/** Operations which failed with an error */
+	FP_STATS_ERRORS,
+	/** Errors reported by the NBIS minutiae detection. Only counted if
+	 * libfprint was configured with --enable-nbis-log. */
+	FP_STATS_NBIS_ERRORS,
+	FP_STATS_NR_COUNTERS,
+};
+
+#define FP_STATS_NR_BUCKETS 32
+
+/** \ingroup stats
+ * Timing statistics for a single stage.
+ */
+struct fp_stats {
+	/** Number of samples recorded */
+	uint64_t count;
+	/** Sum of all sample durations, in microseconds */
+	uint64_t total_usec;
+	/** Shortest sample, in microseconds. 0 if there are no samples. */
+	uint64_t min_usec;
+	/** Longest sample, in microseconds */
+	uint64_t max_usec;
+	/** Number of samples which took between 2^i and 2^(i+1) microseconds */
+	uint64_t histogram[FP_STATS_NR_BUCKETS];
+};
+
+int fp_stats_get(struct fp_dev *dev, enum fp_stats_stage stage,
+	struct fp_stats *stats);
+int fp_stats_get_counter(struct fp_dev *dev, enum fp_stats_counter counter,
+	uint64_t *value);
+int fp_stats_reset(struct fp_dev *dev);
+const char *fp_stats_stage_get_name(enum fp_stats_stage stage);
+
 /* Asynchronous I/O */
 
 typedef void (*fp_dev_open_cb)(struct fp_dev *dev, int status, void *user_data);
@@ -19,6 +19,7 @@
 
 #include <sys/types.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -45,6 +46,8 @@
  * natural upright orientation.
  */
 
+static void img_maps_free(struct fpi_img_maps *maps);
+
 struct fp_img *fpi_img_new(size_t length)
 {
 	struct fp_img *img = g_malloc0(sizeof(*img) + length);
@@ -79,6 +82,8 @@ gboolean fpi_img_is_sane(struct fp_img *img)
 
 struct fp_img *fpi_img_resize(struct fp_img *img, size_t newsize)
 {
+	g_free(img->block_variance);
+	img->block_variance = NULL;
 	return g_realloc(img, sizeof(*img) + newsize);
 }
 
@@ -91,10 +96,12 @@ API_EXPORTED void fp_img_free(struct fp_img *img)
 	if (!img)
 		return;
 
-	if (img->minutiae)
-		free_minutiae(img->minutiae);
+	fpi_minutiae_free(img->minutiae);
 	if (img->binarized)
 		free(img->binarized);
+	fp_img_free(img->lowres);
+	img_maps_free(img->maps);
+	g_free(img->block_variance);
 	g_free(img);
 }
 
@@ -164,49 +171,114 @@ API_EXPORTED int fp_img_save_to_file(struct fp_img *img, char *path)
 	return 0;
 }
 
-static void vflip(struct fp_img *img)
+/* Copy a row of pixels, optionally mirroring and/or inverting it on the way.
+ * With reverse set, dst and src must not overlap; otherwise they may be the
+ * same row. The bulk of the row is processed 8 pixels at a time: mirroring
+ * 8 pixels is a byte swap of a 64-bit word (whatever the host byte order),
+ * and inverting a pixel is the same as 0xff - pixel. */
+static void copy_row(unsigned char *dst, const unsigned char *src, int width,
+	int reverse, int invert)
 {
-	int width = img->width;
-	int data_len = img->width * img->height;
-	unsigned char rowbuf[width];
+	uint64_t mask = invert ? ~(uint64_t) 0 : 0;
+	int words = width / 8;
+	int rem = width % 8;
+	uint64_t word;
 	int i;
 
-	for (i = 0; i < img->height / 2; i++) {
-		int offset = i * width;
-		int swap_offset = data_len - (width * (i + 1));
-
-		/* copy top row into buffer */
-		memcpy(rowbuf, img->data + offset, width);
+	if (!reverse) {
+		if (!invert) {
+			if (dst != src)
+				memcpy(dst, src, width);
+			return;
+		}
+		for (i = 0; i < words * 8; i += 8) {
+			memcpy(&word, src + i, 8);
+			word ^= mask;
+			memcpy(dst + i, &word, 8);
+		}
+		for (; i < width; i++)
+			dst[i] = 0xff - src[i];
+		return;
+	}
 
-		/* copy lower row over upper row */
-		memcpy(img->data + offset, img->data + swap_offset, width);
+	/* dst[i] = src[width - 1 - i] */
+	for (i = 0; i < words; i++) {
+		memcpy(&word, src + width - 8 * (i + 1), 8);
+		word = GUINT64_SWAP_LE_BE(word) ^ mask;
+		memcpy(dst + 8 * i, &word, 8);
+	}
+	dst += words * 8;
+	for (i = 0; i < rem; i++)
+		dst[i] = src[rem - 1 - i] ^ (unsigned char) mask;
+}
 
-		/* copy buffer over lower row */
-		memcpy(img->data + swap_offset, rowbuf, width);
+/* Mirror and/or invert a row in place, using rowbuf as scratch space */
+static void standardize_row(unsigned char *row, unsigned char *rowbuf,
+	int width, int reverse, int invert)
+{
+	if (reverse) {
+		memcpy(rowbuf, row, width);
+		copy_row(row, rowbuf, width, reverse, invert);
+	} else {
+		copy_row(row, row, width, reverse, invert);
 	}
 }
 
-static void hflip(struct fp_img *img)
+/* Apply any combination of the standardization flags in a single pass over
+ * the image. Vertical flipping swaps pairs of rows, and each row is mirrored
+ * and/or inverted while it is being moved. */
+static void standardize_in_place(struct fp_img *img, uint16_t flags)
 {
 	int width = img->width;
+	int height = img->height;
+	int reverse = flags & FP_IMG_H_FLIPPED;
+	int invert = flags & FP_IMG_COLORS_INVERTED;
 	unsigned char rowbuf[width];
-	int i, j;
+	int i;
+
+	if (!(flags & FP_IMG_V_FLIPPED)) {
+		for (i = 0; i < height; i++)
+			standardize_row(img->data + i * width, rowbuf, width,
+				reverse, invert);
+		return;
+	}
 
-	for (i = 0; i < img->height; i++) {
-		int offset = i * width;
+	for (i = 0; i < height / 2; i++) {
+		unsigned char *top = img->data + i * width;
+		unsigned char *bottom = img->data + (height - i - 1) * width;
 
-		memcpy(rowbuf, img->data + offset, width);
-		for (j = 0; j < width; j++)
-			img->data[offset + j] = rowbuf[width - j - 1];
+		memcpy(rowbuf, top, width);
+		copy_row(top, bottom, width, reverse, invert);
+		copy_row(bottom, rowbuf, width, reverse, invert);
 	}
+
+	/* the middle row of an odd height image stays where it is */
+	if (height % 2)
+		standardize_row(img->data + i * width, rowbuf, width, reverse,
+			invert);
 }
 
-static void invert_colors(struct fp_img *img)
+/* For drivers that decode into a fresh buffer: copy the raw image data at
+ * src (img->width * img->height pixels) into img, applying the given
+ * standardization flags on the way. This leaves no work for
+ * fp_img_standardize(), so the flags must not also be set on img. */
+void fpi_img_copy_standardized(struct fp_img *img, const unsigned char *src,
+	uint16_t flags)
 {
-	int data_len = img->width * img->height;
+	int width = img->width;
+	int height = img->height;
 	int i;
-	for (i = 0; i < data_len; i++)
-		img->data[i] = 0xff - img->data[i];
+
+	for (i = 0; i < height; i++) {
+		const unsigned char *row = src;
+
+		if (flags & FP_IMG_V_FLIPPED)
+			row += (height - i - 1) * width;
+		else
+			row += i * width;
+		copy_row(img->data + i * width, row, width,
+			flags & FP_IMG_H_FLIPPED, flags & FP_IMG_COLORS_INVERTED);
+	}
 }
 
 /** \ingroup img
@@ -218,18 +290,28 @@ static void invert_colors(struct fp_img *img)
  */
 API_EXPORTED void fp_img_standardize(struct fp_img *img)
 {
-	if (img->flags & FP_IMG_V_FLIPPED) {
-		vflip(img);
-		img->flags &= ~FP_IMG_V_FLIPPED;
-	}
-	if (img->flags & FP_IMG_H_FLIPPED) {
-		hflip(img);
-		img->flags &= ~FP_IMG_H_FLIPPED;
-	}
-	if (img->flags & FP_IMG_COLORS_INVERTED) {
-		invert_colors(img);
-		img->flags &= ~FP_IMG_COLORS_INVERTED;
-	}
+	uint16_t flags = img->flags & FP_IMG_STANDARDIZATION_FLAGS;
+
+	if (img->lowres)
+		fp_img_standardize(img->lowres);
+	if (!flags)
+		return;
+	standardize_in_place(img, flags);
+	img->flags &= ~FP_IMG_STANDARDIZATION_FLAGS;
+	g_free(img->block_variance);
+	img->block_variance = NULL;
+}
+
+/* Some drivers enlarge small images so that mindtct can process them, and
+ * the enlarged image is what applications get to see. Where the enlargement
+ * gives mindtct more pixels than it needs, a copy enlarged less can be
+ * attached, and minutiae are then detected in that copy instead. The image
+ * takes ownership of the copy. */
+void fpi_img_set_lowres(struct fp_img *img, struct fp_img *lowres)
+{
+	fp_img_free(img->lowres);
+	lowres->flags = img->flags;
+	img->lowres = lowres;
 }
 
 /* Based on write_minutiae_XYTQ and bz_load */
@@ -237,8 +319,10 @@ static void minutiae_to_xyt(struct fp_minutiae *minutiae, int bwidth,
 	int bheight, unsigned char *buf)
 {
 	int i;
-	struct fp_minutia *minutia;
+	struct fp_minutia minutia;
 	struct minutiae_struct c[MAX_FILE_MINUTIAE];
+	int keys[MAX_FILE_MINUTIAE];
+	int order[MAX_FILE_MINUTIAE];
 	struct xyt_struct *xyt = (struct xyt_struct *) buf;
 
 	/* FIXME: only considers first 150 minutiae (MAX_FILE_MINUTIAE) */
@@ -246,50 +330,438 @@ static void minutiae_to_xyt(struct fp_minutiae *minutiae, int bwidth,
 	int nmin = min(minutiae->num, MAX_FILE_MINUTIAE);
 
 	for (i = 0; i < nmin; i++){
-		minutia = minutiae->list[i];
+		/* the attributes the conversion looks at */
+		minutia.x = minutiae->x[i];
+		minutia.y = minutiae->y[i];
+		minutia.direction = minutiae->direction[i];
 
 		lfs2nist_minutia_XYT(&c[i].col[0], &c[i].col[1], &c[i].col[2],
-				minutia, bwidth, bheight);
-		c[i].col[3] = sround(minutia->reliability * 100.0);
+				&minutia, bwidth, bheight);
+		c[i].col[3] = sround(minutiae->reliability[i] * 100.0);
 
 		if (c[i].col[2] > 180)
 			c[i].col[2] -= 360;
+
+		/* y is in 1..bheight, so this orders like sort_x_y */
+		keys[i] = c[i].col[0] * (bheight + 1) + c[i].col[1];
+		order[i] = i;
 	}
 
-	qsort((void *) &c, (size_t) nmin, sizeof(struct minutiae_struct),
-			sort_x_y);
+	/* keeps minutiae at the same spot in the order mindtct found them in,
+	 * unlike qsort which may or may not */
+	if (radix_sort_int_inc_2(keys, order, nmin) < 0) {
+		qsort((void *) &c, (size_t) nmin, sizeof(struct minutiae_struct),
+				sort_x_y);
+		for (i = 0; i < nmin; i++)
+			order[i] = i;
+	}
 
 	for (i = 0; i < nmin; i++) {
-		xyt->xcol[i]     = c[i].col[0];
-		xyt->ycol[i]     = c[i].col[1];
-		xyt->thetacol[i] = c[i].col[2];
+		xyt->xcol[i]     = c[order[i]].col[0];
+		xyt->ycol[i]     = c[order[i]].col[1];
+		xyt->thetacol[i] = c[order[i]].col[2];
 	}
 	xyt->nrows = nmin;
 }
 
-int fpi_img_detect_minutiae(struct fp_img *img)
+/* Blank margins cost mindtct as much time as the print itself, so images
+ * are cropped to the blocks that show any texture at all before minutiae
+ * detection. Blocks this flat are low contrast to mindtct, which would not
+ * find minutiae in them anyway. */
+#define ROI_BLOCKSIZE		16
+#define ROI_MIN_VARIANCE	4
+/* kept around the foreground so that mindtct's handling of the image edges
+ * stays clear of the ridges. A multiple of mindtct's block size, so that
+ * its blocks line up with those of the whole image. */
+#define ROI_MARGIN		(2 * MAP_BLOCKSIZE_V2)
+/* not worth copying the image for less than this (in percent of its area) */
+#define ROI_MIN_SAVING		10
+
+struct img_roi {
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+/* not worked out yet, above any variance of 8 bit pixels */
+#define BLOCK_VARIANCE_UNKNOWN	UINT_MAX
+
+/* Variance of the pixel values in the block of the image at bx,by. The
+ * quality check and the foreground crop both go over these blocks, so they
+ * are kept with the image and each is only worked out once. */
+static unsigned int block_variance(struct fp_img *img, int bx, int by)
 {
-	struct fp_minutiae *minutiae;
+	int blocks_x = (img->width + ROI_BLOCKSIZE - 1) / ROI_BLOCKSIZE;
+	int bw = min(ROI_BLOCKSIZE, img->width - bx);
+	int bh = min(ROI_BLOCKSIZE, img->height - by);
+	unsigned int sum = 0, sum_sq = 0;
+	uint64_t n = bw * bh;
+	unsigned int *var;
+	int col, row;
+
+	if (!img->block_variance) {
+		int blocks_y = (img->height + ROI_BLOCKSIZE - 1) / ROI_BLOCKSIZE;
+		size_t size = blocks_x * blocks_y * sizeof(*img->block_variance);
+
+		img->block_variance = g_malloc(size);
+		memset(img->block_variance, 0xff, size);
+	}
+
+	var = &img->block_variance[by / ROI_BLOCKSIZE * blocks_x
+		+ bx / ROI_BLOCKSIZE];
+	if (*var != BLOCK_VARIANCE_UNKNOWN)
+		return *var;
+
+	for (row = by; row < by + bh; row++) {
+		const unsigned char *p = img->data + row * img->width + bx;
+		for (col = 0; col < bw; col++) {
+			sum += p[col];
+			sum_sq += p[col] * p[col];
+		}
+	}
+
+	*var = (n * sum_sq - (uint64_t) sum * sum) / (n * n);
+	return *var;
+}
+
+static gboolean find_foreground(struct fp_img *img, struct img_roi *roi)
+{
+	int x0 = img->width, y0 = img->height, x1 = 0, y1 = 0;
+	int bx, by;
+
+	for (by = 0; by < img->height; by += ROI_BLOCKSIZE) {
+		int bh = min(ROI_BLOCKSIZE, img->height - by);
+
+		for (bx = 0; bx < img->width; bx += ROI_BLOCKSIZE) {
+			int bw = min(ROI_BLOCKSIZE, img->width - bx);
+
+			/* can't grow the box */
+			if (bx >= x0 && bx + bw <= x1 && by >= y0 && by + bh <= y1)
+				continue;
+			if (block_variance(img, bx, by) < ROI_MIN_VARIANCE)
+				continue;
+
+			x0 = min(x0, bx);
+			y0 = min(y0, by);
+			x1 = max(x1, bx + bw);
+			y1 = max(y1, by + bh);
+		}
+	}
+
+	/* nothing but background: leave it to mindtct to find nothing */
+	if (x1 == 0)
+		return FALSE;
+
+	roi->x = max(0, x0 - ROI_MARGIN);
+	roi->y = max(0, y0 - ROI_MARGIN);
+	roi->width = min(img->width, x1 + ROI_MARGIN) - roi->x;
+	roi->height = min(img->height, y1 + ROI_MARGIN) - roi->y;
+
+	return roi->width * roi->height * 100
+		<= img->width * img->height * (100 - ROI_MIN_SAVING);
+}
+
+static unsigned char *crop_image(struct fp_img *img, struct img_roi *roi)
+{
+	unsigned char *data = g_malloc(roi->width * roi->height);
+	int row;
+
+	for (row = 0; row < roi->height; row++)
+		memcpy(data + row * roi->width,
+			img->data + (roi->y + row) * img->width + roi->x, roi->width);
+	return data;
+}
+
+/* Move minutiae found in the cropped image to where they are in the whole
+ * image, and pad the binarized image back to full size. mindtct only ever
+ * saw the cropped image, so this gives the same coordinates as detection on
+ * the whole image would, but not necessarily the same minutiae: near the
+ * crop edges its maps and ridge tracing may differ, which is why the crop
+ * keeps a ROI_MARGIN around the print. */
+static unsigned char *uncrop_results(struct fp_img *img, struct img_roi *roi,
+	struct fp_minutiae *minutiae, unsigned char *bdata)
+{
+	unsigned char *full;
+	int i;
+	int row;
+
+	for (i = 0; i < minutiae->num; i++) {
+		minutiae->x[i] += roi->x;
+		minutiae->y[i] += roi->y;
+		minutiae->ex[i] += roi->x;
+		minutiae->ey[i] += roi->y;
+	}
+
+	/* freed with free() in fp_img_free() */
+	full = malloc(img->width * img->height);
+	memset(full, 0xff, img->width * img->height);
+	for (row = 0; row < roi->height; row++)
+		memcpy(full + (roi->y + row) * img->width + roi->x,
+			bdata + row * roi->width, roi->width);
+	free(bdata);
+	return full;
+}
+
+/* Captures that cannot possibly yield enough minutiae for a print are
+ * turned away before mindtct runs. The limits are far below what a usable
+ * print needs, so that only clearly bad captures are rejected here. */
+/* a contrast (standard deviation) of 8 grey levels */
+#define QUALITY_MIN_VARIANCE	64
+/* blocks of ROI_BLOCKSIZE, about 10mm^2 at 500 dpi */
+#define QUALITY_MIN_BLOCKS	16
+#define QUALITY_MIN_HEIGHT	(3 * ROI_BLOCKSIZE)
+
+/* Returns 0 if the image is worth extracting minutiae from, otherwise the
+ * FP_ENROLL_RETRY code that says why not. */
+int fpi_img_check_quality(struct fp_img *img)
+{
+	int good_blocks = 0;
+	int bx, by;
+
+	if (img->height < QUALITY_MIN_HEIGHT) {
+		fp_dbg("image only %d lines high", img->height);
+		return FP_ENROLL_RETRY_TOO_SHORT;
+	}
+
+	for (by = 0; by < img->height; by += ROI_BLOCKSIZE)
+		for (bx = 0; bx < img->width; bx += ROI_BLOCKSIZE)
+			if (block_variance(img, bx, by) >= QUALITY_MIN_VARIANCE
+					&& ++good_blocks >= QUALITY_MIN_BLOCKS)
+				return 0;
+
+	fp_dbg("only %d blocks with enough contrast", good_blocks);
+	return FP_ENROLL_RETRY;
+}
+
+/* pixel in an image of size to corresponding to pixel pos in one of size
+ * from, with pixel centres lined up the way bilinear scaling does */
+#define SCALE_POS(pos, from, to)	((2 * (pos) + 1) * (to) / (2 * (from)))
+
+/* Move minutiae found in the low resolution copy of an image to where they
+ * are in the image, and scale the binarized image up to its size. */
+static unsigned char *upscale_results(struct fp_img *img,
+	struct fp_img *lowres, struct fp_minutiae *minutiae,
+	unsigned char *bdata)
+{
+	unsigned char *full;
+	int *cols;
+	int i;
+	int row;
+
+	for (i = 0; i < minutiae->num; i++) {
+		minutiae->x[i] = SCALE_POS(minutiae->x[i], lowres->width,
+			img->width);
+		minutiae->y[i] = SCALE_POS(minutiae->y[i], lowres->height,
+			img->height);
+		minutiae->ex[i] = SCALE_POS(minutiae->ex[i], lowres->width,
+			img->width);
+		minutiae->ey[i] = SCALE_POS(minutiae->ey[i], lowres->height,
+			img->height);
+	}
+
+	cols = g_malloc(img->width * sizeof(*cols));
+	for (i = 0; i < img->width; i++)
+		cols[i] = SCALE_POS(i, img->width, lowres->width);
+
+	/* freed with free() in fp_img_free() */
+	full = malloc(img->width * img->height);
+	for (row = 0; row < img->height; row++) {
+		unsigned char *dst = full + row * img->width;
+		const unsigned char *src = bdata
+			+ SCALE_POS(row, img->height, lowres->height) * lowres->width;
+		for (i = 0; i < img->width; i++)
+			dst[i] = src[cols[i]];
+	}
+
+	g_free(cols);
+	free(bdata);
+	return full;
+}
+
+/* Minutiae detection comes in two tiers. The first generates mindtct's
+ * image maps, which say where the print is and how clear its ridges are;
+ * that is all a live preview needs. The second binarizes the image and
+ * finds the minutiae, reusing the maps of the first. */
+struct fpi_img_maps {
+	/* dropped once minutiae have been detected from them */
+	LFSMAPS *lfs;
+	/* the crop of the image the maps are for, if cropped */
+	unsigned char *data;
+	struct img_roi roi;
+	gboolean cropped;
+
+	/* for the preview API: maps over the whole image, in blocks of
+	 * MAP_BLOCKSIZE_V2 pixels, and what they tell about the print */
+	int width;
+	int height;
+	unsigned char *quality;
+	int *direction;
+	int nr_minutiae;
+	int offset_x;
+	int offset_y;
+};
+
+/* Blocks of at least this quality (in mindtct's 0-4 grading) are where
+ * minutiae are reliably found. */
+#define PREVIEW_GOOD_QUALITY		3
+/* Good blocks per minutia to expect: a print shows about one minutia in
+ * every 4mm^2 of clear ridges, and a block at DEFAULT_PPI is 0.165mm^2. */
+#define PREVIEW_BLOCKS_PER_MINUTIA	24
+
+static void img_maps_free(struct fpi_img_maps *maps)
+{
+	if (!maps)
+		return;
+
+	free_image_maps(maps->lfs);
+	g_free(maps->data);
+	g_free(maps->quality);
+	g_free(maps->direction);
+	g_free(maps);
+}
+
+/* Spread the maps of the (cropped, low resolution) image mindtct looked at
+ * over the whole image, and estimate minutiae count and finger position
+ * from them. */
+static void summarize_maps(struct fp_img *img, struct fp_img *src,
+	struct fpi_img_maps *maps)
+{
+	const int bs = MAP_BLOCKSIZE_V2;
+	LFSMAPS *lfs = maps->lfs;
+	int good = 0, good_lfs;
+	int64_t sum_x = 0, sum_y = 0;
+	int bx, by;
+	int i;
+
+	maps->width = (img->width + bs - 1) / bs;
+	maps->height = (img->height + bs - 1) / bs;
+	maps->quality = g_malloc(maps->width * maps->height);
+	maps->direction = g_malloc(maps->width * maps->height
+		* sizeof(*maps->direction));
+
+	for (by = 0; by < maps->height; by++) {
+		for (bx = 0; bx < maps->width; bx++) {
+			/* centre of the block */
+			int px = min(bx * bs + bs / 2, img->width - 1);
+			int py = min(by * bs + bs / 2, img->height - 1);
+			int m;
+
+			i = by * maps->width + bx;
+			if (src != img) {
+				px = SCALE_POS(px, img->width, src->width);
+				py = SCALE_POS(py, img->height, src->height);
+			}
+			px -= maps->roi.x;
+			py -= maps->roi.y;
+
+			/* cropped away as background */
+			if (px < 0 || py < 0 || px >= maps->roi.width
+					|| py >= maps->roi.height) {
+				maps->quality[i] = 0;
+				maps->direction[i] = -1;
+				continue;
+			}
+
+			m = (py / bs) * lfs->mw + px / bs;
+			maps->quality[i] = lfs->quality_map[m];
+			maps->direction[i] = lfs->direction_map[m];
+			if (maps->quality[i] >= PREVIEW_GOOD_QUALITY) {
+				good++;
+				sum_x += bx;
+				sum_y += by;
+			}
+		}
+	}
+
+	/* counted at the resolution minutiae are detected at */
+	good_lfs = 0;
+	for (i = 0; i < lfs->mw * lfs->mh; i++)
+		if (lfs->quality_map[i] >= PREVIEW_GOOD_QUALITY)
+			good_lfs++;
+	maps->nr_minutiae = good_lfs / PREVIEW_BLOCKS_PER_MINUTIA;
+
+	if (good) {
+		maps->offset_x = sum_x * bs / good + bs / 2 - img->width / 2;
+		maps->offset_y = sum_y * bs / good + bs / 2 - img->height / 2;
+	}
+}
+
+/* The first tier: generate the image maps and attach them to the image */
+static int img_detect_maps(struct fp_img *img)
+{
+	struct fp_img *src = img->lowres ? img->lowres : img;
+	struct fpi_img_maps *maps;
+	unsigned char *data = src->data;
 	int r;
-	int *direction_map, *low_contrast_map, *low_flow_map;
-	int *high_curve_map, *quality_map;
-	int map_w, map_h;
+
+	if (img->flags & FP_IMG_STANDARDIZATION_FLAGS) {
+		fp_err("cant detect minutiae for non-standardized image");
+		return -EINVAL;
+	}
+
+	maps = g_malloc0(sizeof(*maps));
+	maps->cropped = find_foreground(src, &maps->roi);
+	if (maps->cropped) {
+		fp_dbg("foreground is %dx%d at %d,%d of %dx%d", maps->roi.width,
+			maps->roi.height, maps->roi.x, maps->roi.y, src->width,
+			src->height);
+		data = maps->data = crop_image(src, &maps->roi);
+	} else {
+		maps->roi.x = 0;
+		maps->roi.y = 0;
+		maps->roi.width = src->width;
+		maps->roi.height = src->height;
+	}
+
+	r = get_image_maps(&maps->lfs, data, maps->roi.width, maps->roi.height,
+		8, &g_lfsparms_V2);
+	if (r) {
+		fp_err("get image maps failed, code %d", r);
+		img_maps_free(maps);
+		return r;
+	}
+
+	summarize_maps(img, src, maps);
+	img_maps_free(img->maps);
+	img->maps = maps;
+	return 0;
+}
+
+/* imgdev may be NULL when the image did not come from a device */
+int fpi_img_detect_minutiae(struct fp_img_dev *imgdev, struct fp_img *img)
+{
+	struct fp_minutiae *minutiae;
+	struct fpi_img_maps *maps;
+	int r = 0;
 	unsigned char *bdata;
 	int bw, bh, bd;
 	GTimer *timer;
+	gint64 start;
+	struct fp_img *src = img->lowres ? img->lowres : img;
 
 	if (img->flags & FP_IMG_STANDARDIZATION_FLAGS) {
 		fp_err("cant detect minutiae for non-standardized image");
 		return -EINVAL;
 	}
 
-	/* 25.4 mm per inch */
 	timer = g_timer_new();
-	r = get_minutiae(&minutiae, &quality_map, &direction_map,
-                         &low_contrast_map, &low_flow_map, &high_curve_map,
-                         &map_w, &map_h, &bdata, &bw, &bh, &bd,
-                         img->data, img->width, img->height, 8,
-						 DEFAULT_PPI / (double)25.4, &g_lfsparms_V2);
+	start = fpi_stats_start();
+	/* a preview may have done the first tier already */
+	if (!img->maps || !img->maps->lfs)
+		r = img_detect_maps(img);
+	maps = img->maps;
+	/* 25.4 mm per inch */
+	if (!r)
+		r = get_minutiae_from_maps(&minutiae, &bdata, &bw, &bh, &bd, maps->lfs,
+			maps->cropped ? maps->data : src->data, maps->roi.width,
+			maps->roi.height, 8, DEFAULT_PPI / (double)25.4,
+			&g_lfsparms_V2);
+	if (!r && maps->cropped)
+		bdata = uncrop_results(src, &maps->roi, minutiae, bdata);
+	if (!r && src != img)
+		bdata = upscale_results(img, src, minutiae, bdata);
+	fpi_stats_add(imgdev ? imgdev->dev : NULL, FP_STATS_STAGE_EXTRACT, start);
 	g_timer_stop(timer);
 	fp_dbg("minutiae scan completed in %f secs", g_timer_elapsed(timer, NULL));
 	g_timer_destroy(timer);
@@ -301,11 +773,11 @@ int fpi_img_detect_minutiae(struct fp_img *img)
 	img->minutiae = minutiae;
 	img->binarized = bdata;
 
-	free(quality_map);
-	free(direction_map);
-	free(low_contrast_map);
-	free(low_flow_map);
-	free(high_curve_map);
+	/* only the preview of the maps is of any further use */
+	free_image_maps(maps->lfs);
+	maps->lfs = NULL;
+	g_free(maps->data);
+	maps->data = NULL;
 	return minutiae->num;
 }
 
@@ -317,7 +789,7 @@ int fpi_img_to_print_data(struct fp_img_dev *imgdev, struct fp_img *img,
 	int r;
 
 	if (!img->minutiae) {
-		r = fpi_img_detect_minutiae(img);
+		r = fpi_img_detect_minutiae(imgdev, img);
 		if (r < 0)
 			return r;
 		if (!img->minutiae) {
@@ -342,6 +814,10 @@ int fpi_img_to_print_data(struct fp_img_dev *imgdev, struct fp_img *img,
 	return 0;
 }
 
+/* bozorth3 keeps its working tables in global variables, so matches from
+ * different threads have to take turns. mindtct has no such state. */
+static GMutex bozorth_lock;
+
 int fpi_img_compare_print_data(struct fp_print_data *enrolled_print,
 	struct fp_print_data *new_print)
 {
@@ -365,6 +841,7 @@ int fpi_img_compare_print_data(struct fp_print_data *enrolled_print,
 	data_item = new_print->prints->data;
 	pstruct = (struct xyt_struct *)data_item->data;
 
+	g_mutex_lock(&bozorth_lock);
 	probe_len = bozorth_probe_init(pstruct);
 	list_item = enrolled_print->prints;
 	do {
@@ -375,6 +852,7 @@ int fpi_img_compare_print_data(struct fp_print_data *enrolled_print,
 		max_score = max(score, max_score);
 		list_item = g_slist_next(list_item);
 	} while (list_item);
+	g_mutex_unlock(&bozorth_lock);
 
 	return max_score;
 }
@@ -399,6 +877,7 @@ int fpi_img_compare_print_data_to_gallery(struct fp_print_data *print,
 	data_item = print->prints->data;
 	pstruct = (struct xyt_struct *)data_item->data;
 
+	g_mutex_lock(&bozorth_lock);
 	probe_len = bozorth_probe_init(pstruct);
 	while ((gallery_print = gallery[i++])) {
 		list_item = gallery_print->prints;
@@ -407,12 +886,14 @@ int fpi_img_compare_print_data_to_gallery(struct fp_print_data *print,
 			gstruct = (struct xyt_struct *)data_item->data;
 			r = bozorth_to_gallery(probe_len, pstruct, gstruct);
 			if (r >= match_threshold) {
+				g_mutex_unlock(&bozorth_lock);
 				*match_offset = i - 1;
 				return FP_VERIFY_MATCH;
 			}
 			list_item = g_slist_next(list_item);
 		} while (list_item);
 	}
+	g_mutex_unlock(&bozorth_lock);
 	return FP_VERIFY_NO_MATCH;
 }
 
@@ -447,7 +928,7 @@ API_EXPORTED struct fp_img *fp_img_binarize(struct fp_img *img)
 	}
 
 	if (!img->binarized) {
-		int r = fpi_img_detect_minutiae(img);
+		int r = fpi_img_detect_minutiae(NULL, img);
 		if (r < 0)
 			return NULL;
 		if (!img->binarized) {
@@ -495,7 +976,7 @@ API_EXPORTED struct fp_minutia **fp_img_get_minutiae(struct fp_img *img,
 	}
 
 	if (!img->minutiae) {
-		int r = fpi_img_detect_minutiae(img);
+		int r = fpi_img_detect_minutiae(NULL, img);
 		if (r < 0)
 			return NULL;
 		if (!img->minutiae) {
@@ -505,6 +986,114 @@ API_EXPORTED struct fp_minutia **fp_img_get_minutiae(struct fp_img *img,
 	}
 
 	*nr_minutiae = img->minutiae->num;
-	return img->minutiae->list;
+	return fpi_minutiae_get_view(img->minutiae);
+}
+
+
+static struct fpi_img_maps *get_maps(struct fp_img *img)
+{
+	if (img->flags & FP_IMG_BINARIZED_FORM) {
+		fp_err("image is binarized");
+		return NULL;
+	}
+
+	if (!img->maps && img_detect_maps(img) < 0)
+		return NULL;
+	return img->maps;
+}
+
+/** \ingroup img
+ * Get a quick impression of the print in an image: roughly how many
+ * minutiae can be expected from it, and how far the finger is off the
+ * centre of the image. This is meant for giving feedback on every frame of
+ * a live capture, such as asking the user to move their finger.
+ *
+ * Only the first part of minutiae detection is done for this, which skips
+ * binarization and the search for minutiae. That part is not repeated
+ * when fp_img_get_minutiae() or fp_img_binarize() is called on the same
+ * image later on.
+ *
+ * The estimate is coarse: it follows from the area of the print where
+ * ridges are clear, not from minutiae actually found. Use
+ * fp_img_get_minutiae() where the real number matters.
+ *
+ * The image must have been \ref img_std "standardized" otherwise this function
+ * will fail.
+ *
+ * \param img a standardized image
+ * \param offset_x output location for how many pixels the centre of the
+ * print is to the right of the centre of the image, negative if to the left
+ * \param offset_y output location for how many pixels the centre of the
+ * print is below the centre of the image, negative if above
+ * \returns the estimated number of minutiae, or a negative error code
+ */
+API_EXPORTED int fp_img_get_preview(struct fp_img *img, int *offset_x,
+	int *offset_y)
+{
+	struct fpi_img_maps *maps = get_maps(img);
+
+	if (!maps)
+		return -EINVAL;
+
+	*offset_x = maps->offset_x;
+	*offset_y = maps->offset_y;
+	return maps->nr_minutiae;
+}
+
+/** \ingroup img
+ * Get the quality map of an image, as generated by the first part of
+ * minutiae detection (see fp_img_get_preview()). The map has one entry per
+ * block of 8x8 pixels, row by row, grading the block from 0 (no usable
+ * ridges, or not part of the print) to 4 (clear ridges). Minutiae are
+ * found reliably in blocks graded 3 or 4.
+ *
+ * The image must have been \ref img_std "standardized" otherwise this function
+ * will fail. The returned map is only valid while the image has not been
+ * freed, and must not be modified or freed.
+ *
+ * \param img a standardized image
+ * \param width output location for the width of the map in blocks
+ * \param height output location for the height of the map in blocks
+ * \returns the quality map, or NULL on error
+ */
+API_EXPORTED const unsigned char *fp_img_get_quality_map(struct fp_img *img,
+	int *width, int *height)
+{
+	struct fpi_img_maps *maps = get_maps(img);
+
+	if (!maps)
+		return NULL;
+
+	*width = maps->width;
+	*height = maps->height;
+	return maps->quality;
 }
 
+/** \ingroup img
+ * Get the ridge flow direction map of an image, as generated by the first
+ * part of minutiae detection (see fp_img_get_preview()). The map has one
+ * entry per block of 8x8 pixels, row by row. Directions are in steps of
+ * 11.25 degrees clockwise, from 0 for vertical ridges up to 15, and are -1
+ * for blocks without a clear direction.
+ *
+ * The image must have been \ref img_std "standardized" otherwise this function
+ * will fail. The returned map is only valid while the image has not been
+ * freed, and must not be modified or freed.
+ *
+ * \param img a standardized image
+ * \param width output location for the width of the map in blocks
+ * \param height output location for the height of the map in blocks
+ * \returns the direction map, or NULL on error
+ */
+API_EXPORTED const int *fp_img_get_direction_map(struct fp_img *img,
+	int *width, int *height)
+{
+	struct fpi_img_maps *maps = get_maps(img);
+
+	if (!maps)
+		return NULL;
+
+	*width = maps->width;
+	*height = maps->height;
+	return maps->direction;
+}
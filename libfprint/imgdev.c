@@ -60,15 +60,77 @@ void fpi_imgdev_open_complete(struct fp_img_dev *imgdev, int status)
 	fpi_drvcb_open_complete(imgdev->dev, status);
 }
 
-static void img_dev_close(struct fp_dev *dev)
+static int dev_activate(struct fp_img_dev *imgdev, enum fp_imgdev_state state);
+static void dev_deactivate(struct fp_img_dev *imgdev);
+
+static void dev_close(struct fp_img_dev *imgdev)
 {
-	struct fp_img_dev *imgdev = dev->priv;
-	struct fp_img_driver *imgdrv = fpi_driver_to_img_driver(dev->drv);
+	struct fp_img_driver *imgdrv = fpi_driver_to_img_driver(imgdev->dev->drv);
 
 	if (imgdrv->close)
 		imgdrv->close(imgdev);
 	else
-		fpi_drvcb_close_complete(dev);
+		fpi_drvcb_close_complete(imgdev->dev);
+}
+
+/* Warm sessions leave the device activated once an action has stopped, so
+ * that the next action can start without going through activation again.
+ * The device is deactivated when no action has been started for the idle
+ * timeout, or when it is closed. */
+static void warm_session_end(struct fp_img_dev *imgdev)
+{
+	if (imgdev->warm_timer) {
+		fpi_timeout_cancel(imgdev->warm_timer);
+		imgdev->warm_timer = NULL;
+	}
+	imgdev->warm_state = IMG_WARM_STATE_COOLING;
+	dev_deactivate(imgdev);
+}
+
+static void warm_session_expired(void *data)
+{
+	struct fp_img_dev *imgdev = data;
+
+	fp_dbg("idle for %ums, deactivating", imgdev->warm_timeout);
+	/* freed once this returns */
+	imgdev->warm_timer = NULL;
+	warm_session_end(imgdev);
+}
+
+void fpi_imgdev_set_warm_timeout(struct fp_img_dev *imgdev,
+	unsigned int timeout)
+{
+	imgdev->warm_timeout = timeout;
+	if (imgdev->warm_state != IMG_WARM_STATE_IDLE)
+		return;
+
+	/* restart the wait with the new timeout */
+	fpi_timeout_cancel(imgdev->warm_timer);
+	imgdev->warm_timer = NULL;
+	if (timeout)
+		imgdev->warm_timer = fpi_timeout_add(imgdev->dev, timeout,
+			warm_session_expired, imgdev);
+	if (!imgdev->warm_timer)
+		warm_session_end(imgdev);
+}
+
+static void img_dev_close(struct fp_dev *dev)
+{
+	struct fp_img_dev *imgdev = dev->priv;
+
+	switch (imgdev->warm_state) {
+	case IMG_WARM_STATE_IDLE:
+		warm_session_end(imgdev);
+		/* fall through */
+	case IMG_WARM_STATE_COOLING:
+		/* closed once deactivated */
+		imgdev->close_pending = TRUE;
+		return;
+	default:
+		break;
+	}
+
+	dev_close(imgdev);
 }
 
 void fpi_imgdev_close_complete(struct fp_img_dev *imgdev)
@@ -130,6 +192,7 @@ void fpi_imgdev_report_finger_status(struct fp_img_dev *imgdev,
 	if (present && imgdev->action_state == IMG_ACQUIRE_STATE_AWAIT_FINGER_ON) {
 		dev_change_state(imgdev, IMGDEV_STATE_CAPTURE);
 		imgdev->action_state = IMG_ACQUIRE_STATE_AWAIT_IMAGE;
+		imgdev->acquire_start = fpi_stats_start();
 		return;
 	} else if (present
 			|| imgdev->action_state != IMG_ACQUIRE_STATE_AWAIT_FINGER_OFF) {
@@ -184,13 +247,16 @@ static void verify_process_img(struct fp_img_dev *imgdev)
 {
 	struct fp_img_driver *imgdrv = fpi_driver_to_img_driver(imgdev->dev->drv);
 	int match_score = imgdrv->bz3_threshold;
+	gint64 start;
 	int r;
 
 	if (match_score == 0)
 		match_score = BOZORTH3_DEFAULT_THRESHOLD;
 
+	start = fpi_stats_start();
 	r = fpi_img_compare_print_data(imgdev->dev->verify_data,
 		imgdev->acquire_data);
+	fpi_stats_add(imgdev->dev, FP_STATS_STAGE_MATCH, start);
 
 	if (r >= match_score)
 		r = FP_VERIFY_MATCH;
@@ -205,13 +271,16 @@ static void identify_process_img(struct fp_img_dev *imgdev)
 	struct fp_img_driver *imgdrv = fpi_driver_to_img_driver(imgdev->dev->drv);
 	int match_score = imgdrv->bz3_threshold;
 	size_t match_offset;
+	gint64 start;
 	int r;
 
 	if (match_score == 0)
 		match_score = BOZORTH3_DEFAULT_THRESHOLD;
 
+	start = fpi_stats_start();
 	r = fpi_img_compare_print_data_to_gallery(imgdev->acquire_data,
 		imgdev->dev->identify_gallery, match_score, &match_offset);
+	fpi_stats_add(imgdev->dev, FP_STATS_STAGE_MATCH, start);
 
 	imgdev->action_result = r;
 	imgdev->identify_match_offset = match_offset;
@@ -220,19 +289,25 @@ static void identify_process_img(struct fp_img_dev *imgdev)
 void fpi_imgdev_image_captured(struct fp_img_dev *imgdev, struct fp_img *img)
 {
 	struct fp_print_data *print;
+	gint64 start;
 	int r;
 	fp_dbg("");
 
 	if (imgdev->action_state != IMG_ACQUIRE_STATE_AWAIT_IMAGE) {
 		fp_dbg("ignoring due to current state %d", imgdev->action_state);
+		fp_img_free(img);
 		return;
 	}
 
 	if (imgdev->action_result) {
 		fp_dbg("not overwriting existing action result");
+		fp_img_free(img);
 		return;
 	}
 
+	fpi_stats_add(imgdev->dev, FP_STATS_STAGE_ACQUIRE, imgdev->acquire_start);
+	fpi_stats_inc(imgdev->dev, FP_STATS_IMAGES_CAPTURED);
+
 	r = sanitize_image(imgdev, &img);
 	if (r < 0) {
 		imgdev->action_result = r;
@@ -240,9 +315,19 @@ void fpi_imgdev_image_captured(struct fp_img_dev *imgdev, struct fp_img *img)
 		goto next_state;
 	}
 
+	start = fpi_stats_start();
 	fp_img_standardize(img);
+	fpi_stats_add(imgdev->dev, FP_STATS_STAGE_STANDARDIZE, start);
 	imgdev->acquire_img = img;
 	if (imgdev->action != IMG_ACTION_CAPTURE) {
+		/* don't make the user wait for the extraction of a hopeless image */
+		r = fpi_img_check_quality(img);
+		if (r) {
+			/* depends on FP_ENROLL_RETRY* == FP_VERIFY_RETRY* */
+			imgdev->action_result = r;
+			goto next_state;
+		}
+
 		r = fpi_img_to_print_data(imgdev, img, &print);
 		if (r < 0) {
 			fp_dbg("image to print data conversion error: %d", r);
@@ -301,6 +386,18 @@ void fpi_imgdev_session_error(struct fp_img_dev *imgdev, int error)
 {
 	fp_dbg("error %d", error);
 	BUG_ON(error == 0);
+	/* no point in keeping a failing device activated */
+	imgdev->session_failed = TRUE;
+	if (imgdev->warm_state == IMG_WARM_STATE_IDLE) {
+		warm_session_end(imgdev);
+		return;
+	}
+	/* being deactivated: an action started meanwhile has not been told
+	 * it started, and finds out how the device is doing when it is
+	 * activated again */
+	if (imgdev->warm_state == IMG_WARM_STATE_COOLING)
+		return;
+
 	switch (imgdev->action) {
 	case IMG_ACTION_ENROLL:
 		fpi_drvcb_enroll_stage_completed(imgdev->dev, error, NULL, NULL);
@@ -324,6 +421,10 @@ void fpi_imgdev_activate_complete(struct fp_img_dev *imgdev, int status)
 {
 	fp_dbg("status %d", status);
 
+	if (status == 0)
+		fpi_stats_add(imgdev->dev, FP_STATS_STAGE_ACTIVATE,
+			imgdev->activate_start);
+
 	switch (imgdev->action) {
 	case IMG_ACTION_ENROLL:
 		fpi_drvcb_enroll_started(imgdev->dev, status);
@@ -344,15 +445,51 @@ void fpi_imgdev_activate_complete(struct fp_img_dev *imgdev, int status)
 
 	if (status == 0) {
 		imgdev->action_state = IMG_ACQUIRE_STATE_AWAIT_FINGER_ON;
+		/* unconditional captures may not report the finger at all */
+		imgdev->acquire_start = fpi_stats_start();
 		dev_change_state(imgdev, IMGDEV_STATE_AWAIT_FINGER_ON);
 	}
 }
 
+/* The warm session has ended: carry out what was asked for meanwhile */
+static void warm_session_ended(struct fp_img_dev *imgdev)
+{
+	int r;
+
+	imgdev->warm_state = IMG_WARM_STATE_NONE;
+	if (imgdev->close_pending) {
+		imgdev->close_pending = FALSE;
+		dev_close(imgdev);
+	} else if (imgdev->action_state == IMG_ACQUIRE_STATE_DEACTIVATING) {
+		/* stopped before it was activated */
+		fpi_imgdev_deactivate_complete(imgdev);
+	} else if (imgdev->action != IMG_ACTION_NONE) {
+		/* errors while cooling down were about the old activation */
+		imgdev->session_failed = FALSE;
+		r = dev_activate(imgdev, IMGDEV_STATE_AWAIT_FINGER_ON);
+		if (r < 0) {
+			fp_err("activation failed with error %d", r);
+			fpi_imgdev_activate_complete(imgdev, r);
+		}
+	}
+}
+
 void fpi_imgdev_deactivate_complete(struct fp_img_dev *imgdev)
 {
+	enum fp_imgdev_action action = imgdev->action;
+
 	fp_dbg("");
 
-	switch (imgdev->action) {
+	if (imgdev->warm_state == IMG_WARM_STATE_COOLING) {
+		warm_session_ended(imgdev);
+		return;
+	}
+
+	/* cleared first, as the callbacks may start the next action */
+	imgdev->action = IMG_ACTION_NONE;
+	imgdev->action_state = 0;
+
+	switch (action) {
 	case IMG_ACTION_ENROLL:
 		fpi_drvcb_enroll_stopped(imgdev->dev);
 		break;
@@ -366,12 +503,9 @@ void fpi_imgdev_deactivate_complete(struct fp_img_dev *imgdev)
 		fpi_drvcb_capture_stopped(imgdev->dev);
 		break;
 	default:
-		fp_err("unhandled action %d", imgdev->action);
+		fp_err("unhandled action %d", action);
 		break;
 	}
-
-	imgdev->action = IMG_ACTION_NONE;
-	imgdev->action_state = 0;
 }
 
 int fpi_imgdev_get_img_width(struct fp_img_dev *imgdev)
@@ -426,6 +560,23 @@ static int generic_acquire_start(struct fp_dev *dev, int action)
 	imgdev->action = action;
 	imgdev->action_state = IMG_ACQUIRE_STATE_ACTIVATING;
 	imgdev->enroll_stage = 0;
+	imgdev->activate_start = fpi_stats_start();
+	imgdev->session_failed = FALSE;
+
+	switch (imgdev->warm_state) {
+	case IMG_WARM_STATE_IDLE:
+		fp_dbg("device still activated");
+		fpi_timeout_cancel(imgdev->warm_timer);
+		imgdev->warm_timer = NULL;
+		imgdev->warm_state = IMG_WARM_STATE_NONE;
+		fpi_imgdev_activate_complete(imgdev, 0);
+		return 0;
+	case IMG_WARM_STATE_COOLING:
+		/* activated again once deactivated */
+		return 0;
+	default:
+		break;
+	}
 
 	r = dev_activate(imgdev, IMGDEV_STATE_AWAIT_FINGER_ON);
 	if (r < 0)
@@ -437,8 +588,24 @@ static int generic_acquire_start(struct fp_dev *dev, int action)
 
 static void generic_acquire_stop(struct fp_img_dev *imgdev)
 {
+	/* only once activation has completed and while nothing failed. A
+	 * device stopped mid-capture would stay in its capture state, which
+	 * some drivers keep re-arming, so it is deactivated as usual. */
+	gboolean keep_warm = imgdev->warm_timeout && !imgdev->session_failed
+		&& (imgdev->action_state == IMG_ACQUIRE_STATE_AWAIT_FINGER_ON
+		|| imgdev->action_state == IMG_ACQUIRE_STATE_AWAIT_FINGER_OFF
+		|| imgdev->action_state == IMG_ACQUIRE_STATE_DONE);
+
+	if (keep_warm) {
+		imgdev->warm_timer = fpi_timeout_add(imgdev->dev,
+			imgdev->warm_timeout, warm_session_expired, imgdev);
+		keep_warm = imgdev->warm_timer != NULL;
+	}
+
 	imgdev->action_state = IMG_ACQUIRE_STATE_DEACTIVATING;
-	dev_deactivate(imgdev);
+	/* when already deactivating, the action stops once that is done */
+	if (!keep_warm && imgdev->warm_state != IMG_WARM_STATE_COOLING)
+		dev_deactivate(imgdev);
 
 	fp_print_data_free(imgdev->acquire_data);
 	fp_print_data_free(imgdev->enroll_data);
@@ -447,6 +614,14 @@ static void generic_acquire_stop(struct fp_img_dev *imgdev)
 	imgdev->enroll_data = NULL;
 	imgdev->acquire_img = NULL;
 	imgdev->action_result = 0;
+
+	/* the device stays armed for the next action; it is only the action
+	 * that stops */
+	if (keep_warm) {
+		fp_dbg("keeping device activated for %ums", imgdev->warm_timeout);
+		imgdev->warm_state = IMG_WARM_STATE_IDLE;
+		fpi_imgdev_deactivate_complete(imgdev);
+	}
 }
 
 static int img_dev_enroll_start(struct fp_dev *dev)
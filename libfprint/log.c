@@ -0,0 +1,342 @@
+/*
+ * Message log delivery and buffering
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "fp_internal.h"
+
+/* Nothing in this file may use fp_dbg() and friends: they would recurse
+ * back into here. */
+
+/* In the buffered modes, each thread that logs gets its own ring of
+ * formatted messages. The owning thread is the only producer and whoever
+ * holds drain_lock is the only consumer, so the rings themselves need no
+ * locking: the producer only ever advances head and the consumer only ever
+ * advances tail. When a ring is full, new messages are dropped and counted
+ * rather than blocking the logging thread.
+ *
+ * Messages are formatted when they are logged rather than when they are
+ * delivered, as arguments such as strings are often gone by then. The
+ * component and function names are string literals and are kept as
+ * pointers. */
+
+#define LOG_RING_SIZE		256	/* must be a power of 2 */
+#define LOG_MSG_LEN		120
+#define LOG_DRAIN_INTERVAL	50000	/* usec */
+
+struct log_entry {
+	gint64 timestamp;
+	enum fpi_log_level level;
+	const char *component;
+	const char *function;
+	char message[LOG_MSG_LEN];
+};
+
+struct log_ring {
+	volatile guint head;
+	volatile guint tail;
+	volatile guint dropped;
+	/* owning thread has exited, free once drained */
+	volatile gint orphaned;
+	struct log_entry entries[LOG_RING_SIZE];
+};
+
+static volatile gint log_mode = FP_LOG_MODE_SYNC;
+static fp_log_handler log_handler = NULL;
+static void *log_handler_data = NULL;
+
+/* protects the list of rings */
+static GMutex rings_lock;
+static GSList *rings = NULL;
+/* serializes consumers */
+static GMutex drain_lock;
+
+static GThread *drain_thread = NULL;
+static volatile gint drain_thread_stop = 0;
+
+static void ring_orphan(gpointer data)
+{
+	struct log_ring *ring = data;
+	g_atomic_int_set(&ring->orphaned, 1);
+}
+
+static GPrivate thread_ring = G_PRIVATE_INIT(ring_orphan);
+/* set while this thread runs the log handler */
+static GPrivate in_handler;
+
+static struct log_ring *get_thread_ring(void)
+{
+	struct log_ring *ring = g_private_get(&thread_ring);
+
+	if (ring)
+		return ring;
+
+	ring = g_malloc0(sizeof(*ring));
+	g_private_set(&thread_ring, ring);
+	g_mutex_lock(&rings_lock);
+	rings = g_slist_prepend(rings, ring);
+	g_mutex_unlock(&rings_lock);
+	return ring;
+}
+
+static const char *level_to_str(enum fpi_log_level level, FILE **stream)
+{
+	*stream = stderr;
+	switch (level) {
+	case FPRINT_LOG_LEVEL_INFO:
+		*stream = stdout;
+		return "info";
+	case FPRINT_LOG_LEVEL_WARNING:
+		return "warning";
+	case FPRINT_LOG_LEVEL_ERROR:
+		return "error";
+	case FPRINT_LOG_LEVEL_DEBUG:
+		return "debug";
+	default:
+		return "unknown";
+	}
+}
+
+static void deliver(enum fpi_log_level level, const char *component,
+	const char *function, gint64 timestamp, const char *message)
+{
+	FILE *stream;
+	const char *prefix;
+
+	if (log_handler && !g_private_get(&in_handler)) {
+		g_private_set(&in_handler, GINT_TO_POINTER(TRUE));
+		log_handler((enum fp_log_level) level, component, function,
+			timestamp, message, log_handler_data);
+		g_private_set(&in_handler, NULL);
+		return;
+	}
+
+	prefix = level_to_str(level, &stream);
+	/* logged by the handler itself: passing it back would recurse */
+	if (log_handler)
+		stream = stderr;
+	fprintf(stream, "%s:%s [%s] %s\n", component ? component : "fp", prefix,
+		function, message);
+}
+
+static void ring_write(enum fpi_log_level level, const char *component,
+	const char *function, const char *format, va_list args)
+{
+	struct log_ring *ring = get_thread_ring();
+	guint head = ring->head;
+	struct log_entry *entry;
+
+	if (head - g_atomic_int_get(&ring->tail) >= LOG_RING_SIZE) {
+		g_atomic_int_inc(&ring->dropped);
+		return;
+	}
+
+	entry = &ring->entries[head & (LOG_RING_SIZE - 1)];
+	entry->timestamp = g_get_monotonic_time();
+	entry->level = level;
+	entry->component = component;
+	entry->function = function;
+	g_vsnprintf(entry->message, LOG_MSG_LEN, format, args);
+
+	/* publish the entry only once it is complete */
+	g_atomic_int_set(&ring->head, head + 1);
+}
+
+static void ring_drain(struct log_ring *ring)
+{
+	guint tail = ring->tail;
+	guint head = g_atomic_int_get(&ring->head);
+	guint dropped;
+
+	while (tail != head) {
+		struct log_entry *entry = &ring->entries[tail & (LOG_RING_SIZE - 1)];
+		deliver(entry->level, entry->component, entry->function,
+			entry->timestamp, entry->message);
+		/* hand the slot back to the producer */
+		g_atomic_int_set(&ring->tail, ++tail);
+	}
+
+	dropped = g_atomic_int_and(&ring->dropped, 0);
+	if (dropped) {
+		char msg[64];
+		g_snprintf(msg, sizeof(msg), "%u messages dropped, log buffer full",
+			dropped);
+		deliver(FPRINT_LOG_LEVEL_WARNING, "log", __FUNCTION__,
+			g_get_monotonic_time(), msg);
+	}
+}
+
+static void drain_all(void)
+{
+	GSList *list;
+	GSList *elem;
+
+	g_mutex_lock(&drain_lock);
+
+	/* work on a copy so that the handler can log (and thus register a new
+	 * ring) without deadlocking on rings_lock. rings are only ever freed
+	 * below, under drain_lock, so the copied pointers stay valid. */
+	g_mutex_lock(&rings_lock);
+	list = g_slist_copy(rings);
+	g_mutex_unlock(&rings_lock);
+
+	for (elem = list; elem; elem = g_slist_next(elem)) {
+		struct log_ring *ring = elem->data;
+		ring_drain(ring);
+		if (g_atomic_int_get(&ring->orphaned)
+				&& ring->tail == g_atomic_int_get(&ring->head)) {
+			g_mutex_lock(&rings_lock);
+			rings = g_slist_remove(rings, ring);
+			g_mutex_unlock(&rings_lock);
+			g_free(ring);
+		}
+	}
+
+	g_slist_free(list);
+	g_mutex_unlock(&drain_lock);
+}
+
+static gpointer drain_thread_fn(gpointer data)
+{
+	while (!g_atomic_int_get(&drain_thread_stop)) {
+		drain_all();
+		g_usleep(LOG_DRAIN_INTERVAL);
+	}
+	return NULL;
+}
+
+static void stop_drain_thread(void)
+{
+	if (!drain_thread)
+		return;
+
+	g_atomic_int_set(&drain_thread_stop, 1);
+	g_thread_join(drain_thread);
+	drain_thread = NULL;
+	g_atomic_int_set(&drain_thread_stop, 0);
+}
+
+/* Deliver a message which has passed the log level checks in fpi_log() */
+void fpi_log_write(enum fpi_log_level level, const char *component,
+	const char *function, const char *format, va_list args)
+{
+	FILE *stream;
+	const char *prefix;
+	char *message;
+
+	if (g_atomic_int_get(&log_mode) != FP_LOG_MODE_SYNC) {
+		ring_write(level, component, function, format, args);
+		return;
+	}
+
+	if (log_handler) {
+		message = g_strdup_vprintf(format, args);
+		deliver(level, component, function, g_get_monotonic_time(), message);
+		g_free(message);
+		return;
+	}
+
+	prefix = level_to_str(level, &stream);
+	fprintf(stream, "%s:%s [%s] ", component ? component : "fp", prefix,
+		function);
+	vfprintf(stream, format, args);
+	fprintf(stream, "\n");
+}
+
+void fpi_log_exit(void)
+{
+	fp_set_log_mode(FP_LOG_MODE_SYNC);
+}
+
+/** \ingroup core
+ * Route libfprint's log messages to your own function instead of having
+ * them printed to stdout/stderr. Only messages that pass the level set
+ * with fp_set_debug() are passed on.
+ *
+ * In \ref FP_LOG_MODE_SYNC "synchronous mode", the handler is called from
+ * whichever thread logged the message. In the buffered modes, it is called
+ * from the thread calling fp_log_flush() or from libfprint's log thread.
+ * Messages that the handler itself causes libfprint to log while it runs
+ * synchronously are printed to stderr rather than passed back to it. The
+ * handler must not call fp_log_flush() or fp_set_log_mode().
+ *
+ * The handler must not be changed while messages are being delivered from
+ * another thread.
+ *
+ * \param handler the function to call for each message, or NULL to restore
+ * the default of printing messages
+ * \param user_data data to pass to the handler
+ */
+API_EXPORTED void fp_set_log_handler(fp_log_handler handler, void *user_data)
+{
+	log_handler = handler;
+	log_handler_data = user_data;
+}
+
+/** \ingroup core
+ * Choose how log messages are delivered. By default, every message is
+ * printed (or passed to the \ref fp_set_log_handler "log handler") as soon
+ * as it is logged, which can considerably slow down time-critical code
+ * paths when verbose logging is enabled.
+ *
+ * In the buffered modes, messages are formatted into a small per-thread
+ * buffer instead, and delivered later in batches. Messages longer than
+ * about 120 characters are truncated, and if a buffer fills up before it
+ * is drained, further messages from that thread are discarded and a
+ * warning reports how many were lost.
+ *
+ * Switching back to \ref FP_LOG_MODE_SYNC delivers any buffered messages
+ * first, as does fp_exit().
+ *
+ * \param mode the delivery mode
+ * \returns 0 on success, negative on error
+ */
+API_EXPORTED int fp_set_log_mode(enum fp_log_mode mode)
+{
+	switch (mode) {
+	case FP_LOG_MODE_SYNC:
+	case FP_LOG_MODE_BUFFERED:
+		stop_drain_thread();
+		break;
+	case FP_LOG_MODE_BACKGROUND:
+		if (!drain_thread)
+			drain_thread = g_thread_new("fprint-log", drain_thread_fn, NULL);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	g_atomic_int_set(&log_mode, mode);
+	if (mode == FP_LOG_MODE_SYNC)
+		drain_all();
+	return 0;
+}
+
+/** \ingroup core
+ * Deliver all log messages which have been buffered so far. Only useful
+ * in the buffered \ref fp_set_log_mode "log modes".
+ */
+API_EXPORTED void fp_log_flush(void)
+{
+	drain_all();
+}
@@ -0,0 +1,80 @@
+/*
+ * Compact storage for detected minutiae
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "minutiae"
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "fp_internal.h"
+#include "nbis/include/lfs.h"
+
+/* mindtct keeps the minutiae it finds in struct fp_minutiae, one array per
+ * attribute, and they stay there for as long as the image has them.
+ *
+ * fp_img_get_minutiae() has to return struct fp_minutia pointers, so a set
+ * of such records is built the first time it is asked for. */
+
+void fpi_minutiae_free(struct fp_minutiae *minutiae)
+{
+	if (!minutiae)
+		return;
+
+	g_free(minutiae->view);
+	g_free(minutiae->view_list);
+	free_minutiae(minutiae);
+}
+
+/* Get the minutiae as a list of struct fp_minutia pointers, which remains
+ * valid until the minutiae are freed. The neighbour arrays of the records
+ * point into the minutiae's own. */
+struct fp_minutia **fpi_minutiae_get_view(struct fp_minutiae *minutiae)
+{
+	int i;
+
+	if (minutiae->view_list)
+		return minutiae->view_list;
+
+	minutiae->view = g_malloc0(minutiae->num * sizeof(*minutiae->view));
+	/* never NULL, even without minutiae */
+	minutiae->view_list = g_malloc0((minutiae->num + 1)
+		* sizeof(*minutiae->view_list));
+	for (i = 0; i < minutiae->num; i++) {
+		struct fp_minutia *minutia = &minutiae->view[i];
+
+		minutia->x = minutiae->x[i];
+		minutia->y = minutiae->y[i];
+		minutia->ex = minutiae->ex[i];
+		minutia->ey = minutiae->ey[i];
+		minutia->direction = minutiae->direction[i];
+		minutia->reliability = minutiae->reliability[i];
+		minutia->type = minutiae->type[i];
+		minutia->appearing = minutiae->appearing[i];
+		minutia->feature_id = minutiae->feature_id[i];
+		minutia->num_nbrs = minutiae->num_nbrs[i];
+		if (minutia->num_nbrs) {
+			minutia->nbrs = minutiae->nbrs + minutiae->nbrs_first[i];
+			minutia->ridge_counts = minutiae->ridge_counts
+				+ minutiae->nbrs_first[i];
+		}
+		minutiae->view_list[i] = minutia;
+	}
+
+	return minutiae->view_list;
+}
@@ -158,6 +158,25 @@ typedef struct shape{
    int nrows;     /* Number of rows assigned to shape.          */
 } SHAPE;
 
+/* Image maps generated ahead of minutia detection, kept together */
+/* with the padded image they were generated from, so that minutia */
+/* detection can be run on them later.  See get_image_maps().      */
+typedef struct lfsmaps{
+   int iw;                 /* Width (in pixels) of the input image.      */
+   int ih;                 /* Height (in pixels) of the input image.     */
+   unsigned char *pdata;   /* Padded input image, scaled to 6 bits.      */
+   int pw;                 /* Width (in pixels) of the padded image.     */
+   int ph;                 /* Height (in pixels) of the padded image.    */
+   int maxpad;             /* Padding (in pixels) around the image.      */
+   int *direction_map;
+   int *low_contrast_map;
+   int *low_flow_map;
+   int *high_curve_map;
+   int *quality_map;
+   int mw;                 /* Width (in blocks) of the maps.             */
+   int mh;                 /* Height (in blocks) of the maps.            */
+} LFSMAPS;
+
 /* Parameters used by LFS for setting thresholds and  */
 /* defining testing criterion.                        */
 typedef struct lfsparms{
@@ -705,9 +724,13 @@ extern int find_valid_block(int *, int *, int *, int *, int *,
 extern void set_margin_blocks(int *, const int, const int, const int);
 
 /* contour.c */
+extern int begin_contour_workspace(void);
+extern void end_contour_workspace(void);
 int allocate_contour(int **ocontour_x, int **ocontour_y,
                      int **ocontour_ex, int **ocontour_ey, const int ncontour);
 extern void free_contour(int *, int *, int *, int *);
+extern int allocate_chain(int **, const int);
+extern void free_chain(int *);
 extern int get_high_curvature_contour(int **, int **, int **, int **, int *,
                      const int, const int, const int, const int, const int,
                      unsigned char *, const int, const int);
@@ -729,6 +752,13 @@ extern void fix_edge_pixel_pair(int *, int *, int *, int *,
                      unsigned char *, const int, const int);
 
 /* detect.c */
+extern int get_image_maps(LFSMAPS **, unsigned char *, const int, const int,
+                 const int, const LFSPARMS *);
+extern void free_image_maps(LFSMAPS *);
+extern int get_minutiae_from_maps(MINUTIAE **,
+                 unsigned char **, int *, int *, int *, const LFSMAPS *,
+                 unsigned char *, const int, const int,
+                 const int, const double, const LFSPARMS *);
 extern int get_minutiae(MINUTIAE **, int **, int **, int **,
                  int **, int **, int *, int *,
                  unsigned char **, int *, int *, int *,
@@ -775,16 +805,18 @@ extern int alloc_power_stats(int **, double **, int **, double **, const int);
 /* line.c */
 extern int line_points(int **, int **, int *,
                      const int, const int, const int, const int);
+extern int fill_line_points(int *, int *, const int, int *,
+                     const int, const int, const int, const int);
 
 /* loop.c */
 extern int get_loop_list(int **, MINUTIAE *, const int, unsigned char *,
                      const int, const int);
-extern int on_loop(const MINUTIA *, const int, unsigned char *, const int,
-                     const int);
+extern int on_loop(const MINUTIAE *, const int, const int, unsigned char *,
+                     const int, const int);
 extern int on_island_lake(int **, int **, int **, int **, int *,
-                     const MINUTIA *, const MINUTIA *, const int,
+                     const MINUTIAE *, const int, const int, const int,
                      unsigned char *, const int, const int);
-extern int on_hook(const MINUTIA *, const MINUTIA *, const int,
+extern int on_hook(const MINUTIAE *, const int, const int, const int,
                      unsigned char *, const int, const int);
 extern int is_loop_clockwise(const int *, const int *, const int, const int);
 extern int process_loop(MINUTIAE *, const int *, const int *,
@@ -867,10 +899,10 @@ extern int detect_minutiae_V2(MINUTIAE *,
                      unsigned char *, const int, const int,
                      int *, int *, int *, const int, const int,
                      const LFSPARMS *);
-extern int update_minutiae(MINUTIAE *, MINUTIA *, unsigned char *,
+extern int update_minutiae(MINUTIAE *, const MINUTIA *, unsigned char *,
                      const int, const int, const LFSPARMS *);
-extern int update_minutiae_V2(MINUTIAE *, MINUTIA *, const int, const int,
-                     unsigned char *, const int, const int,
+extern int update_minutiae_V2(MINUTIAE *, const MINUTIA *, const int,
+                     const int, unsigned char *, const int, const int,
                      const LFSPARMS *);
 extern int sort_minutiae(MINUTIAE *, const int, const int);
 extern int sort_minutiae_y_x(MINUTIAE *, const int, const int);
@@ -879,14 +911,15 @@ extern int rm_dup_minutiae(MINUTIAE *);
 extern void dump_minutiae(FILE *, const MINUTIAE *);
 extern void dump_minutiae_pts(FILE *, const MINUTIAE *);
 extern void dump_reliable_minutiae_pts(FILE *, const MINUTIAE *, const double);
-extern int create_minutia(MINUTIA **, const int, const int,
+extern void create_minutia(MINUTIA *, const int, const int,
                      const int, const int, const int, const double,
                      const int, const int, const int);
 extern void free_minutiae(MINUTIAE *);
-extern void free_minutia(MINUTIA *);
 extern int remove_minutia(const int, MINUTIAE *);
-extern int join_minutia(const MINUTIA *, const MINUTIA *, unsigned char *,
-                     const int, const int, const int, const int);
+extern void move_minutia(MINUTIAE *, const int, const int);
+extern int join_minutia(const MINUTIAE *, const int, const int,
+                     unsigned char *, const int, const int, const int,
+                     const int);
 extern int minutia_type(const int);
 extern int is_minutia_appearing(const int, const int, const int, const int);
 extern int choose_scan_direction(const int, const int);
@@ -953,8 +986,8 @@ extern int process_vertical_scan_minutia_V2(MINUTIAE *, const int, const int,
                      const int, const int,
                      unsigned char *, const int, const int,
                      int *, int *, int *, const LFSPARMS *);
-extern int update_minutiae_V2(MINUTIAE *, MINUTIA *, const int, const int,
-                     unsigned char *, const int, const int,
+extern int update_minutiae_V2(MINUTIAE *, const MINUTIA *, const int,
+                     const int, unsigned char *, const int, const int,
                      const LFSPARMS *);
 extern int adjust_high_curvature_minutia(int *, int *, int *, int *, int *,
                      const int, const int, const int, const int,
@@ -1002,6 +1035,9 @@ extern void bubble_sort_int_inc_2(int *, int *, const int);
 extern void bubble_sort_double_inc_2(double *, int *, const int);
 extern void bubble_sort_double_dec_2(double *, int *,  const int);
 extern void bubble_sort_int_inc(int *, const int);
+extern void insertion_sort_double_inc_2(double *, int *, const int);
+extern void network_sort_double_dec_2(double *, int *, const int);
+extern int radix_sort_int_inc_2(int *, int *, const int);
 
 /* util.c */
 extern int maxv(const int *, const int);
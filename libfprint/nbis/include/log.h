@@ -27,6 +27,9 @@ identified are necessarily the best available for the purpose.
 /* Definitions and references to support log report files. */
 /* UPDATED: 03/16/2005 by MDG */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -41,8 +44,32 @@ extern int g_avrdir;
 extern float g_dir_strength;
 extern int g_nvalid;
 
+/* Within libfprint, log reports go to libfprint's debug log if it was */
+/* configured with --enable-nbis-log, by source file (see log.c).      */
+/* Otherwise, the calls and their arguments compile to nothing.        */
+#ifdef LOG_REPORT
 extern int open_logfile(void);
 extern int close_logfile(void);
 extern void print2log(char *, ...);
+#else
+#define open_logfile()     (0)
+#define close_logfile()    (0)
+#ifdef ENABLE_NBIS_LOG
+extern void nbis_log(const char *, const char *, const char *, ...);
+#define print2log(...)     nbis_log(__FILE__, __func__, __VA_ARGS__)
+#else
+#define print2log(...)     ((void)0)
+#endif
+#endif
+
+/* Error reports go to libfprint's log as errors, and are counted in   */
+/* its statistics, if it was configured with --enable-nbis-log.        */
+/* Otherwise they go to stderr, as NIST wrote them.                    */
+#if defined(ENABLE_NBIS_LOG) && !defined(LOG_REPORT)
+extern void nbis_err(const char *, const char *, const char *, ...);
+#define print2err(...)     nbis_err(__FILE__, __func__, __VA_ARGS__)
+#else
+#define print2err(...)     fprintf(stderr, __VA_ARGS__)
+#endif
 
 #endif
@@ -45,6 +45,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -141,7 +142,7 @@ int binarize_image_V2(unsigned char **odata, int *ow, int *oh,
 
    bdata = (unsigned char *)malloc(bw*bh*sizeof(unsigned char));
    if(bdata == (unsigned char *)NULL){
-      fprintf(stderr, "ERROR : binarize_image_V2 : malloc : bdata\n");
+      print2err("ERROR : binarize_image_V2 : malloc : bdata\n");
       return(-600);
    }
 
@@ -47,6 +47,7 @@ identified are necessarily the best available for the purpose.
 #include <stdlib.h>
 #include <string.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -90,7 +91,7 @@ int block_offsets(int **optr, int *ow, int *oh,
 
    /* Test if unpadded image is smaller than a single block */
    if((iw < blocksize) || (ih < blocksize)){
-      fprintf(stderr,
+      print2err(
          "ERROR : block_offsets : image must be at least %d by %d in size\n",
               blocksize, blocksize);
       return(-80);
@@ -117,7 +118,7 @@ int block_offsets(int **optr, int *ow, int *oh,
    /* Allocate list of block offsets */
    blkoffs = (int *)malloc(bsize * sizeof(int));
    if(blkoffs == (int *)NULL){
-      fprintf(stderr, "ERROR : block_offsets : malloc : blkoffs\n");
+      print2err("ERROR : block_offsets : malloc : blkoffs\n");
       return(-81);
    }
 
@@ -243,7 +244,7 @@ int low_contrast_block(const int blkoffset, const int blocksize,
       pi++;
    }
    if(!found){
-      fprintf(stderr,
+      print2err(
               "ERROR : low_contrast_block : min percentile pixel not found\n");
       return(-510);
    }
@@ -261,7 +262,7 @@ int low_contrast_block(const int blkoffset, const int blocksize,
       pi--;
    }
    if(!found){
-      fprintf(stderr,
+      print2err(
               "ERROR : low_contrast_block : max percentile pixel not found\n");
       return(-511);
    }
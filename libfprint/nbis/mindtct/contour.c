@@ -36,8 +36,12 @@ identified are necessarily the best available for the purpose.
 
 ***********************************************************************
                ROUTINES:
+                        begin_contour_workspace()
+                        end_contour_workspace()
                         allocate_contour()
                         free_contour()
+                        allocate_chain()
+                        free_chain()
                         get_high_curvature_contour()
                         get_centered_contour()
                         trace_contour()
@@ -51,7 +55,159 @@ identified are necessarily the best available for the purpose.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <glib.h>
 #include <lfs.h>
+#include <log.h>
+
+/*************************************************************************
+**************************************************************************
+   Contour workspace.  Contours and chain codes are allocated and freed
+   for nearly every candidate minutia.  Each one is kept in a single
+   block, headed by the number of ints it has room for.  While a
+   workspace is open on a thread, freed blocks are kept on its list and
+   handed out again rather than going back to the system, so a pass over
+   the minutiae settles on a few blocks as large as its longest contours.
+**************************************************************************/
+
+typedef struct contour_block{
+   struct contour_block *next;
+   int capacity;      /* Number of ints following the header. */
+} CONTOUR_BLOCK;
+
+typedef struct contour_workspace{
+   CONTOUR_BLOCK *free_blocks;
+   int depth;         /* Number of begin_contour_workspace() calls open. */
+} CONTOUR_WORKSPACE;
+
+static GPrivate contour_workspace;
+
+/*************************************************************************
+**************************************************************************
+#cat: begin_contour_workspace - Opens a contour workspace on the calling
+#cat:            thread, so that contours freed from then on are reused
+#cat:            by later allocations.  Calls may be nested, each one
+#cat:            matched by a call to end_contour_workspace().
+
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int begin_contour_workspace(void)
+{
+   CONTOUR_WORKSPACE *workspace;
+
+   workspace = (CONTOUR_WORKSPACE *)g_private_get(&contour_workspace);
+   if(workspace == (CONTOUR_WORKSPACE *)NULL){
+      workspace = (CONTOUR_WORKSPACE *)calloc(1, sizeof(CONTOUR_WORKSPACE));
+      if(workspace == (CONTOUR_WORKSPACE *)NULL){
+         print2err(
+                 "ERROR : begin_contour_workspace : calloc : workspace\n");
+         return(-184);
+      }
+      g_private_set(&contour_workspace, workspace);
+   }
+   workspace->depth++;
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: end_contour_workspace - Closes a contour workspace opened by
+#cat:            begin_contour_workspace().  When the outermost one is
+#cat:            closed, the blocks kept by the workspace are deallocated.
+**************************************************************************/
+void end_contour_workspace(void)
+{
+   CONTOUR_WORKSPACE *workspace;
+   CONTOUR_BLOCK *block;
+
+   workspace = (CONTOUR_WORKSPACE *)g_private_get(&contour_workspace);
+   if(workspace == (CONTOUR_WORKSPACE *)NULL)
+      return;
+   if(--workspace->depth > 0)
+      return;
+
+   while(workspace->free_blocks != (CONTOUR_BLOCK *)NULL){
+      block = workspace->free_blocks;
+      workspace->free_blocks = block->next;
+      free(block);
+   }
+   free(workspace);
+   g_private_set(&contour_workspace, NULL);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: get_contour_block - Allocates a block of ints, reusing one kept by
+#cat:            the thread's contour workspace if there is one.
+
+   Input:
+      nints     - number of ints needed
+   Return Code:
+      the block's ints, or NULL on allocation error
+**************************************************************************/
+static int *get_contour_block(const int nints)
+{
+   CONTOUR_WORKSPACE *workspace;
+   CONTOUR_BLOCK *block, **link;
+
+   workspace = (CONTOUR_WORKSPACE *)g_private_get(&contour_workspace);
+   block = (CONTOUR_BLOCK *)NULL;
+   if(workspace != (CONTOUR_WORKSPACE *)NULL){
+      /* Take the first kept block large enough ... */
+      for(link = &workspace->free_blocks; *link != (CONTOUR_BLOCK *)NULL;
+          link = &(*link)->next){
+         if((*link)->capacity >= nints)
+            break;
+      }
+      /* or, failing that, the first one, to be grown. */
+      if(*link == (CONTOUR_BLOCK *)NULL)
+         link = &workspace->free_blocks;
+      if(*link != (CONTOUR_BLOCK *)NULL){
+         block = *link;
+         *link = block->next;
+      }
+   }
+
+   if((block == (CONTOUR_BLOCK *)NULL) || (block->capacity < nints)){
+      free(block);
+      block = (CONTOUR_BLOCK *)malloc(sizeof(CONTOUR_BLOCK) +
+                                      (nints * sizeof(int)));
+      if(block == (CONTOUR_BLOCK *)NULL)
+         return((int *)NULL);
+      block->capacity = nints;
+   }
+
+   return((int *)(block+1));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: put_contour_block - Deallocates a block from get_contour_block(),
+#cat:            or keeps it in the thread's contour workspace if there
+#cat:            is one.
+
+   Input:
+      data      - the block's ints
+**************************************************************************/
+static void put_contour_block(int *data)
+{
+   CONTOUR_WORKSPACE *workspace;
+   CONTOUR_BLOCK *block;
+
+   if(data == (int *)NULL)
+      return;
+
+   block = ((CONTOUR_BLOCK *)data) - 1;
+   workspace = (CONTOUR_WORKSPACE *)g_private_get(&contour_workspace);
+   if(workspace == (CONTOUR_WORKSPACE *)NULL){
+      free(block);
+      return;
+   }
+   block->next = workspace->free_blocks;
+   workspace->free_blocks = block;
+}
 
 /*************************************************************************
 **************************************************************************
@@ -87,46 +243,16 @@ int allocate_contour(int **ocontour_x, int **ocontour_y,
 {
    int *contour_x, *contour_y, *contour_ex, *contour_ey;
 
-   /* Allocate contour's x-coord list. */
-   contour_x = (int *)malloc(ncontour*sizeof(int));
+   /* Allocate the 4 lists in a single block, x-coord list first. */
+   contour_x = get_contour_block(4*ncontour);
    /* If allocation error... */
    if(contour_x == (int *)NULL){
-      fprintf(stderr, "ERROR : allocate_contour : malloc : contour_x\n");
+      print2err("ERROR : allocate_contour : malloc : contour_x\n");
       return(-180);
    }
-
-   /* Allocate contour's y-coord list. */
-   contour_y = (int *)malloc(ncontour*sizeof(int));
-   /* If allocation error... */
-   if(contour_y == (int *)NULL){
-      /* Deallocate memory allocated to this point in this routine. */
-      free(contour_x);
-      fprintf(stderr, "ERROR : allocate_contour : malloc : contour_y\n");
-      return(-181);
-   }
-
-   /* Allocate contour's edge x-coord list. */
-   contour_ex = (int *)malloc(ncontour*sizeof(int));
-   /* If allocation error... */
-   if(contour_ex == (int *)NULL){
-      /* Deallocate memory allocated to this point in this routine. */
-      free(contour_x);
-      free(contour_y);
-      fprintf(stderr, "ERROR : allocate_contour : malloc : contour_ex\n");
-      return(-182);
-   }
-
-   /* Allocate contour's edge y-coord list. */
-   contour_ey = (int *)malloc(ncontour*sizeof(int));
-   /* If allocation error... */
-   if(contour_ey == (int *)NULL){
-      /* Deallocate memory allocated to this point in this routine. */
-      free(contour_x);
-      free(contour_y);
-      free(contour_ex);
-      fprintf(stderr, "ERROR : allocate_contour : malloc : contour_ey\n");
-      return(-183);
-   }
+   contour_y = contour_x + ncontour;
+   contour_ex = contour_y + ncontour;
+   contour_ey = contour_ex + ncontour;
 
    /* Otherwise, allocations successful, so assign output pointers. */
    *ocontour_x = contour_x;
@@ -159,10 +285,46 @@ int allocate_contour(int **ocontour_x, int **ocontour_y,
 void free_contour(int *contour_x, int *contour_y,
                   int *contour_ex, int *contour_ey)
 {
-   free(contour_x);
-   free(contour_y);
-   free(contour_ex);
-   free(contour_ey);
+   /* All 4 lists live in the block of the x-coord list. */
+   put_contour_block(contour_x);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: allocate_chain - Allocates a chain code vector for a contour.
+
+   Input:
+      nchain    - number of codes in the chain
+   Output:
+      ochain    - allocated chain code vector
+   Return Code:
+      Zero      - vector was successfully allocated
+      Negative  - system (allocation) error
+**************************************************************************/
+int allocate_chain(int **ochain, const int nchain)
+{
+   int *chain;
+
+   chain = get_contour_block(nchain);
+   if(chain == (int *)NULL){
+      print2err("ERROR : allocate_chain : malloc : chain\n");
+      return(-185);
+   }
+
+   *ochain = chain;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: free_chain - Deallocates a chain code vector from allocate_chain().
+
+   Input:
+      chain     - chain code vector
+**************************************************************************/
+void free_chain(int *chain)
+{
+   put_contour_block(chain);
 }
 
 /*************************************************************************
@@ -35,69 +35,60 @@ identified are necessarily the best available for the purpose.
 
 ***********************************************************************
                ROUTINES:
+                        get_image_maps()
+                        free_image_maps()
                         lfs_detect_minutiae_V2()
+                        get_minutiae_from_maps()
                         get_minutiae()
 
 ***********************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <lfs.h>
 #include <log.h>
 
 /*************************************************************************
-#cat: lfs_detect_minutiae_V2 - Takes a grayscale fingerprint image (of
-#cat:          arbitrary size), and returns a set of image block maps,
-#cat:          a binarized image designating ridges from valleys,
-#cat:          and a list of minutiae (including position, reliability,
-#cat:          type, direction, neighbors, and ridge counts to neighbors).
-#cat:          The image maps include a ridge flow directional map,
-#cat:          a map of low contrast blocks, a map of low ridge flow blocks.
-#cat:          and a map of high-curvature blocks.
+#cat: get_image_maps - Takes a grayscale fingerprint image (of arbitrary
+#cat:          size), and returns the image block maps that the rest of
+#cat:          minutia detection is driven by: a ridge flow directional
+#cat:          map, a map of low contrast blocks, a map of low ridge flow
+#cat:          blocks, a map of high-curvature blocks, and the integrated
+#cat:          quality map built from them.  The padded image the maps
+#cat:          were computed on is kept with them, so that minutiae can
+#cat:          later be detected by get_minutiae_from_maps() without
+#cat:          generating the maps again.
 
    Input:
       idata     - input 8-bit grayscale fingerprint image data
       iw        - width (in pixels) of the image
       ih        - height (in pixels) of the image
+      id        - pixel depth (in bits) of the image
       lfsparms  - parameters and thresholds for controlling LFS
 
    Output:
-      ominutiae - resulting list of minutiae
-      odmap     - resulting Direction Map
-                  {invalid (-1) or valid ridge directions}
-      olcmap    - resulting Low Contrast Map
-                  {low contrast (TRUE), high contrast (FALSE)}
-      olfmap    - resulting Low Ridge Flow Map
-                  {low ridge flow (TRUE), high ridge flow (FALSE)}
-      ohcmap    - resulting High Curvature Map
-                  {high curvature (TRUE), low curvature (FALSE)}
-      omw       - width (in blocks) of image maps
-      omh       - height (in blocks) of image maps
-      obdata    - resulting binarized image
-                  {0 = black pixel (ridge) and 255 = white pixel (valley)}
-      obw       - width (in pixels) of the binary image
-      obh       - height (in pixels) of the binary image
+      omaps     - resulting image maps, to be freed with free_image_maps()
    Return Code:
       Zero      - successful completion
       Negative  - system error
 **************************************************************************/
-static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
-                        int **odmap, int **olcmap, int **olfmap, int **ohcmap,
-                        int *omw, int *omh,
-                        unsigned char **obdata, int *obw, int *obh,
-                        unsigned char *idata, const int iw, const int ih,
-                        const LFSPARMS *lfsparms)
+int get_image_maps(LFSMAPS **omaps, unsigned char *idata,
+                   const int iw, const int ih, const int id,
+                   const LFSPARMS *lfsparms)
 {
-   unsigned char *pdata, *bdata;
-   int pw, ph, bw, bh;
+   LFSMAPS *maps;
    DIR2RAD *dir2rad;
    DFTWAVES *dftwaves;
    ROTGRIDS *dftgrids;
-   ROTGRIDS *dirbingrids;
-   int *direction_map, *low_contrast_map, *low_flow_map, *high_curve_map;
-   int mw, mh;
-   int ret, maxpad;
-   MINUTIAE *minutiae;
+   int ret;
+
+   /* If input image is not 8-bit grayscale ... */
+   if(id != 8){
+      print2err("ERROR : get_image_maps : input image pixel ");
+      print2err("depth = %d != 8.\n", id);
+      return(-2);
+   }
 
    /******************/
    /* INITIALIZATION */
@@ -108,15 +99,25 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       /* If system error, exit with error code. */
       return(ret);
 
+   maps = (LFSMAPS *)calloc(1, sizeof(LFSMAPS));
+   if(maps == (LFSMAPS *)NULL){
+      print2err("ERROR : get_image_maps : calloc : maps\n");
+      return(-582);
+   }
+   maps->iw = iw;
+   maps->ih = ih;
+
    /* Determine the maximum amount of image padding required to support */
    /* LFS processes.                                                    */
-   maxpad = get_max_padding_V2(lfsparms->windowsize, lfsparms->windowoffset,
+   maps->maxpad = get_max_padding_V2(lfsparms->windowsize,
+                          lfsparms->windowoffset,
                           lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
 
    /* Initialize lookup table for converting integer directions */
    /* to angles in radians.                                     */
    if((ret = init_dir2rad(&dir2rad, lfsparms->num_directions))){
       /* Free memory allocated to this point. */
+      free_image_maps(maps);
       return(ret);
    }
 
@@ -126,46 +127,51 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
                         lfsparms->windowsize))){
       /* Free memory allocated to this point. */
       free_dir2rad(dir2rad);
+      free_image_maps(maps);
       return(ret);
    }
 
    /* Initialize lookup table for pixel offsets to rotated grids */
    /* used for DFT analyses.                                     */
-   if((ret = init_rotgrids(&dftgrids, iw, ih, maxpad,
+   if((ret = init_rotgrids(&dftgrids, iw, ih, maps->maxpad,
                         lfsparms->start_dir_angle, lfsparms->num_directions,
                         lfsparms->windowsize, lfsparms->windowsize,
                         RELATIVE2ORIGIN))){
       /* Free memory allocated to this point. */
       free_dir2rad(dir2rad);
       free_dftwaves(dftwaves);
+      free_image_maps(maps);
       return(ret);
    }
 
    /* Pad input image based on max padding. */
-   if(maxpad > 0){   /* May not need to pad at all */
-      if((ret = pad_uchar_image(&pdata, &pw, &ph, idata, iw, ih,
-                             maxpad, lfsparms->pad_value))){
+   if(maps->maxpad > 0){   /* May not need to pad at all */
+      if((ret = pad_uchar_image(&(maps->pdata), &(maps->pw), &(maps->ph),
+                             idata, iw, ih,
+                             maps->maxpad, lfsparms->pad_value))){
          /* Free memory allocated to this point. */
          free_dir2rad(dir2rad);
          free_dftwaves(dftwaves);
          free_rotgrids(dftgrids);
+         free_image_maps(maps);
          return(ret);
       }
    }
    else{
       /* If padding is unnecessary, then copy the input image. */
-      pdata = (unsigned char *)malloc(iw*ih);
-      if(pdata == (unsigned char *)NULL){
+      maps->pdata = (unsigned char *)malloc(iw*ih);
+      if(maps->pdata == (unsigned char *)NULL){
          /* Free memory allocated to this point. */
          free_dir2rad(dir2rad);
          free_dftwaves(dftwaves);
          free_rotgrids(dftgrids);
-         fprintf(stderr, "ERROR : lfs_detect_minutiae_V2 : malloc : pdata\n");
+         free_image_maps(maps);
+         print2err("ERROR : get_image_maps : malloc : pdata\n");
          return(-580);
       }
-      memcpy(pdata, idata, iw*ih);
-      pw = iw;
-      ph = ih;
+      memcpy(maps->pdata, idata, iw*ih);
+      maps->pw = iw;
+      maps->ph = ih;
    }
 
    /* Scale input image to 6 bits [0..63] */
@@ -174,7 +180,7 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /* could not get this work upon first attempt. Also, if not   */
    /* careful, I think accumulated power magnitudes may overflow */
    /* doubles.                                                   */
-   bits_8to6(pdata, pw, ph);
+   bits_8to6(maps->pdata, maps->pw, maps->ph);
 
    print2log("\nINITIALIZATION AND PADDING DONE\n");
 
@@ -183,14 +189,16 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /******************/
 
    /* Generate block maps from the input image. */
-   if((ret = gen_image_maps(&direction_map, &low_contrast_map,
-                    &low_flow_map, &high_curve_map, &mw, &mh,
-                    pdata, pw, ph, dir2rad, dftwaves, dftgrids, lfsparms))){
+   if((ret = gen_image_maps(&(maps->direction_map),
+                    &(maps->low_contrast_map), &(maps->low_flow_map),
+                    &(maps->high_curve_map), &(maps->mw), &(maps->mh),
+                    maps->pdata, maps->pw, maps->ph,
+                    dir2rad, dftwaves, dftgrids, lfsparms))){
       /* Free memory allocated to this point. */
       free_dir2rad(dir2rad);
       free_dftwaves(dftwaves);
       free_rotgrids(dftgrids);
-      free(pdata);
+      free_image_maps(maps);
       return(ret);
    }
    /* Deallocate working memories. */
@@ -198,37 +206,105 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    free_dftwaves(dftwaves);
    free_rotgrids(dftgrids);
 
+   /* Build integrated quality map. */
+   if((ret = gen_quality_map(&(maps->quality_map),
+                            maps->direction_map, maps->low_contrast_map,
+                            maps->low_flow_map, maps->high_curve_map,
+                            maps->mw, maps->mh))){
+      free_image_maps(maps);
+      return(ret);
+   }
+
    print2log("\nMAPS DONE\n");
 
+   /* If LOG_REPORT defined, close log report file. */
+   if((ret = close_logfile())){
+      free_image_maps(maps);
+      return(ret);
+   }
+
+   *omaps = maps;
+   return(0);
+}
+
+/*************************************************************************
+#cat: free_image_maps - Deallocates the image maps returned by
+#cat:          get_image_maps(), along with any of the maps still
+#cat:          attached to them.
+
+   Input:
+      maps      - image maps to be deallocated
+**************************************************************************/
+void free_image_maps(LFSMAPS *maps)
+{
+   if(maps == (LFSMAPS *)NULL)
+      return;
+
+   free(maps->pdata);
+   free(maps->direction_map);
+   free(maps->low_contrast_map);
+   free(maps->low_flow_map);
+   free(maps->high_curve_map);
+   free(maps->quality_map);
+   free(maps);
+}
+
+/*************************************************************************
+#cat: lfs_detect_minutiae_V2 - Takes the image maps of a grayscale
+#cat:          fingerprint image, and returns a binarized image designating
+#cat:          ridges from valleys, and a list of minutiae (including
+#cat:          position, reliability, type, direction, neighbors, and
+#cat:          ridge counts to neighbors).
+
+   Input:
+      maps      - image maps from get_image_maps()
+      lfsparms  - parameters and thresholds for controlling LFS
+
+   Output:
+      ominutiae - resulting list of minutiae
+      obdata    - resulting binarized image
+                  {0 = black pixel (ridge) and 255 = white pixel (valley)}
+      obw       - width (in pixels) of the binary image
+      obh       - height (in pixels) of the binary image
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
+                        unsigned char **obdata, int *obw, int *obh,
+                        const LFSMAPS *maps, const LFSPARMS *lfsparms)
+{
+   unsigned char *bdata;
+   int bw, bh;
+   ROTGRIDS *dirbingrids;
+   const int iw = maps->iw, ih = maps->ih;
+   int ret;
+   MINUTIAE *minutiae;
+
+   /* If LOG_REPORT defined, open log report file. */
+   if((ret = open_logfile()))
+      /* If system error, exit with error code. */
+      return(ret);
+
    /******************/
    /* BINARIZARION   */
    /******************/
 
    /* Initialize lookup table for pixel offsets to rotated grids */
    /* used for directional binarization.                         */
-   if((ret = init_rotgrids(&dirbingrids, iw, ih, maxpad,
+   if((ret = init_rotgrids(&dirbingrids, iw, ih, maps->maxpad,
                         lfsparms->start_dir_angle, lfsparms->num_directions,
                         lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h,
                         RELATIVE2CENTER))){
-      /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
       return(ret);
    }
 
    /* Binarize input image based on NMAP information. */
    if((ret = binarize_V2(&bdata, &bw, &bh,
-                      pdata, pw, ph, direction_map, mw, mh,
+                      maps->pdata, maps->pw, maps->ph,
+                      maps->direction_map, maps->mw, maps->mh,
                       dirbingrids, lfsparms))){
       /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
       free_rotgrids(dirbingrids);
       return(ret);
    }
@@ -240,14 +316,9 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /* the input image, then ERROR.                                 */
    if((iw != bw) || (ih != bh)){
       /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
       free(bdata);
-      fprintf(stderr, "ERROR : lfs_detect_minutiae_V2 :");
-      fprintf(stderr,"binary image has bad dimensions : %d, %d\n",
+      print2err("ERROR : lfs_detect_minutiae_V2 :");
+      print2err("binary image has bad dimensions : %d, %d\n",
               bw, bh);
       return(-581);
    }
@@ -264,32 +335,26 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
 
    /* Allocate initial list of minutia pointers. */
    if((ret = alloc_minutiae(&minutiae, MAX_MINUTIAE))){
+      free(bdata);
       return(ret);
    }
 
    /* Detect the minutiae in the binarized image. */
    if((ret = detect_minutiae_V2(minutiae, bdata, iw, ih,
-                             direction_map, low_flow_map, high_curve_map,
-                             mw, mh, lfsparms))){
+                             maps->direction_map, maps->low_flow_map,
+                             maps->high_curve_map, maps->mw, maps->mh,
+                             lfsparms))){
       /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
       free(bdata);
+      free_minutiae(minutiae);
       return(ret);
    }
 
    if((ret = remove_false_minutia_V2(minutiae, bdata, iw, ih,
-                       direction_map, low_flow_map, high_curve_map, mw, mh,
+                       maps->direction_map, maps->low_flow_map,
+                       maps->high_curve_map, maps->mw, maps->mh,
                        lfsparms))){
       /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
       free(bdata);
       free_minutiae(minutiae);
       return(ret);
@@ -302,11 +367,7 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /******************/
    if((ret = count_minutiae_ridges(minutiae, bdata, iw, ih, lfsparms))){
       /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
+      free(bdata);
       free_minutiae(minutiae);
       return(ret);
    }
@@ -322,16 +383,7 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /* grayscale binary image [0,255].           */
    gray2bin(1, 255, 0, bdata, iw, ih);
 
-   /* Deallocate working memory. */
-   free(pdata);
-
    /* Assign results to output pointers. */
-   *odmap = direction_map;
-   *olcmap = low_contrast_map;
-   *olfmap = low_flow_map;
-   *ohcmap = high_curve_map;
-   *omw = mw;
-   *omh = mh;
    *obdata = bdata;
    *obw = bw;
    *obh = bh;
@@ -346,12 +398,15 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
 
 /*************************************************************************
 **************************************************************************
-#cat:   get_minutiae - Takes a grayscale fingerprint image, binarizes the input
-#cat:                image, and detects minutiae points using LFS Version 2.
-#cat:                The routine passes back the detected minutiae, the
-#cat:                binarized image, and a set of image quality maps.
+#cat:   get_minutiae_from_maps - Takes a grayscale fingerprint image and
+#cat:                the image maps get_image_maps() generated for it,
+#cat:                binarizes the image, and detects minutiae points
+#cat:                using LFS Version 2.  The routine passes back the
+#cat:                detected minutiae and the binarized image.  The maps
+#cat:                are left to the caller.
 
    Input:
+      maps     - image maps generated from idata
       idata    - grayscale fingerprint image data
       iw       - width (in pixels) of the grayscale image
       ih       - height (in pixels) of the grayscale image
@@ -361,13 +416,6 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    Output:
       ominutiae         - points to a structure containing the
                           detected minutiae
-      oquality_map      - resulting integrated image quality map
-      odirection_map    - resulting direction map
-      olow_contrast_map - resulting low contrast map
-      olow_flow_map     - resulting low ridge flow map
-      ohigh_curve_map   - resulting high curvature map
-      omap_w   - width (in blocks) of image maps
-      omap_h   - height (in blocks) of image maps
       obdata   - points to binarized image data
       obw      - width (in pixels) of binarized image
       obh      - height (in pixels) of binarized image
@@ -376,75 +424,56 @@ static int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       Zero     - successful completion
       Negative - system error
 **************************************************************************/
-int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
-                 int **odirection_map, int **olow_contrast_map,
-                 int **olow_flow_map, int **ohigh_curve_map,
-                 int *omap_w, int *omap_h,
+int get_minutiae_from_maps(MINUTIAE **ominutiae,
                  unsigned char **obdata, int *obw, int *obh, int *obd,
+                 const LFSMAPS *maps,
                  unsigned char *idata, const int iw, const int ih,
                  const int id, const double ppmm, const LFSPARMS *lfsparms)
 {
    int ret;
    MINUTIAE *minutiae = NULL;
-   int *direction_map = NULL, *low_contrast_map = NULL, *low_flow_map = NULL;
-   int *high_curve_map = NULL, *quality_map = NULL;
-   int map_w = 0, map_h = 0;
    unsigned char *bdata = NULL;
    int bw = 0, bh = 0;
 
    /* If input image is not 8-bit grayscale ... */
    if(id != 8){
-      fprintf(stderr, "ERROR : get_minutiae : input image pixel ");
-      fprintf(stderr, "depth = %d != 8.\n", id);
+      print2err("ERROR : get_minutiae_from_maps : input image pixel ");
+      print2err("depth = %d != 8.\n", id);
       return(-2);
    }
 
-   /* Detect minutiae in grayscale fingerpeint image. */
-   if((ret = lfs_detect_minutiae_V2(&minutiae,
-                                   &direction_map, &low_contrast_map,
-                                   &low_flow_map, &high_curve_map,
-                                   &map_w, &map_h,
-                                   &bdata, &bw, &bh,
-                                   idata, iw, ih, lfsparms))){
-      return(ret);
+   /* If the maps were generated from an image of another size ... */
+   if((iw != maps->iw) || (ih != maps->ih)){
+      print2err("ERROR : get_minutiae_from_maps : ");
+      print2err("maps are for a %d x %d image, not %d x %d\n",
+              maps->iw, maps->ih, iw, ih);
+      return(-583);
    }
 
-   /* Build integrated quality map. */
-   if((ret = gen_quality_map(&quality_map,
-                            direction_map, low_contrast_map,
-                            low_flow_map, high_curve_map, map_w, map_h))){
-      free_minutiae(minutiae);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
-      free(bdata);
+   /* Reuse contour lists across the whole detection. */
+   if((ret = begin_contour_workspace()))
+      return(ret);
+
+   /* Detect minutiae in grayscale fingerpeint image. */
+   ret = lfs_detect_minutiae_V2(&minutiae, &bdata, &bw, &bh,
+                                maps, lfsparms);
+   end_contour_workspace();
+   if(ret){
       return(ret);
    }
 
    /* Assign reliability from quality map. */
-   if((ret = combined_minutia_quality(minutiae, quality_map, map_w, map_h,
+   if((ret = combined_minutia_quality(minutiae, maps->quality_map,
+                                     maps->mw, maps->mh,
                                      lfsparms->blocksize,
                                      idata, iw, ih, id, ppmm))){
       free_minutiae(minutiae);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
-      free(quality_map);
       free(bdata);
       return(ret);
    }
 
    /* Set output pointers. */
    *ominutiae = minutiae;
-   *oquality_map = quality_map;
-   *odirection_map = direction_map;
-   *olow_contrast_map = low_contrast_map;
-   *olow_flow_map = low_flow_map;
-   *ohigh_curve_map = high_curve_map;
-   *omap_w = map_w;
-   *omap_h = map_h;
    *obdata = bdata;
    *obw = bw;
    *obh = bh;
@@ -453,3 +482,82 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
    /* Return normally. */
    return(0);
 }
+
+/*************************************************************************
+**************************************************************************
+#cat:   get_minutiae - Takes a grayscale fingerprint image, binarizes the input
+#cat:                image, and detects minutiae points using LFS Version 2.
+#cat:                The routine passes back the detected minutiae, the
+#cat:                binarized image, and a set of image quality maps.
+
+   Input:
+      idata    - grayscale fingerprint image data
+      iw       - width (in pixels) of the grayscale image
+      ih       - height (in pixels) of the grayscale image
+      id       - pixel depth (in bits) of the grayscale image
+      ppmm     - the scan resolution (in pixels/mm) of the grayscale image
+      lfsparms - parameters and thresholds for controlling LFS
+   Output:
+      ominutiae         - points to a structure containing the
+                          detected minutiae
+      oquality_map      - resulting integrated image quality map
+      odirection_map    - resulting direction map
+      olow_contrast_map - resulting low contrast map
+      olow_flow_map     - resulting low ridge flow map
+      ohigh_curve_map   - resulting high curvature map
+      omap_w   - width (in blocks) of image maps
+      omap_h   - height (in blocks) of image maps
+      obdata   - points to binarized image data
+      obw      - width (in pixels) of binarized image
+      obh      - height (in pixels) of binarized image
+      obd      - pixel depth (in bits) of binarized image
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
+                 int **odirection_map, int **olow_contrast_map,
+                 int **olow_flow_map, int **ohigh_curve_map,
+                 int *omap_w, int *omap_h,
+                 unsigned char **obdata, int *obw, int *obh, int *obd,
+                 unsigned char *idata, const int iw, const int ih,
+                 const int id, const double ppmm, const LFSPARMS *lfsparms)
+{
+   int ret;
+   LFSMAPS *maps;
+   MINUTIAE *minutiae = NULL;
+   unsigned char *bdata = NULL;
+   int bw = 0, bh = 0, bd = 0;
+
+   /* Generate the image maps. */
+   if((ret = get_image_maps(&maps, idata, iw, ih, id, lfsparms)))
+      return(ret);
+
+   /* Detect minutiae from them. */
+   if((ret = get_minutiae_from_maps(&minutiae, &bdata, &bw, &bh, &bd,
+                                   maps, idata, iw, ih, id, ppmm,
+                                   lfsparms))){
+      free_image_maps(maps);
+      return(ret);
+   }
+
+   /* Set output pointers, handing the maps over to the caller. */
+   *ominutiae = minutiae;
+   *oquality_map = maps->quality_map;
+   *odirection_map = maps->direction_map;
+   *olow_contrast_map = maps->low_contrast_map;
+   *olow_flow_map = maps->low_flow_map;
+   *ohigh_curve_map = maps->high_curve_map;
+   *omap_w = maps->mw;
+   *omap_h = maps->mh;
+   *obdata = bdata;
+   *obw = bw;
+   *obh = bh;
+   *obd = bd;
+
+   free(maps->pdata);
+   free(maps);
+
+   /* Return normally. */
+   return(0);
+}
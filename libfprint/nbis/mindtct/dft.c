@@ -46,6 +46,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -168,12 +169,12 @@ int dft_dir_powers(double **powers, unsigned char *pdata,
    /* Allocate line sum vector, and initialize to zeros */
    /* This routine requires square block (grid), so ERROR otherwise. */
    if(dftgrids->grid_w != dftgrids->grid_h){
-      fprintf(stderr, "ERROR : dft_dir_powers : DFT grids must be square\n");
+      print2err("ERROR : dft_dir_powers : DFT grids must be square\n");
       return(-90);
    }
    rowsums = (int *)malloc(dftgrids->grid_w * sizeof(int));
    if(rowsums == (int *)NULL){
-      fprintf(stderr, "ERROR : dft_dir_powers : malloc : rowsums\n");
+      print2err("ERROR : dft_dir_powers : malloc : rowsums\n");
       return(-91);
    }
 
@@ -280,7 +281,7 @@ static int sort_dft_waves(int *wis, const double *powmaxs, const double *pownorm
    /* Allocate normalized power^2 array */
    pownorms2 = (double *)malloc(nstats * sizeof(double));
    if(pownorms2 == (double *)NULL){
-      fprintf(stderr, "ERROR : sort_dft_waves : malloc : pownorms2\n");
+      print2err("ERROR : sort_dft_waves : malloc : pownorms2\n");
       return(-100);
    }
 
@@ -292,7 +293,7 @@ static int sort_dft_waves(int *wis, const double *powmaxs, const double *pownorm
    }
 
    /* Sort the statistic indices on the normalized squared power. */
-   bubble_sort_double_dec_2(pownorms2, wis, nstats);
+   network_sort_double_dec_2(pownorms2, wis, nstats);
 
    /* Deallocate the working memory. */
    free(pownorms2);
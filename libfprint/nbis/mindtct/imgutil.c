@@ -48,6 +48,7 @@ identified are necessarily the best available for the purpose.
 #include <stdlib.h>
 #include <memory.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -185,7 +186,7 @@ int pad_uchar_image(unsigned char **optr, int *ow, int *oh,
    /* Allocate padded image */
    pdata = (unsigned char *)malloc(psize * sizeof(unsigned char));
    if(pdata == (unsigned char *)NULL){
-      fprintf(stderr, "ERROR : pad_uchar_image : malloc : pdata\n");
+      print2err("ERROR : pad_uchar_image : malloc : pdata\n");
       return(-160);
    }
 
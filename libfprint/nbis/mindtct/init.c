@@ -46,6 +46,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -72,7 +73,7 @@ int init_dir2rad(DIR2RAD **optr, const int ndirs)
    /* Allocate structure */
    dir2rad = (DIR2RAD *)malloc(sizeof(DIR2RAD));
    if(dir2rad == (DIR2RAD *)NULL){
-      fprintf(stderr, "ERROR : init_dir2rad : malloc : dir2rad\n");
+      print2err("ERROR : init_dir2rad : malloc : dir2rad\n");
       return(-10);
    }
 
@@ -84,7 +85,7 @@ int init_dir2rad(DIR2RAD **optr, const int ndirs)
    if(dir2rad->cos == (double *)NULL){
       /* Free memory allocated to this point. */
       free(dir2rad);
-      fprintf(stderr, "ERROR : init_dir2rad : malloc : dir2rad->cos\n");
+      print2err("ERROR : init_dir2rad : malloc : dir2rad->cos\n");
       return(-11);
    }
 
@@ -94,7 +95,7 @@ int init_dir2rad(DIR2RAD **optr, const int ndirs)
       /* Free memory allocated to this point. */
       free(dir2rad->cos);
       free(dir2rad);
-      fprintf(stderr, "ERROR : init_dir2rad : malloc : dir2rad->sin\n");
+      print2err("ERROR : init_dir2rad : malloc : dir2rad->sin\n");
       return(-12);
    }
 
@@ -147,7 +148,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
    /* Allocate structure */
    dftwaves = (DFTWAVES *)malloc(sizeof(DFTWAVES));
    if(dftwaves == (DFTWAVES *)NULL){
-      fprintf(stderr, "ERROR : init_dftwaves : malloc : dftwaves\n");
+      print2err("ERROR : init_dftwaves : malloc : dftwaves\n");
       return(-20);
    }
 
@@ -161,7 +162,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
    if(dftwaves == (DFTWAVES *)NULL){
       /* Free memory allocated to this point. */
       free(dftwaves);
-      fprintf(stderr, "ERROR : init_dftwaves : malloc : dftwaves->waves\n");
+      print2err("ERROR : init_dftwaves : malloc : dftwaves->waves\n");
       return(-21);
    }
 
@@ -183,7 +184,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
          }}
          free(dftwaves->waves);
          free(dftwaves);
-         fprintf(stderr,
+         print2err(
                  "ERROR : init_dftwaves : malloc : dftwaves->waves[i]\n");
          return(-22);
       }
@@ -199,7 +200,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
          free(dftwaves->waves[i]);
          free(dftwaves->waves);
          free(dftwaves);
-         fprintf(stderr,
+         print2err(
                  "ERROR : init_dftwaves : malloc : dftwaves->waves[i]->cos\n");
          return(-23);
       }
@@ -216,7 +217,7 @@ int init_dftwaves(DFTWAVES **optr, const double *dft_coefs,
          free(dftwaves->waves[i]);
          free(dftwaves->waves);
          free(dftwaves);
-         fprintf(stderr,
+         print2err(
                  "ERROR : init_dftwaves : malloc : dftwaves->waves[i]->sin\n");
          return(-24);
       }
@@ -389,7 +390,7 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
    /* Allocate structure */
    rotgrids = (ROTGRIDS *)malloc(sizeof(ROTGRIDS));
    if(rotgrids == (ROTGRIDS *)NULL){
-      fprintf(stderr, "ERROR : init_rotgrids : malloc : rotgrids\n");
+      print2err("ERROR : init_rotgrids : malloc : rotgrids\n");
       return(-30);
    }
 
@@ -423,7 +424,7 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
          grid_pad = sround(pad);
          break;
       default:
-         fprintf(stderr,
+         print2err(
                  "ERROR : init_rotgrids : Illegal relative flag : %d\n",
                  relative2);
          free(rotgrids);
@@ -439,7 +440,7 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
       /* sufficiently large to handle the rotated grids herein.          */
       if(ipad < grid_pad){
          /* If input pad is NOT large enough, then ERROR. */
-         fprintf(stderr, "ERROR : init_rotgrids : Pad passed is too small\n");
+         print2err("ERROR : init_rotgrids : Pad passed is too small\n");
          free(rotgrids);
          return(-32);
       }
@@ -462,7 +463,7 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
    if(rotgrids->grids == (int **)NULL){
       /* Free memory allocated to this point. */
       free(rotgrids);
-      fprintf(stderr, "ERROR : init_rotgrids : malloc : rotgrids->grids\n");
+      print2err("ERROR : init_rotgrids : malloc : rotgrids->grids\n");
       return(-33);
    }
 
@@ -482,7 +483,7 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
             free(rotgrids->grids[_j]);
          }}
          free(rotgrids);
-         fprintf(stderr,
+         print2err(
                  "ERROR : init_rotgrids : malloc : rotgrids->grids[dir]\n");
          return(-34);
       }
@@ -589,7 +590,7 @@ int alloc_dir_powers(double ***opowers, const int nwaves, const int ndirs)
    /* Allocate list of double pointers to hold power vectors */
    powers = (double **)malloc(nwaves * sizeof(double*));
    if(powers == (double **)NULL){
-      fprintf(stderr, "ERROR : alloc_dir_powers : malloc : powers\n");
+      print2err("ERROR : alloc_dir_powers : malloc : powers\n");
       return(-40);
    }
    /* Foreach DFT wave ... */
@@ -602,7 +603,7 @@ int alloc_dir_powers(double ***opowers, const int nwaves, const int ndirs)
             free(powers[_j]);
          }}
          free(powers);
-         fprintf(stderr, "ERROR : alloc_dir_powers : malloc : powers[w]\n");
+         print2err("ERROR : alloc_dir_powers : malloc : powers[w]\n");
          return(-41);
       }
    }
@@ -648,7 +649,7 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
    /* Allocate DFT wave index vector */
    wis = (int *)malloc(nstats * sizeof(int));
    if(wis == (int *)NULL){
-      fprintf(stderr, "ERROR : alloc_power_stats : malloc : wis\n");
+      print2err("ERROR : alloc_power_stats : malloc : wis\n");
       return(-50);
    }
 
@@ -657,7 +658,7 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
    if(powmaxs == (double *)NULL){
       /* Free memory allocated to this point. */
       free(wis);
-      fprintf(stderr, "ERROR : alloc_power_stats : malloc : powmaxs\n");
+      print2err("ERROR : alloc_power_stats : malloc : powmaxs\n");
       return(-51);
    }
 
@@ -667,7 +668,7 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
       /* Free memory allocated to this point. */
       free(wis);
       free(powmaxs);
-      fprintf(stderr, "ERROR : alloc_power_stats : malloc : powmax_dirs\n");
+      print2err("ERROR : alloc_power_stats : malloc : powmax_dirs\n");
       return(-52);
    }
 
@@ -678,7 +679,7 @@ int alloc_power_stats(int **owis, double **opowmaxs, int **opowmax_dirs,
       free(wis);
       free(powmaxs);
       free(pownorms);
-      fprintf(stderr, "ERROR : alloc_power_stats : malloc : pownorms\n");
+      print2err("ERROR : alloc_power_stats : malloc : pownorms\n");
       return(-53);
    }
 
@@ -35,11 +35,13 @@ identified are necessarily the best available for the purpose.
 ***********************************************************************
                ROUTINES:
                         line_points()
+                        fill_line_points()
 ***********************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -62,13 +64,7 @@ identified are necessarily the best available for the purpose.
 int line_points(int **ox_list, int **oy_list, int *onum,
                 const int x1, const int y1, const int x2, const int y2)
 {
-   int asize;
-   int dx, dy, adx, ady;
-   int x_incr, y_incr;
-   int i, inx, iny, intx, inty;
-   double x_factor, y_factor;
-   double rx, ry;
-   int ix, iy;
+   int asize, ret;
    int *x_list, *y_list;
 
    /* Compute maximum number of points needed to hold line segment. */
@@ -77,16 +73,64 @@ int line_points(int **ox_list, int **oy_list, int *onum,
    /* Allocate x and y-pixel coordinate lists to length 'asize'. */
    x_list = (int *)malloc(asize*sizeof(int));
    if(x_list == (int *)NULL){
-      fprintf(stderr, "ERROR : line_points : malloc : x_list\n");
+      print2err("ERROR : line_points : malloc : x_list\n");
       return(-410);
    }
    y_list = (int *)malloc(asize*sizeof(int));
    if(y_list == (int *)NULL){
       free(x_list);
-      fprintf(stderr, "ERROR : line_points : malloc : y_list\n");
+      print2err("ERROR : line_points : malloc : y_list\n");
       return(-411);
    }
 
+   if((ret = fill_line_points(x_list, y_list, asize, onum,
+                              x1, y1, x2, y2))){
+      free(x_list);
+      free(y_list);
+      return(ret);
+   }
+
+   /* Set output pointers. */
+   *ox_list = x_list;
+   *oy_list = y_list;
+
+   /* Return normally. */
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: fill_line_points - Stores the contiguous coordinates of a line
+#cat:               connecting 2 specified points in lists supplied by
+#cat:               the caller.
+
+   Input:
+      x_list  - list to hold the x-coords, of length asize
+      y_list  - list to hold the y-coords, of length asize
+      asize   - length of the lists, at least the larger of
+                |x2-x1|+2 and |y2-y1|+2
+      x1      - x-coord of first point
+      y1      - y-coord of first point
+      x2      - x-coord of second point
+      y2      - y-coord of second point
+   Output:
+      x_list  - x-coords along line trajectory
+      y_list  - y-coords along line trajectory
+      onum    - number of points along line trajectory
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int fill_line_points(int *x_list, int *y_list, const int asize, int *onum,
+                const int x1, const int y1, const int x2, const int y2)
+{
+   int dx, dy, adx, ady;
+   int x_incr, y_incr;
+   int i, inx, iny, intx, inty;
+   double x_factor, y_factor;
+   double rx, ry;
+   int ix, iy;
+
    /* Compute delta x and y. */
    dx = x2 - x1;
    dy = y2 - y1;
@@ -169,9 +213,7 @@ int line_points(int **ox_list, int **oy_list, int *onum,
    while((ix != x2) || (iy != y2)){
 
       if(i >= asize){
-         fprintf(stderr, "ERROR : line_points : coord list overflow\n");
-         free(x_list);
-         free(y_list);
+         print2err("ERROR : fill_line_points : coord list overflow\n");
          return(-412);
       }
 
@@ -193,9 +235,7 @@ int line_points(int **ox_list, int **oy_list, int *onum,
       y_list[i++] = iy;
    }
 
-   /* Set output pointers. */
-   *ox_list = x_list;
-   *oy_list = y_list;
+   /* Set output pointer. */
    *onum = i;
 
    /* Return normally. */
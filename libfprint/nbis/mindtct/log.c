@@ -36,6 +36,8 @@ identified are necessarily the best available for the purpose.
                         open_logfile()
                         print2log()
                         close_logfile()
+                        nbis_log()
+                        nbis_err()
 ***********************************************************************/
 
 #include <log.h>
@@ -47,16 +49,16 @@ int avrdir;
 float dir_strength;
 int nvalid;
 
+#ifdef LOG_REPORT
+
 /***************************************************************************/
 /***************************************************************************/
 int open_logfile()
 {
-#ifdef LOG_REPORT
    if((logfp = fopen(LOG_FILE, "wb")) == NULL){
       fprintf(stderr, "ERROR : open_logfile : fopen : %s\n", LOG_FILE);
       return(-1);
    }
-#endif
 
    return(0);
 }
@@ -65,26 +67,151 @@ int open_logfile()
 /***************************************************************************/
 void print2log(char *fmt, ...)
 {
-#ifdef LOG_REPORT
    va_list ap;
 
    va_start(ap, fmt);
    vfprintf(logfp, fmt, ap);
    va_end(ap);
-#endif
 }
 
 /***************************************************************************/
 /***************************************************************************/
 int close_logfile()
 {
-#ifdef LOG_REPORT
    if(fclose(logfp)){
       fprintf(stderr, "ERROR : close_logfile : fclose : %s\n", LOG_FILE);
       return(-1);
    }
-#endif
 
    return(0);
 }
 
+#elif defined(ENABLE_NBIS_LOG)
+
+#include <string.h>
+#include <glib.h>
+#include "fp_internal.h"
+
+/* Reports are written a piece of a line at a time, so each thread */
+/* collects the pieces until the line is complete. Error reports   */
+/* have their own lines, so they do not end up in a debug report.  */
+static void free_log_line(gpointer line)
+{
+   g_string_free((GString *)line, TRUE);
+}
+
+static GPrivate log_line = G_PRIVATE_INIT(free_log_line);
+static GPrivate err_line = G_PRIVATE_INIT(free_log_line);
+
+/* Source files to report from, from LIBFPRINT_NBIS_LOG, or NULL for all. */
+static gchar **log_categories;
+
+/***************************************************************************/
+/***************************************************************************/
+static const char *log_category(const char *file)
+{
+   const char *category;
+
+   /* Report by source file name, which lives as long as the program. */
+   category = strrchr(file, '/');
+   return((category != NULL) ? category + 1 : file);
+}
+
+/***************************************************************************/
+/***************************************************************************/
+static int nbis_log_enabled(const char *category)
+{
+   static gsize initialized;
+   const char *env;
+   int i, len;
+
+   if(g_once_init_enter(&initialized)){
+      env = g_getenv("LIBFPRINT_NBIS_LOG");
+      if(env != NULL && *env != '\0' && strcmp(env, "all") != 0)
+         log_categories = g_strsplit(env, ",", 0);
+      g_once_init_leave(&initialized, 1);
+   }
+
+   if(log_categories == NULL)
+      return(TRUE);
+
+   /* Match "remove" as well as "remove.c". */
+   len = strlen(category);
+   if(len > 2 && strcmp(category + len - 2, ".c") == 0)
+      len -= 2;
+   for(i = 0; log_categories[i] != NULL; i++){
+      if(strncmp(log_categories[i], category, len) == 0 &&
+         (log_categories[i][len] == '\0' ||
+          strcmp(log_categories[i] + len, ".c") == 0))
+         return(TRUE);
+   }
+
+   return(FALSE);
+}
+
+/***************************************************************************/
+/***************************************************************************/
+static int append_log_line(GPrivate *key, enum fpi_log_level level,
+                           const char *category, const char *function,
+                           const char *fmt, va_list ap)
+{
+   GString *line;
+   char *nl;
+   int lines = 0;
+
+   line = (GString *)g_private_get(key);
+   if(line == NULL){
+      line = g_string_new(NULL);
+      g_private_set(key, line);
+   }
+
+   g_string_append_vprintf(line, fmt, ap);
+
+   /* Pass each complete, non-empty line on. */
+   while((nl = strchr(line->str, '\n')) != NULL){
+      *nl = '\0';
+      if(nl != line->str){
+         fpi_log(level, category, function, "%s", line->str);
+         lines++;
+      }
+      g_string_erase(line, 0, (nl - line->str) + 1);
+   }
+
+   return(lines);
+}
+
+/***************************************************************************/
+/***************************************************************************/
+void nbis_log(const char *file, const char *function, const char *fmt, ...)
+{
+   const char *category;
+   va_list ap;
+
+   category = log_category(file);
+   if(!nbis_log_enabled(category))
+      return;
+
+   va_start(ap, fmt);
+   append_log_line(&log_line, FPRINT_LOG_LEVEL_DEBUG, category, function,
+                   fmt, ap);
+   va_end(ap);
+}
+
+/***************************************************************************/
+/***************************************************************************/
+void nbis_err(const char *file, const char *function, const char *fmt, ...)
+{
+   va_list ap;
+   int lines;
+
+   /* Errors are always reported, whatever LIBFPRINT_NBIS_LOG says. */
+   va_start(ap, fmt);
+   lines = append_log_line(&err_line, FPRINT_LOG_LEVEL_ERROR,
+                           log_category(file), function, fmt, ap);
+   va_end(ap);
+
+   while(lines-- > 0)
+      fpi_stats_inc(NULL, FP_STATS_NBIS_ERRORS);
+}
+
+#endif
@@ -53,6 +53,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -93,12 +94,9 @@ static int chain_code_loop(int **ochain, int *onchain,
    /* number of points in the contour.  There will be one chain code */
    /* between each point on the contour including a code between the */
    /* last to the first point on the contour (completing the loop).  */
-   chain = (int *)malloc(ncontour * sizeof(int));
-   /* If the allocation fails ... */
-   if(chain == (int *)NULL){
-      fprintf(stderr, "ERROR : chain_code_loop : malloc : chain\n");
+   if(allocate_chain(&chain, ncontour))
+      /* If the allocation fails ... */
       return(-170);
-   }
 
    /* For each neighboring point in the list (with "i" pointing to the */
    /* previous neighbor and "j" pointing to the next neighbor...       */
@@ -233,24 +231,21 @@ int get_loop_list(int **oonloop, MINUTIAE *minutiae, const int loop_len,
 {
    int i, ret;
    int *onloop;
-   MINUTIA *minutia;
 
    /* Allocate a list of onloop flags (one for each minutia in list). */
    onloop = (int *)malloc(minutiae->num * sizeof(int));
    if(onloop == (int *)NULL){
-      fprintf(stderr, "ERROR : get_loop_list : malloc : onloop\n");
+      print2err("ERROR : get_loop_list : malloc : onloop\n");
       return(-320);
    }
 
    i = 0;
    /* Foreach minutia remaining in list ... */
    while(i < minutiae->num){
-      /* Assign a temporary pointer. */
-      minutia = minutiae->list[i];
       /* If current minutia is a bifurcation ... */
-      if(minutia->type == BIFURCATION){
+      if(minutiae->type[i] == BIFURCATION){
          /* Check to see if it is on a loop of specified length. */
-         ret = on_loop(minutia, loop_len, bdata, iw, ih);
+         ret = on_loop(minutiae, i, loop_len, bdata, iw, ih);
          /* If minutia is on a loop... */
          if(ret == LOOP_FOUND){
             /* Then set the onloop flag to TRUE. */
@@ -308,6 +303,7 @@ int get_loop_list(int **oonloop, MINUTIAE *minutiae, const int loop_len,
 
    Input:
       minutiae      - list of true and false minutiae
+      i             - index of the minutia point in the list
       max_loop_len  - maximum size of loop searched for
       bdata         - binary image data (0==while & 1==black)
       iw            - width (in pixels) of image
@@ -318,7 +314,7 @@ int get_loop_list(int **oonloop, MINUTIAE *minutiae, const int loop_len,
       FALSE      - minutia determined not to lie on qualifying loop
       Negative   - system error
 **************************************************************************/
-int on_loop(const MINUTIA *minutia, const int max_loop_len,
+int on_loop(const MINUTIAE *minutiae, const int i, const int max_loop_len,
             unsigned char *bdata, const int iw, const int ih)
 {
    int ret;
@@ -328,8 +324,9 @@ int on_loop(const MINUTIA *minutia, const int max_loop_len,
    /* and stepping along up to the specified maximum number of steps. */
    ret = trace_contour(&contour_x, &contour_y,
                        &contour_ex, &contour_ey, &ncontour, max_loop_len,
-                       minutia->x, minutia->y, minutia->x, minutia->y,
-                       minutia->ex, minutia->ey,
+                       minutiae->x[i], minutiae->y[i],
+                       minutiae->x[i], minutiae->y[i],
+                       minutiae->ex[i], minutiae->ey[i],
                        SCAN_CLOCKWISE, bdata, iw, ih);
 
    /* If trace was not possible ... */
@@ -360,8 +357,9 @@ int on_loop(const MINUTIA *minutia, const int max_loop_len,
 #cat:                 points of the loop are returned.
 
    Input:
-      minutia1      - first minutia point
-      minutia2      - second minutia point
+      minutiae      - list of true and false minutiae
+      m1            - index of the first minutia point
+      m2            - index of the second minutia point
       max_half_loop - maximum size of half the loop circumference searched for
       bdata         - binary image data (0==while & 1==black)
       iw            - width (in pixels) of image
@@ -380,7 +378,7 @@ int on_loop(const MINUTIA *minutia, const int max_loop_len,
 **************************************************************************/
 int on_island_lake(int **ocontour_x, int **ocontour_y,
                    int **ocontour_ex, int **ocontour_ey, int *oncontour,
-                   const MINUTIA *minutia1, const MINUTIA *minutia2,
+                   const MINUTIAE *minutiae, const int m1, const int m2,
                    const int max_half_loop,
                    unsigned char *bdata, const int iw, const int ih)
 {
@@ -394,8 +392,9 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
    /* until 2nd mintuia point is encountered.                             */
    ret = trace_contour(&contour1_x, &contour1_y,
                        &contour1_ex, &contour1_ey, &ncontour1, max_half_loop,
-                       minutia2->x, minutia2->y, minutia1->x, minutia1->y,
-                       minutia1->ex, minutia1->ey,
+                       minutiae->x[m2], minutiae->y[m2],
+                       minutiae->x[m1], minutiae->y[m1],
+                       minutiae->ex[m1], minutiae->ey[m1],
                        SCAN_CLOCKWISE, bdata, iw, ih);
 
    /* If trace was not possible, return IGNORE. */
@@ -411,8 +410,9 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
       /*  mintuia point is encountered.                                     */
       ret = trace_contour(&contour2_x, &contour2_y,
                         &contour2_ex, &contour2_ey, &ncontour2, max_half_loop,
-                        minutia1->x, minutia1->y, minutia2->x, minutia2->y,
-                        minutia2->ex, minutia2->ey,
+                        minutiae->x[m1], minutiae->y[m1],
+                        minutiae->x[m2], minutiae->y[m2],
+                        minutiae->ex[m2], minutiae->ey[m2],
                         SCAN_CLOCKWISE, bdata, iw, ih);
 
       /* If trace was not possible, return IGNORE. */
@@ -438,10 +438,10 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
 
          /* Store 1st minutia. */
          l = 0;
-         loop_x[l] = minutia1->x;
-         loop_y[l] = minutia1->y;
-         loop_ex[l] = minutia1->ex;
-         loop_ey[l++] = minutia1->ey;
+         loop_x[l] = minutiae->x[m1];
+         loop_y[l] = minutiae->y[m1];
+         loop_ex[l] = minutiae->ex[m1];
+         loop_ey[l++] = minutiae->ey[m1];
          /* Store first contour. */
          for(i = 0; i < ncontour1; i++){
             loop_x[l] = contour1_x[i];
@@ -450,10 +450,10 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
             loop_ey[l++] = contour1_ey[i];
          }
          /* Store 2nd minutia. */
-         loop_x[l] = minutia2->x;
-         loop_y[l] = minutia2->y;
-         loop_ex[l] = minutia2->ex;
-         loop_ey[l++] = minutia2->ey;
+         loop_x[l] = minutiae->x[m2];
+         loop_y[l] = minutiae->y[m2];
+         loop_ex[l] = minutiae->ex[m2];
+         loop_ey[l++] = minutiae->ey[m2];
          /* Store 2nd contour. */
          for(i = 0; i < ncontour2; i++){
             loop_x[l] = contour2_x[i];
@@ -512,8 +512,9 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
 #cat:           of a ridge or valley.
 
    Input:
-      minutia1      - first minutia point
-      minutia2      - second minutia point
+      minutiae      - list of true and false minutiae
+      m1            - index of the first minutia point
+      m2            - index of the second minutia point
       max_hook_len  - maximum length of contour searched along for a hook
       bdata         - binary image data (0==while & 1==black)
       iw            - width (in pixels) of image
@@ -524,7 +525,7 @@ int on_island_lake(int **ocontour_x, int **ocontour_y,
       FALSE      - minutiae determined not to lie on same qualifying hook
       Negative   - system error
 **************************************************************************/
-int on_hook(const MINUTIA *minutia1, const MINUTIA *minutia2,
+int on_hook(const MINUTIAE *minutiae, const int m1, const int m2,
             const int max_hook_len,
             unsigned char *bdata, const int iw, const int ih)
 {
@@ -541,8 +542,9 @@ int on_hook(const MINUTIA *minutia1, const MINUTIA *minutia2,
 
    ret = trace_contour(&contour_x, &contour_y,
                        &contour_ex, &contour_ey, &ncontour, max_hook_len,
-                       minutia2->x, minutia2->y, minutia1->ex, minutia1->ey,
-                       minutia1->x, minutia1->y,
+                       minutiae->x[m2], minutiae->y[m2],
+                       minutiae->ex[m1], minutiae->ey[m1],
+                       minutiae->x[m1], minutiae->y[m1],
                        SCAN_CLOCKWISE, bdata, iw, ih);
 
    /* If trace was not possible, return IGNORE. */
@@ -571,8 +573,9 @@ int on_hook(const MINUTIA *minutia1, const MINUTIA *minutia2,
    /* edge neighbors counter-clockwise.                           */
    ret = trace_contour(&contour_x, &contour_y,
                        &contour_ex, &contour_ey, &ncontour, max_hook_len,
-                       minutia2->x, minutia2->y, minutia1->ex, minutia1->ey,
-                       minutia1->x, minutia1->y,
+                       minutiae->x[m2], minutiae->y[m2],
+                       minutiae->ex[m1], minutiae->ey[m1],
+                       minutiae->x[m1], minutiae->y[m1],
                        SCAN_COUNTER_CLOCKWISE, bdata, iw, ih);
 
    /* If trace was not possible, return IGNORE. */
@@ -644,7 +647,7 @@ int is_loop_clockwise(const int *contour_x, const int *contour_y,
    ret = is_chain_clockwise(chain, nchain, default_ret);
 
    /* Free the chain code and return result. */
-   free(chain);
+   free_chain(chain);
    return(ret);
 }
 
@@ -788,7 +791,7 @@ int process_loop(MINUTIAE *minutiae,
    int mid_x, mid_y, mid_pix;
    int feature_pix;
    int ret;
-   MINUTIA *minutia;
+   MINUTIA minutia;
 
    /* If contour is empty, then just return. */
    if(ncontour <= 0)
@@ -837,21 +840,16 @@ int process_loop(MINUTIAE *minutiae,
                return(appearing);
             }
             /* Create new minutia object. */
-            if((ret = create_minutia(&minutia,
-                                    contour_x[max_fr], contour_y[max_fr],
-                                    contour_ex[max_fr], contour_ey[max_fr],
-                                    idir, DEFAULT_RELIABILITY,
-                                    type, appearing, LOOP_ID))){
-               /* Return system error code. */
-               return(ret);
-            }
+            create_minutia(&minutia,
+                           contour_x[max_fr], contour_y[max_fr],
+                           contour_ex[max_fr], contour_ey[max_fr],
+                           idir, DEFAULT_RELIABILITY,
+                           type, appearing, LOOP_ID);
             /* Update the minutiae list with potential new minutia. */
-            ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-            /* If minuitia IGNORED and not added to the minutia list ... */
-            if(ret == IGNORE)
-               /* Deallocate the minutia. */
-               free_minutia(minutia);
+            if((ret = update_minutiae(minutiae, &minutia,
+                                      bdata, iw, ih, lfsparms)) < 0)
+               /* Return system error. */
+               return(ret);
 
             /* 2. Treat point opposite of maximum distance point as */
             /*    a potential minutia.                              */
@@ -871,21 +869,16 @@ int process_loop(MINUTIAE *minutiae,
                return(appearing);
             }
             /* Create new minutia object. */
-            if((ret = create_minutia(&minutia,
-                                    contour_x[max_to], contour_y[max_to],
-                                    contour_ex[max_to], contour_ey[max_to],
-                                    idir, DEFAULT_RELIABILITY,
-                                    type, appearing, LOOP_ID))){
-               /* Return system error code. */
-               return(ret);
-            }
+            create_minutia(&minutia,
+                           contour_x[max_to], contour_y[max_to],
+                           contour_ex[max_to], contour_ey[max_to],
+                           idir, DEFAULT_RELIABILITY,
+                           type, appearing, LOOP_ID);
             /* Update the minutiae list with potential new minutia. */
-            ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-            /* If minuitia IGNORED and not added to the minutia list ... */
-            if(ret == IGNORE)
-               /* Deallocate the minutia. */
-               free_minutia(minutia);
+            if((ret = update_minutiae(minutiae, &minutia,
+                                      bdata, iw, ih, lfsparms)) < 0)
+               /* Return system error. */
+               return(ret);
 
             /* Done successfully processing this loop, so return normally. */
             return(0);
@@ -942,7 +935,7 @@ int process_loop_V2(MINUTIAE *minutiae,
    int mid_x, mid_y, mid_pix;
    int feature_pix;
    int ret;
-   MINUTIA *minutia;
+   MINUTIA minutia;
    int fmapval;
    double reliability;
 
@@ -1005,22 +998,17 @@ int process_loop_V2(MINUTIAE *minutiae,
                reliability = HIGH_RELIABILITY;
 
             /* Create new minutia object. */
-            if((ret = create_minutia(&minutia,
-                                    contour_x[max_fr], contour_y[max_fr],
-                                    contour_ex[max_fr], contour_ey[max_fr],
-                                    idir, reliability,
-                                    type, appearing, LOOP_ID))){
-               /* Return system error code. */
-               return(ret);
-            }
+            create_minutia(&minutia,
+                           contour_x[max_fr], contour_y[max_fr],
+                           contour_ex[max_fr], contour_ey[max_fr],
+                           idir, reliability,
+                           type, appearing, LOOP_ID);
             /* Update the minutiae list with potential new minutia.  */
             /* NOTE: Deliberately using version one of this routine. */
-            ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-            /* If minuitia IGNORED and not added to the minutia list ... */
-            if(ret == IGNORE)
-               /* Deallocate the minutia. */
-               free_minutia(minutia);
+            if((ret = update_minutiae(minutiae, &minutia,
+                                      bdata, iw, ih, lfsparms)) < 0)
+               /* Return system error. */
+               return(ret);
 
             /* 2. Treat point opposite of maximum distance point as */
             /*    a potential minutia.                              */
@@ -1052,23 +1040,18 @@ int process_loop_V2(MINUTIAE *minutiae,
                reliability = HIGH_RELIABILITY;
 
             /* Create new minutia object. */
-            if((ret = create_minutia(&minutia,
-                                    contour_x[max_to], contour_y[max_to],
-                                    contour_ex[max_to], contour_ey[max_to],
-                                    idir, reliability,
-                                    type, appearing, LOOP_ID))){
-               /* Return system error code. */
-               return(ret);
-            }
+            create_minutia(&minutia,
+                           contour_x[max_to], contour_y[max_to],
+                           contour_ex[max_to], contour_ey[max_to],
+                           idir, reliability,
+                           type, appearing, LOOP_ID);
 
             /* Update the minutiae list with potential new minutia. */
             /* NOTE: Deliberately using version one of this routine. */
-            ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-            /* If minuitia IGNORED and not added to the minutia list ... */
-            if(ret == IGNORE)
-               /* Deallocate the minutia. */
-               free_minutia(minutia);
+            if((ret = update_minutiae(minutiae, &minutia,
+                                      bdata, iw, ih, lfsparms)) < 0)
+               /* Return system error. */
+               return(ret);
 
             /* Done successfully processing this loop, so return normally. */
             return(0);
@@ -1182,7 +1165,7 @@ int fill_loop(const int *contour_x, const int *contour_y,
        if(shape->rows[i]->npts < 1){
           /* Deallocate the shape. */
           free_shape(shape);
-          fprintf(stderr,
+          print2err(
           "WARNING : fill_loop : unexpected shape, preempting loop fill\n");
           /* This is unexpected, but not fatal, so return normally. */
           return(0);
@@ -116,7 +116,7 @@ int gen_image_maps(int **odmap, int **olcmap, int **olfmap, int **ohcmap,
    /* 1. Compute block offsets for the entire image, accounting for pad */
    /* Block_offsets() assumes square block (grid), so ERROR otherwise. */
    if(dftgrids->grid_w != dftgrids->grid_h){
-      fprintf(stderr,
+      print2err(
               "ERROR : gen_image_maps : DFT grids must be square\n");
       return(-540);
    }
@@ -247,7 +247,7 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
    /* Allocate Direction Map memory */
    direction_map = (int *)malloc(bsize * sizeof(int));
    if(direction_map == (int *)NULL){
-      fprintf(stderr,
+      print2err(
               "ERROR : gen_initial_maps : malloc : direction_map\n");
       return(-550);
    }
@@ -258,7 +258,7 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
    low_contrast_map = (int *)malloc(bsize * sizeof(int));
    if(low_contrast_map == (int *)NULL){
       free(direction_map);
-      fprintf(stderr,
+      print2err(
               "ERROR : gen_initial_maps : malloc : low_contrast_map\n");
       return(-551);
    }
@@ -270,7 +270,7 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
    if(low_flow_map == (int *)NULL){
       free(direction_map);
       free(low_contrast_map);
-      fprintf(stderr,
+      print2err(
               "ERROR : gen_initial_maps : malloc : low_flow_map\n");
       return(-552);
    }
@@ -478,7 +478,7 @@ int interpolate_direction_map(int *direction_map, int *low_contrast_map,
    /* Allocate output (interpolated) Direction Map. */
    omap = (int *)malloc(mw*mh*sizeof(int));
    if(omap == (int *)NULL){
-      fprintf(stderr,
+      print2err(
               "ERROR : interpolate_direction_map : malloc : omap\n");
       return(-520);
    }
@@ -652,13 +652,13 @@ int morph_TF_map(int *tfmap, const int mw, const int mh,
    /* Convert TRUE/FALSE map into a binary byte image. */
    cimage = (unsigned char *)malloc(mw*mh);
    if(cimage == (unsigned char *)NULL){
-      fprintf(stderr, "ERROR : morph_TF_map : malloc : cimage\n");
+      print2err("ERROR : morph_TF_map : malloc : cimage\n");
       return(-660);
    }
 
    mimage = (unsigned char *)malloc(mw*mh);
    if(mimage == (unsigned char *)NULL){
-      fprintf(stderr, "ERROR : morph_TF_map : malloc : mimage\n");
+      print2err("ERROR : morph_TF_map : malloc : mimage\n");
       return(-661);
    }
 
@@ -714,7 +714,7 @@ int pixelize_map(int **omap, const int iw, const int ih,
 
    pmap = (int *)malloc(iw*ih*sizeof(int));
    if(pmap == (int *)NULL){
-      fprintf(stderr, "ERROR : pixelize_map : malloc : pmap\n");
+      print2err("ERROR : pixelize_map : malloc : pmap\n");
       return(-590);
    }
 
@@ -724,7 +724,7 @@ int pixelize_map(int **omap, const int iw, const int ih,
 
    if((bw != mw) || (bh != mh)){
       free(blkoffs);
-      fprintf(stderr,
+      print2err(
          "ERROR : pixelize_map : block dimensions do not match\n");
       return(-591);
    }
@@ -874,7 +874,7 @@ int gen_high_curve_map(int **ohcmap, int *direction_map,
    /* Allocate High Curvature Map. */
    high_curve_map = (int *)malloc(mapsize * sizeof(int));
    if(high_curve_map == (int *)NULL){
-      fprintf(stderr,
+      print2err(
               "ERROR: gen_high_curve_map : malloc : high_curve_map\n");
       return(-530);
    }
@@ -979,7 +979,7 @@ int gen_initial_imap(int **optr, int *blkoffs, const int mw, const int mh,
    /* Allocate IMAP memory */
    imap = (int *)malloc(bsize * sizeof(int));
    if(imap == (int *)NULL){
-      fprintf(stderr, "ERROR : gen_initial_imap : malloc : imap\n");
+      print2err("ERROR : gen_initial_imap : malloc : imap\n");
       return(-70);
    }
 
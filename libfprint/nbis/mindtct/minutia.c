@@ -48,14 +48,15 @@ identified are necessarily the best available for the purpose.
                         dump_reliable_minutiae_pts()
                         create_minutia()
                         free_minutiae()
-                        free_minutia()
                         remove_minutia()
+                        move_minutia()
                         join_minutia()
                         minutia_type()
                         is_minutia_appearing()
                         choose_scan_direction()
                         scan4minutiae()
                         scan4minutiae_horizontally()
+                        scan4minutiae_V2()
                         scan4minutiae_horizontally_V2()
                         scan4minutiae_vertically()
                         scan4minutiae_vertically_V2()
@@ -79,9 +80,95 @@ identified are necessarily the best available for the purpose.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <lfs.h>
+#include <log.h>
 
+/* Number of integer attribute arrays in a minutiae list. */
+#define NUM_INT_ATTRS 10
 
+/*************************************************************************
+**************************************************************************
+#cat: int_attrs - Collects the addresses of the integer attribute arrays
+#cat:            of a minutiae list, so that they may be allocated and
+#cat:            rearranged together.
+
+   Input:
+      minutiae - list of minutiae
+   Output:
+      attrs    - addresses of the NUM_INT_ATTRS attribute arrays
+**************************************************************************/
+static void int_attrs(int **attrs[], MINUTIAE *minutiae)
+{
+   attrs[0] = &(minutiae->x);
+   attrs[1] = &(minutiae->y);
+   attrs[2] = &(minutiae->ex);
+   attrs[3] = &(minutiae->ey);
+   attrs[4] = &(minutiae->direction);
+   attrs[5] = &(minutiae->type);
+   attrs[6] = &(minutiae->appearing);
+   attrs[7] = &(minutiae->feature_id);
+   attrs[8] = &(minutiae->num_nbrs);
+   attrs[9] = &(minutiae->nbrs_first);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: permute_minutiae - Rearranges the attribute arrays of a minutiae list
+#cat:            into the specified order.
+
+   Input:
+      minutiae - list of minutiae
+      order    - for each new position, the old position of its minutia
+      tmp      - scratch space for minutiae->num doubles
+   Output:
+      minutiae - list of rearranged minutiae
+**************************************************************************/
+static void permute_minutiae(MINUTIAE *minutiae, const int *order,
+                             double *tmp)
+{
+   int **attrs[NUM_INT_ATTRS];
+   int *itmp = (int *)tmp;
+   int i, j;
+
+   int_attrs(attrs, minutiae);
+   for(j = 0; j < NUM_INT_ATTRS; j++){
+      for(i = 0; i < minutiae->num; i++)
+         itmp[i] = (*attrs[j])[order[i]];
+      memcpy(*attrs[j], itmp, minutiae->num * sizeof(int));
+   }
+   for(i = 0; i < minutiae->num; i++)
+      tmp[i] = minutiae->reliability[order[i]];
+   memcpy(minutiae->reliability, tmp, minutiae->num * sizeof(double));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: append_minutia - Adds a minutia point to the end of a minutiae list
+#cat:            which has room for it.
+
+   Input:
+      minutia  - minutia structure for detected point
+   Output:
+      minutiae - list with the minutia added
+**************************************************************************/
+static void append_minutia(MINUTIAE *minutiae, const MINUTIA *minutia)
+{
+   int i = minutiae->num;
+
+   minutiae->x[i] = minutia->x;
+   minutiae->y[i] = minutia->y;
+   minutiae->ex[i] = minutia->ex;
+   minutiae->ey[i] = minutia->ey;
+   minutiae->direction[i] = minutia->direction;
+   minutiae->reliability[i] = minutia->reliability;
+   minutiae->type[i] = minutia->type;
+   minutiae->appearing[i] = minutia->appearing;
+   minutiae->feature_id[i] = minutia->feature_id;
+   minutiae->num_nbrs[i] = 0;
+   minutiae->nbrs_first[i] = 0;
+   (minutiae->num)++;
+}
 
 /*************************************************************************
 **************************************************************************
@@ -99,15 +186,25 @@ identified are necessarily the best available for the purpose.
 int alloc_minutiae(MINUTIAE **ominutiae, const int max_minutiae)
 {
    MINUTIAE *minutiae;
+   int **attrs[NUM_INT_ATTRS];
+   int i;
 
-   minutiae = (MINUTIAE *)malloc(sizeof(MINUTIAE));
+   minutiae = (MINUTIAE *)calloc(1, sizeof(MINUTIAE));
    if(minutiae == (MINUTIAE *)NULL){
-      fprintf(stderr, "ERROR : alloc_minutiae : malloc : minutiae\n");
+      print2err("ERROR : alloc_minutiae : calloc : minutiae\n");
       exit(-430);
    }
-   minutiae->list = (MINUTIA **)malloc(max_minutiae * sizeof(MINUTIA *));
-   if(minutiae->list == (MINUTIA **)NULL){
-      fprintf(stderr, "ERROR : alloc_minutiae : malloc : minutiae->list\n");
+   int_attrs(attrs, minutiae);
+   for(i = 0; i < NUM_INT_ATTRS; i++){
+      *attrs[i] = (int *)malloc(max_minutiae * sizeof(int));
+      if(*attrs[i] == (int *)NULL){
+         print2err("ERROR : alloc_minutiae : malloc : attribute\n");
+         exit(-431);
+      }
+   }
+   minutiae->reliability = (double *)malloc(max_minutiae * sizeof(double));
+   if(minutiae->reliability == (double *)NULL){
+      print2err("ERROR : alloc_minutiae : malloc : reliability\n");
       exit(-431);
    }
 
@@ -135,11 +232,22 @@ int alloc_minutiae(MINUTIAE **ominutiae, const int max_minutiae)
 **************************************************************************/
 int realloc_minutiae(MINUTIAE *minutiae, const int incr_minutiae)
 {
+   int **attrs[NUM_INT_ATTRS];
+   int i;
+
    minutiae->alloc += incr_minutiae;
-   minutiae->list = (MINUTIA **)realloc(minutiae->list,
-                                     minutiae->alloc * sizeof(MINUTIA *));
-   if(minutiae->list == (MINUTIA **)NULL){
-      fprintf(stderr, "ERROR : realloc_minutiae : realloc : minutiae->list\n");
+   int_attrs(attrs, minutiae);
+   for(i = 0; i < NUM_INT_ATTRS; i++){
+      *attrs[i] = (int *)realloc(*attrs[i], minutiae->alloc * sizeof(int));
+      if(*attrs[i] == (int *)NULL){
+         print2err("ERROR : realloc_minutiae : realloc : attribute\n");
+         exit(-432);
+      }
+   }
+   minutiae->reliability = (double *)realloc(minutiae->reliability,
+                                        minutiae->alloc * sizeof(double));
+   if(minutiae->reliability == (double *)NULL){
+      print2err("ERROR : realloc_minutiae : realloc : reliability\n");
       exit(-432);
    }
 
@@ -241,7 +349,7 @@ int detect_minutiae_V2(MINUTIAE *minutiae,
       IGNORE    - minutia is to be ignored (already in the minutiae list)
       Negative  - system error
 **************************************************************************/
-int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
+int update_minutiae(MINUTIAE *minutiae, const MINUTIA *minutia,
                    unsigned char *bdata, const int iw, const int ih,
                    const LFSPARMS *lfsparms)
 {
@@ -270,18 +378,18 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
       for(i = 0; i < minutiae->num; i++){
          /* If x distance between new minutia and current list minutia */
          /* are sufficiently close...                                 */
-         dx = abs(minutiae->list[i]->x - minutia->x);
+         dx = abs(minutiae->x[i] - minutia->x);
          if(dx < lfsparms->max_minutia_delta){
             /* If y distance between new minutia and current list minutia */
             /* are sufficiently close...                                 */
-            dy = abs(minutiae->list[i]->y - minutia->y);
+            dy = abs(minutiae->y[i] - minutia->y);
             if(dy < lfsparms->max_minutia_delta){
                /* If new minutia and current list minutia are same type... */
-               if(minutiae->list[i]->type == minutia->type){
+               if(minutiae->type[i] == minutia->type){
                   /* Test to see if minutiae have similar directions. */
                   /* Take minimum of computed inner and outer        */
                   /* direction differences.                          */
-                  delta_dir = abs(minutiae->list[i]->direction -
+                  delta_dir = abs(minutiae->direction[i] -
                                   minutia->direction);
                   delta_dir = min(delta_dir, full_ndirs-delta_dir);
                   /* If directional difference is <= 45 degrees... */
@@ -299,8 +407,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...        */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               minutiae->x[i], minutiae->y[i],
+                               minutiae->ex[i], minutiae->ey[i],
                                SCAN_CLOCKWISE, bdata, iw, ih)){
                         /* Consider the new minutia to be the same as the */
                         /* current list minutia, so don't add the new one */
@@ -312,8 +420,8 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...       */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               minutiae->x[i], minutiae->y[i],
+                               minutiae->ex[i], minutiae->ey[i],
                                SCAN_COUNTER_CLOCKWISE, bdata, iw, ih)){
                         /* Consider the new minutia to be the same as the */
                         /* current list minutia, so don't add the new one */
@@ -334,8 +442,7 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
    } /* Otherwise, minutiae list is empty. */
 
    /* Otherwise, assume new minutia is not in the list, so add it. */
-   minutiae->list[minutiae->num] = minutia;
-   (minutiae->num)++;
+   append_minutia(minutiae, minutia);
 
    /* New minutia was successfully added to the list. */
    /* Return normally. */
@@ -364,7 +471,7 @@ int update_minutiae(MINUTIAE *minutiae, MINUTIA *minutia,
       IGNORE    - minutia is to be ignored (already in the minutiae list)
       Negative  - system error
 **************************************************************************/
-int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
+int update_minutiae_V2(MINUTIAE *minutiae, const MINUTIA *minutia,
                    const int scan_dir, const int dmapval,
                    unsigned char *bdata, const int iw, const int ih,
                    const LFSPARMS *lfsparms)
@@ -395,18 +502,18 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
       for(i = minutiae->num-1; i >= 0; i--){
          /* If x distance between new minutia and current list minutia */
          /* are sufficiently close...                                 */
-         dx = abs(minutiae->list[i]->x - minutia->x);
+         dx = abs(minutiae->x[i] - minutia->x);
          if(dx < lfsparms->max_minutia_delta){
             /* If y distance between new minutia and current list minutia */
             /* are sufficiently close...                                 */
-            dy = abs(minutiae->list[i]->y - minutia->y);
+            dy = abs(minutiae->y[i] - minutia->y);
             if(dy < lfsparms->max_minutia_delta){
                /* If new minutia and current list minutia are same type... */
-               if(minutiae->list[i]->type == minutia->type){
+               if(minutiae->type[i] == minutia->type){
                   /* Test to see if minutiae have similar directions. */
                   /* Take minimum of computed inner and outer        */
                   /* direction differences.                          */
-                  delta_dir = abs(minutiae->list[i]->direction -
+                  delta_dir = abs(minutiae->direction[i] -
                                   minutia->direction);
                   delta_dir = min(delta_dir, full_ndirs-delta_dir);
                   /* If directional difference is <= 45 degrees... */
@@ -424,13 +531,13 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
                      /* If new minutia point found on contour...        */
                      if(search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               minutiae->x[i], minutiae->y[i],
+                               minutiae->ex[i], minutiae->ey[i],
                                SCAN_CLOCKWISE, bdata, iw, ih) ||
                         search_contour(minutia->x, minutia->y,
                                lfsparms->max_minutia_delta,
-                               minutiae->list[i]->x, minutiae->list[i]->y,
-                               minutiae->list[i]->ex, minutiae->list[i]->ey,
+                               minutiae->x[i], minutiae->y[i],
+                               minutiae->ex[i], minutiae->ey[i],
                                SCAN_COUNTER_CLOCKWISE, bdata, iw, ih)){
                         /* If new minutia has VALID block direction ... */
                         if(dmapval >= 0){
@@ -478,8 +585,7 @@ int update_minutiae_V2(MINUTIAE *minutiae, MINUTIA *minutia,
 
    /* Otherwise, assume new minutia is not in the list, or those that */
    /* were close neighbors were selectively removed, so add it.       */
-   minutiae->list[minutiae->num] = minutia;
-   (minutiae->num)++;
+   append_minutia(minutiae, minutia);
 
    /* New minutia was successfully added to the list. */
    /* Return normally. */
@@ -505,19 +611,19 @@ int sort_minutiae_y_x(MINUTIAE *minutiae, const int iw, const int ih)
 {
    int *ranks, *order;
    int i, ret;
-   MINUTIA **newlist;
+   double *tmp;
 
    /* Allocate a list of integers to hold 1-D image pixel offsets */
    /* for each of the 2-D minutia coordinate points.               */
    ranks = (int *)malloc(minutiae->num * sizeof(int));
    if(ranks == (int *)NULL){
-      fprintf(stderr, "ERROR : sort_minutiae_y_x : malloc : ranks\n");
+      print2err("ERROR : sort_minutiae_y_x : malloc : ranks\n");
       return(-310);
    }
 
    /* Compute 1-D image pixel offsets form 2-D minutia coordinate points. */
    for(i = 0; i < minutiae->num; i++)
-      ranks[i] = (minutiae->list[i]->y * iw) + minutiae->list[i]->x;
+      ranks[i] = (minutiae->y[i] * iw) + minutiae->x[i];
 
    /* Get sorted order of minutiae. */
    if((ret = sort_indices_int_inc(&order, ranks, minutiae->num))){
@@ -525,25 +631,20 @@ int sort_minutiae_y_x(MINUTIAE *minutiae, const int iw, const int ih)
       return(ret);
    }
 
-   /* Allocate new MINUTIA list to hold sorted minutiae. */
-   newlist = (MINUTIA **)malloc(minutiae->num * sizeof(MINUTIA *));
-   if(newlist == (MINUTIA **)NULL){
+   /* Allocate scratch space to rearrange the attributes through. */
+   tmp = (double *)malloc(minutiae->num * sizeof(double));
+   if(tmp == (double *)NULL){
       free(ranks);
       free(order);
-      fprintf(stderr, "ERROR : sort_minutiae_y_x : malloc : newlist\n");
+      print2err("ERROR : sort_minutiae_y_x : malloc : tmp\n");
       return(-311);
    }
 
-   /* Put minutia into sorted order in new list. */
-   for(i = 0; i < minutiae->num; i++)
-      newlist[i] = minutiae->list[order[i]];
-
-   /* Deallocate non-sorted list of minutia pointers. */
-   free(minutiae->list);
-   /* Assign new sorted list of minutia to minutiae list. */
-   minutiae->list = newlist;
+   /* Put minutiae into sorted order. */
+   permute_minutiae(minutiae, order, tmp);
 
    /* Free the working memories supporting the sort. */
+   free(tmp);
    free(order);
    free(ranks);
 
@@ -570,19 +671,19 @@ int sort_minutiae_x_y(MINUTIAE *minutiae, const int iw, const int ih)
 {
    int *ranks, *order;
    int i, ret;
-   MINUTIA **newlist;
+   double *tmp;
 
    /* Allocate a list of integers to hold 1-D image pixel offsets */
    /* for each of the 2-D minutia coordinate points.               */
    ranks = (int *)malloc(minutiae->num * sizeof(int));
    if(ranks == (int *)NULL){
-      fprintf(stderr, "ERROR : sort_minutiae_x_y : malloc : ranks\n");
+      print2err("ERROR : sort_minutiae_x_y : malloc : ranks\n");
       return(-440);
    }
 
    /* Compute 1-D image pixel offsets form 2-D minutia coordinate points. */
    for(i = 0; i < minutiae->num; i++)
-      ranks[i] = (minutiae->list[i]->x * iw) + minutiae->list[i]->y;
+      ranks[i] = (minutiae->x[i] * iw) + minutiae->y[i];
 
    /* Get sorted order of minutiae. */
    if((ret = sort_indices_int_inc(&order, ranks, minutiae->num))){
@@ -590,25 +691,20 @@ int sort_minutiae_x_y(MINUTIAE *minutiae, const int iw, const int ih)
       return(ret);
    }
 
-   /* Allocate new MINUTIA list to hold sorted minutiae. */
-   newlist = (MINUTIA **)malloc(minutiae->num * sizeof(MINUTIA *));
-   if(newlist == (MINUTIA **)NULL){
+   /* Allocate scratch space to rearrange the attributes through. */
+   tmp = (double *)malloc(minutiae->num * sizeof(double));
+   if(tmp == (double *)NULL){
       free(ranks);
       free(order);
-      fprintf(stderr, "ERROR : sort_minutiae_x_y : malloc : newlist\n");
+      print2err("ERROR : sort_minutiae_x_y : malloc : tmp\n");
       return(-441);
    }
 
-   /* Put minutia into sorted order in new list. */
-   for(i = 0; i < minutiae->num; i++)
-      newlist[i] = minutiae->list[order[i]];
-
-   /* Deallocate non-sorted list of minutia pointers. */
-   free(minutiae->list);
-   /* Assign new sorted list of minutia to minutiae list. */
-   minutiae->list = newlist;
+   /* Put minutiae into sorted order. */
+   permute_minutiae(minutiae, order, tmp);
 
    /* Free the working memories supporting the sort. */
+   free(tmp);
    free(order);
    free(ranks);
 
@@ -634,17 +730,14 @@ int sort_minutiae_x_y(MINUTIAE *minutiae, const int iw, const int ih)
 int rm_dup_minutiae(MINUTIAE *minutiae)
 {
    int i, ret;
-   MINUTIA *minutia1, *minutia2;
 
    /* Work backward from the end of the list of minutiae.  This way */
    /* we can selectively remove minutia from the list and not cause */
    /* problems with keeping track of current indices.               */
    for(i = minutiae->num-1; i > 0; i--){
-      minutia1 = minutiae->list[i];
-      minutia2 = minutiae->list[i-1];
       /* If minutia pair has identical coordinates ... */
-      if((minutia1->x == minutia2->x) &&
-         (minutia1->y == minutia2->y)){
+      if((minutiae->x[i] == minutiae->x[i-1]) &&
+         (minutiae->y[i] == minutiae->y[i-1])){
          /* Remove the 2nd minutia from the minutiae list. */
          if((ret = remove_minutia(i-1, minutiae)))
             return(ret);
@@ -668,7 +761,7 @@ int rm_dup_minutiae(MINUTIAE *minutiae)
 **************************************************************************/
 void dump_minutiae(FILE *fpout, const MINUTIAE *minutiae)
 {
-   int i, j;
+   int i, j, k;
 
    fprintf(fpout, "\n%d Minutiae Detected\n\n", minutiae->num);
 
@@ -676,25 +769,26 @@ void dump_minutiae(FILE *fpout, const MINUTIAE *minutiae)
       /* Precision of reliablity added one decimal position */
       /* on 09-13-04 */
       fprintf(fpout, "%4d : %4d, %4d : %2d : %6.3f :", i,
-             minutiae->list[i]->x, minutiae->list[i]->y,
-             minutiae->list[i]->direction, minutiae->list[i]->reliability);
-      if(minutiae->list[i]->type == RIDGE_ENDING)
+             minutiae->x[i], minutiae->y[i],
+             minutiae->direction[i], minutiae->reliability[i]);
+      if(minutiae->type[i] == RIDGE_ENDING)
          fprintf(fpout, "RIG : ");
       else
          fprintf(fpout, "BIF : ");
    
-      if(minutiae->list[i]->appearing)
+      if(minutiae->appearing[i])
          fprintf(fpout, "APP : ");
       else
          fprintf(fpout, "DIS : ");
 
-      fprintf(fpout, "%2d ", minutiae->list[i]->feature_id);
+      fprintf(fpout, "%2d ", minutiae->feature_id[i]);
 
-      for(j = 0; j < minutiae->list[i]->num_nbrs; j++){
+      for(j = 0; j < minutiae->num_nbrs[i]; j++){
+         k = minutiae->nbrs_first[i] + j;
          fprintf(fpout, ": %4d,%4d; %2d ",
-                 minutiae->list[minutiae->list[i]->nbrs[j]]->x,
-                 minutiae->list[minutiae->list[i]->nbrs[j]]->y,
-                 minutiae->list[i]->ridge_counts[j]);
+                 minutiae->x[minutiae->nbrs[k]],
+                 minutiae->y[minutiae->nbrs[k]],
+                 minutiae->ridge_counts[k]);
       }
 
       fprintf(fpout, "\n");
@@ -723,7 +817,7 @@ void dump_minutiae_pts(FILE *fpout, const MINUTIAE *minutiae)
    /* Foreach minutia in list... */
    for(i = 0; i < minutiae->num; i++){
       /* Write the minutia's coordinate point to the file pointer. */
-      fprintf(fpout, "%4d %4d\n", minutiae->list[i]->x, minutiae->list[i]->y);
+      fprintf(fpout, "%4d %4d\n", minutiae->x[i], minutiae->y[i]);
    }
 }
 
@@ -751,7 +845,7 @@ void dump_reliable_minutiae_pts(FILE *fpout, const MINUTIAE *minutiae,
    count = 0;
    /* Foreach minutia in list... */
    for(i = 0; i < minutiae->num; i++){
-      if(minutiae->list[i]->reliability == reliability)
+      if(minutiae->reliability[i] == reliability)
          count++;
    }
 
@@ -761,17 +855,17 @@ void dump_reliable_minutiae_pts(FILE *fpout, const MINUTIAE *minutiae,
 
    /* Foreach minutia in list... */
    for(i = 0; i < minutiae->num; i++){
-      if(minutiae->list[i]->reliability == reliability)
+      if(minutiae->reliability[i] == reliability)
          /* Write the minutia's coordinate point to the file pointer. */
          fprintf(fpout, "%4d %4d\n",
-                 minutiae->list[i]->x, minutiae->list[i]->y);
+                 minutiae->x[i], minutiae->y[i]);
    }
 }
 
 /*************************************************************************
 **************************************************************************
 #cat: create_minutia - Takes attributes associated with a detected minutia
-#cat:            point and allocates and initializes a minutia structure.
+#cat:            point and initializes a minutia structure with them.
 
    Input:
       x_loc   - x-pixel coord of minutia (interior to feature)
@@ -784,26 +878,13 @@ void dump_reliable_minutiae_pts(FILE *fpout, const MINUTIAE *minutiae,
       appearing  - designates the minutia as appearing or disappearing
       feature_id - index of minutia's matching feature_patterns[]
    Output:
-      ominutia - ponter to an allocated and initialized minutia structure
-   Return Code:
-      Zero       - minutia structure successfully allocated and initialized
-      Negative   - system error
+      minutia - initialized minutia structure
 *************************************************************************/
-int create_minutia(MINUTIA **ominutia, const int x_loc, const int y_loc,
+void create_minutia(MINUTIA *minutia, const int x_loc, const int y_loc,
                    const int x_edge, const int y_edge, const int idir,
                    const double reliability,
                    const int type, const int appearing, const int feature_id)
 {
-   MINUTIA *minutia;
-
-   /* Allocate a minutia structure. */
-   minutia = (MINUTIA *)malloc(sizeof(MINUTIA));
-   /* If allocation error... */
-   if(minutia == (MINUTIA *)NULL){
-      fprintf(stderr, "ERROR : create_minutia : malloc : minutia\n");
-      return(-230);
-   }
-
    /* Assign minutia structure attributes. */
    minutia->x = x_loc;
    minutia->y = y_loc;
@@ -817,11 +898,6 @@ int create_minutia(MINUTIA **ominutia, const int x_loc, const int y_loc,
    minutia->nbrs = (int *)NULL;
    minutia->ridge_counts = (int *)NULL;
    minutia->num_nbrs = 0;
-
-   /* Set minutia object to output pointer. */
-   *ominutia = minutia;
-   /* Return normally. */
-   return(0);
 }
 
 /*************************************************************************
@@ -834,38 +910,24 @@ int create_minutia(MINUTIA **ominutia, const int x_loc, const int y_loc,
 *************************************************************************/
 void free_minutiae(MINUTIAE *minutiae)
 {
+   int **attrs[NUM_INT_ATTRS];
    int i;
 
-   /* Deallocate minutia structures in the list. */
-   for(i = 0; i < minutiae->num; i++)
-      free_minutia(minutiae->list[i]);
-   /* Deallocate list of minutia pointers. */
-   free(minutiae->list);
+   /* Deallocate attribute arrays. */
+   int_attrs(attrs, minutiae);
+   for(i = 0; i < NUM_INT_ATTRS; i++)
+      free(*attrs[i]);
+   free(minutiae->reliability);
+   /* Deallocate neighbor lists. */
+   if(minutiae->nbrs != (int *)NULL)
+      free(minutiae->nbrs);
+   if(minutiae->ridge_counts != (int *)NULL)
+      free(minutiae->ridge_counts);
 
    /* Deallocate the list structure. */
    free(minutiae);
 }
 
-/*************************************************************************
-**************************************************************************
-#cat: free_minutia - Takes a minutia pointer and deallocates all memory
-#cat:            associated with it.
-
-   Input:
-      minutia - pointer to allocated minutia structure
-*************************************************************************/
-void free_minutia(MINUTIA *minutia)
-{
-   /* Deallocate sublists. */
-   if(minutia->nbrs != (int *)NULL)
-      free(minutia->nbrs);
-   if(minutia->ridge_counts != (int *)NULL)
-      free(minutia->ridge_counts);
-
-   /* Deallocate the minutia structure. */
-   free(minutia);
-}
-
 /*************************************************************************
 **************************************************************************
 #cat: remove_minutia - Removes the specified minutia point from the input
@@ -882,21 +944,23 @@ void free_minutia(MINUTIA *minutia)
 **************************************************************************/
 int remove_minutia(const int index, MINUTIAE *minutiae)
 {
-   int fr, to;
+   int **attrs[NUM_INT_ATTRS];
+   int i, n;
 
    /* Make sure the requested index is within range. */
    if((index < 0) && (index >= minutiae->num)){
-      fprintf(stderr, "ERROR : remove_minutia : index out of range\n");
+      print2err("ERROR : remove_minutia : index out of range\n");
       return(-380);
    }
 
-   /* Deallocate the minutia structure to be removed. */
-   free_minutia(minutiae->list[index]);
-
    /* Slide the remaining list of minutiae up over top of the */
    /* position of the minutia being removed.                 */
-   for(to = index, fr = index+1; fr < minutiae->num; to++, fr++)
-      minutiae->list[to] = minutiae->list[fr];
+   n = minutiae->num - index - 1;
+   int_attrs(attrs, minutiae);
+   for(i = 0; i < NUM_INT_ATTRS; i++)
+      memmove(*attrs[i] + index, *attrs[i] + index + 1, n * sizeof(int));
+   memmove(minutiae->reliability + index, minutiae->reliability + index + 1,
+           n * sizeof(double));
 
    /* Decrement the number of minutiae remaining in the list. */
    minutiae->num--;
@@ -905,6 +969,29 @@ int remove_minutia(const int index, MINUTIAE *minutiae)
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: move_minutia - Copies the attributes of one minutia in a list over
+#cat:                those of another.
+
+   Input:
+      to         - position of minutia to be overwritten
+      fr         - position of minutia to be copied
+      minutiae   - input list of minutiae
+   Output:
+      minutiae   - list with minutia at position to replaced
+**************************************************************************/
+void move_minutia(MINUTIAE *minutiae, const int to, const int fr)
+{
+   int **attrs[NUM_INT_ATTRS];
+   int i;
+
+   int_attrs(attrs, minutiae);
+   for(i = 0; i < NUM_INT_ATTRS; i++)
+      (*attrs[i])[to] = (*attrs[i])[fr];
+   minutiae->reliability[to] = minutiae->reliability[fr];
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: join_minutia - Takes 2 minutia points and connectes their features in
@@ -914,8 +1001,9 @@ int remove_minutia(const int index, MINUTIAE *minutiae)
 #cat:                from the interior line.
 
    Input:
-      minutia1      - first minutia point to be joined
-      minutia2      - second minutia point to be joined
+      minutiae      - list of minutiae
+      m1            - index of first minutia point to be joined
+      m2            - index of second minutia point to be joined
       bdata         - binary image data (0==while & 1==black)
       iw            - width (in pixels) of image
       ih            - height (in pixels) of image
@@ -927,7 +1015,7 @@ int remove_minutia(const int index, MINUTIAE *minutiae)
       Zero      - successful completion
       Negative  - system error
 **************************************************************************/
-int join_minutia(const MINUTIA *minutia1, const MINUTIA *minutia2,
+int join_minutia(const MINUTIAE *minutiae, const int m1, const int m2,
                  unsigned char *bdata, const int iw, const int ih,
                  const int with_boundary, const int line_radius)
 {
@@ -938,8 +1026,8 @@ int join_minutia(const MINUTIA *minutia1, const MINUTIA *minutia2,
    int x1, y1, x2, y2;
 
    /* Compute X and Y deltas between minutia points. */
-   delta_x = abs(minutia1->x - minutia2->x);
-   delta_y = abs(minutia1->y - minutia2->y);
+   delta_x = abs(minutiae->x[m1] - minutiae->x[m2]);
+   delta_y = abs(minutiae->y[m1] - minutiae->y[m2]);
 
    /* Set flag based on |DX| >= |DY|. */
    /* If flag is true then add additional pixel width to the join line  */
@@ -953,12 +1041,13 @@ int join_minutia(const MINUTIA *minutia1, const MINUTIA *minutia2,
 
    /* Compute points along line segment between the two minutia points. */
    if((ret = line_points(&x_list, &y_list, &num,
-                      minutia1->x, minutia1->y, minutia2->x, minutia2->y)))
+                      minutiae->x[m1], minutiae->y[m1],
+                      minutiae->x[m2], minutiae->y[m2])))
       /* If error with line routine, return error code. */
       return(ret);
 
    /* Determine pixel color of minutia and boundary. */
-   if(minutia1->type == RIDGE_ENDING){
+   if(minutiae->type[m1] == RIDGE_ENDING){
       /* To connect 2 ridge-endings, draw black. */
       minutia_pix = 1;
       boundary_pix = 0;
@@ -1111,7 +1200,7 @@ int is_minutia_appearing(const int x_loc, const int y_loc,
       return(DISAPPEARING);
 
    /* Should never get here, but just in case. */
-   fprintf(stderr,
+   print2err(
            "ERROR : is_minutia_appearing : bad configuration of pixels\n");
    return(-240);
 }
@@ -1375,126 +1464,599 @@ int scan4minutiae_horizontally(MINUTIAE *minutiae,
 
 /*************************************************************************
 **************************************************************************
-#cat: scan4minutiae_horizontally_V2 - Scans an entire binary image
-#cat:                horizontally, detecting potential minutiae points.
-#cat:                Minutia detected via the horizontal scan process are
-#cat:                by nature vertically oriented (orthogonal to the scan).
+   Band scanning.  The horizontal and vertical scans are split into
+   bands of scan lines (rows or columns).  Each band is searched for
+   feature patterns in its own thread, collecting the features it finds,
+   and the features are then processed in the order a single scan would
+   have found them.  Processing a feature in a HIGH CURVATURE block can
+   fill a loop in the binary image, which changes what the rest of the
+   scan finds.  If that happens, the features collected from there on are
+   dropped and the rest of the image is scanned as before.
+
+   The scan lines are also kept packed 64 pixels to a word.  No feature
+   pattern has the same first and second pixel pair, so a scan can only
+   find a feature where the pixel pair changes from one position to the
+   next.  The packed lines are used to skip straight to such positions.
+**************************************************************************/
+
+/* Minimum number of scan lines per band. */
+#define SCAN_MIN_BAND_LINES   128
+
+typedef struct scan_hit{
+   int line;          /* Scan line the feature was found on.      */
+   int pos;           /* Position of its 3rd pixel pair on it.    */
+   int pos2;          /* Position of its 2nd pixel pair on it.    */
+   int feature_id;
+} SCAN_HIT;
+
+typedef struct scan_band{
+   int scan_dir;
+   unsigned char *bdata;
+   int iw, ih;
+   int *pdirection_map, *plow_flow_map, *phigh_curve_map;
+   const LFSPARMS *lfsparms;
+   /* Scan lines of the image, nwords words per line, bit i of word */
+   /* i/64 holding the pixel at position i.                         */
+   uint64_t *bits;
+   int nwords;
+   /* List to process features into as they are found, or NULL to */
+   /* collect them in the band's hits.                            */
+   MINUTIAE *minutiae;
+   int sline, eline;  /* Scan lines of the band. */
+   int spos;          /* Position in the first line to start at. */
+   SCAN_HIT *hits;
+   int nhits, alloc;
+   /* Copy of the image around the feature being processed. */
+   unsigned char *win;
+   int radius;
+   int changed;       /* Image changed by the last feature processed. */
+   int ret;
+} SCAN_BAND;
+
+/*************************************************************************
+**************************************************************************
+#cat: pack_scan_lines - Packs a range of scan lines of the binary image
+#cat:                into the packed scan lines of a band.
 
    Input:
-      bdata     - binary image data (0==while & 1==black)
-      iw        - width (in pixels) of image
-      ih        - height (in pixels) of image
-      pdirection_map  - pixelized Direction Map
-      plow_flow_map   - pixelized Low Ridge Flow Map
-      phigh_curve_map - pixelized High Curvature Map
-      lfsparms  - parameters and thresholds for controlling LFS
+      band      - band with the packed scan lines of the image
+      sline     - first scan line to pack
+      eline     - scan line after the last one to pack
    Output:
-      minutiae   - points to a list of detected minutia structures
+      band      - band with the scan lines packed
+**************************************************************************/
+static void pack_scan_lines(SCAN_BAND *band, const int sline, const int eline)
+{
+   uint64_t *wptr;
+   unsigned char *pptr;
+   int line, pos, len, step;
+
+   if(band->scan_dir == SCAN_HORIZONTAL){
+      len = band->iw;
+      step = 1;
+   }
+   else{
+      len = band->ih;
+      step = band->iw;
+   }
+
+   for(line = sline; line < eline; line++){
+      wptr = band->bits + (line * band->nwords);
+      memset(wptr, 0, band->nwords * sizeof(uint64_t));
+      if(band->scan_dir == SCAN_HORIZONTAL)
+         pptr = band->bdata+(line*band->iw);
+      else
+         pptr = band->bdata+line;
+      for(pos = 0; pos < len; pos++, pptr += step)
+         if(*pptr)
+            wptr[pos>>6] |= ((uint64_t)1) << (pos & 63);
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: next_scan_change - Finds the first position on a scan line, from a
+#cat:                given one on, where the pixel pair differs from the
+#cat:                one at the next position.
+
+   Input:
+      band      - band with the packed scan lines of the image
+      line      - scan line, scanned together with the next one
+      pos       - position to start looking from
+      len       - length of the scan line
+   Return Code:
+      position of the change, or len if there is none
+**************************************************************************/
+static int next_scan_change(SCAN_BAND *band, const int line, const int pos,
+                const int len)
+{
+   uint64_t *w1 = band->bits + (line * band->nwords);
+   uint64_t *w2 = w1 + band->nwords;
+   uint64_t d1, d2, diff;
+   int i, found;
+
+   for(i = pos>>6; i < band->nwords; i++){
+      /* Bit n set where pixel n differs from pixel n+1. */
+      d1 = w1[i] >> 1;
+      d2 = w2[i] >> 1;
+      if(i+1 < band->nwords){
+         d1 |= w1[i+1] << 63;
+         d2 |= w2[i+1] << 63;
+      }
+      diff = (d1 ^ w1[i]) | (d2 ^ w2[i]);
+      if(i == (pos>>6))
+         diff &= ~((uint64_t)0) << (pos & 63);
+      if(diff){
+#ifdef __GNUC__
+         found = (i<<6) + __builtin_ctzll(diff);
+#else
+         for(found = i<<6; !(diff & 1); found++)
+            diff >>= 1;
+#endif
+         /* Past the end, the last pixel differs from the padding. */
+         return(found < len-1 ? found : len);
+      }
+   }
+
+   return(len);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: save_scan_window - Copies the part of the binary image that a loop
+#cat:                found from a feature at the given point could lie in,
+#cat:                or compares the image with such a copy.
+
+   Input:
+      band      - band being scanned, with room for the copy in win
+      fx, fy    - center of the window
+      compare   - if TRUE, compare rather than copy
+   Return Code:
+      TRUE      - (compare only) the image differs from the copy
+      FALSE     - otherwise
+**************************************************************************/
+static int save_scan_window(SCAN_BAND *band, const int fx, const int fy,
+                const int compare)
+{
+   unsigned char *win = band->win;
+   int sx, ex, sy, ey, y;
+
+   sx = max(0, fx - band->radius);
+   ex = min(band->iw, fx + band->radius + 1);
+   sy = max(0, fy - band->radius);
+   ey = min(band->ih, fy + band->radius + 1);
+
+   for(y = sy; y < ey; y++){
+      if(compare){
+         if(memcmp(win, band->bdata+(y*band->iw)+sx, ex-sx))
+            return(TRUE);
+      }
+      else
+         memcpy(win, band->bdata+(y*band->iw)+sx, ex-sx);
+      win += ex-sx;
+   }
+
+   return(FALSE);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: scan_band_feature - Processes a feature found by scan_band_lines()
+#cat:                into the band's minutiae list, or adds it to the
+#cat:                band's features to be processed later.
+
+   Input:
+      band       - band being scanned
+      line       - scan line the feature was found on
+      pos        - position of the feature's 3rd pixel pair on the line
+      pos2       - position of the feature's 2nd pixel pair on the line
+      feature_id - index of the feature in g_feature_patterns[]
+   Output:
+      band       - band with changed set if processing the feature
+                   changed the binary image
    Return Code:
       Zero      - successful completion
       Negative  - system error
 **************************************************************************/
-int scan4minutiae_horizontally_V2(MINUTIAE *minutiae,
-                unsigned char *bdata, const int iw, const int ih,
-                int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
-                const LFSPARMS *lfsparms)
+static int scan_band_feature(SCAN_BAND *band, const int line, const int pos,
+                const int pos2, const int feature_id)
+{
+   int fx, fy, pair, saved, ret;
+
+   if(band->minutiae != (MINUTIAE *)NULL){
+      /* Pixel the feature's location is derived from. */
+      if(band->scan_dir == SCAN_HORIZONTAL){
+         fx = (pos + pos2)>>1;
+         fy = line;
+         pair = band->iw;
+      }
+      else{
+         fx = line;
+         fy = (pos + pos2)>>1;
+         pair = 1;
+      }
+
+      /* Only features in HIGH CURVATURE blocks can lead to fills. */
+      saved = band->phigh_curve_map[(fy*band->iw)+fx] ||
+              band->phigh_curve_map[(fy*band->iw)+fx+pair];
+      if(saved)
+         save_scan_window(band, fx, fy, FALSE);
+
+      if(band->scan_dir == SCAN_HORIZONTAL)
+         ret = process_horizontal_scan_minutia_V2(band->minutiae,
+                         pos, line, pos2, feature_id,
+                         band->bdata, band->iw, band->ih,
+                         band->pdirection_map, band->plow_flow_map,
+                         band->phigh_curve_map, band->lfsparms);
+      else
+         ret = process_vertical_scan_minutia_V2(band->minutiae,
+                         line, pos, pos2, feature_id,
+                         band->bdata, band->iw, band->ih,
+                         band->pdirection_map, band->plow_flow_map,
+                         band->phigh_curve_map, band->lfsparms);
+      /* Return code may be:                       */
+      /* 1.  ret< 0 (implying system error)        */
+      /* 2. ret==IGNORE (ignore current feature)   */
+      if(ret < 0)
+         return(ret);
+
+      band->changed = saved && save_scan_window(band, fx, fy, TRUE);
+      if(band->changed){
+         /* Bring the packed lines in the window up to date. */
+         if(band->scan_dir == SCAN_HORIZONTAL)
+            pack_scan_lines(band, max(0, fy - band->radius),
+                            min(band->ih, fy + band->radius + 1));
+         else
+            pack_scan_lines(band, max(0, fx - band->radius),
+                            min(band->iw, fx + band->radius + 1));
+      }
+      return(0);
+   }
+
+   if(band->nhits >= band->alloc){
+      band->alloc += MAX_MINUTIAE;
+      band->hits = (SCAN_HIT *)realloc(band->hits,
+                                       band->alloc * sizeof(SCAN_HIT));
+      if(band->hits == (SCAN_HIT *)NULL){
+         print2err("ERROR : scan_band_feature : realloc : hits\n");
+         return(-270);
+      }
+   }
+   band->hits[band->nhits].line = line;
+   band->hits[band->nhits].pos = pos;
+   band->hits[band->nhits].pos2 = pos2;
+   band->hits[band->nhits].feature_id = feature_id;
+   band->nhits++;
+
+   return(0);
+}
+/*************************************************************************
+**************************************************************************
+#cat: scan_band_lines - Scans the lines of a band for feature patterns,
+#cat:                in the scan direction of the band.
+
+   Input:
+      band      - band to be scanned
+   Output:
+      band      - band with its features processed or collected
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+static int scan_band_lines(SCAN_BAND *band)
 {
-   int sx, sy, ex, ey, cx, cy, x2;
    unsigned char *p1ptr, *p2ptr;
    int possible[NFEATURES], nposs;
+   int line, pos, pos2, len, pair, step;
    int ret;
 
-   /* Set scan region to entire image. */
-   sx = 0;
-   ex = iw;
-   sy = 0;
-   ey = ih;
+   /* Offsets from the first pixel of a pair to the second one and */
+   /* to the next pair along the scan line.                        */
+   if(band->scan_dir == SCAN_HORIZONTAL){
+      len = band->iw;
+      pair = band->iw;
+      step = 1;
+   }
+   else{
+      len = band->ih;
+      pair = 1;
+      step = band->iw;
+   }
 
-   /* Start at first row in region. */
-   cy = sy;
-   /* While second scan row not outside the bottom of the scan region... */
-   while(cy+1 < ey){
-      /* Start at beginning of new scan row in region. */
-      cx = sx;
-      /* While not at end of region's current scan row. */
-      while(cx < ex){
-         /* Get pixel pair from current x position in current and next */
-         /* scan rows. */
-         p1ptr = bdata+(cy*iw)+cx;
-         p2ptr = bdata+((cy+1)*iw)+cx;
+   pos = band->spos;
+   for(line = band->sline; line < band->eline; line++, pos = 0){
+      /* While not at end of current scan line. */
+      while(pos < len){
+         /* Skip to where the pixel pair changes. */
+         pos = next_scan_change(band, line, pos, len);
+         if(pos >= len)
+            break;
+         /* Get pixel pair from current position in current and next */
+         /* scan lines. */
+         if(band->scan_dir == SCAN_HORIZONTAL)
+            p1ptr = band->bdata+(line*band->iw)+pos;
+         else
+            p1ptr = band->bdata+(pos*band->iw)+line;
+         p2ptr = p1ptr+pair;
          /* If scan pixel pair matches first pixel pair of */
          /* 1 or more features... */
          if(match_1st_pair(*p1ptr, *p2ptr, possible, &nposs)){
             /* Bump forward to next scan pixel pair. */
-            cx++;
-            p1ptr++;
-            p2ptr++;
-            /* If not at end of region's current scan row... */
-            if(cx < ex){
+            pos++;
+            p1ptr += step;
+            p2ptr += step;
+            /* If not at end of current scan line... */
+            if(pos < len){
                /* If scan pixel pair matches second pixel pair of */
                /* 1 or more features... */
                if(match_2nd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                  /* Store current x location. */
-                  x2 = cx;
+                  /* Store current position. */
+                  pos2 = pos;
                   /* Skip repeated pixel pairs. */
-                  skip_repeated_horizontal_pair(&cx, ex, &p1ptr, &p2ptr,
-                                                    iw, ih);
-                  /* If not at end of region's current scan row... */
-                  if(cx < ex){
+                  if(band->scan_dir == SCAN_HORIZONTAL)
+                     skip_repeated_horizontal_pair(&pos, len, &p1ptr, &p2ptr,
+                                                   band->iw, band->ih);
+                  else
+                     skip_repeated_vertical_pair(&pos, len, &p1ptr, &p2ptr,
+                                                 band->iw, band->ih);
+                  /* If not at end of current scan line... */
+                  if(pos < len){
                      /* If scan pixel pair matches third pixel pair of */
                      /* a single feature... */
                      if(match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                        /* Process detected minutia point. */
-                        if((ret = process_horizontal_scan_minutia_V2(minutiae,
-                                         cx, cy, x2, possible[0],
-                                         bdata, iw, ih, pdirection_map,
-                                         plow_flow_map, phigh_curve_map,
-                                         lfsparms))){
-                           /* Return code may be:                       */
-                           /* 1.  ret< 0 (implying system error)        */
-                           /* 2. ret==IGNORE (ignore current feature)   */
-                           if(ret < 0)
-                              return(ret);
-                           /* Otherwise, IGNORE and continue. */
-                        }
+                        if((ret = scan_band_feature(band, line, pos, pos2,
+                                                    possible[0])))
+                           return(ret);
                      }
 
                      /* Set up to resume scan. */
-                     /* Test to see if 3rd pair can slide into 2nd pair. */
-                     /* The values of the 2nd pair MUST be different.    */
-                     /* If 3rd pair values are different ... */
-                     if(*p1ptr != *p2ptr){
-                        /* Set next first pair to last of repeated */
-                        /* 2nd pairs, ie. back up one pair.        */
-                        cx--;
-                     }
-
-                     /* Otherwise, 3rd pair can't be a 2nd pair, so  */
-                     /* keep pointing to 3rd pair so that it is used */
-                     /* in the next first pair test.                 */
-
-                  } /* Else, at end of current scan row. */
+                     /* If 3rd pair values are different, it can slide */
+                     /* into the next first pair, so back up one pair. */
+                     if(*p1ptr != *p2ptr)
+                        pos--;
+                  }
                }
-
                /* Otherwise, 2nd pair failed, so keep pointing to it */
                /* so that it is used in the next first pair test.    */
-
-            } /* Else, at end of current scan row. */
+            }
          }
          /* Otherwise, 1st pair failed... */
          else{
             /* Bump forward to next pixel pair. */
-            cx++;
+            pos++;
          }
-      } /* While not at end of current scan row. */
-      /* Bump forward to next scan row. */
-      cy++;
-   } /* While not out of scan rows. */
+      }
+   }
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: scan_band_thread - Thread function collecting the features of a band.
+**************************************************************************/
+static void *scan_band_thread(void *data)
+{
+   SCAN_BAND *band = (SCAN_BAND *)data;
+
+   band->ret = scan_band_lines(band);
+   return(NULL);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: process_band_hits - Processes the features collected from all bands,
+#cat:                in scan order.  If the binary image is changed along
+#cat:                the way, the rest of the image is scanned again.
+
+   Input:
+      bands     - bands with collected features, in scan order
+      nbands    - number of bands
+   Output:
+      minutiae   - points to a list of detected minutia structures
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+static int process_band_hits(MINUTIAE *minutiae, SCAN_BAND *bands,
+                const int nbands)
+{
+   SCAN_BAND rest;
+   SCAN_HIT *hit;
+   unsigned char *p1ptr, *p2ptr;
+   int b, h, ret;
+   int iw = bands[0].iw;
+
+   for(b = 0; b < nbands; b++){
+      rest = bands[b];
+      rest.minutiae = minutiae;
+
+      for(h = 0; h < bands[b].nhits; h++){
+         hit = &bands[b].hits[h];
+
+         if((ret = scan_band_feature(&rest, hit->line, hit->pos, hit->pos2,
+                                     hit->feature_id)))
+            return(ret);
+
+         if(rest.changed){
+            /* The feature's 3rd pixel pair. */
+            if(rest.scan_dir == SCAN_HORIZONTAL){
+               p1ptr = rest.bdata+(hit->line*iw)+hit->pos;
+               p2ptr = p1ptr+iw;
+            }
+            else{
+               p1ptr = rest.bdata+(hit->pos*iw)+hit->line;
+               p2ptr = p1ptr+1;
+            }
+
+            /* Scan the rest of the image, resuming right after the */
+            /* feature the way scan_band_lines() does.              */
+            rest.sline = hit->line;
+            rest.spos = hit->pos;
+            if(*p1ptr != *p2ptr)
+               rest.spos--;
+            rest.eline = bands[nbands-1].eline;
+            return(scan_band_lines(&rest));
+         }
+      }
+   }
 
-   /* Return normally. */
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: scan4minutiae_V2 - Scans an entire binary image horizontally or
+#cat:                vertically for minutiae, in bands scanned in parallel
+#cat:                if the image is large enough.
+
+   Input:
+      scan_dir  - SCAN_HORIZONTAL or SCAN_VERTICAL
+      bdata     - binary image data (0==while & 1==black)
+      iw        - width (in pixels) of image
+      ih        - height (in pixels) of image
+      pdirection_map  - pixelized Direction Map
+      plow_flow_map   - pixelized Low Ridge Flow Map
+      phigh_curve_map - pixelized High Curvature Map
+      lfsparms  - parameters and thresholds for controlling LFS
+   Output:
+      minutiae   - points to a list of detected minutia structures
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+static int scan4minutiae_V2(MINUTIAE *minutiae, const int scan_dir,
+                unsigned char *bdata, const int iw, const int ih,
+                int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
+                const LFSPARMS *lfsparms)
+{
+   SCAN_BAND *bands;
+   GThread **threads;
+   uint64_t *bits;
+   unsigned char *win;
+   int nlines, nwords, radius, nbands, b, ret;
+
+   /* Every line but the last is scanned together with the next one. */
+   nlines = (scan_dir == SCAN_HORIZONTAL ? ih : iw) - 1;
+   nwords = ((scan_dir == SCAN_HORIZONTAL ? iw : ih) + 63) / 64;
+
+   /* A loop traced from a feature has all its pixels within half the */
+   /* traced contour length of the feature.                           */
+   radius = lfsparms->high_curve_half_contour + 2;
+
+   nbands = min(g_get_num_processors(), nlines / SCAN_MIN_BAND_LINES);
+   nbands = max(nbands, 1);
+
+   bands = (SCAN_BAND *)calloc(nbands, sizeof(SCAN_BAND));
+   threads = (GThread **)calloc(nbands, sizeof(GThread *));
+   if((bands == (SCAN_BAND *)NULL) || (threads == (GThread **)NULL)){
+      free(bands);
+      free(threads);
+      print2err("ERROR : scan4minutiae_V2 : calloc : bands\n");
+      return(-272);
+   }
+
+   bits = (uint64_t *)malloc((nlines+1) * nwords * sizeof(uint64_t));
+   if(bits == (uint64_t *)NULL){
+      free(bands);
+      free(threads);
+      print2err("ERROR : scan4minutiae_V2 : malloc : bits\n");
+      return(-273);
+   }
+
+   win = (unsigned char *)malloc((2*radius+1) * (2*radius+1));
+   if(win == (unsigned char *)NULL){
+      free(bands);
+      free(threads);
+      free(bits);
+      print2err("ERROR : scan4minutiae_V2 : malloc : win\n");
+      return(-271);
+   }
+
+   for(b = 0; b < nbands; b++){
+      bands[b].scan_dir = scan_dir;
+      bands[b].bdata = bdata;
+      bands[b].iw = iw;
+      bands[b].ih = ih;
+      bands[b].pdirection_map = pdirection_map;
+      bands[b].plow_flow_map = plow_flow_map;
+      bands[b].phigh_curve_map = phigh_curve_map;
+      bands[b].lfsparms = lfsparms;
+      bands[b].bits = bits;
+      bands[b].nwords = nwords;
+      bands[b].win = win;
+      bands[b].radius = radius;
+      bands[b].sline = (nlines * b) / nbands;
+      bands[b].eline = (nlines * (b+1)) / nbands;
+   }
+
+   pack_scan_lines(&bands[0], 0, nlines+1);
+
+   /* A single band is processed as it is scanned. */
+   if(nbands == 1){
+      bands[0].minutiae = minutiae;
+      ret = scan_band_lines(&bands[0]);
+      free(bands);
+      free(threads);
+      free(bits);
+      free(win);
+      return(ret);
+   }
+
+   for(b = 1; b < nbands; b++)
+      threads[b] = g_thread_new("mindtct-scan", scan_band_thread, &bands[b]);
+   scan_band_thread(&bands[0]);
+   for(b = 1; b < nbands; b++)
+      g_thread_join(threads[b]);
+
+   ret = 0;
+   for(b = 0; b < nbands; b++)
+      if(bands[b].ret < 0)
+         ret = bands[b].ret;
+
+   if(ret == 0)
+      ret = process_band_hits(minutiae, bands, nbands);
+
+   for(b = 0; b < nbands; b++)
+      free(bands[b].hits);
+   free(bands);
+   free(threads);
+   free(bits);
+   free(win);
+
+   return(ret);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: scan4minutiae_horizontally_V2 - Scans an entire binary image
+#cat:                horizontally, detecting potential minutiae points.
+#cat:                Minutia detected via the horizontal scan process are
+#cat:                by nature vertically oriented (orthogonal to the scan).
+
+   Input:
+      bdata     - binary image data (0==while & 1==black)
+      iw        - width (in pixels) of image
+      ih        - height (in pixels) of image
+      pdirection_map  - pixelized Direction Map
+      plow_flow_map   - pixelized Low Ridge Flow Map
+      phigh_curve_map - pixelized High Curvature Map
+      lfsparms  - parameters and thresholds for controlling LFS
+   Output:
+      minutiae   - points to a list of detected minutia structures
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int scan4minutiae_horizontally_V2(MINUTIAE *minutiae,
+                unsigned char *bdata, const int iw, const int ih,
+                int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
+                const LFSPARMS *lfsparms)
+{
+   return(scan4minutiae_V2(minutiae, SCAN_HORIZONTAL, bdata, iw, ih,
+                 pdirection_map, plow_flow_map, phigh_curve_map, lfsparms));
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: scan4minutiae_vertically - Scans a specified region of binary image data 
@@ -1660,100 +2222,8 @@ int scan4minutiae_vertically_V2(MINUTIAE *minutiae,
                 int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
                 const LFSPARMS *lfsparms)
 {
-   int sx, sy, ex, ey, cx, cy, y2;
-   unsigned char *p1ptr, *p2ptr;
-   int possible[NFEATURES], nposs;
-   int ret;
-
-   /* Set scan region to entire image. */
-   sx = 0;
-   ex = iw;
-   sy = 0;
-   ey = ih;
-
-   /* Start at first column in region. */
-   cx = sx;
-   /* While second scan column not outside the right of the region ... */
-   while(cx+1 < ex){
-      /* Start at beginning of new scan column in region. */
-      cy = sy;
-      /* While not at end of region's current scan column. */
-      while(cy < ey){
-         /* Get pixel pair from current y position in current and next */
-         /* scan columns. */
-         p1ptr = bdata+(cy*iw)+cx;
-         p2ptr = p1ptr+1;
-         /* If scan pixel pair matches first pixel pair of */
-         /* 1 or more features... */
-         if(match_1st_pair(*p1ptr, *p2ptr, possible, &nposs)){
-            /* Bump forward to next scan pixel pair. */
-            cy++;
-            p1ptr+=iw;
-            p2ptr+=iw;
-            /* If not at end of region's current scan column... */
-            if(cy < ey){
-               /* If scan pixel pair matches second pixel pair of */
-               /* 1 or more features... */
-               if(match_2nd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                  /* Store current y location. */
-                  y2 = cy;
-                  /* Skip repeated pixel pairs. */
-                  skip_repeated_vertical_pair(&cy, ey, &p1ptr, &p2ptr,
-                                                  iw, ih);
-                  /* If not at end of region's current scan column... */
-                  if(cy < ey){
-                     /* If scan pixel pair matches third pixel pair of */
-                     /* a single feature... */
-                     if(match_3rd_pair(*p1ptr, *p2ptr, possible, &nposs)){
-                        /* Process detected minutia point. */
-                        if((ret = process_vertical_scan_minutia_V2(minutiae,
-                                         cx, cy, y2, possible[0],
-                                         bdata, iw, ih, pdirection_map,
-                                         plow_flow_map, phigh_curve_map,
-                                         lfsparms))){
-                           /* Return code may be:                       */
-                           /* 1.  ret< 0 (implying system error)        */
-                           /* 2. ret==IGNORE (ignore current feature)   */
-                           if(ret < 0)
-                              return(ret);
-                           /* Otherwise, IGNORE and continue. */
-                        }
-                     }
-
-                     /* Set up to resume scan. */
-                     /* Test to see if 3rd pair can slide into 2nd pair. */
-                     /* The values of the 2nd pair MUST be different.    */
-                     /* If 3rd pair values are different ... */
-                     if(*p1ptr != *p2ptr){
-                        /* Set next first pair to last of repeated */
-                        /* 2nd pairs, ie. back up one pair.        */
-                        cy--;
-                     }
-
-                     /* Otherwise, 3rd pair can't be a 2nd pair, so  */
-                     /* keep pointing to 3rd pair so that it is used */
-                     /* in the next first pair test.                 */
-
-                  } /* Else, at end of current scan row. */
-               }
-
-               /* Otherwise, 2nd pair failed, so keep pointing to it */
-               /* so that it is used in the next first pair test.    */
-
-            } /* Else, at end of current scan column. */
-         }
-         /* Otherwise, 1st pair failed... */
-         else{
-            /* Bump forward to next pixel pair. */
-            cy++;
-         }
-      } /* While not at end of current scan column. */
-      /* Bump forward to next scan column. */
-      cx++;
-   } /* While not out of scan columns. */
-
-   /* Return normally. */
-   return(0);
+   return(scan4minutiae_V2(minutiae, SCAN_VERTICAL, bdata, iw, ih,
+                 pdirection_map, plow_flow_map, phigh_curve_map, lfsparms));
 }
 
 /*************************************************************************
@@ -2173,7 +2643,7 @@ int get_nbr_block_index(int *oblk_i, const int nbr_dir,
          ni = (blk_y*mw)+nx;
          break;
       default:
-         fprintf(stderr,
+         print2err(
          "ERROR : get_nbr_block_index : illegal neighbor direction\n");
           return(-200);
    }
@@ -2318,7 +2788,7 @@ int adjust_horizontal_rescan(const int nbr_dir, int *rescan_x, int *rescan_y,
          *rescan_h = scan_h;
          break;
       default:
-         fprintf(stderr,
+         print2err(
          "ERROR : adjust_horizontal_rescan : illegal neighbor direction\n");
           return(-210);
    }
@@ -2462,7 +2932,7 @@ int adjust_vertical_rescan(const int nbr_dir, int *rescan_x, int *rescan_y,
          *rescan_h = scan_h;
          break;
       default:
-         fprintf(stderr,
+         print2err(
          "ERROR : adjust_vertical_rescan : illegal neighbor direction\n");
           return(-220);
    }
@@ -2505,7 +2975,7 @@ int process_horizontal_scan_minutia(MINUTIAE *minutiae,
                     const int imapval, const int nmapval,
                     const LFSPARMS *lfsparms)
 {
-   MINUTIA *minutia;
+   MINUTIA minutia;
    int x_loc, y_loc;
    int x_edge, y_edge;
    int idir, ret;
@@ -2555,20 +3025,16 @@ int process_horizontal_scan_minutia(MINUTIAE *minutiae,
    }
 
    /* Create a minutia object based on derived attributes. */
-   if((ret = create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
-                     DEFAULT_RELIABILITY,
-                     g_feature_patterns[feature_id].type,
-                     g_feature_patterns[feature_id].appearing, feature_id)))
-      /* Return system error. */
-      return(ret);
+   create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
+                  DEFAULT_RELIABILITY,
+                  g_feature_patterns[feature_id].type,
+                  g_feature_patterns[feature_id].appearing, feature_id);
 
    /* Update the minutiae list with potential new minutia. */
-   ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-   /* If minuitia IGNORED and not added to the minutia list ... */
-   if(ret == IGNORE)
-      /* Deallocate the minutia. */
-      free_minutia(minutia);
+   if((ret = update_minutiae(minutiae, &minutia,
+                             bdata, iw, ih, lfsparms)) < 0)
+      /* Return system error. */
+      return(ret);
 
    /* Otherwise, return normally. */
    return(0);
@@ -2609,7 +3075,7 @@ int process_horizontal_scan_minutia_V2(MINUTIAE *minutiae,
                  int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
                  const LFSPARMS *lfsparms)
 {
-   MINUTIA *minutia;
+   MINUTIA minutia;
    int x_loc, y_loc;
    int x_edge, y_edge;
    int idir, ret;
@@ -2678,21 +3144,16 @@ int process_horizontal_scan_minutia_V2(MINUTIAE *minutiae,
       reliability = HIGH_RELIABILITY;
 
    /* Create a minutia object based on derived attributes. */
-   if((ret = create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
-                     reliability,
-                     g_feature_patterns[feature_id].type,
-                     g_feature_patterns[feature_id].appearing, feature_id)))
-      /* Return system error. */
-      return(ret);
+   create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
+                  reliability,
+                  g_feature_patterns[feature_id].type,
+                  g_feature_patterns[feature_id].appearing, feature_id);
 
    /* Update the minutiae list with potential new minutia. */
-   ret = update_minutiae_V2(minutiae, minutia, SCAN_HORIZONTAL,
-                            dmapval, bdata, iw, ih, lfsparms);
-
-   /* If minuitia IGNORED and not added to the minutia list ... */
-   if(ret == IGNORE)
-      /* Deallocate the minutia. */
-      free_minutia(minutia);
+   if((ret = update_minutiae_V2(minutiae, &minutia, SCAN_HORIZONTAL,
+                                dmapval, bdata, iw, ih, lfsparms)) < 0)
+      /* Return system error. */
+      return(ret);
 
    /* Otherwise, return normally. */
    return(0);
@@ -2732,7 +3193,7 @@ int process_vertical_scan_minutia(MINUTIAE *minutiae,
                     const int imapval, const int nmapval,
                     const LFSPARMS *lfsparms)
 {
-   MINUTIA *minutia;
+   MINUTIA minutia;
    int x_loc, y_loc;
    int x_edge, y_edge;
    int idir, ret;
@@ -2781,20 +3242,16 @@ int process_vertical_scan_minutia(MINUTIAE *minutiae,
    }
 
    /* Create a minutia object based on derived attributes. */
-   if((ret = create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
-                     DEFAULT_RELIABILITY,
-                     g_feature_patterns[feature_id].type,
-                     g_feature_patterns[feature_id].appearing, feature_id)))
-      /* Return system error. */
-      return(ret);
+   create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
+                  DEFAULT_RELIABILITY,
+                  g_feature_patterns[feature_id].type,
+                  g_feature_patterns[feature_id].appearing, feature_id);
 
    /* Update the minutiae list with potential new minutia. */
-   ret = update_minutiae(minutiae, minutia, bdata, iw, ih, lfsparms);
-
-   /* If minuitia IGNORED and not added to the minutia list ... */
-   if(ret == IGNORE)
-      /* Deallocate the minutia. */
-      free_minutia(minutia);
+   if((ret = update_minutiae(minutiae, &minutia,
+                             bdata, iw, ih, lfsparms)) < 0)
+      /* Return system error. */
+      return(ret);
 
    /* Otherwise, return normally. */
    return(0);
@@ -2835,7 +3292,7 @@ int process_vertical_scan_minutia_V2(MINUTIAE *minutiae,
                  int *pdirection_map, int *plow_flow_map, int *phigh_curve_map,
                  const LFSPARMS *lfsparms)
 {
-   MINUTIA *minutia;
+   MINUTIA minutia;
    int x_loc, y_loc;
    int x_edge, y_edge;
    int idir, ret;
@@ -2903,21 +3360,16 @@ int process_vertical_scan_minutia_V2(MINUTIAE *minutiae,
       reliability = HIGH_RELIABILITY;
 
    /* Create a minutia object based on derived attributes. */
-   if((ret = create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
-                     reliability,
-                     g_feature_patterns[feature_id].type,
-                     g_feature_patterns[feature_id].appearing, feature_id)))
-      /* Return system error. */
-      return(ret);
+   create_minutia(&minutia, x_loc, y_loc, x_edge, y_edge, idir,
+                  reliability,
+                  g_feature_patterns[feature_id].type,
+                  g_feature_patterns[feature_id].appearing, feature_id);
 
    /* Update the minutiae list with potential new minutia. */
-   ret = update_minutiae_V2(minutiae, minutia, SCAN_VERTICAL,
-                            dmapval, bdata, iw, ih, lfsparms);
-
-   /* If minuitia IGNORED and not added to the minutia list ... */
-   if(ret == IGNORE)
-      /* Deallocate the minutia. */
-      free_minutia(minutia);
+   if((ret = update_minutiae_V2(minutiae, &minutia, SCAN_VERTICAL,
+                                dmapval, bdata, iw, ih, lfsparms)) < 0)
+      /* Return system error. */
+      return(ret);
 
    /* Otherwise, return normally. */
    return(0);
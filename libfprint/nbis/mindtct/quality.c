@@ -47,6 +47,7 @@ identified are necessarily the best available for the purpose.
 #include <string.h>
 #include <math.h>
 #include <lfs.h>
+#include <log.h>
 
 /***********************************************************************
 ************************************************************************
@@ -97,7 +98,7 @@ int gen_quality_map(int **oqmap, int *direction_map, int *low_contrast_map,
 
    QualMap = (int *)malloc(map_w * map_h * sizeof(int));
    if(QualMap == (int *)NULL){
-      fprintf(stderr, "ERROR : gen_quality_map : malloc : QualMap\n");
+      print2err("ERROR : gen_quality_map : malloc : QualMap\n");
       return(-2);
    }
 
@@ -182,7 +183,8 @@ int gen_quality_map(int **oqmap, int *direction_map, int *low_contrast_map,
    Modified by Michael D. Garris (NIST) Sept. 25, 2000
 
    Input:
-      minutia    - structure containing detected minutia
+      x          - x-pixel coord of detected minutia
+      y          - y-pixel coord of detected minutia
       idata      - 8-bit grayscale fingerprint image
       iw         - width (in pixels) of the image
       ih         - height (in pixels) of the image
@@ -191,21 +193,13 @@ int gen_quality_map(int **oqmap, int *direction_map, int *low_contrast_map,
       mean       - mean of neighboring pixels
       stdev      - standard deviation of neighboring pixels
 ************************************************************************/
-static void get_neighborhood_stats(double *mean, double *stdev, MINUTIA *minutia,
+static void get_neighborhood_stats(double *mean, double *stdev,
+                     const int x, const int y,
                      unsigned char *idata, const int iw, const int ih,
                      const int radius_pix)
 {
-   int i, x, y, rows, cols;
-   int n = 0, sumX = 0, sumXX = 0;
-   int histogram[256];
-
-   /* Zero out histogram. */
-   memset(histogram, 0, 256 * sizeof(int));
-
-   /* Set minutia's coordinate variables. */
-   x = minutia->x;
-   y = minutia->y;
-
+   int rows, cols, pix;
+   int n, sumX = 0, sumXX = 0;
 
    /* If minutiae point is within sampleboxsize distance of image border, */
    /* a value of 0 reliability is returned. */
@@ -217,6 +211,8 @@ static void get_neighborhood_stats(double *mean, double *stdev, MINUTIA *minutia
       
    }
 
+   n = ((2*radius_pix)+1) * ((2*radius_pix)+1);
+
    /* Foreach row in neighborhood ... */
    for(rows = y - radius_pix;
        rows <= y + radius_pix;
@@ -225,20 +221,10 @@ static void get_neighborhood_stats(double *mean, double *stdev, MINUTIA *minutia
       for(cols = x - radius_pix;
           cols <= x + radius_pix;
           cols++){
-         /* Bump neighbor's pixel value bin in histogram. */
-         histogram[*(idata+(rows * iw)+cols)]++;
-      }
-   }
-
-   /* Foreach grayscale pixel bin ... */
-   for(i = 0; i < 256; i++){
-      if(histogram[i]){
-         /* Accumulate Sum(X[i]) */
-         sumX += (i * histogram[i]);
-         /* Accumulate Sum(X[i]^2) */
-         sumXX += (i * i * histogram[i]);
-         /* Accumulate N samples */
-         n += histogram[i];
+         pix = *(idata+(rows * iw)+cols);
+         /* Accumulate Sum(X[i]) and Sum(X[i]^2) */
+         sumX += pix;
+         sumXX += pix * pix;
       }
    }
 
@@ -264,7 +250,8 @@ static void get_neighborhood_stats(double *mean, double *stdev, MINUTIA *minutia
    light & dark areas in equal proportions).
 
    Input:
-      minutia    - structure containing detected minutia
+      x          - x-pixel coord of detected minutia
+      y          - y-pixel coord of detected minutia
       idata      - 8-bit grayscale fingerprint image
       iw         - width (in pixels) of the image
       ih         - height (in pixels) of the image
@@ -272,13 +259,14 @@ static void get_neighborhood_stats(double *mean, double *stdev, MINUTIA *minutia
    Return Value:
       reliability - computed reliability measure
 ************************************************************************/
-static double grayscale_reliability(MINUTIA *minutia, unsigned char *idata,
-                             const int iw, const int ih, const int radius_pix)
+static double grayscale_reliability(const int x, const int y,
+                             unsigned char *idata, const int iw, const int ih,
+                             const int radius_pix)
 {
    double mean, stdev;
    double reliability;
 
-   get_neighborhood_stats(&mean, &stdev, minutia, idata, iw, ih, radius_pix);
+   get_neighborhood_stats(&mean, &stdev, x, y, idata, iw, ih, radius_pix);
 
    reliability = min((stdev>IDEALSTDEV ? 1.0 : stdev/(double)IDEALSTDEV),
                          (1.0-(fabs(mean-IDEALMEAN)/(double)IDEALMEAN)));
@@ -316,14 +304,13 @@ int combined_minutia_quality(MINUTIAE *minutiae,
 {
    int ret, i, index, radius_pix;
    int *pquality_map, qmap_value;
-   MINUTIA *minutia;
    double gs_reliability, reliability;
 
    /* If image is not 8-bit grayscale ... */
    if(id != 8){
-      fprintf(stderr, "ERROR : combined_miutia_quality : ");
-      fprintf(stderr, "image must pixel depth = %d must be 8 ", id);
-      fprintf(stderr, "to compute reliability\n");
+      print2err("ERROR : combined_miutia_quality : ");
+      print2err("image must pixel depth = %d must be 8 ", id);
+      print2err("to compute reliability\n");
       return(-2);
    }
 
@@ -338,16 +325,13 @@ int combined_minutia_quality(MINUTIAE *minutiae,
 
    /* Foreach minutiae detected ... */
    for(i = 0; i < minutiae->num; i++){
-      /* Assign minutia pointer. */
-      minutia = minutiae->list[i];
-
       /* Compute reliability from stdev and mean of pixel neighborhood. */
-      gs_reliability = grayscale_reliability(minutia,
+      gs_reliability = grayscale_reliability(minutiae->x[i], minutiae->y[i],
                                              idata, iw, ih, radius_pix);
 
       /* Lookup quality map value. */
       /* Compute minutia pixel index. */
-      index = (minutia->y * iw) + minutia->x;
+      index = (minutiae->y[i] * iw) + minutiae->x[i];
       /* Switch on pixel's quality value ... */
       qmap_value = pquality_map[index];
 
@@ -375,13 +359,13 @@ int combined_minutia_quality(MINUTIAE *minutiae,
             break;
          /* Error if quality value not in range [0..4]. */
          default:
-            fprintf(stderr, "ERROR : combined_miutia_quality : ");
-            fprintf(stderr, "unexpected quality map value %d ", qmap_value);
-            fprintf(stderr, "not in range [0..4]\n");
+            print2err("ERROR : combined_miutia_quality : ");
+            print2err("unexpected quality map value %d ", qmap_value);
+            print2err("not in range [0..4]\n");
             free(pquality_map);
             return(-3);
       }
-      minutia->reliability = reliability;
+      minutiae->reliability[i] = reliability;
    }
 
    /* NEW 05-08-2002 */
@@ -52,6 +52,66 @@ identified are necessarily the best available for the purpose.
 #include <lfs.h>
 #include <log.h>
 
+/* Type of the minutiae in slots emptied by tombstone_minutia(). */
+#define REMOVED_MINUTIA  -1
+
+/*************************************************************************
+**************************************************************************
+#cat: tombstone_minutia - Leaves the slot of a minutia in the list empty,
+#cat:                by setting its type to REMOVED_MINUTIA. Sliding the
+#cat:                rest of the list up for every minutia removed made
+#cat:                removal quadratic in the number of candidates; the
+#cat:                tests below skip empty slots instead, and
+#cat:                compact_minutiae() closes the gaps once at the end.
+
+   Input:
+      index     - position of minutia to be removed from list
+      minutiae  - list of minutiae
+   Output:
+      minutiae  - list with the minutia's slot emptied
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+static int tombstone_minutia(const int index, MINUTIAE *minutiae)
+{
+   /* Make sure the requested index is within range and still in use. */
+   if((index < 0) || (index >= minutiae->num) ||
+      (minutiae->type[index] == REMOVED_MINUTIA)){
+      print2err("ERROR : tombstone_minutia : index out of range\n");
+      return(-380);
+   }
+
+   minutiae->type[index] = REMOVED_MINUTIA;
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: compact_minutiae - Closes the gaps left in a minutiae list by
+#cat:                tombstone_minutia(), keeping the order of the
+#cat:                remaining minutiae.
+
+   Input:
+      minutiae  - list of minutiae with empty slots
+   Output:
+      minutiae  - list without empty slots
+**************************************************************************/
+static void compact_minutiae(MINUTIAE *minutiae)
+{
+   int fr, to;
+
+   for(to = 0, fr = 0; fr < minutiae->num; fr++)
+      if(minutiae->type[fr] != REMOVED_MINUTIA){
+         if(to != fr)
+            move_minutia(minutiae, to, fr);
+         to++;
+      }
+
+   minutiae->num = to;
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: remove_holes - Removes minutia points on small loops around valleys.
@@ -73,31 +133,33 @@ static int remove_holes(MINUTIAE *minutiae,
                  const LFSPARMS *lfsparms)
 {
    int i, ret;
-   MINUTIA *minutia;
 
    print2log("\nREMOVING HOLES:\n");
 
    i = 0;
    /* Foreach minutia remaining in list ... */
    while(i < minutiae->num){
-      /* Assign a temporary pointer. */
-      minutia = minutiae->list[i];
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA){
+         i++;
+         continue;
+      }
       /* If current minutia is a bifurcation ... */
-      if(minutia->type == BIFURCATION){
+      if(minutiae->type[i] == BIFURCATION){
          /* Check to see if it is on a loop of specified length (ex. 15). */
-         ret = on_loop(minutia, lfsparms->small_loop_len, bdata, iw, ih);
+         ret = on_loop(minutiae, i, lfsparms->small_loop_len, bdata, iw, ih);
          /* If minutia is on a loop ... or loop test IGNORED */
          if((ret == LOOP_FOUND) || (ret == IGNORE)){
 
-            print2log("%d,%d RM\n", minutia->x, minutia->y);
+            print2log("%d,%d RM\n", minutiae->x[i], minutiae->y[i]);
 
             /* Then remove the minutia from list. */
-            if((ret = remove_minutia(i, minutiae))){
+            if((ret = tombstone_minutia(i, minutiae))){
                /* Return error code. */
                return(ret);
             }
-            /* No need to advance because next minutia has "slid" */
-            /* into position pointed to by 'i'.                   */
+            /* No need to advance, the empty slot left behind is */
+            /* skipped on the next pass through the loop.         */
          }
          /* If the minutia is NOT on a loop... */
          else if (ret == FALSE){
@@ -146,7 +208,6 @@ static int remove_hooks(MINUTIAE *minutiae,
    int *to_remove;
    int i, f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
-   MINUTIA *minutia1, *minutia2;
    double dist;
 
    print2log("\nREMOVING HOOKS:\n");
@@ -156,7 +217,7 @@ static int remove_hooks(MINUTIAE *minutiae,
    /* "calloc" initializes the list to FALSE.                          */
    to_remove = (int *)calloc(minutiae->num, sizeof(int));
    if(to_remove == (int *)NULL){
-      fprintf(stderr, "ERROR : remove_hooks : calloc : to_remove\n");
+      print2err("ERROR : remove_hooks : calloc : to_remove\n");
       return(-640);
    }
 
@@ -176,23 +237,29 @@ static int remove_hooks(MINUTIAE *minutiae,
    f = 0;
    /* Foreach primary (first) minutia (except for last one in list) ... */
    while(f < minutiae->num-1){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[f] == REMOVED_MINUTIA){
+         f++;
+         continue;
+      }
 
       /* If current first minutia not previously set to be removed. */
       if(!to_remove[f]){
 
          print2log("\n");
 
-         /* Set first minutia to temporary pointer. */
-         minutia1 = minutiae->list[f];
          /* Foreach secondary (second) minutia to right of first minutia ... */
          s = f+1;
          while(s < minutiae->num){
-            /* Set second minutia to temporary pointer. */
-            minutia2 = minutiae->list[s];
+            /* Skip minutiae removed by earlier tests. */
+            if(minutiae->type[s] == REMOVED_MINUTIA){
+               s++;
+               continue;
+            }
 
             print2log("1:%d(%d,%d)%d 2:%d(%d,%d)%d ",
-                      f, minutia1->x, minutia1->y, minutia1->type,
-                      s, minutia2->x, minutia2->y, minutia2->type);
+                      f, minutiae->x[f], minutiae->y[f], minutiae->type[f],
+                      s, minutiae->x[s], minutiae->y[s], minutiae->type[s]);
 
             /* The binary image is potentially being edited during each */
             /* iteration of the secondary minutia loop, therefore       */
@@ -200,14 +267,16 @@ static int remove_hooks(MINUTIAE *minutiae,
             /* these events by using the next 2 tests.                  */
 
             /* If the first minutia's pixel has been previously changed... */
-            if(*(bdata+(minutia1->y*iw)+minutia1->x) != minutia1->type){
+            if(*(bdata+(minutiae->y[f]*iw)+minutiae->x[f]) !=
+               minutiae->type[f]){
                print2log("\n");
                /* Then break out of secondary loop and skip to next first. */
                break;
             }
 
             /* If the second minutia's pixel has been previously changed... */
-            if(*(bdata+(minutia2->y*iw)+minutia2->x) != minutia2->type)
+            if(*(bdata+(minutiae->y[s]*iw)+minutiae->x[s]) !=
+               minutiae->type[s])
                /* Set to remove second minutia. */
                to_remove[s] = TRUE;
 
@@ -215,15 +284,15 @@ static int remove_hooks(MINUTIAE *minutiae,
             if(!to_remove[s]){
 
                /* Compute delta y between 1st & 2nd minutiae and test. */
-               delta_y = minutia2->y - minutia1->y;
+               delta_y = minutiae->y[s] - minutiae->y[f];
                /* If delta y small enough (ex. < 8 pixels) ... */
                if(delta_y <= lfsparms->max_rmtest_dist){
 
                   print2log("1DY ");
 
                   /* Compute Euclidean distance between 1st & 2nd mintuae. */
-                  dist = distance(minutia1->x, minutia1->y,
-                                  minutia2->x, minutia2->y);
+                  dist = distance(minutiae->x[f], minutiae->y[f],
+                                  minutiae->x[s], minutiae->y[s]);
                   /* If distance is NOT too large (ex. < 8 pixels) ... */
                   if(dist <= lfsparms->max_rmtest_dist){
 
@@ -231,11 +300,11 @@ static int remove_hooks(MINUTIAE *minutiae,
 
                      /* Compute "inner" difference between directions on */
                      /* a full circle and test.                          */
-                     if((deltadir = closest_dir_dist(minutia1->direction,
-                                    minutia2->direction, full_ndirs)) ==
+                     if((deltadir = closest_dir_dist(minutiae->direction[f],
+                                    minutiae->direction[s], full_ndirs)) ==
                                     INVALID_DIR){
                         free(to_remove);
-                        fprintf(stderr,
+                        print2err(
                                 "ERROR : remove_hooks : INVALID direction\n");
                         return(-641);
                      }
@@ -247,11 +316,11 @@ static int remove_hooks(MINUTIAE *minutiae,
                         print2log("3DD ");
 
                         /* If 1st & 2nd minutiae are NOT same type ... */
-                        if(minutia1->type != minutia2->type){
+                        if(minutiae->type[f] != minutiae->type[s]){
                            /* Check to see if pair on a hook with contour */
                            /* of specified length (ex. 15 pixels) ...     */
 
-                           ret = on_hook(minutia1, minutia2,
+                           ret = on_hook(minutiae, f, s,
                                          lfsparms->max_hook_len,
                                          bdata, iw, ih);
 
@@ -327,7 +396,7 @@ static int remove_hooks(MINUTIAE *minutiae,
       /* If the current minutia index is flagged for removal ... */
       if(to_remove[i]){
          /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
+         if((ret = tombstone_minutia(i, minutiae))){
             free(to_remove);
             return(ret);
          }
@@ -370,7 +439,6 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
    int i, f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
    int *loop_x, *loop_y, *loop_ex, *loop_ey, nloop;
-   MINUTIA *minutia1, *minutia2;
    double dist;
    int dist_thresh, half_loop;
 
@@ -384,7 +452,7 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
    /* "calloc" initializes the list to FALSE.                          */
    to_remove = (int *)calloc(minutiae->num, sizeof(int));
    if(to_remove == (int *)NULL){
-      fprintf(stderr,
+      print2err(
               "ERROR : remove_islands_and_lakes : calloc : to_remove\n");
       return(-610);
    }
@@ -405,27 +473,32 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
    /* Foreach primary (first) minutia (except for last one in list) ... */
    f = 0;
    while(f < minutiae->num-1){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[f] == REMOVED_MINUTIA){
+         f++;
+         continue;
+      }
 
       /* If current first minutia not previously set to be removed. */
       if(!to_remove[f]){
 
          print2log("\n");
 
-         /* Set first minutia to temporary pointer. */
-         minutia1 = minutiae->list[f];
-
          /* Foreach secondary minutia to right of first minutia ... */
          s = f+1;
          while(s < minutiae->num){
-            /* Set second minutia to temporary pointer. */
-            minutia2 = minutiae->list[s];
+            /* Skip minutiae removed by earlier tests. */
+            if(minutiae->type[s] == REMOVED_MINUTIA){
+               s++;
+               continue;
+            }
 
             /* If the secondary minutia is desired type ... */
-            if(minutia2->type == minutia1->type){
+            if(minutiae->type[s] == minutiae->type[f]){
 
                print2log("1:%d(%d,%d)%d 2:%d(%d,%d)%d ",
-                         f, minutia1->x, minutia1->y, minutia1->type,
-                         s, minutia2->x, minutia2->y, minutia2->type);
+                         f, minutiae->x[f], minutiae->y[f], minutiae->type[f],
+                         s, minutiae->x[s], minutiae->y[s], minutiae->type[s]);
 
                /* The binary image is potentially being edited during   */
                /* each iteration of the secondary minutia loop,         */
@@ -434,7 +507,8 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
 
                /* If the first minutia's pixel has been previously */
                /* changed...                                       */
-               if(*(bdata+(minutia1->y*iw)+minutia1->x) != minutia1->type){
+               if(*(bdata+(minutiae->y[f]*iw)+minutiae->x[f]) !=
+                  minutiae->type[f]){
                   print2log("\n");
                   /* Then break out of secondary loop and skip to next */
                   /* first.                                            */
@@ -443,7 +517,8 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
 
                /* If the second minutia's pixel has been previously */
                /* changed...                                        */
-               if(*(bdata+(minutia2->y*iw)+minutia2->x) != minutia2->type)
+               if(*(bdata+(minutiae->y[s]*iw)+minutiae->x[s]) !=
+                  minutiae->type[s])
                   /* Set to remove second minutia. */
                   to_remove[s] = TRUE;
 
@@ -451,7 +526,7 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
                if(!to_remove[s]){
 
                   /* Compute delta y between 1st & 2nd minutiae and test. */
-                  delta_y = minutia2->y - minutia1->y;
+                  delta_y = minutiae->y[s] - minutiae->y[f];
                   /* If delta y small enough (ex. <16 pixels)... */
                   if(delta_y <= dist_thresh){
 
@@ -459,8 +534,8 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
 
                      /* Compute Euclidean distance between 1st & 2nd */
                      /* mintuae.                                     */
-                     dist = distance(minutia1->x, minutia1->y,
-                                     minutia2->x, minutia2->y);
+                     dist = distance(minutiae->x[f], minutiae->y[f],
+                                     minutiae->x[s], minutiae->y[s]);
 
                      /* If distance is NOT too large (ex. <16 pixels)... */
                      if(dist <= dist_thresh){
@@ -469,11 +544,11 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
 
                         /* Compute "inner" difference between directions */
                         /* on a full circle and test.                    */
-                        if((deltadir = closest_dir_dist(minutia1->direction,
-                                       minutia2->direction, full_ndirs)) ==
+                        if((deltadir = closest_dir_dist(minutiae->direction[f],
+                                       minutiae->direction[s], full_ndirs)) ==
                                        INVALID_DIR){
                            free(to_remove);
-                           fprintf(stderr,
+                           print2err(
                      "ERROR : remove_islands_and_lakes : INVALID direction\n");
                            return(-611);
                         }
@@ -492,7 +567,7 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
                            /* half length (ex. 30 pixels) ...             */
                            ret = on_island_lake(&loop_x, &loop_y,
                                            &loop_ex, &loop_ey, &nloop,
-                                           minutia1, minutia2,
+                                           minutiae, f, s,
                                            half_loop, bdata, iw, ih);
                            /* If pair is on island/lake ... */
                            if(ret == LOOP_FOUND){
@@ -571,7 +646,7 @@ static int remove_islands_and_lakes(MINUTIAE *minutiae,
       /* If the current minutia index is flagged for removal ... */
       if(to_remove[i]){
          /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
+         if((ret = tombstone_minutia(i, minutiae))){
             free(to_remove);
             return(ret);
          }
@@ -622,7 +697,6 @@ static int remove_malformations(MINUTIAE *minutiae,
                          const LFSPARMS *lfsparms)
 {
    int i, j, ret;
-   MINUTIA *minutia;
    int *contour_x, *contour_y, *contour_ex, *contour_ey, ncontour;
    int ax1, ay1, bx1, by1;
    int ax2, ay2, bx2, by2;
@@ -634,12 +708,15 @@ static int remove_malformations(MINUTIAE *minutiae,
    print2log("\nREMOVING MALFORMATIONS:\n");
 
    for(i = minutiae->num-1; i >= 0; i--){
-      minutia = minutiae->list[i];
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA)
+         continue;
       ret = trace_contour(&contour_x, &contour_y,
                           &contour_ex, &contour_ey, &ncontour,
                           lfsparms->malformation_steps_2,
-                          minutia->x, minutia->y,
-                          minutia->x, minutia->y, minutia->ex, minutia->ey,
+                          minutiae->x[i], minutiae->y[i],
+                          minutiae->x[i], minutiae->y[i],
+                          minutiae->ex[i], minutiae->ey[i],
                           SCAN_COUNTER_CLOCKWISE, bdata, iw, ih);
 
       /* If system error occurred during trace ... */
@@ -659,10 +736,10 @@ static int remove_malformations(MINUTIAE *minutiae,
             /* Deallocate the contour. */
             free_contour(contour_x, contour_y, contour_ex, contour_ey);
 
-         print2log("%d,%d RMA\n", minutia->x, minutia->y);
+         print2log("%d,%d RMA\n", minutiae->x[i], minutiae->y[i]);
 
          /* Then remove the minutia. */
-         if((ret = remove_minutia(i, minutiae)))
+         if((ret = tombstone_minutia(i, minutiae)))
             /* If system error, return error code. */
             return(ret);
       }
@@ -682,8 +759,9 @@ static int remove_malformations(MINUTIAE *minutiae,
          ret = trace_contour(&contour_x, &contour_y,
                           &contour_ex, &contour_ey, &ncontour,
                           lfsparms->malformation_steps_2,
-                          minutia->x, minutia->y,
-                          minutia->x, minutia->y, minutia->ex, minutia->ey,
+                          minutiae->x[i], minutiae->y[i],
+                          minutiae->x[i], minutiae->y[i],
+                          minutiae->ex[i], minutiae->ey[i],
                           SCAN_CLOCKWISE, bdata, iw, ih);
 
          /* If system error occurred during trace ... */
@@ -703,10 +781,10 @@ static int remove_malformations(MINUTIAE *minutiae,
                /* Deallocate the contour. */
                free_contour(contour_x, contour_y, contour_ex, contour_ey);
 
-            print2log("%d,%d RMB\n", minutia->x, minutia->y);
+            print2log("%d,%d RMB\n", minutiae->x[i], minutiae->y[i]);
 
             /* Then remove the minutia. */
-            if((ret = remove_minutia(i, minutiae)))
+            if((ret = tombstone_minutia(i, minutiae)))
                /* If system error, return error code. */
                return(ret);
          }
@@ -728,16 +806,16 @@ static int remove_malformations(MINUTIAE *minutiae,
             b_dist = distance(bx1, by1, bx2, by2);
 
             /* Compute block coords from minutia's pixel location. */
-            blk_x = minutia->x/lfsparms->blocksize;
-            blk_y = minutia->y/lfsparms->blocksize;
+            blk_x = minutiae->x[i]/lfsparms->blocksize;
+            blk_y = minutiae->y[i]/lfsparms->blocksize;
 
             removed = FALSE;
 
             /* Check to see if distances are not zero. */
             if((a_dist == 0.0) || (b_dist == 0.0)){
                /* Remove the malformation minutia. */
-               print2log("%d,%d RMMAL1\n", minutia->x, minutia->y);
-               if((ret = remove_minutia(i, minutiae)))
+               print2log("%d,%d RMMAL1\n", minutiae->x[i], minutiae->y[i]);
+               if((ret = tombstone_minutia(i, minutiae)))
                   /* If system error, return error code. */
                   return(ret);
                removed = TRUE;
@@ -751,8 +829,9 @@ static int remove_malformations(MINUTIAE *minutiae,
                   /* Need to test this out!                                 */
                   if(b_dist > lfsparms->max_malformation_dist){
                      /* Remove the malformation minutia. */
-                     print2log("%d,%d RMMAL2\n", minutia->x, minutia->y);
-                     if((ret = remove_minutia(i, minutiae)))
+                     print2log("%d,%d RMMAL2\n",
+                               minutiae->x[i], minutiae->y[i]);
+                     if((ret = tombstone_minutia(i, minutiae)))
                         /* If system error, return error code. */
                         return(ret);
                      removed = TRUE;
@@ -768,7 +847,7 @@ static int remove_malformations(MINUTIAE *minutiae,
                /* Foreach remaining point along line segment ... */
                for(j = 0; j < num; j++){
                   /* If B path contains pixel opposite minutia type ... */
-                  if(*(bdata+(y_list[j]*iw)+x_list[j]) != minutia->type){
+                  if(*(bdata+(y_list[j]*iw)+x_list[j]) != minutiae->type[i]){
                      /* Compute ratio of A & B path lengths. */
                      ratio = b_dist / a_dist;
                      /* Need to truncate precision so that answers are  */
@@ -779,8 +858,8 @@ static int remove_malformations(MINUTIAE *minutiae,
                         /* Remove the malformation minutia. */
                         /* Then remove the minutia. */
                         print2log("%d,%d RMMAL3 (%f)\n",
-                                  minutia->x, minutia->y, ratio);
-                        if((ret = remove_minutia(i, minutiae))){
+                                  minutiae->x[i], minutiae->y[i], ratio);
+                        if((ret = tombstone_minutia(i, minutiae))){
                            free(x_list);
                            free(y_list);
                            /* If system error, return error code. */
@@ -829,7 +908,6 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    int ix, iy, sbi, ebi;
    int bx, by, px, py;
    int removed;
-   MINUTIA *minutia;
    int lo_margin, hi_margin;
 
    /* The next 2 lookup tables are indexed by 'ix' and 'iy'. */
@@ -897,7 +975,7 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    /* If the margin covers more than the entire block ... */
    if(lfsparms->inv_block_margin > (lfsparms->blocksize>>1)){
       /* Then treat this as an error. */
-      fprintf(stderr,
+      print2err(
         "ERROR : remove_near_invblock_V2 : margin too large for blocksize\n");
       return(-620);
    }
@@ -910,12 +988,16 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    i = 0;
    /* Foreach minutia remaining in the list ... */
    while(i < minutiae->num){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA){
+         i++;
+         continue;
+      }
       /* Assign temporary minutia pointer. */
-      minutia = minutiae->list[i];
 
       /* Compute block coords from minutia's pixel location. */
-      bx = minutia->x/lfsparms->blocksize;
-      by = minutia->y/lfsparms->blocksize;
+      bx = minutiae->x[i]/lfsparms->blocksize;
+      by = minutiae->y[i]/lfsparms->blocksize;
 
       /* Compute pixel offset into the image block corresponding to the */
       /* minutia's pixel location.                                      */
@@ -925,8 +1007,8 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
       /* even multiple of 'blocksize' and we are processing minutia     */
       /* located in the right-most column (or bottom-most row) of       */
       /* blocks.  I don't think this will pose a problem in practice.   */
-      px = minutia->x % lfsparms->blocksize;
-      py = minutia->y % lfsparms->blocksize;
+      px = minutiae->x[i] % lfsparms->blocksize;
+      py = minutiae->y[i] % lfsparms->blocksize;
 
       /* Determine if x pixel offset into the block is in the margins. */
       /* If x pixel offset is in left margin ... */
@@ -972,7 +1054,7 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
             if((nbx < 0) || (nbx >= mw) ||
                (nby < 0) || (nby >= mh)){
 
-               print2log("%d,%d RM1\n", minutia->x, minutia->y);
+               print2log("%d,%d RM1\n", minutiae->x[i], minutiae->y[i]);
 
                /* Then the minutia is in a margin adjacent to the edge of */
                /* the image.                                              */
@@ -981,7 +1063,7 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
                /* an even multiple, then some minutia may not be detected */
                /* as being in the margin of "the image" (not the block).  */
                /* In practice, I don't think this will impact performance.*/
-               if((ret = remove_minutia(i, minutiae)))
+               if((ret = tombstone_minutia(i, minutiae)))
                   /* If system error occurred while removing minutia, */
                   /* then return error code.                          */
                   return(ret);
@@ -999,10 +1081,10 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
                /* (ex. 7)...                                      */
                if(nvalid < lfsparms->rm_valid_nbr_min){
 
-                  print2log("%d,%d RM2\n", minutia->x, minutia->y);
+                  print2log("%d,%d RM2\n", minutiae->x[i], minutiae->y[i]);
 
                   /* Then remove the current minutia from the list. */
-                  if((ret = remove_minutia(i, minutiae)))
+                  if((ret = tombstone_minutia(i, minutiae)))
                      /* If system error occurred while removing minutia, */
                      /* then return error code.                          */
                      return(ret);
@@ -1024,8 +1106,8 @@ static int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
       if(!removed)
          /* Advance to the next minutia in the list. */
          i++;
-      /* Otherwise the next minutia has slid into the spot where current */
-      /* minutia was removed, so don't bump minutia index.               */
+      /* Otherwise the empty slot left behind is skipped on the next */
+      /* pass through the loop.                                      */
    } /* End minutia loop */
 
    /* Return normally. */
@@ -1057,7 +1139,6 @@ static int remove_pointing_invblock_V2(MINUTIAE *minutiae,
    int i, ret;
    int delta_x, delta_y, dmapval;
    int nx, ny, bx, by;
-   MINUTIA *minutia;
    double pi_factor, theta;
    double dx, dy;
 
@@ -1069,10 +1150,14 @@ static int remove_pointing_invblock_V2(MINUTIAE *minutiae,
    i = 0;
    /* Foreach minutia remaining in list ... */
    while(i < minutiae->num){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA){
+         i++;
+         continue;
+      }
       /* Set temporary minutia pointer. */
-      minutia = minutiae->list[i];
       /* Convert minutia's direction to radians. */
-      theta = minutia->direction * pi_factor;
+      theta = minutiae->direction[i] * pi_factor;
       /* Compute translation offsets (ex. 6 pixels). */
       dx = sin(theta) * (double)(lfsparms->trans_dir_pix);
       dy = cos(theta) * (double)(lfsparms->trans_dir_pix);
@@ -1083,8 +1168,8 @@ static int remove_pointing_invblock_V2(MINUTIAE *minutiae,
       delta_x = sround(dx);
       delta_y = sround(dy);
       /* Translate the minutia's coords. */
-      nx = minutia->x - delta_x;
-      ny = minutia->y + delta_y;
+      nx = minutiae->x[i] - delta_x;
+      ny = minutiae->y[i] + delta_y;
       /* Convert pixel coords to block coords. */
       bx = (int)(nx / lfsparms->blocksize);
       by = (int)(ny / lfsparms->blocksize);
@@ -1102,13 +1187,13 @@ static int remove_pointing_invblock_V2(MINUTIAE *minutiae,
       /* If the block's direction is INVALID ... */
       if(dmapval == INVALID_DIR){
 
-         print2log("%d,%d RM\n", minutia->x, minutia->y);
+         print2log("%d,%d RM\n", minutiae->x[i], minutiae->y[i]);
 
          /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
+         if((ret = tombstone_minutia(i, minutiae))){
             return(ret);
          }
-         /* No need to advance because next minutia has slid into slot. */
+         /* No need to advance, the empty slot is skipped next time. */
       }
       else{
          /* Advance to next minutia in list. */
@@ -1147,7 +1232,6 @@ static int remove_overlaps(MINUTIAE *minutiae,
    int *to_remove;
    int i, f, s, ret;
    int delta_y, full_ndirs, qtr_ndirs, deltadir, min_deltadir;
-   MINUTIA *minutia1, *minutia2;
    double dist;
    int joindir, opp1dir, half_ndirs;
 
@@ -1158,7 +1242,7 @@ static int remove_overlaps(MINUTIAE *minutiae,
    /* "calloc" initializes the list to FALSE.                          */
    to_remove = (int *)calloc(minutiae->num, sizeof(int));
    if(to_remove == (int *)NULL){
-      fprintf(stderr, "ERROR : remove_overlaps : calloc : to_remove\n");
+      print2err("ERROR : remove_overlaps : calloc : to_remove\n");
       return(-650);
    }
 
@@ -1180,23 +1264,29 @@ static int remove_overlaps(MINUTIAE *minutiae,
    f = 0;
    /* Foreach primary (first) minutia (except for last one in list) ... */
    while(f < minutiae->num-1){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[f] == REMOVED_MINUTIA){
+         f++;
+         continue;
+      }
 
       /* If current first minutia not previously set to be removed. */
       if(!to_remove[f]){
 
          print2log("\n");
 
-         /* Set first minutia to temporary pointer. */
-         minutia1 = minutiae->list[f];
          /* Foreach secondary (second) minutia to right of first minutia ... */
          s = f+1;
          while(s < minutiae->num){
-            /* Set second minutia to temporary pointer. */
-            minutia2 = minutiae->list[s];
+            /* Skip minutiae removed by earlier tests. */
+            if(minutiae->type[s] == REMOVED_MINUTIA){
+               s++;
+               continue;
+            }
 
             print2log("1:%d(%d,%d)%d 2:%d(%d,%d)%d ",
-                      f, minutia1->x, minutia1->y, minutia1->type,
-                      s, minutia2->x, minutia2->y, minutia2->type);
+                      f, minutiae->x[f], minutiae->y[f], minutiae->type[f],
+                      s, minutiae->x[s], minutiae->y[s], minutiae->type[s]);
 
             /* The binary image is potentially being edited during each */
             /* iteration of the secondary minutia loop, therefore       */
@@ -1204,14 +1294,16 @@ static int remove_overlaps(MINUTIAE *minutiae,
             /* these events by using the next 2 tests.                  */
 
             /* If the first minutia's pixel has been previously changed... */
-            if(*(bdata+(minutia1->y*iw)+minutia1->x) != minutia1->type){
+            if(*(bdata+(minutiae->y[f]*iw)+minutiae->x[f]) !=
+               minutiae->type[f]){
                print2log("\n");
                /* Then break out of secondary loop and skip to next first. */
                break;
             }
 
             /* If the second minutia's pixel has been previously changed... */
-            if(*(bdata+(minutia2->y*iw)+minutia2->x) != minutia2->type)
+            if(*(bdata+(minutiae->y[s]*iw)+minutiae->x[s]) !=
+               minutiae->type[s])
                /* Set to remove second minutia. */
                to_remove[s] = TRUE;
 
@@ -1219,15 +1311,15 @@ static int remove_overlaps(MINUTIAE *minutiae,
             if(!to_remove[s]){
 
                /* Compute delta y between 1st & 2nd minutiae and test. */
-               delta_y = minutia2->y - minutia1->y;
+               delta_y = minutiae->y[s] - minutiae->y[f];
                /* If delta y small enough (ex. < 8 pixels) ... */
                if(delta_y <= lfsparms->max_overlap_dist){
 
                   print2log("1DY ");
 
                   /* Compute Euclidean distance between 1st & 2nd mintuae. */
-                  dist = distance(minutia1->x, minutia1->y,
-                                  minutia2->x, minutia2->y);
+                  dist = distance(minutiae->x[f], minutiae->y[f],
+                                  minutiae->x[s], minutiae->y[s]);
                   /* If distance is NOT too large (ex. < 8 pixels) ... */
                   if(dist <= lfsparms->max_overlap_dist){
 
@@ -1235,11 +1327,11 @@ static int remove_overlaps(MINUTIAE *minutiae,
 
                      /* Compute "inner" difference between directions on */
                      /* a full circle and test.                          */
-                     if((deltadir = closest_dir_dist(minutia1->direction,
-                                    minutia2->direction, full_ndirs)) ==
+                     if((deltadir = closest_dir_dist(minutiae->direction[f],
+                                    minutiae->direction[s], full_ndirs)) ==
                                     INVALID_DIR){
                         free(to_remove);
-                        fprintf(stderr,
+                        print2err(
                            "ERROR : remove_overlaps : INVALID direction\n");
                         return(-651);
                      }
@@ -1251,19 +1343,20 @@ static int remove_overlaps(MINUTIAE *minutiae,
                         print2log("3DD ");
 
                         /* If 1st & 2nd minutiae are same type ... */
-                        if(minutia1->type == minutia2->type){
+                        if(minutiae->type[f] == minutiae->type[s]){
                            /* Test to see if both are on opposite sides */
                            /* of an overlap.                            */
 
                            /* Compute direction of "joining" vector.      */
                            /* First, compute direction of line from first */
                            /* to second minutia points.                   */
-                           joindir = line2direction(minutia1->x, minutia1->y,
-                                                    minutia2->x, minutia2->y,
-                                                    lfsparms->num_directions);
+                           joindir = line2direction(
+                                          minutiae->x[f], minutiae->y[f],
+                                          minutiae->x[s], minutiae->y[s],
+                                          lfsparms->num_directions);
 
                            /* Comptue opposite direction of first minutia. */
-                           opp1dir = (minutia1->direction+
+                           opp1dir = (minutiae->direction[f]+
                                       lfsparms->num_directions)%full_ndirs;
                            /* Take "inner" distance on full circle between */
                            /* the first minutia's opposite direction and   */
@@ -1278,8 +1371,8 @@ static int remove_overlaps(MINUTIAE *minutiae,
                            /*    a free path exists between pair ...     */
                            if(((joindir <= half_ndirs) ||
                                (dist <= lfsparms->max_overlap_join_dist)) &&
-                               free_path(minutia1->x, minutia1->y,
-                                         minutia2->x, minutia2->y,
+                               free_path(minutiae->x[f], minutiae->y[f],
+                                         minutiae->x[s], minutiae->y[s],
                                          bdata, iw, ih, lfsparms)){
 
                               print2log("4OV RM\n");
@@ -1336,7 +1429,7 @@ static int remove_overlaps(MINUTIAE *minutiae,
       /* If the current minutia index is flagged for removal ... */
       if(to_remove[i]){
          /* Remove the minutia from the minutiae list. */
-         if((ret = remove_minutia(i, minutiae))){
+         if((ret = tombstone_minutia(i, minutiae))){
             free(to_remove);
             return(ret);
          }
@@ -1385,7 +1478,6 @@ static int remove_pores_V2(MINUTIAE *minutiae,
    int rx, ry;
    int px, py, pex, pey, bx, by, dx, dy;
    int qx, qy, qex, qey, ax, ay, cx, cy;
-   MINUTIA *minutia;
    double pi_factor, theta, sin_theta, cos_theta;
    double ab2, cd2, ratio;
    int *contour_x, *contour_y, *contour_ex, *contour_ey, ncontour;
@@ -1431,15 +1523,19 @@ static int remove_pores_V2(MINUTIAE *minutiae,
    i = 0;
    /* Foreach minutia remaining in the list ... */
    while(i < minutiae->num){
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA){
+         i++;
+         continue;
+      }
       /* Set temporary minutia pointer. */
-      minutia = minutiae->list[i];
 
       /* Initialize remove flag to FALSE. */
       removed = FALSE;
 
       /* Compute block coords from minutia point. */
-      blk_x = minutia->x / lfsparms->blocksize;
-      blk_y = minutia->y / lfsparms->blocksize;
+      blk_x = minutiae->x[i] / lfsparms->blocksize;
+      blk_y = minutiae->y[i] / lfsparms->blocksize;
 
       /* If minutia in LOW RIDGE FLOW or HIGH CURVATURE block */
       /* with a valid direction ...                           */
@@ -1447,15 +1543,15 @@ static int remove_pores_V2(MINUTIAE *minutiae,
           *(high_curve_map+(blk_y*mw)+blk_x)) &&
          (*(direction_map+(blk_y*mw)+blk_x) >= 0)){
          /* Compute radian angle from minutia direction. */
-         theta = (double)minutia->direction * pi_factor;
+         theta = (double)minutiae->direction[i] * pi_factor;
          /* Compute sine and cosine factors of this angle. */
          sin_theta = sin(theta);
          cos_theta = cos(theta);
          /* Translate the minutia point (ex. 3 pixels) in opposite */
          /* direction minutia is pointing.  Call this point 'R'.   */
-         drx = (double)minutia->x -
+         drx = (double)minutiae->x[i] -
                      (sin_theta * (double)lfsparms->pores_trans_r);
-         dry = (double)minutia->y +
+         dry = (double)minutiae->y[i] +
                      (cos_theta * (double)lfsparms->pores_trans_r);
          /* Need to truncate precision so that answers are consistent */
          /* on different computer architectures when rounding doubles. */
@@ -1465,7 +1561,7 @@ static int remove_pores_V2(MINUTIAE *minutiae,
          ry = sround(dry);
 
          /* If 'R' is opposite color from minutia type ... */
-         if(*(bdata+(ry*iw)+rx) != minutia->type){
+         if(*(bdata+(ry*iw)+rx) != minutiae->type[i]){
 
             /* Search a specified number of steps (ex. 12) from 'R' in a */
             /* perpendicular direction from the minutia direction until  */
@@ -1473,7 +1569,7 @@ static int remove_pores_V2(MINUTIAE *minutiae,
             /* found within the specified number of steps, then call     */
             /* this point 'P' (storing the point's edge pixel as well).  */
             if(search_in_direction(&px, &py, &pex, &pey,
-                                   minutia->type,
+                                   minutiae->type[i],
                                    rx, ry, -cos_theta, -sin_theta,
                                    lfsparms->pores_perp_steps,
                                    bdata, iw, ih)){
@@ -1503,10 +1599,10 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                      free_contour(contour_x, contour_y,
                                   contour_ex, contour_ey);
 
-                  print2log("%d,%d RMB\n", minutia->x, minutia->y);
+                  print2log("%d,%d RMB\n", minutiae->x[i], minutiae->y[i]);
 
                   /* Then remove the minutia. */
-                  if((ret = remove_minutia(i, minutiae)))
+                  if((ret = tombstone_minutia(i, minutiae)))
                      /* If system error, return error code. */
                      return(ret);
                   /* Set remove flag to TRUE. */
@@ -1547,10 +1643,10 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                         free_contour(contour_x, contour_y,
                                      contour_ex, contour_ey);
 
-                     print2log("%d,%d RMD\n", minutia->x, minutia->y);
+                     print2log("%d,%d RMD\n", minutiae->x[i], minutiae->y[i]);
 
                      /* Then remove the minutia. */
-                     if((ret = remove_minutia(i, minutiae)))
+                     if((ret = tombstone_minutia(i, minutiae)))
                         /* If system error, return error code. */
                         return(ret);
                      /* Set remove flag to TRUE. */
@@ -1571,7 +1667,7 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                      /* of steps, then call this point 'Q' (storing the  */
                      /* point's edge pixel as well).                     */
                      if(search_in_direction(&qx, &qy, &qex, &qey,
-                                            minutia->type,
+                                            minutiae->type[i],
                                             rx, ry, cos_theta, sin_theta,
                                             lfsparms->pores_perp_steps,
                                             bdata, iw, ih)){
@@ -1602,10 +1698,11 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                               free_contour(contour_x, contour_y,
                                            contour_ex, contour_ey);
 
-                           print2log("%d,%d RMA\n", minutia->x, minutia->y);
+                           print2log("%d,%d RMA\n",
+                                     minutiae->x[i], minutiae->y[i]);
 
                            /* Then remove the minutia. */
-                           if((ret = remove_minutia(i, minutiae)))
+                           if((ret = tombstone_minutia(i, minutiae)))
                               /* If system error, return error code. */
                               return(ret);
                            /* Set remove flag to TRUE. */
@@ -1648,10 +1745,10 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                                               contour_ex, contour_ey);
 
                               print2log("%d,%d RMC\n",
-                                        minutia->x, minutia->y);
+                                        minutiae->x[i], minutiae->y[i]);
 
                               /* Then remove the minutia. */
-                              if((ret = remove_minutia(i, minutiae)))
+                              if((ret = tombstone_minutia(i, minutiae)))
                                  /* If system error, return error code. */
                                  return(ret);
                               /* Set remove flag to TRUE. */
@@ -1682,13 +1779,13 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                                  if(ratio <= lfsparms->pores_max_ratio){
 
                                     print2log("%d,%d ",
-                                              minutia->x, minutia->y);
+                                              minutiae->x[i], minutiae->y[i]);
       print2log("R=%d,%d P=%d,%d B=%d,%d D=%d,%d Q=%d,%d A=%d,%d C=%d,%d ",
               rx, ry, px, py, bx, by, dx, dy, qx, qy, ax, ay, cx, cy);
                                     print2log("RMRATIO %f\n", ratio);
 
                                     /* Then assume pore & remove minutia. */
-                                    if((ret = remove_minutia(i, minutiae)))
+                                    if((ret = tombstone_minutia(i, minutiae)))
                                        /* If system error, return code. */
                                        return(ret);
                                     /* Set remove flag to TRUE. */
@@ -1703,10 +1800,11 @@ static int remove_pores_V2(MINUTIAE *minutiae,
                      /* Otherwise, Q not found ... */
                      else{
 
-                        print2log("%d,%d RMQ\n", minutia->x, minutia->y);
+                        print2log("%d,%d RMQ\n",
+                                  minutiae->x[i], minutiae->y[i]);
 
                         /* Then remove the minutia. */
-                        if((ret = remove_minutia(i, minutiae)))
+                        if((ret = tombstone_minutia(i, minutiae)))
                            /* If system error, return error code. */
                            return(ret);
                         /* Set remove flag to TRUE. */
@@ -1718,10 +1816,10 @@ static int remove_pores_V2(MINUTIAE *minutiae,
             /* Otherwise, P not found ... */
             else{
 
-               print2log("%d,%d RMP\n", minutia->x, minutia->y);
+               print2log("%d,%d RMP\n", minutiae->x[i], minutiae->y[i]);
 
                /* Then remove the minutia. */
-               if((ret = remove_minutia(i, minutiae)))
+               if((ret = tombstone_minutia(i, minutiae)))
                   /* If system error, return error code. */
                   return(ret);
                /* Set remove flag to TRUE. */
@@ -1735,7 +1833,7 @@ static int remove_pores_V2(MINUTIAE *minutiae,
       if(!removed)
          /* Bump to next minutia in list. */
          i++;
-      /* Otherwise, next minutia has slid into slot of current removed one. */
+      /* Otherwise, the empty slot left behind is skipped next time. */
 
    } /* End While minutia remaining in list. */
 
@@ -1771,7 +1869,6 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
                  const LFSPARMS *lfsparms)
 {
    int i, j, ret;
-   MINUTIA *minutia;
    double pi_factor, theta, sin_theta, cos_theta;
    int *contour_x, *contour_y, *contour_ex, *contour_ey, ncontour;
    int *rot_y, minloc;
@@ -1785,7 +1882,7 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
    /* minutia's contour.                                       */
    rot_y = (int *)malloc(((lfsparms->side_half_contour<<1)+1) * sizeof(int));
    if(rot_y == (int *)NULL){
-      fprintf(stderr,
+      print2err(
               "ERROR : remove_or_adjust_side_minutiae_V2 : malloc : rot_y\n");
       return(-630);
    }
@@ -1796,15 +1893,19 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
    i = 0;
    /* Foreach minutia remaining in list ... */
    while(i < minutiae->num){
-      /* Assign a temporary pointer. */
-      minutia = minutiae->list[i];
+      /* Skip minutiae removed by earlier tests. */
+      if(minutiae->type[i] == REMOVED_MINUTIA){
+         i++;
+         continue;
+      }
 
       /* Extract a contour centered on the minutia point (ex. 7 pixels */
       /* in both directions).                                          */
       ret = get_centered_contour(&contour_x, &contour_y,
                          &contour_ex, &contour_ey, &ncontour,
                          lfsparms->side_half_contour,
-                         minutia->x, minutia->y, minutia->ex, minutia->ey,
+                         minutiae->x[i], minutiae->y[i],
+                         minutiae->ex[i], minutiae->ey[i],
                          bdata, iw, ih);
 
       /* If system error occurred ... */
@@ -1821,17 +1922,17 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
          (ret == IGNORE) ||
          (ret == INCOMPLETE)){
 
-         print2log("%d,%d RM1\n", minutia->x, minutia->y);
+         print2log("%d,%d RM1\n", minutiae->x[i], minutiae->y[i]);
 
          /* Remove minutia from list. */
-         if((ret = remove_minutia(i, minutiae))){
+         if((ret = tombstone_minutia(i, minutiae))){
             /* Deallocate working memory. */
             free(rot_y);
             /* Return error code. */
             return(ret);
          }
-         /* No need to advance because next minutia has "slid" */
-         /* into position pointed to by 'i'.                   */
+         /* No need to advance, the empty slot left behind is */
+         /* skipped on the next pass through the loop.         */
       }
       /* Otherwise, a complete contour was found and extracted ... */
       else{
@@ -1857,7 +1958,7 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
          /*         ry = x*sin(T) - y*cos(T)                  */
 
          /* Convert minutia's direction to radians. */
-         theta = (double)minutia->direction * pi_factor;
+         theta = (double)minutiae->direction[i] * pi_factor;
          /* Compute sine and cosine values at theta for rotation. */
          sin_theta = sin(theta);
          cos_theta = cos(theta);
@@ -1890,20 +1991,20 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
          if((minmax_num == 1) &&
             (minmax_type[0] == -1)){
 
-            print2log("%d,%d ", minutia->x, minutia->y);
+            print2log("%d,%d ", minutiae->x[i], minutiae->y[i]);
 
             /* Reset loation of minutia point to contour point at minima. */
-            minutia->x = contour_x[minmax_i[0]];
-            minutia->y = contour_y[minmax_i[0]];
-            minutia->ex = contour_ex[minmax_i[0]];
-            minutia->ey = contour_ey[minmax_i[0]];
+            minutiae->x[i] = contour_x[minmax_i[0]];
+            minutiae->y[i] = contour_y[minmax_i[0]];
+            minutiae->ex[i] = contour_ex[minmax_i[0]];
+            minutiae->ey[i] = contour_ey[minmax_i[0]];
 
             /* Must check if adjusted minutia is now in INVALID block ... */
-            bx = minutia->x/lfsparms->blocksize;
-            by = minutia->y/lfsparms->blocksize;
+            bx = minutiae->x[i]/lfsparms->blocksize;
+            by = minutiae->y[i]/lfsparms->blocksize;
             if(*(direction_map+(by*mw)+bx) == INVALID_DIR){
                /* Remove minutia from list. */
-               if((ret = remove_minutia(i, minutiae))){
+               if((ret = tombstone_minutia(i, minutiae))){
                   /* Deallocate working memory. */
                   free(rot_y);
                   free_contour(contour_x, contour_y, contour_ex, contour_ey);
@@ -1915,15 +2016,15 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
                   /* Return error code. */
                   return(ret);
                }
-               /* No need to advance because next minutia has "slid" */
-               /* into position pointed to by 'i'.                   */
+               /* No need to advance, the empty slot left behind is */
+               /* skipped on the next pass through the loop.         */
 
                print2log("RM2\n");
             }
             else{
                /* Advance to the next minutia in the list. */
                i++;
-               print2log("AD1 %d,%d\n", minutia->x, minutia->y);
+               print2log("AD1 %d,%d\n", minutiae->x[i], minutiae->y[i]);
             }
 
          }
@@ -1936,20 +2037,20 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
             else
                minloc = minmax_i[2];
 
-            print2log("%d,%d ", minutia->x, minutia->y);
+            print2log("%d,%d ", minutiae->x[i], minutiae->y[i]);
 
             /* Reset loation of minutia point to contour point at minima. */
-            minutia->x = contour_x[minloc];
-            minutia->y = contour_y[minloc];
-            minutia->ex = contour_ex[minloc];
-            minutia->ey = contour_ey[minloc];
+            minutiae->x[i] = contour_x[minloc];
+            minutiae->y[i] = contour_y[minloc];
+            minutiae->ex[i] = contour_ex[minloc];
+            minutiae->ey[i] = contour_ey[minloc];
 
             /* Must check if adjusted minutia is now in INVALID block ... */
-            bx = minutia->x/lfsparms->blocksize;
-            by = minutia->y/lfsparms->blocksize;
+            bx = minutiae->x[i]/lfsparms->blocksize;
+            by = minutiae->y[i]/lfsparms->blocksize;
             if(*(direction_map+(by*mw)+bx) == INVALID_DIR){
                /* Remove minutia from list. */
-               if((ret = remove_minutia(i, minutiae))){
+               if((ret = tombstone_minutia(i, minutiae))){
                   /* Deallocate working memory. */
                   free(rot_y);
                   free_contour(contour_x, contour_y, contour_ex, contour_ey);
@@ -1961,24 +2062,24 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
                   /* Return error code. */
                   return(ret);
                }
-               /* No need to advance because next minutia has "slid" */
-               /* into position pointed to by 'i'.                   */
+               /* No need to advance, the empty slot left behind is */
+               /* skipped on the next pass through the loop.         */
 
                print2log("RM3\n");
             }
             else{
                /* Advance to the next minutia in the list. */
                i++;
-               print2log("AD2 %d,%d\n", minutia->x, minutia->y);
+               print2log("AD2 %d,%d\n", minutiae->x[i], minutiae->y[i]);
             }
          }
          /* Otherwise, ... */
          else{
 
-            print2log("%d,%d RM4\n", minutia->x, minutia->y);
+            print2log("%d,%d RM4\n", minutiae->x[i], minutiae->y[i]);
 
             /* Remove minutia from list. */
-            if((ret = remove_minutia(i, minutiae))){
+            if((ret = tombstone_minutia(i, minutiae))){
                /* If system error, then deallocate working memories. */
                free(rot_y);
                free_contour(contour_x, contour_y, contour_ex, contour_ey);
@@ -1990,8 +2091,8 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
                /* Return error code. */
                return(ret);
             }
-            /* No need to advance because next minutia has "slid" */
-            /* into position pointed to by 'i'.                   */
+            /* No need to advance, the empty slot left behind is */
+            /* skipped on the next pass through the loop.         */
          }
 
          /* Deallocate contour and min/max buffers. */
@@ -2013,28 +2114,11 @@ static int remove_or_adjust_side_minutiae_V2(MINUTIAE *minutiae,
 
 /*************************************************************************
 **************************************************************************
-#cat: remove_false_minutia_V2 - Takes a list of true and false minutiae and
-#cat:                attempts to detect and remove the false minutiae based
-#cat:                on a series of tests.
+#cat: remove_false_minutia_tests - Runs the tests of remove_false_minutia_V2()
+#cat:                in turn. Removed minutiae leave empty slots in the list.
 
-   Input:
-      minutiae  - list of true and false minutiae
-      bdata     - binary image data (0==while & 1==black)
-      iw        - width (in pixels) of image
-      ih        - height (in pixels) of image
-      direction_map  - map of image blocks containing directional ridge flow
-      low_flow_map   - map of image blocks flagged as LOW RIDGE FLOW
-      high_curve_map - map of image blocks flagged as HIGH CURVATURE
-      mw        - width in blocks of the maps
-      mh        - height in blocks of the maps
-      lfsparms  - parameters and thresholds for controlling LFS
-   Output:
-      minutiae  - list of pruned minutiae
-   Return Code:
-      Zero     - successful completion
-      Negative - system error
 **************************************************************************/
-int remove_false_minutia_V2(MINUTIAE *minutiae,
+static int remove_false_minutia_tests(MINUTIAE *minutiae,
            unsigned char *bdata, const int iw, const int ih,
            int *direction_map, int *low_flow_map, int *high_curve_map,
            const int mw, const int mh, const LFSPARMS *lfsparms)
@@ -2107,3 +2191,43 @@ int remove_false_minutia_V2(MINUTIAE *minutiae,
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: remove_false_minutia_V2 - Takes a list of true and false minutiae and
+#cat:                attempts to detect and remove the false minutiae based
+#cat:                on a series of tests.
+
+   Input:
+      minutiae  - list of true and false minutiae
+      bdata     - binary image data (0==while & 1==black)
+      iw        - width (in pixels) of image
+      ih        - height (in pixels) of image
+      direction_map  - map of image blocks containing directional ridge flow
+      low_flow_map   - map of image blocks flagged as LOW RIDGE FLOW
+      high_curve_map - map of image blocks flagged as HIGH CURVATURE
+      mw        - width in blocks of the maps
+      mh        - height in blocks of the maps
+      lfsparms  - parameters and thresholds for controlling LFS
+   Output:
+      minutiae  - list of pruned minutiae
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int remove_false_minutia_V2(MINUTIAE *minutiae,
+           unsigned char *bdata, const int iw, const int ih,
+           int *direction_map, int *low_flow_map, int *high_curve_map,
+           const int mw, const int mh, const LFSPARMS *lfsparms)
+{
+   int ret;
+
+   ret = remove_false_minutia_tests(minutiae, bdata, iw, ih,
+                                    direction_map, low_flow_map,
+                                    high_curve_map, mw, mh, lfsparms);
+
+   /* Close the gaps left by the tests, also on error, so that the */
+   /* list can be deallocated as usual.                            */
+   compact_minutiae(minutiae);
+
+   return(ret);
+}
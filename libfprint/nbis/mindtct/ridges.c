@@ -37,7 +37,10 @@ identified are necessarily the best available for the purpose.
                ROUTINES:
                         count_minutiae_ridges()
                         count_minutia_ridges()
+                        alloc_ridge_scratch()
+                        free_ridge_scratch()
                         find_neighbors()
+                        find_grid_neighbors()
                         update_nbr_dists()
                         insert_neighbor()
                         sort_neighbors()
@@ -47,9 +50,32 @@ identified are necessarily the best available for the purpose.
 ***********************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <lfs.h>
 #include <log.h>
 
+/* Size (in pixels) of the square cells minutiae are binned in when */
+/* looking for neighbors.                                           */
+#define NBR_GRID_CELL   32
+
+/* Working memory reused while finding neighbors and counting ridges */
+/* for a list of minutiae.                                           */
+typedef struct ridge_scratch{
+   /* Minutiae binned in a grid of cells, by increasing index.    */
+   /* The minutiae in cell c are cell_items[cell_start[c]] up to  */
+   /* (not including) cell_items[cell_start[c+1]].                */
+   int gw, gh;
+   int *cell_start;
+   int *cell_items;
+   /* Neighbors found so far for the current primary minutia. */
+   int *nbr_list;
+   double *nbr_sqr_dists;
+   /* Line trajectory between 2 minutiae and its pixel values. */
+   int *xlist, *ylist;
+   unsigned char *pix;
+   int asize;
+} RIDGE_SCRATCH;
+
 /*************************************************************************
 **************************************************************************
 #cat: insert_neighbor - Takes a minutia index and its squared distance to a
@@ -85,7 +111,7 @@ static int insert_neighbor(const int pos, const int nbr_index, const double nbr_
    /* NOTE: pos is zero-oriented while nnbrs and max_nbrs are 1-oriented. */
    if((pos > *nnbrs) ||
       (pos >= max_nbrs)){
-      fprintf(stderr,
+      print2err(
               "ERROR : insert_neighbor : insertion point exceeds lists\n");
       return(-480);
    }
@@ -105,7 +131,7 @@ static int insert_neighbor(const int pos, const int nbr_index, const double nbr_
    /* Otherwise, there is a list overflow error condition */
    /* (shouldn't ever happen, but just in case) ...       */
    else{
-      fprintf(stderr,
+      print2err(
               "ERROR : insert_neighbor : overflow in neighbor lists\n");
       return(-481);
    }
@@ -134,7 +160,8 @@ static int insert_neighbor(const int pos, const int nbr_index, const double nbr_
 #cat:               determines if the new neighbor is sufficiently close
 #cat:               to be added to the list of nearest neighbors.  If added,
 #cat:               it is placed in the list in its proper order based on
-#cat:               squared distance to the primary point.
+#cat:               squared distance to the primary point, and on minutia
+#cat:               index between neighbors at the same distance.
 
    Input:
       nbr_list - current list of nearest neighbor minutia indices
@@ -158,32 +185,30 @@ static int update_nbr_dists(int *nbr_list, double *nbr_sqr_dists,
                       const int first, const int second, MINUTIAE *minutiae)
 {
    double dist2;
-   MINUTIA *minutia1, *minutia2;
-   int pos, last_nbr;
-
-   /* Compute position of maximum last neighbor stored. */
-   last_nbr = max_nbrs - 1;
-
-   /* Assigne temporary minutia pointers. */
-   minutia1 = minutiae->list[first];
-   minutia2 = minutiae->list[second];
+   int pos;
 
    /* Compute squared euclidean distance between minutia pair. */
-   dist2 = squared_distance(minutia1->x, minutia1->y,
-                            minutia2->x, minutia2->y);
+   dist2 = squared_distance(minutiae->x[first], minutiae->y[first],
+                            minutiae->x[second], minutiae->y[second]);
+
+   /* Find insertion point in neighbor lists.  Neighbors are      */
+   /* visited in no particular order, so ties on distance go to   */
+   /* the lower index, as they would scanning the sorted list.    */
+   for(pos = 0; pos < *nnbrs; pos++){
+      if((dist2 < nbr_sqr_dists[pos]) ||
+         ((dist2 == nbr_sqr_dists[pos]) && (second < nbr_list[pos])))
+         break;
+   }
 
    /* If maximum number of neighbors not yet stored in lists OR */
-   /* if the squared distance to current secondary is less      */
-   /* than the largest stored neighbor distance ...             */
+   /* if the current secondary goes before the last stored     */
+   /* neighbor ...                                              */
    if((*nnbrs < max_nbrs) ||
-      (dist2 < nbr_sqr_dists[last_nbr])){
-
-      /* Find insertion point in neighbor lists. */
-      pos = find_incr_position_dbl(dist2, nbr_sqr_dists, *nnbrs);
+      (pos < *nnbrs)){
       /* If the position returned is >= maximum list length (this should */
       /* never happen, but just in case) ...                             */
       if(pos >= max_nbrs){
-         fprintf(stderr, 
+         print2err(
          "ERROR : update_nbr_dists : illegal position for new neighbor\n");
          return(-470);
       }
@@ -204,6 +229,80 @@ static int update_nbr_dists(int *nbr_list, double *nbr_sqr_dists,
 
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: find_grid_neighbors - Takes a primary minutia and a list of all
+#cat:               minutiae binned in a grid, and locates a specified
+#cat:               maximum number of closest neighbors to the primary point
+#cat:               among the minutiae after it in the list.  The cells of
+#cat:               the grid are searched in growing rings around the cell
+#cat:               of the primary point.
+
+   Input:
+      max_nbrs - maximum number of closest neighbors to be returned
+      first    - index of the primary minutia point
+      minutiae - list of minutiae, sorted on x then y
+      scratch  - working memory, with the minutiae binned in its grid
+   Output:
+      scratch  - closest neighbors and their squared distances
+   Return Code:
+      Zero or Positive - number of neighbors found
+      Negative         - system error
+**************************************************************************/
+static int find_grid_neighbors(const int max_nbrs, const int first,
+                   MINUTIAE *minutiae, RIDGE_SCRATCH *scratch)
+{
+   int ret, second, nnbrs;
+   int x, y, cx, cy, gx, gy, r, c, i, dmin;
+
+   /* Initialize number of stored neighbors to 0. */
+   nnbrs = 0;
+
+   x = minutiae->x[first];
+   y = minutiae->y[first];
+   cx = x / NBR_GRID_CELL;
+   cy = y / NBR_GRID_CELL;
+
+   /* The minutiae after the primary one lie below it in the same */
+   /* pixel column or in columns to the right of it, so cells to  */
+   /* the left of the primary one are never searched.             */
+   for(r = 0; r < max(scratch->gw, scratch->gh); r++){
+      /* Foreach cell in the right half of the ring r cells away ... */
+      for(gx = cx; (gx <= cx + r) && (gx < scratch->gw); gx++){
+         for(gy = max(0, cy - r); (gy <= cy + r) && (gy < scratch->gh); gy++){
+            if((gx != cx + r) && (gy != cy - r) && (gy != cy + r))
+               continue;
+
+            c = (gy * scratch->gw) + gx;
+            for(i = scratch->cell_start[c]; i < scratch->cell_start[c+1]; i++){
+               second = scratch->cell_items[i];
+               if(second <= first)
+                  continue;
+               /* Append or insert the new neighbor into the neighbor */
+               /* lists.                                              */
+               if((ret = update_nbr_dists(scratch->nbr_list,
+                                scratch->nbr_sqr_dists, &nnbrs, max_nbrs,
+                                first, second, minutiae)))
+                  return(ret);
+            }
+         }
+      }
+
+      /* If the neighbor lists are full AND no minutia beyond this ring */
+      /* can be closer than the farthest neighbor stored ...            */
+      if(nnbrs == max_nbrs){
+         dmin = min(((cx + r + 1) * NBR_GRID_CELL) - x,
+                    min(y - ((cy - r) * NBR_GRID_CELL) + 1,
+                        ((cy + r + 1) * NBR_GRID_CELL) - y));
+         if((double)dmin * dmin > scratch->nbr_sqr_dists[max_nbrs-1])
+            /* So, stop searching for more neighbors. */
+            break;
+      }
+   }
+
+   return(nnbrs);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: find_neighbors - Takes a primary minutia and a list of all minutiae
@@ -217,96 +316,60 @@ static int update_nbr_dists(int *nbr_list, double *nbr_sqr_dists,
       max_nbrs - maximum number of closest neighbors to be returned
       first    - index of the primary minutia point
       minutiae - list of minutiae
+      scratch  - working memory, with the minutiae binned in its grid
+                 if they are sorted on x then y
    Output:
-      onbr_list - points to list of detected closest neighbors
-      onnbrs    - points to number of neighbors returned
+      onnbrs    - points to number of neighbors found, which are left
+                  in scratch->nbr_list
    Return Code:
       Zero      - successful completion
       Negative  - system error
 **************************************************************************/
-static int find_neighbors(int **onbr_list, int *onnbrs, const int max_nbrs,
-                   const int first, MINUTIAE *minutiae)
+static int find_neighbors(int *onnbrs, const int max_nbrs,
+                   const int first, MINUTIAE *minutiae,
+                   RIDGE_SCRATCH *scratch)
 {
-   int ret, second, last_nbr;
-   MINUTIA *minutia1, *minutia2;
-   int *nbr_list, nnbrs;
-   double *nbr_sqr_dists, xdist, xdist2;
-
-   /* Allocate list of neighbor minutiae indices. */
-   nbr_list = (int *)malloc(max_nbrs * sizeof(int));
-   if(nbr_list == (int *)NULL){
-      fprintf(stderr, "ERROR : find_neighbors : malloc : nbr_list\n");
-      return(-460);
-   }
-
-   /* Allocate list of squared euclidean distances between neighbors */
-   /* and current primary minutia point.                             */
-   nbr_sqr_dists = (double *)malloc(max_nbrs * sizeof(double));
-   if(nbr_sqr_dists == (double *)NULL){
-      free(nbr_list);
-      fprintf(stderr,
-              "ERROR : find_neighbors : malloc : nbr_sqr_dists\n");
-      return(-461);
+   int ret, second, nnbrs;
+   double xdist;
+
+   /* If the minutiae are binned in a grid ... */
+   if(scratch->cell_start != (int *)NULL){
+      nnbrs = find_grid_neighbors(max_nbrs, first, minutiae, scratch);
+      if(nnbrs < 0)
+         return(nnbrs);
    }
+   /* Otherwise, walk the list from the primary minutia on. */
+   else{
+      /* Initialize number of stored neighbors to 0. */
+      nnbrs = 0;
+
+      /* NOTE: The minutia in the input list have been sorted on X and */
+      /* then on Y.  So, the neighbors are selected according to those */
+      /* that lie below the primary minutia in the same pixel column   */
+      /* and then subsequently those that lie in complete pixel        */
+      /* columns to the right of the primary minutia.                  */
+      for(second = first + 1; second < minutiae->num; second++){
+         /* Compute distance between minutiae along x-axis. */
+         xdist = minutiae->x[second] - minutiae->x[first];
+
+         /* If the neighbor lists is full AND the x-distance to current */
+         /* secondary is not smaller than maximum neighbor distance     */
+         /* stored ...                                                  */
+         if((nnbrs == max_nbrs) &&
+            (xdist * xdist >= scratch->nbr_sqr_dists[max_nbrs-1]))
+            /* So, stop searching for more neighbors. */
+            break;
 
-   /* Initialize number of stored neighbors to 0. */
-   nnbrs = 0;
-   /* Assign secondary to one passed current primary minutia. */
-   second = first + 1;
-   /* Compute location of maximum last stored neighbor. */
-   last_nbr = max_nbrs - 1;
-
-   /* While minutia (in sorted order) still remian for processing ... */
-   /* NOTE: The minutia in the input list have been sorted on X and   */
-   /* then on Y.  So, the neighbors are selected according to those   */
-   /* that lie below the primary minutia in the same pixel column and */
-   /* then subsequently those that lie in complete pixel columns to   */
-   /* the right of the primary minutia.                               */
-   while(second < minutiae->num){
-      /* Assign temporary minutia pointers. */
-      minutia1 = minutiae->list[first];
-      minutia2 = minutiae->list[second];
-
-      /* Compute squared distance between minutiae along x-axis. */
-      xdist = minutia2->x - minutia1->x;
-      xdist2 = xdist * xdist;
-
-      /* If the neighbor lists are not full OR the x-distance to current */
-      /* secondary is smaller than maximum neighbor distance stored ...  */
-      if((nnbrs < max_nbrs) ||
-         (xdist2 < nbr_sqr_dists[last_nbr])){
          /* Append or insert the new neighbor into the neighbor lists. */
-         if((ret = update_nbr_dists(nbr_list, nbr_sqr_dists, &nnbrs, max_nbrs,
-                          first, second, minutiae))){
-            free(nbr_sqr_dists);
+         if((ret = update_nbr_dists(scratch->nbr_list, scratch->nbr_sqr_dists,
+                                    &nnbrs, max_nbrs, first, second,
+                                    minutiae)))
             return(ret);
-         }
       }
-      /* Otherwise, if the neighbor lists is full AND the x-distance   */
-      /* to current secondary is larger than maximum neighbor distance */
-      /* stored ...                                                    */
-      else
-         /* So, stop searching for more neighbors. */
-         break;
-
-       /* Bump to next secondary minutia. */
-       second++;
    }
 
-   /* Deallocate working memory. */
-   free(nbr_sqr_dists);
-
-   /* If no neighbors found ... */
-   if(nnbrs == 0){
-      /* Deallocate the neighbor list. */
-      free(nbr_list);
-      *onnbrs = 0;
-   }
-   /* Otherwise, assign neighbors to output pointer. */
-   else{
-      *onbr_list = nbr_list;
-      *onnbrs = nnbrs;
-   }
+   /* Assign number of neighbors to output pointer. */
+   *onnbrs = nnbrs;
 
    /* Return normally. */
    return(0);
@@ -342,7 +405,7 @@ static int sort_neighbors(int *nbr_list, const int nnbrs, const int first,
    /* of the secondary neighbors.                                 */
    join_thetas = (double *)malloc(nnbrs * sizeof(double));
    if(join_thetas == (double *)NULL){
-      fprintf(stderr, "ERROR : sort_neighbors : malloc : join_thetas\n");
+      print2err("ERROR : sort_neighbors : malloc : join_thetas\n");
       return(-490);
    }
 
@@ -351,10 +414,10 @@ static int sort_neighbors(int *nbr_list, const int nnbrs, const int first,
       /* Coordinates are swapped and order of points reversed to    */
       /* account for 0 direction is vertical and positive direction */
       /* is clockwise.                                              */
-      theta = angle2line(minutiae->list[nbr_list[i]]->y,
-                         minutiae->list[nbr_list[i]]->x,
-                         minutiae->list[first]->y,
-                         minutiae->list[first]->x);
+      theta = angle2line(minutiae->y[nbr_list[i]],
+                         minutiae->x[nbr_list[i]],
+                         minutiae->y[first],
+                         minutiae->x[first]);
 
       /* Make sure the angle is positive. */
       theta += pi2;
@@ -363,7 +426,7 @@ static int sort_neighbors(int *nbr_list, const int nnbrs, const int first,
    }
 
    /* Sort the neighbor indicies into rank order. */
-   bubble_sort_double_inc_2(join_thetas, nbr_list, nnbrs);
+   insertion_sort_double_inc_2(join_thetas, nbr_list, nnbrs);
 
    /* Deallocate the list of angles. */
    free(join_thetas);
@@ -383,12 +446,8 @@ static int sort_neighbors(int *nbr_list, const int nnbrs, const int first,
       iptr  - pointer to starting pixel index into trajectory
       pix1  - first pixel value in transition pair
       pix2  - second pixel value in transition pair
-      xlist - x-pixel coords of line trajectory
-      ylist - y-pixel coords of line trajectory
-      num   - number of coords in line trajectory
-      bdata - binary image data (0==while & 1==black)
-      iw    - width (in pixels) of image
-      ih    - height (in pixels) of image
+      pix   - binary pixel values (0==while & 1==black) along trajectory
+      num   - number of pixels in line trajectory
    Output:
       iptr  - points to location where 2nd pixel in pair is found
    Return Code:
@@ -396,8 +455,7 @@ static int sort_neighbors(int *nbr_list, const int nnbrs, const int first,
       FALSE - pixel pair transition not found
 **************************************************************************/
 static int find_transition(int *iptr, const int pix1, const int pix2,
-                    const int *xlist, const int *ylist, const int num,
-                    unsigned char *bdata, const int iw, const int ih)
+                    const unsigned char *pix, const int num)
 {
    int i, j;
 
@@ -409,8 +467,7 @@ static int find_transition(int *iptr, const int pix1, const int pix2,
    /* While not one point from the end of the trajectory .. */
    while(i < num-1){
       /* If we have found the desired transition ... */
-      if((*(bdata+(ylist[i]*iw)+xlist[i]) == pix1) &&
-         (*(bdata+(ylist[j]*iw)+xlist[j]) == pix2)){
+      if((pix[i] == pix1) && (pix[j] == pix2)){
          /* Adjust the position pointer to the location of the */
          /* second pixel in the transition.                    */
          *iptr = j;
@@ -554,52 +611,55 @@ static int validate_ridge_crossing(const int ridge_start, const int ridge_end,
       iw        - width (in pixels) of image
       ih        - height (in pixels) of image
       lfsparms  - parameters and thresholds for controlling LFS
+      scratch   - working memory to hold the line trajectory
    Return Code:
       Zero or Positive - number of ridges counted
       Negative         - system error
 **************************************************************************/
 static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
                 unsigned char *bdata, const int iw, const int ih,
-                const LFSPARMS *lfsparms)
+                const LFSPARMS *lfsparms, RIDGE_SCRATCH *scratch)
 {
-   MINUTIA *minutia1, *minutia2;
    int i, ret, found;
    int *xlist, *ylist, num;
+   unsigned char *pix;
    int ridge_cnt, ridge_start, ridge_end;
-   int prevpix, curpix;
-
-   minutia1 = minutiae->list[first];
-   minutia2 = minutiae->list[second];
+   int prevpix;
 
    /* If the 2 mintuia have identical pixel coords ... */
-   if((minutia1->x == minutia2->x) &&
-      (minutia1->y == minutia2->y))
+   if((minutiae->x[first] == minutiae->x[second]) &&
+      (minutiae->y[first] == minutiae->y[second]))
       /* Then zero ridges between points. */
      return(0);
 
    /* Compute linear trajectory of contiguous pixels between first */
    /* and second minutia points.                                   */
-   if((ret = line_points(&xlist, &ylist, &num,
-                        minutia1->x, minutia1->y, minutia2->x, minutia2->y))){
+   xlist = scratch->xlist;
+   ylist = scratch->ylist;
+   if((ret = fill_line_points(xlist, ylist, scratch->asize, &num,
+                        minutiae->x[first], minutiae->y[first],
+                        minutiae->x[second], minutiae->y[second]))){
       return(ret);
    }
 
    /* It there are no points on the line trajectory, then no ridges */
    /* to count (this should not happen, but just in case) ...       */
-   if(num == 0){
-      free(xlist);
-      free(ylist);
+   if(num == 0)
       return(0);
-   }
+
+   /* Read the pixels along the trajectory once, rather than at each */
+   /* transition test.                                               */
+   pix = scratch->pix;
+   for(i = 0; i < num; i++)
+      pix[i] = *(bdata+(ylist[i]*iw)+xlist[i]);
 
    /* Find first pixel opposite type along linear trajectory from */
    /* first minutia.                                              */
-   prevpix = *(bdata+(ylist[0]*iw)+xlist[0]);
+   prevpix = pix[0];
    i = 1;
    found = FALSE;
    while(i < num){
-      curpix = *(bdata+(ylist[i]*iw)+xlist[i]);
-      if(curpix != prevpix){
+      if(pix[i] != prevpix){
          found = TRUE;
          break;
       }
@@ -607,26 +667,21 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
    }
 
    /* If opposite pixel not found ... then no ridges to count */
-   if(!found){
-      free(xlist);
-      free(ylist);
+   if(!found)
       return(0);
-   }
 
    /* Ready to count ridges, so initialize counter to 0. */
    ridge_cnt = 0;
 
-   print2log("RIDGE COUNT: %d,%d to %d,%d ", minutia1->x, minutia1->y,
-                                               minutia2->x, minutia2->y);
+   print2log("RIDGE COUNT: %d,%d to %d,%d ",
+             minutiae->x[first], minutiae->y[first],
+             minutiae->x[second], minutiae->y[second]);
 
    /* While not at the end of the trajectory ... */
    while(i < num){
       /* If 0-to-1 transition not found ... */
-      if(!find_transition(&i, 0, 1, xlist, ylist, num, bdata, iw, ih)){
+      if(!find_transition(&i, 0, 1, pix, num)){
          /* Then we are done looking for ridges. */
-         free(xlist);
-         free(ylist);
-
          print2log("\n");
 
          /* Return number of ridges counted to this point. */
@@ -639,11 +694,8 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
       print2log(": RS %d,%d ", xlist[i], ylist[i]);
 
       /* If 1-to-0 transition not found ... */
-      if(!find_transition(&i, 1, 0, xlist, ylist, num, bdata, iw, ih)){
+      if(!find_transition(&i, 1, 0, pix, num)){
          /* Then we are done looking for ridges. */
-         free(xlist);
-         free(ylist);
-
          print2log("\n");
 
          /* Return number of ridges counted to this point. */
@@ -667,12 +719,9 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
                                     lfsparms->max_ridge_steps);
 
       /* If system error ... */
-      if(ret < 0){
-         free(xlist);
-         free(ylist);
+      if(ret < 0)
          /* Return the error code. */
          return(ret);
-      }
 
       print2log("; V%d ", ret);
 
@@ -687,10 +736,6 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
       /* and go back and search for new ridge start.                   */
    }
 
-   /* Deallocate working memories. */
-   free(xlist);
-   free(ylist);
-
    print2log("\n");
 
    /* Return the number of ridges counted. */
@@ -702,13 +747,17 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
 #cat: count_minutia_ridges - Takes a minutia, and determines its closest
 #cat:                neighbors and counts the number of interveining ridges
 #cat:                between the minutia point and each of its neighbors.
+#cat:                The results are appended to the list's neighbor arrays,
+#cat:                after those of the minutia before it.
 
    Input:
-      minutia   - input minutia
+      first     - index of the primary minutia point
+      minutiae  - list of minutiae
       bdata     - binary image data (0==while & 1==black)
       iw        - width (in pixels) of image
       ih        - height (in pixels) of image
       lfsparms  - parameters and thresholds for controlling LFS
+      scratch   - working memory, with the minutiae binned in its grid
    Output:
       minutiae  - minutia augmented with neighbors and ridge counts
    Return Code:
@@ -717,50 +766,43 @@ static int ridge_count(const int first, const int second, MINUTIAE *minutiae,
 **************************************************************************/
 static int count_minutia_ridges(const int first, MINUTIAE *minutiae,
                       unsigned char *bdata, const int iw, const int ih,
-                      const LFSPARMS *lfsparms)
+                      const LFSPARMS *lfsparms, RIDGE_SCRATCH *scratch)
 {
-   int i, ret, *nbr_list = NULL, *nbr_nridges, nnbrs;
+   int i, ret, *nbr_list, *nbr_nridges, nnbrs;
 
    /* Find up to the maximum number of qualifying neighbors. */
-   if((ret = find_neighbors(&nbr_list, &nnbrs, lfsparms->max_nbrs,
-                           first, minutiae))){
-      free(nbr_list);
+   if((ret = find_neighbors(&nnbrs, lfsparms->max_nbrs,
+                           first, minutiae, scratch))){
       return(ret);
    }
 
-   print2log("NBRS FOUND: %d,%d = %d\n", minutiae->list[first]->x,
-              minutiae->list[first]->y, nnbrs);
+   print2log("NBRS FOUND: %d,%d = %d\n", minutiae->x[first],
+              minutiae->y[first], nnbrs);
 
    /* If no neighors found ... */
    if(nnbrs == 0){
-      /* Then no list returned and no ridges to count. */
+      /* Then no ridges to count. */
       return(0);
    }
 
+   /* The neighbors and their ridge counts go in the list's arrays. */
+   nbr_list = minutiae->nbrs + minutiae->nbrs_first[first];
+   nbr_nridges = minutiae->ridge_counts + minutiae->nbrs_first[first];
+   memcpy(nbr_list, scratch->nbr_list, nnbrs * sizeof(int));
+
    /* Sort neighbors on delta dirs. */
    if((ret = sort_neighbors(nbr_list, nnbrs, first, minutiae))){
-      free(nbr_list);
       return(ret);
    }
 
    /* Count ridges between first and neighbors. */
-   /* List of ridge counts, one for each neighbor stored. */
-   nbr_nridges = (int *)malloc(nnbrs * sizeof(int));
-   if(nbr_nridges == (int *)NULL){
-      free(nbr_list);
-      fprintf(stderr, "ERROR : count_minutia_ridges : malloc : nbr_nridges\n");
-      return(-450);
-   }
-
    /* Foreach neighbor found and sorted in list ... */
    for(i = 0; i < nnbrs; i++){
       /* Count the ridges between the primary minutia and the neighbor. */
-      ret = ridge_count(first, nbr_list[i], minutiae, bdata, iw, ih, lfsparms);
+      ret = ridge_count(first, nbr_list[i], minutiae, bdata, iw, ih, lfsparms,
+                        scratch);
       /* If system error ... */
       if(ret < 0){
-         /* Deallocate working memories. */
-         free(nbr_list);
-         free(nbr_nridges);
          /* Return error code. */
          return(ret);
       }
@@ -769,15 +811,114 @@ static int count_minutia_ridges(const int first, MINUTIAE *minutiae,
       nbr_nridges[i] = ret;
    }
 
-   /* Assign neighbor indices and ridge counts to primary minutia. */
-   minutiae->list[first]->nbrs = nbr_list;
-   minutiae->list[first]->ridge_counts = nbr_nridges;
-   minutiae->list[first]->num_nbrs = nnbrs;
+   /* Assign number of neighbors to primary minutia. */
+   minutiae->num_nbrs[first] = nnbrs;
+
+   /* Return normally. */
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: alloc_ridge_scratch - Allocates the working memory used to find the
+#cat:                neighbors of and count ridges for a list of minutiae,
+#cat:                and bins the minutiae in its grid if they are sorted
+#cat:                on x then y.
+
+   Input:
+      minutiae  - list of minutiae, sorted on x then y
+      iw        - width (in pixels) of image
+      ih        - height (in pixels) of image
+      max_nbrs  - maximum number of closest neighbors to be returned
+   Output:
+      scratch   - working memory
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+static int alloc_ridge_scratch(RIDGE_SCRATCH *scratch, MINUTIAE *minutiae,
+                      const int iw, const int ih, const int max_nbrs)
+{
+   int i, c, ncells;
+
+   memset(scratch, 0, sizeof(RIDGE_SCRATCH));
+   scratch->gw = (iw + NBR_GRID_CELL - 1) / NBR_GRID_CELL;
+   scratch->gh = (ih + NBR_GRID_CELL - 1) / NBR_GRID_CELL;
+   ncells = scratch->gw * scratch->gh;
+   /* Longest line trajectory between 2 points in the image. */
+   scratch->asize = max(iw, ih) + 1;
+
+   scratch->nbr_list = (int *)malloc(max_nbrs * sizeof(int));
+   scratch->nbr_sqr_dists = (double *)malloc(max_nbrs * sizeof(double));
+   scratch->xlist = (int *)malloc(scratch->asize * sizeof(int));
+   scratch->ylist = (int *)malloc(scratch->asize * sizeof(int));
+   scratch->pix = (unsigned char *)malloc(scratch->asize);
+   if((scratch->nbr_list == (int *)NULL) ||
+      (scratch->nbr_sqr_dists == (double *)NULL) ||
+      (scratch->xlist == (int *)NULL) ||
+      (scratch->ylist == (int *)NULL) ||
+      (scratch->pix == (unsigned char *)NULL)){
+      print2err("ERROR : alloc_ridge_scratch : malloc : scratch\n");
+      return(-455);
+   }
+
+   /* sort_minutiae_x_y() ranks minutiae on x*iw+y, which is only   */
+   /* ordered on x then y if the image is no taller than wide.  The */
+   /* grid relies on that order, so otherwise leave it out.         */
+   if(ih > iw)
+      return(0);
+
+   scratch->cell_start = (int *)calloc(ncells + 1, sizeof(int));
+   scratch->cell_items = (int *)malloc(max(minutiae->num, 1) * sizeof(int));
+   if((scratch->cell_start == (int *)NULL) ||
+      (scratch->cell_items == (int *)NULL)){
+      print2err("ERROR : alloc_ridge_scratch : malloc : cells\n");
+      return(-456);
+   }
+
+   /* Count the minutiae in each cell, turn the counts into the */
+   /* offset of each cell, and then bin the minutiae.           */
+   for(i = 0; i < minutiae->num; i++){
+      c = ((minutiae->y[i] / NBR_GRID_CELL) * scratch->gw) +
+          (minutiae->x[i] / NBR_GRID_CELL);
+      scratch->cell_start[c+1]++;
+   }
+   for(c = 0; c < ncells; c++)
+      scratch->cell_start[c+1] += scratch->cell_start[c];
+   for(i = 0; i < minutiae->num; i++){
+      c = ((minutiae->y[i] / NBR_GRID_CELL) * scratch->gw) +
+          (minutiae->x[i] / NBR_GRID_CELL);
+      scratch->cell_items[scratch->cell_start[c]++] = i;
+   }
+   /* Binning moved each offset on to the next cell's, so shift them */
+   /* back.                                                          */
+   for(c = ncells; c > 0; c--)
+      scratch->cell_start[c] = scratch->cell_start[c-1];
+   scratch->cell_start[0] = 0;
 
    /* Return normally. */
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: free_ridge_scratch - Deallocates the working memory allocated by
+#cat:                alloc_ridge_scratch().
+
+   Input:
+      scratch   - working memory
+**************************************************************************/
+static void free_ridge_scratch(RIDGE_SCRATCH *scratch)
+{
+   free(scratch->cell_start);
+   free(scratch->cell_items);
+   free(scratch->nbr_list);
+   free(scratch->nbr_sqr_dists);
+   free(scratch->xlist);
+   free(scratch->ylist);
+   free(scratch->pix);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: count_minutiae_ridges - Takes a list of minutiae, and for each one,
@@ -801,8 +942,9 @@ int count_minutiae_ridges(MINUTIAE *minutiae,
                       unsigned char *bdata, const int iw, const int ih,
                       const LFSPARMS *lfsparms)
 {
+   RIDGE_SCRATCH scratch;
    int ret;
-   int i;
+   int i, nslots;
 
    print2log("\nFINDING NBRS AND COUNTING RIDGES:\n");
 
@@ -816,16 +958,46 @@ int count_minutiae_ridges(MINUTIAE *minutiae,
       return(ret);
    }
 
+   /* Allocate the neighbor arrays shared by all the minutiae, with */
+   /* room for the maximum number of neighbors of each.             */
+   nslots = max(minutiae->num * lfsparms->max_nbrs, 1);
+   free(minutiae->nbrs);
+   free(minutiae->ridge_counts);
+   minutiae->nbrs = (int *)malloc(nslots * sizeof(int));
+   minutiae->ridge_counts = (int *)malloc(nslots * sizeof(int));
+   if((minutiae->nbrs == (int *)NULL) ||
+      (minutiae->ridge_counts == (int *)NULL)){
+      print2err("ERROR : count_minutiae_ridges : malloc : nbrs\n");
+      return(-450);
+   }
+   for(i = 0; i < minutiae->num; i++){
+      minutiae->num_nbrs[i] = 0;
+      minutiae->nbrs_first[i] = 0;
+   }
+
+   /* Working memory shared by all the minutiae. */
+   if((ret = alloc_ridge_scratch(&scratch, minutiae, iw, ih,
+                                 lfsparms->max_nbrs))){
+      free_ridge_scratch(&scratch);
+      return(ret);
+   }
+
    /* Foreach remaining sorted minutia in list ... */
    for(i = 0; i < minutiae->num-1; i++){
+      /* The minutia's neighbors follow those of the one before it. */
+      if(i > 0)
+         minutiae->nbrs_first[i] = minutiae->nbrs_first[i-1] +
+                                   minutiae->num_nbrs[i-1];
       /* Located neighbors and count number of ridges in between. */
-      /* NOTE: neighbor and ridge count results are stored in     */
-      /*       minutiae->list[i].                                 */
-      if((ret = count_minutia_ridges(i, minutiae, bdata, iw, ih, lfsparms))){
+      if((ret = count_minutia_ridges(i, minutiae, bdata, iw, ih, lfsparms,
+                                     &scratch))){
+         free_ridge_scratch(&scratch);
          return(ret);
       }
    }
 
+   free_ridge_scratch(&scratch);
+
    /* Return normally. */
    return(0);
 }
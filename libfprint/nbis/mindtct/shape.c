@@ -43,6 +43,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -80,7 +81,7 @@ static int alloc_shape(SHAPE **oshape, const int xmin, const int ymin,
    shape = (SHAPE *)malloc(sizeof(SHAPE));
    /* If there is an allocation error... */
    if(shape == (SHAPE *)NULL){
-      fprintf(stderr, "ERROR : alloc_shape : malloc : shape\n");
+      print2err("ERROR : alloc_shape : malloc : shape\n");
       return(-250);
    }
 
@@ -91,7 +92,7 @@ static int alloc_shape(SHAPE **oshape, const int xmin, const int ymin,
    if(shape->rows == (ROW **)NULL){
       /* Deallocate memory alloated by this routine to this point. */
       free(shape);
-      fprintf(stderr, "ERROR : alloc_shape : malloc : shape->rows\n");
+      print2err("ERROR : alloc_shape : malloc : shape->rows\n");
       return(-251);
    }
 
@@ -117,7 +118,7 @@ static int alloc_shape(SHAPE **oshape, const int xmin, const int ymin,
          }
          free(shape->rows);
          free(shape);
-         fprintf(stderr, "ERROR : alloc_shape : malloc : shape->rows[i]\n");
+         print2err("ERROR : alloc_shape : malloc : shape->rows[i]\n");
          return(-252);
       }
 
@@ -133,7 +134,7 @@ static int alloc_shape(SHAPE **oshape, const int xmin, const int ymin,
          free(shape->rows[i]);
          free(shape->rows);
          free(shape);
-         fprintf(stderr,
+         print2err(
                  "ERROR : alloc_shape : malloc : shape->rows[i]->xs\n");
          return(-253);
       }
@@ -246,7 +247,7 @@ int shape_from_contour(SHAPE **oshape, const int *contour_x,
          if(row->npts >= row->alloc){
             /* This should never happen becuase we have allocated */
             /* based on shape bounding limits.                    */
-            fprintf(stderr,
+            print2err(
                     "ERROR : shape_from_contour : row overflow\n");
             return(-260);
          }
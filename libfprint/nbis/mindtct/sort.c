@@ -40,11 +40,16 @@ identified are necessarily the best available for the purpose.
                         bubble_sort_double_inc_2()
                         bubble_sort_double_dec_2()
                         bubble_sort_int_inc()
+                        insertion_sort_double_inc_2()
+                        network_sort_double_dec_2()
+                        radix_sort_int_inc_2()
 ***********************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -66,12 +71,12 @@ identified are necessarily the best available for the purpose.
 int sort_indices_int_inc(int **optr, int *ranks, const int num)
 {
    int *order;
-   int i;
+   int i, ret;
 
    /* Allocate list of sequential indices. */
    order = (int *)malloc(num * sizeof(int));
    if(order == (int *)NULL){
-      fprintf(stderr, "ERROR : sort_indices_int_inc : malloc : order\n");
+      print2err("ERROR : sort_indices_int_inc : malloc : order\n");
       return(-390);
    }
    /* Initialize list of sequential indices. */
@@ -79,7 +84,10 @@ int sort_indices_int_inc(int **optr, int *ranks, const int num)
       order[i] = i;
 
    /* Sort the indecies into rank order. */
-   bubble_sort_int_inc_2(ranks, order, num);
+   if((ret = radix_sort_int_inc_2(ranks, order, num))){
+      free(order);
+      return(ret);
+   }
 
    /* Set output pointer to the resulting order of sorted indices. */
    *optr = order;
@@ -112,7 +120,7 @@ int sort_indices_double_inc(int **optr, double *ranks, const int num)
    /* Allocate list of sequential indices. */
    order = (int *)malloc(num * sizeof(int));
    if(order == (int *)NULL){
-      fprintf(stderr, "ERROR : sort_indices_double_inc : malloc : order\n");
+      print2err("ERROR : sort_indices_double_inc : malloc : order\n");
       return(-400);
    }
    /* Initialize list of sequential indices. */
@@ -318,3 +326,190 @@ void bubble_sort_int_inc(int *ranks, const int len)
    }     
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: insertion_sort_double_inc_2 - Takes a list of double ranks and a
+#cat:              corresponding list of integer attributes, and sorts the
+#cat:              ranks into increasing order moving the attributes
+#cat:              correspondingly.  Equal ranks keep their order, so the
+#cat:              result is the same as from bubble_sort_double_inc_2(),
+#cat:              without its repeated passes over short lists.
+
+   Input:
+      ranks     - list of double to be sort on
+      items     - list of corresponding integer attributes
+      len       - number of items in list
+   Output:
+      ranks     - list of doubles sorted in increasing order
+      items     - list of attributes in corresponding sorted order
+**************************************************************************/
+void insertion_sort_double_inc_2(double *ranks, int *items, const int len)
+{
+   int i, j, titem;
+   double trank;
+
+   for(i = 1; i < len; i++){
+      trank = ranks[i];
+      titem = items[i];
+      /* Shift larger ranks up, stopping at equal ones. */
+      for(j = i; (j > 0) && (ranks[j-1] > trank); j--){
+         ranks[j] = ranks[j-1];
+         items[j] = items[j-1];
+      }
+      ranks[j] = trank;
+      items[j] = titem;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: network_sort_double_dec_2 - Sorts a short list of double ranks into
+#cat:              decreasing order moving the corresponding integer
+#cat:              attributes along, with a fixed sequence of compare and
+#cat:              swap steps.  Only neighbours are swapped, and only when
+#cat:              strictly out of order, so the result is the same as from
+#cat:              bubble_sort_double_dec_2().  Lists of other lengths than
+#cat:              the ones provided for are passed on to that routine.
+
+   Input:
+      ranks - list of values to be sorted
+      items - list of items, each corresponding to a particular rank value
+      len   - length of the lists to be sorted
+   Output:
+      ranks - list of values sorted in descending order
+      items - list of items in the corresponding sorted order of the ranks
+**************************************************************************/
+#define SORT_DEC_STEP(p)                                      \
+   if(ranks[p] < ranks[(p)+1]){                               \
+      trank = ranks[p]; ranks[p] = ranks[(p)+1];              \
+      ranks[(p)+1] = trank;                                   \
+      titem = items[p]; items[p] = items[(p)+1];              \
+      items[(p)+1] = titem;                                   \
+   }
+
+void network_sort_double_dec_2(double *ranks, int *items, const int len)
+{
+   int titem;
+   double trank;
+
+   /* Odd-even transposition networks. */
+   switch(len){
+      case 0:
+      case 1:
+         break;
+      case 2:
+         SORT_DEC_STEP(0)
+         break;
+      case 3:
+         SORT_DEC_STEP(0)
+         SORT_DEC_STEP(1)
+         SORT_DEC_STEP(0)
+         break;
+      case 4:
+         SORT_DEC_STEP(0) SORT_DEC_STEP(2)
+         SORT_DEC_STEP(1)
+         SORT_DEC_STEP(0) SORT_DEC_STEP(2)
+         SORT_DEC_STEP(1)
+         break;
+      default:
+         bubble_sort_double_dec_2(ranks, items, len);
+         break;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: radix_sort_int_inc_2 - Takes a list of integer ranks and a corresponding
+#cat:              list of integer attributes, and sorts the ranks into
+#cat:              increasing order moving the attributes correspondingly.
+#cat:              Equal ranks keep their order, so the result is the same
+#cat:              as from bubble_sort_int_inc_2(), in linear time.  Short
+#cat:              lists are insertion sorted instead.
+
+   Input:
+      ranks     - list of integers to be sort on
+      items     - list of corresponding integer attributes
+      len       - number of items in list
+   Output:
+      ranks     - list of integers sorted in increasing order
+      items     - list of attributes in corresponding sorted order
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+#define RADIX_MIN_LEN      64
+#define RADIX_BITS         8
+#define RADIX_BUCKETS      (1<<RADIX_BITS)
+/* Flip the sign bit so that negative ranks sort below positive ones. */
+#define RADIX_KEY(r)       (((unsigned int)(r)) ^ 0x80000000u)
+
+int radix_sort_int_inc_2(int *ranks, int *items, const int len)
+{
+   int *tmp, *src_r, *src_i, *dst_r, *dst_i, *swap;
+   int counts[RADIX_BUCKETS];
+   int i, j, shift, digit, trank, titem;
+
+   if(len < RADIX_MIN_LEN){
+      for(i = 1; i < len; i++){
+         trank = ranks[i];
+         titem = items[i];
+         for(j = i; (j > 0) && (ranks[j-1] > trank); j--){
+            ranks[j] = ranks[j-1];
+            items[j] = items[j-1];
+         }
+         ranks[j] = trank;
+         items[j] = titem;
+      }
+      return(0);
+   }
+
+   tmp = (int *)malloc(2 * len * sizeof(int));
+   if(tmp == (int *)NULL){
+      print2err("ERROR : radix_sort_int_inc_2 : malloc : tmp\n");
+      return(-391);
+   }
+
+   src_r = ranks;
+   src_i = items;
+   dst_r = tmp;
+   dst_i = tmp + len;
+
+   /* Least significant digit first, each pass keeping the order */
+   /* of the previous one among ranks with the same digit.        */
+   for(shift = 0; shift < 32; shift += RADIX_BITS){
+      memset(counts, 0, sizeof(counts));
+      for(i = 0; i < len; i++)
+         counts[(RADIX_KEY(src_r[i]) >> shift) & (RADIX_BUCKETS-1)]++;
+
+      /* Skip the pass if all ranks have the same digit. */
+      digit = (RADIX_KEY(src_r[0]) >> shift) & (RADIX_BUCKETS-1);
+      if(counts[digit] == len)
+         continue;
+
+      /* Turn counts into starting positions. */
+      for(i = 0, j = 0; i < RADIX_BUCKETS; i++){
+         trank = counts[i];
+         counts[i] = j;
+         j += trank;
+      }
+
+      for(i = 0; i < len; i++){
+         digit = (RADIX_KEY(src_r[i]) >> shift) & (RADIX_BUCKETS-1);
+         dst_r[counts[digit]] = src_r[i];
+         dst_i[counts[digit]] = src_i[i];
+         counts[digit]++;
+      }
+
+      swap = src_r; src_r = dst_r; dst_r = swap;
+      swap = src_i; src_i = dst_i; dst_i = swap;
+   }
+
+   /* Copy back if the last pass left the result in the work buffer. */
+   if(src_r != ranks){
+      memcpy(ranks, src_r, len * sizeof(int));
+      memcpy(items, src_i, len * sizeof(int));
+   }
+
+   free(tmp);
+   return(0);
+}
@@ -49,6 +49,7 @@ identified are necessarily the best available for the purpose.
 #include <stdio.h>
 #include <stdlib.h>
 #include <lfs.h>
+#include <log.h>
 
 /*************************************************************************
 **************************************************************************
@@ -160,20 +161,20 @@ int minmaxs(int **ominmax_val, int **ominmax_type, int **ominmax_i,
    /* Allocate the buffers. */
    minmax_val = (int *)malloc(minmax_alloc * sizeof(int));
    if(minmax_val == (int *)NULL){
-      fprintf(stderr, "ERROR : minmaxs : malloc : minmax_val\n");
+      print2err("ERROR : minmaxs : malloc : minmax_val\n");
       return(-290);
    }
    minmax_type = (int *)malloc(minmax_alloc * sizeof(int));
    if(minmax_type == (int *)NULL){
       free(minmax_val);
-      fprintf(stderr, "ERROR : minmaxs : malloc : minmax_type\n");
+      print2err("ERROR : minmaxs : malloc : minmax_type\n");
       return(-291);
    }
    minmax_i = (int *)malloc(minmax_alloc * sizeof(int));
    if(minmax_i == (int *)NULL){
       free(minmax_val);
       free(minmax_type);
-      fprintf(stderr, "ERROR : minmaxs : malloc : minmax_i\n");
+      print2err("ERROR : minmaxs : malloc : minmax_i\n");
       return(-292);
    }
 
@@ -433,7 +434,7 @@ int remove_from_int_list(const int index, int *list, const int num)
 
    /* Make sure the requested index is within range. */
    if((index < 0) && (index >= num)){
-      fprintf(stderr, "ERROR : remove_from_int_list : index out of range\n");
+      print2err("ERROR : remove_from_int_list : index out of range\n");
       return(-370);
    }
 
@@ -0,0 +1,110 @@
+/*
+ * Pixel format conversion for sensors with packed pixel data
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include "fp_internal.h"
+
+/* Start of output row 'row' as seen through the standardization flags, and
+ * the direction in which to walk along it. */
+static unsigned char *out_row(unsigned char *output, unsigned int row,
+	unsigned int width, unsigned int height, uint16_t flags)
+{
+	if (flags & FP_IMG_V_FLIPPED)
+		row = height - row - 1;
+	output += row * width;
+	if (flags & FP_IMG_H_FLIPPED)
+		output += width - 1;
+	return output;
+}
+
+/*
+ * Unpack a 4 bits per pixel image into 8 bits per pixel. Every input byte
+ * holds two pixels which are either horizontal neighbours in a row-major
+ * image, or vertical neighbours in a column-major one (an image stored
+ * column by column, 2 rows per byte, as the Authentec sensors do). The high
+ * nibble is the first pixel of the two unless FPI_4BPP_LOW_NIBBLE_FIRST is
+ * given.
+ *
+ * flags are FP_IMG_* standardization flags to apply while unpacking, in
+ * which case they must not also be set on the resulting image. width (for
+ * row-major data) or height (for column-major data) must be even.
+ *
+ * The 16 grey levels are mapped through a small table which also takes care
+ * of inversion, and the output is always written sequentially; with
+ * column-major input, the (much smaller) input is read with a stride
+ * instead.
+ */
+void fpi_img_unpack_4bpp(unsigned char *output, const unsigned char *input,
+	unsigned int width, unsigned int height, unsigned int format,
+	uint16_t flags)
+{
+	unsigned char levels[16];
+	unsigned int first = (format & FPI_4BPP_LOW_NIBBLE_FIRST) ? 0 : 4;
+	unsigned int second = 4 - first;
+	int step = (flags & FP_IMG_H_FLIPPED) ? -1 : 1;
+	unsigned int i, row, col;
+
+	for (i = 0; i < 16; i++) {
+		unsigned char level;
+
+		if (format & FPI_4BPP_LEVELS_SHIFT)
+			level = i << 4;
+		else
+			level = i * 17;
+		if (flags & FP_IMG_COLORS_INVERTED)
+			level = 0xff - level;
+		levels[i] = level;
+	}
+
+	if (format & FPI_4BPP_COLUMN_MAJOR) {
+		unsigned int half = height / 2;
+
+		for (row = 0; row < half; row++) {
+			unsigned char *top = out_row(output, 2 * row, width, height,
+				flags);
+			unsigned char *bottom = out_row(output, 2 * row + 1, width,
+				height, flags);
+			const unsigned char *src = input + row;
+
+			for (col = 0; col < width; col++) {
+				unsigned char byte = *src;
+
+				*top = levels[(byte >> first) & 0x0f];
+				*bottom = levels[(byte >> second) & 0x0f];
+				top += step;
+				bottom += step;
+				src += half;
+			}
+		}
+		return;
+	}
+
+	for (row = 0; row < height; row++) {
+		unsigned char *dst = out_row(output, row, width, height, flags);
+
+		for (col = 0; col < width; col += 2) {
+			unsigned char byte = *input++;
+
+			dst[0] = levels[(byte >> first) & 0x0f];
+			dst[step] = levels[(byte >> second) & 0x0f];
+			dst += 2 * step;
+		}
+	}
+}
@@ -57,15 +57,11 @@
  * functions.
  */
 
-/* this is a singly-linked list of pending timers, sorted with the timer that
- * is expiring soonest at the head. */
-static GSList *active_timers = NULL;
-
-/* notifiers for added or removed poll fds */
-static fp_pollfd_added_cb fd_added_cb = NULL;
-static fp_pollfd_removed_cb fd_removed_cb = NULL;
+/* each context keeps a singly-linked list of pending timers, sorted with the
+ * timer that is expiring soonest at the head. */
 
 struct fpi_timeout {
+	struct fp_context *ctx;
 	struct timeval expiry;
 	fpi_timeout_fn callback;
 	void *data;
@@ -88,10 +84,12 @@ static int timeout_sort_fn(gconstpointer _a, gconstpointer _b)
 
 /* A timeout is the asynchronous equivalent of sleeping. You create a timeout
  * saying that you'd like to have a function invoked at a certain time in
- * the future. */
-struct fpi_timeout *fpi_timeout_add(unsigned int msec, fpi_timeout_fn callback,
-	void *data)
+ * the future. The timeout fires from the event handling of the device's
+ * context. */
+struct fpi_timeout *fpi_timeout_add(struct fp_dev *dev, unsigned int msec,
+	fpi_timeout_fn callback, void *data)
 {
+	struct fp_context *ctx = dev->ctx;
 	struct timespec ts;
 	struct timeval add_msec;
 	struct fpi_timeout *timeout;
@@ -106,6 +104,7 @@ struct fpi_timeout *fpi_timeout_add(unsigned int msec, fpi_timeout_fn callback,
 	}
 
 	timeout = g_malloc(sizeof(*timeout));
+	timeout->ctx = ctx;
 	timeout->callback = callback;
 	timeout->data = data;
 	TIMESPEC_TO_TIMEVAL(&timeout->expiry, &ts);
@@ -116,7 +115,7 @@ struct fpi_timeout *fpi_timeout_add(unsigned int msec, fpi_timeout_fn callback,
 	add_msec.tv_usec = (msec % 1000) * 1000;
 	timeradd(&timeout->expiry, &add_msec, &timeout->expiry);
 
-	active_timers = g_slist_insert_sorted(active_timers, timeout,
+	ctx->active_timers = g_slist_insert_sorted(ctx->active_timers, timeout,
 		timeout_sort_fn);
 
 	return timeout;
@@ -124,8 +123,10 @@ struct fpi_timeout *fpi_timeout_add(unsigned int msec, fpi_timeout_fn callback,
 
 void fpi_timeout_cancel(struct fpi_timeout *timeout)
 {
+	struct fp_context *ctx = timeout->ctx;
+
 	fp_dbg("");
-	active_timers = g_slist_remove(active_timers, timeout);
+	ctx->active_timers = g_slist_remove(ctx->active_timers, timeout);
 	g_free(timeout);
 }
 
@@ -134,7 +135,7 @@ void fpi_timeout_cancel(struct fpi_timeout *timeout)
  * timeval/timeout output parameters were populated. if the returned timeval
  * is zero then it means the timeout has already expired and should be handled
  * ASAP. */
-static int get_next_timeout_expiry(struct timeval *out,
+static int get_next_timeout_expiry(struct fp_context *ctx, struct timeval *out,
 	struct fpi_timeout **out_timeout)
 {
 	struct timespec ts;
@@ -142,7 +143,7 @@ static int get_next_timeout_expiry(struct timeval *out,
 	struct fpi_timeout *next_timeout;
 	int r;
 
-	if (active_timers == NULL)
+	if (ctx->active_timers == NULL)
 		return 0;
 
 	r = clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -152,7 +153,7 @@ static int get_next_timeout_expiry(struct timeval *out,
 	}
 	TIMESPEC_TO_TIMEVAL(&tv, &ts);
 
-	next_timeout = active_timers->data;
+	next_timeout = ctx->active_timers->data;
 	if (out_timeout)
 		*out_timeout = next_timeout;
 
@@ -170,19 +171,21 @@ static int get_next_timeout_expiry(struct timeval *out,
 /* handle a timeout that has expired */
 static void handle_timeout(struct fpi_timeout *timeout)
 {
+	struct fp_context *ctx = timeout->ctx;
+
 	fp_dbg("");
 	timeout->callback(timeout->data);
-	active_timers = g_slist_remove(active_timers, timeout);
+	ctx->active_timers = g_slist_remove(ctx->active_timers, timeout);
 	g_free(timeout);
 }
 
-static int handle_timeouts(void)
+static int handle_timeouts(struct fp_context *ctx)
 {
 	struct timeval next_timeout_expiry;
 	struct fpi_timeout *next_timeout;
 	int r;
 
-	r = get_next_timeout_expiry(&next_timeout_expiry, &next_timeout);
+	r = get_next_timeout_expiry(ctx, &next_timeout_expiry, &next_timeout);
 	if (r <= 0)
 		return r;
 
@@ -193,22 +196,24 @@ static int handle_timeouts(void)
 }
 
 /** \ingroup poll
- * Handle any pending events. If a non-zero timeout is specified, the function
- * will potentially block for the specified amount of time, although it may
- * return sooner if events have been handled. The function acts as non-blocking
- * for a zero timeout.
+ * Handle any pending events of a context. If a non-zero timeout is
+ * specified, the function will potentially block for the specified amount of
+ * time, although it may return sooner if events have been handled. The
+ * function acts as non-blocking for a zero timeout.
  *
+ * \param ctx the context to handle events for
  * \param timeout Maximum timeout for this blocking function
  * \returns 0 on success, non-zero on error.
  */
-API_EXPORTED int fp_handle_events_timeout(struct timeval *timeout)
+API_EXPORTED int fp_context_handle_events_timeout(struct fp_context *ctx,
+	struct timeval *timeout)
 {
 	struct timeval next_timeout_expiry;
 	struct timeval select_timeout;
 	struct fpi_timeout *next_timeout;
 	int r;
 
-	r = get_next_timeout_expiry(&next_timeout_expiry, &next_timeout);
+	r = get_next_timeout_expiry(ctx, &next_timeout_expiry, &next_timeout);
 	if (r < 0)
 		return r;
 
@@ -228,12 +233,46 @@ API_EXPORTED int fp_handle_events_timeout(struct timeval *timeout)
 		select_timeout = *timeout;
 	}
 
-	r = libusb_handle_events_timeout(fpi_usb_ctx, &select_timeout);
+	r = libusb_handle_events_timeout(ctx->usb_ctx, &select_timeout);
 	*timeout = select_timeout;
 	if (r < 0)
 		return r;
 
-	return handle_timeouts();
+	return handle_timeouts(ctx);
+}
+
+/** \ingroup poll
+ * Convenience function for calling fp_context_handle_events_timeout() with
+ * a sensible default timeout value of two seconds (subject to change if we
+ * decide another value is more sensible).
+ *
+ * \param ctx the context to handle events for
+ * \returns 0 on success, non-zero on error.
+ */
+API_EXPORTED int fp_context_handle_events(struct fp_context *ctx)
+{
+	struct timeval tv;
+	tv.tv_sec = 2;
+	tv.tv_usec = 0;
+	return fp_context_handle_events_timeout(ctx, &tv);
+}
+
+/** \ingroup poll
+ * Handle any pending events of the default context. If a non-zero timeout is
+ * specified, the function will potentially block for the specified amount of
+ * time, although it may return sooner if events have been handled. The
+ * function acts as non-blocking for a zero timeout.
+ *
+ * \param timeout Maximum timeout for this blocking function
+ * \returns 0 on success, non-zero on error.
+ */
+API_EXPORTED int fp_handle_events_timeout(struct timeval *timeout)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return -EINVAL;
+	return fp_context_handle_events_timeout(ctx, timeout);
 }
 
 /** \ingroup poll
@@ -245,25 +284,37 @@ API_EXPORTED int fp_handle_events_timeout(struct timeval *timeout)
  */
 API_EXPORTED int fp_handle_events(void)
 {
-	struct timeval tv;
-	tv.tv_sec = 2;
-	tv.tv_usec = 0;
-	return fp_handle_events_timeout(&tv);
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return -EINVAL;
+	return fp_context_handle_events(ctx);
 }
 
-/* FIXME: docs
- * returns 0 if no timeouts active
- * returns 1 if timeout returned
- * zero timeout means events are to be handled immediately */
-API_EXPORTED int fp_get_next_timeout(struct timeval *tv)
+/** \ingroup poll
+ * Find out when libfprint next needs to handle events on a context, for
+ * users who poll libfprint's file descriptors themselves (see
+ * fp_context_get_pollfds()). Some events are not announced on any file
+ * descriptor but are due at a certain time, such as driver timeouts. Once
+ * the returned time has passed, call fp_context_handle_events_timeout() even
+ * if no file descriptor has become ready.
+ *
+ * \param ctx the context to check
+ * \param tv output location for the time left until events need to be
+ * handled. A zero time means that they need to be handled right away.
+ * \returns 0 if there are no pending timeouts, in which case tv is not
+ * changed, or 1 if tv was filled in.
+ */
+API_EXPORTED int fp_context_get_next_timeout(struct fp_context *ctx,
+	struct timeval *tv)
 {
 	struct timeval fprint_timeout;
 	struct timeval libusb_timeout;
 	int r_fprint;
 	int r_libusb;
 
-	r_fprint = get_next_timeout_expiry(&fprint_timeout, NULL);
-	r_libusb = libusb_get_next_timeout(fpi_usb_ctx, &libusb_timeout);
+	r_fprint = get_next_timeout_expiry(ctx, &fprint_timeout, NULL);
+	r_libusb = libusb_get_next_timeout(ctx->usb_ctx, &libusb_timeout);
 
 	/* if we have no pending timeouts and the same is true for libusb,
 	 * indicate that we have no pending timouts */
@@ -286,18 +337,38 @@ API_EXPORTED int fp_get_next_timeout(struct timeval *tv)
 	return 1;
 }
 
+/** \ingroup poll
+ * Find out when libfprint next needs to handle events on the default
+ * context, see fp_context_get_next_timeout().
+ *
+ * \param tv output location for the time left until events need to be
+ * handled. A zero time means that they need to be handled right away.
+ * \returns 0 if there are no pending timeouts, in which case tv is not
+ * changed, or 1 if tv was filled in.
+ */
+API_EXPORTED int fp_get_next_timeout(struct timeval *tv)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return 0;
+	return fp_context_get_next_timeout(ctx, tv);
+}
+
 /** \ingroup poll
  * Retrieve a list of file descriptors that should be polled for events
- * interesting to libfprint. This function is only for users who wish to
- * combine libfprint's file descriptor set with other event sources - more
- * simplistic users will be able to call fp_handle_events() or a variant
- * directly.
+ * interesting to libfprint on a context. This function is only for users who
+ * wish to combine libfprint's file descriptor set with other event sources -
+ * more simplistic users will be able to call fp_context_handle_events() or a
+ * variant directly.
  *
+ * \param ctx the context to retrieve file descriptors for
  * \param pollfds output location for a list of pollfds. If non-NULL, must be
  * released with free() when done.
  * \returns the number of pollfds in the resultant list, or negative on error.
  */
-API_EXPORTED size_t fp_get_pollfds(struct fp_pollfd **pollfds)
+API_EXPORTED size_t fp_context_get_pollfds(struct fp_context *ctx,
+	struct fp_pollfd **pollfds)
 {
 	const struct libusb_pollfd **usbfds;
 	const struct libusb_pollfd *usbfd;
@@ -305,7 +376,7 @@ API_EXPORTED size_t fp_get_pollfds(struct fp_pollfd **pollfds)
 	size_t cnt = 0;
 	size_t i = 0;
 
-	usbfds = libusb_get_pollfds(fpi_usb_ctx);
+	usbfds = libusb_get_pollfds(ctx->usb_ctx);
 	if (!usbfds) {
 		*pollfds = NULL;
 		return -EIO;
@@ -326,37 +397,93 @@ API_EXPORTED size_t fp_get_pollfds(struct fp_pollfd **pollfds)
 	return cnt;
 }
 
-/* FIXME: docs */
+/** \ingroup poll
+ * Retrieve a list of file descriptors that should be polled for events
+ * interesting to libfprint. This function is only for users who wish to
+ * combine libfprint's file descriptor set with other event sources - more
+ * simplistic users will be able to call fp_handle_events() or a variant
+ * directly.
+ *
+ * \param pollfds output location for a list of pollfds. If non-NULL, must be
+ * released with free() when done.
+ * \returns the number of pollfds in the resultant list, or negative on error.
+ */
+API_EXPORTED size_t fp_get_pollfds(struct fp_pollfd **pollfds)
+{
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx) {
+		*pollfds = NULL;
+		return -EINVAL;
+	}
+	return fp_context_get_pollfds(ctx, pollfds);
+}
+
+/** \ingroup poll
+ * Get told when file descriptors that libfprint needs polled on a context
+ * are added or removed, for users who poll them together with their own
+ * (see fp_context_get_pollfds()). Only changes after this call are
+ * reported, so call fp_context_get_pollfds() afterwards for the file
+ * descriptors there are already.
+ *
+ * \param ctx the context to watch
+ * \param added_cb function to call with each file descriptor that is
+ * added, and the events to poll it for, or NULL
+ * \param removed_cb function to call with each file descriptor that is
+ * removed, or NULL
+ */
+API_EXPORTED void fp_context_set_pollfd_notifiers(struct fp_context *ctx,
+	fp_pollfd_added_cb added_cb, fp_pollfd_removed_cb removed_cb)
+{
+	ctx->fd_added_cb = added_cb;
+	ctx->fd_removed_cb = removed_cb;
+}
+
+/** \ingroup poll
+ * Get told when file descriptors that libfprint needs polled on the default
+ * context are added or removed, see fp_context_set_pollfd_notifiers().
+ *
+ * \param added_cb function to call with each file descriptor that is
+ * added, and the events to poll it for, or NULL
+ * \param removed_cb function to call with each file descriptor that is
+ * removed, or NULL
+ */
 API_EXPORTED void fp_set_pollfd_notifiers(fp_pollfd_added_cb added_cb,
 	fp_pollfd_removed_cb removed_cb)
 {
-	fd_added_cb = added_cb;
-	fd_removed_cb = removed_cb;
+	struct fp_context *ctx = fpi_get_default_ctx();
+
+	if (!ctx)
+		return;
+	fp_context_set_pollfd_notifiers(ctx, added_cb, removed_cb);
 }
 
 static void add_pollfd(int fd, short events, void *user_data)
 {
-	if (fd_added_cb)
-		fd_added_cb(fd, events);
+	struct fp_context *ctx = user_data;
+
+	if (ctx->fd_added_cb)
+		ctx->fd_added_cb(fd, events);
 }
 
 static void remove_pollfd(int fd, void *user_data)
 {
-	if (fd_removed_cb)
-		fd_removed_cb(fd);
+	struct fp_context *ctx = user_data;
+
+	if (ctx->fd_removed_cb)
+		ctx->fd_removed_cb(fd);
 }
 
-void fpi_poll_init(void)
+void fpi_poll_init(struct fp_context *ctx)
 {
-	libusb_set_pollfd_notifiers(fpi_usb_ctx, add_pollfd, remove_pollfd, NULL);
+	libusb_set_pollfd_notifiers(ctx->usb_ctx, add_pollfd, remove_pollfd, ctx);
 }
 
-void fpi_poll_exit(void)
+void fpi_poll_exit(struct fp_context *ctx)
 {
-	g_slist_free(active_timers);
-	active_timers = NULL;
-	fd_added_cb = NULL;
-	fd_removed_cb = NULL;
-	libusb_set_pollfd_notifiers(fpi_usb_ctx, NULL, NULL, NULL);
+	g_slist_free(ctx->active_timers);
+	ctx->active_timers = NULL;
+	ctx->fd_added_cb = NULL;
+	ctx->fd_removed_cb = NULL;
+	libusb_set_pollfd_notifiers(ctx->usb_ctx, NULL, NULL, NULL);
 }
-
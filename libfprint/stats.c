@@ -0,0 +1,226 @@
+/*
+ * Performance counters and latency histograms
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "stats"
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "fp_internal.h"
+
+/** @defgroup stats Performance statistics
+ * libfprint keeps track of where time goes while operating a device: how
+ * long the USB acquisition of an image takes, how long the image processing
+ * stages take, how long a whole verification takes from start to decision,
+ * and so on. Each of these \ref fp_stats_stage "stages" has a sample count,
+ * total/min/max durations and a histogram of durations with logarithmic
+ * buckets, where bucket <em>i</em> counts samples that took at least
+ * 2<sup><em>i</em></sup> and less than 2<sup><em>i</em>+1</sup>
+ * microseconds (bucket 0 also counts samples below one microsecond).
+ *
+ * Statistics are kept both per device, for as long as the device is open,
+ * and globally, from fp_init() onwards. Global statistics also include
+ * work which is not tied to a device, such as fp_img_get_minutiae() calls
+ * on images that your application provides.
+ *
+ * Updating the statistics is cheap and does not take any locks, so it is
+ * safe to query them from another thread while operations are running.
+ *
+ * If libfprint was compiled with statistics disabled, all of these
+ * functions return -ENOTSUP.
+ */
+
+#ifdef ENABLE_STATS
+
+static struct fpi_stats global_stats;
+
+static void atomic_min(uint64_t *ptr, uint64_t value)
+{
+	uint64_t cur = *ptr;
+	while ((cur == 0 || value < cur)
+			&& !__sync_bool_compare_and_swap(ptr, cur, value))
+		cur = *ptr;
+}
+
+static void atomic_max(uint64_t *ptr, uint64_t value)
+{
+	uint64_t cur = *ptr;
+	while (value > cur && !__sync_bool_compare_and_swap(ptr, cur, value))
+		cur = *ptr;
+}
+
+static unsigned int usec_to_bucket(uint64_t usec)
+{
+	unsigned int bucket = 0;
+
+	while (usec > 1 && bucket < FP_STATS_NR_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static void stage_add(struct fp_stats *stage, uint64_t usec)
+{
+	__sync_fetch_and_add(&stage->count, 1);
+	__sync_fetch_and_add(&stage->total_usec, usec);
+	__sync_fetch_and_add(&stage->histogram[usec_to_bucket(usec)], 1);
+	/* a zero minimum means "no samples yet", so clamp real samples */
+	atomic_min(&stage->min_usec, usec ? usec : 1);
+	atomic_max(&stage->max_usec, usec);
+}
+
+/* Record a sample for a stage which began at the given fpi_stats_start()
+ * time. dev may be NULL for work that is not tied to a device. */
+void fpi_stats_add(struct fp_dev *dev, enum fp_stats_stage stage, gint64 start)
+{
+	gint64 usec = g_get_monotonic_time() - start;
+
+	if (stage >= FP_STATS_NR_STAGES || start == 0)
+		return;
+	if (usec < 0)
+		usec = 0;
+
+	stage_add(&global_stats.stages[stage], usec);
+	if (dev)
+		stage_add(&dev->stats.stages[stage], usec);
+}
+
+void fpi_stats_inc(struct fp_dev *dev, enum fp_stats_counter counter)
+{
+	if (counter >= FP_STATS_NR_COUNTERS)
+		return;
+
+	__sync_fetch_and_add(&global_stats.counters[counter], 1);
+	if (dev)
+		__sync_fetch_and_add(&dev->stats.counters[counter], 1);
+}
+
+void fpi_stats_init(void)
+{
+	memset(&global_stats, 0, sizeof(global_stats));
+}
+
+static struct fpi_stats *get_stats(struct fp_dev *dev)
+{
+	return dev ? &dev->stats : &global_stats;
+}
+
+#endif
+
+/** \ingroup stats
+ * Retrieve the timing statistics for a stage.
+ * \param dev the device to query, or NULL for the library-wide statistics
+ * \param stage the stage to query
+ * \param stats output location for the statistics. min_usec is 0 if no
+ * samples have been recorded yet.
+ * \returns 0 on success, negative on error
+ */
+API_EXPORTED int fp_stats_get(struct fp_dev *dev, enum fp_stats_stage stage,
+	struct fp_stats *stats)
+{
+#ifdef ENABLE_STATS
+	struct fp_stats *src;
+	unsigned int i;
+
+	if (stage >= FP_STATS_NR_STAGES)
+		return -EINVAL;
+
+	/* fields are copied one by one so that each value is read atomically,
+	 * the stage as a whole may still be updated while we copy it */
+	src = &get_stats(dev)->stages[stage];
+	stats->count = __sync_fetch_and_add(&src->count, 0);
+	stats->total_usec = __sync_fetch_and_add(&src->total_usec, 0);
+	stats->min_usec = __sync_fetch_and_add(&src->min_usec, 0);
+	stats->max_usec = __sync_fetch_and_add(&src->max_usec, 0);
+	for (i = 0; i < FP_STATS_NR_BUCKETS; i++)
+		stats->histogram[i] = __sync_fetch_and_add(&src->histogram[i], 0);
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/** \ingroup stats
+ * Retrieve the value of an event counter.
+ * \param dev the device to query, or NULL for the library-wide counters
+ * \param counter the counter to query
+ * \param value output location for the counter value
+ * \returns 0 on success, negative on error
+ */
+API_EXPORTED int fp_stats_get_counter(struct fp_dev *dev,
+	enum fp_stats_counter counter, uint64_t *value)
+{
+#ifdef ENABLE_STATS
+	if (counter >= FP_STATS_NR_COUNTERS)
+		return -EINVAL;
+
+	*value = __sync_fetch_and_add(&get_stats(dev)->counters[counter], 0);
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/** \ingroup stats
+ * Reset all statistics and counters to zero. Samples recorded concurrently
+ * with a reset may be partially lost.
+ * \param dev the device to reset, or NULL for the library-wide statistics
+ * \returns 0 on success, negative on error
+ */
+API_EXPORTED int fp_stats_reset(struct fp_dev *dev)
+{
+#ifdef ENABLE_STATS
+	memset(get_stats(dev), 0, sizeof(struct fpi_stats));
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/** \ingroup stats
+ * Retrieve a short human-readable name for a stage, such as "extract".
+ * \param stage the stage
+ * \returns the stage name, or NULL for an invalid stage. Must not be
+ * modified or freed.
+ */
+API_EXPORTED const char *fp_stats_stage_get_name(enum fp_stats_stage stage)
+{
+	static const char * const names[] = {
+		[FP_STATS_STAGE_OPEN] = "open",
+		[FP_STATS_STAGE_ACTIVATE] = "activate",
+		[FP_STATS_STAGE_ACQUIRE] = "acquire",
+		[FP_STATS_STAGE_ASSEMBLE] = "assemble",
+		[FP_STATS_STAGE_STANDARDIZE] = "standardize",
+		[FP_STATS_STAGE_EXTRACT] = "extract",
+		[FP_STATS_STAGE_MATCH] = "match",
+		[FP_STATS_STAGE_STORAGE_LOAD] = "storage-load",
+		[FP_STATS_STAGE_STORAGE_SAVE] = "storage-save",
+		[FP_STATS_STAGE_ENROLL] = "enroll",
+		[FP_STATS_STAGE_VERIFY] = "verify",
+		[FP_STATS_STAGE_IDENTIFY] = "identify",
+		[FP_STATS_STAGE_CAPTURE] = "capture",
+	};
+
+	if (stage >= FP_STATS_NR_STAGES)
+		return NULL;
+	return names[stage];
+}
@@ -56,7 +56,7 @@ API_EXPORTED struct fp_dev *fp_dev_open(struct fp_dscv_dev *ddev)
 		goto out;
 
 	while (!odata->dev)
-		if (fp_handle_events() < 0)
+		if (fp_context_handle_events(ddev->ctx) < 0)
 			goto out;
 
 	if (odata->status == 0)
@@ -83,15 +83,18 @@ static void sync_close_cb(struct fp_dev *dev, void *user_data)
  */
 API_EXPORTED void fp_dev_close(struct fp_dev *dev)
 {
+	struct fp_context *ctx;
 	gboolean closed = FALSE;
 
 	if (!dev)
 		return;
 
 	fp_dbg("");
+	/* dev is freed once closing completes */
+	ctx = dev->ctx;
 	fp_async_dev_close(dev, sync_close_cb, &closed);
 	while (!closed)
-		if (fp_handle_events() < 0)
+		if (fp_context_handle_events(ctx) < 0)
 			break;
 }
 
@@ -212,7 +215,7 @@ API_EXPORTED int fp_enroll_finger_img(struct fp_dev *dev,
 	edata = dev->enroll_stage_cb_data;
 
 	while (!edata->populated) {
-		r = fp_handle_events();
+		r = fp_context_handle_events(dev->ctx);
 		if (r < 0) {
 			g_free(edata);
 			goto err;
@@ -275,7 +278,7 @@ out:
 err:
 	if (fp_async_enroll_stop(dev, enroll_stop_cb, &stopped) == 0)
 		while (!stopped)
-			if (fp_handle_events() < 0)
+			if (fp_context_handle_events(dev->ctx) < 0)
 				break;
 	return r;
 }
@@ -344,7 +347,7 @@ API_EXPORTED int fp_verify_finger_img(struct fp_dev *dev,
 	}
 
 	while (!vdata->populated) {
-		r = fp_handle_events();
+		r = fp_context_handle_events(dev->ctx);
 		if (r < 0) {
 			g_free(vdata);
 			goto err;
@@ -386,7 +389,7 @@ err:
 	fp_dbg("ending verification");
 	if (fp_async_verify_stop(dev, verify_stop_cb, &stopped) == 0)
 		while (!stopped)
-			if (fp_handle_events() < 0)
+			if (fp_context_handle_events(dev->ctx) < 0)
 				break;
 
 	return r;
@@ -465,7 +468,7 @@ API_EXPORTED int fp_identify_finger_img(struct fp_dev *dev,
 	}
 
 	while (!idata->populated) {
-		r = fp_handle_events();
+		r = fp_context_handle_events(dev->ctx);
 		if (r < 0)
 			goto err_stop;
 	}
@@ -504,7 +507,7 @@ API_EXPORTED int fp_identify_finger_img(struct fp_dev *dev,
 err_stop:
 	if (fp_async_identify_stop(dev, identify_stop_cb, &stopped) == 0)
 		while (!stopped)
-			if (fp_handle_events() < 0)
+			if (fp_context_handle_events(dev->ctx) < 0)
 				break;
 
 err:
@@ -573,7 +576,7 @@ API_EXPORTED int fp_dev_img_capture(struct fp_dev *dev, int unconditional,
 	}
 
 	while (!vdata->populated) {
-		r = fp_handle_events();
+		r = fp_context_handle_events(dev->ctx);
 		if (r < 0) {
 			g_free(vdata);
 			goto err;
@@ -603,7 +606,7 @@ err:
 	fp_dbg("ending capture");
 	if (fp_async_capture_stop(dev, capture_stop_cb, &stopped) == 0)
 		while (!stopped)
-			if (fp_handle_events() < 0)
+			if (fp_context_handle_events(dev->ctx) < 0)
 				break;
 
 	return r;
@@ -0,0 +1,493 @@
+/*
+ * Check the imaging device warm session transitions: idle between actions,
+ * cooling down after the idle timeout, and closing while warm
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "fp_internal.h"
+
+static unsigned int failures;
+
+/* What imgdev.c asked the driver, the timers and the core to do since the
+ * last check, as space separated words. */
+static char events[1024];
+
+static void event(const char *fmt, ...)
+{
+	size_t len = strlen(events);
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(events + len, sizeof(events) - len, fmt, args);
+	va_end(args);
+	strncat(events, " ", sizeof(events) - strlen(events) - 1);
+}
+
+#define expect(want) check_events(want, __LINE__)
+
+static void check_events(const char *want, int line)
+{
+	if (strcmp(events, want) != 0) {
+		fprintf(stderr, "line %d: got \"%s\", expected \"%s\"\n",
+			line, events, want);
+		failures++;
+	}
+	events[0] = '\0';
+}
+
+/* A single timer is all imgdev.c uses, fired by hand. */
+struct fpi_timeout {
+	fpi_timeout_fn callback;
+	void *data;
+};
+
+static struct fpi_timeout *timer;
+
+struct fpi_timeout *fpi_timeout_add(struct fp_dev *dev, unsigned int msec,
+	fpi_timeout_fn callback, void *data)
+{
+	if (timer) {
+		event("timer-leak");
+		return NULL;
+	}
+	timer = g_malloc0(sizeof(*timer));
+	timer->callback = callback;
+	timer->data = data;
+	event("timer%u", msec);
+	return timer;
+}
+
+void fpi_timeout_cancel(struct fpi_timeout *timeout)
+{
+	event(timeout && timeout == timer ? "cancel" : "cancel-bad");
+	g_free(timer);
+	timer = NULL;
+}
+
+static void fire_timer(void)
+{
+	struct fpi_timeout *t = timer;
+
+	if (!t) {
+		event("no-timer");
+		return;
+	}
+	event("fire");
+	t->callback(t->data);
+	g_free(t);
+	if (timer == t)
+		timer = NULL;
+}
+
+/* The core, and the image processing that the transitions don't reach */
+static struct fp_dev test_dev;
+static void (*stopped_cb)(void);
+
+void fpi_log(enum fpi_log_level level, const char *component,
+	const char *function, const char *format, ...)
+{
+	if (level == FPRINT_LOG_LEVEL_ERROR)
+		event("error");
+}
+
+void fpi_drvcb_open_complete(struct fp_dev *dev, int status)
+{
+}
+
+void fpi_drvcb_close_complete(struct fp_dev *dev)
+{
+	event("closed");
+}
+
+void fpi_drvcb_verify_started(struct fp_dev *dev, int status)
+{
+	event(status ? "started-error" : "started");
+}
+
+void fpi_drvcb_report_verify_result(struct fp_dev *dev, int result,
+	struct fp_img *img)
+{
+	event("result%d", result);
+}
+
+void fpi_drvcb_verify_stopped(struct fp_dev *dev)
+{
+	void (*cb)(void) = stopped_cb;
+
+	event("stopped");
+	stopped_cb = NULL;
+	if (cb)
+		cb();
+}
+
+void fpi_drvcb_enroll_started(struct fp_dev *dev, int status) { }
+void fpi_drvcb_enroll_stage_completed(struct fp_dev *dev, int result,
+	struct fp_print_data *data, struct fp_img *img) { }
+void fpi_drvcb_enroll_stopped(struct fp_dev *dev) { }
+void fpi_drvcb_identify_started(struct fp_dev *dev, int status) { }
+void fpi_drvcb_report_identify_result(struct fp_dev *dev, int result,
+	size_t match_offset, struct fp_img *img) { }
+void fpi_drvcb_identify_stopped(struct fp_dev *dev) { }
+void fpi_drvcb_capture_started(struct fp_dev *dev, int status) { }
+void fpi_drvcb_report_capture_result(struct fp_dev *dev, int result,
+	struct fp_img *img) { }
+void fpi_drvcb_capture_stopped(struct fp_dev *dev) { }
+
+struct fp_print_data *fpi_print_data_new(struct fp_dev *dev)
+{
+	return NULL;
+}
+
+void fp_print_data_free(struct fp_print_data *data)
+{
+}
+
+void fp_img_free(struct fp_img *img)
+{
+	if (img)
+		event("free-img");
+}
+
+void fp_img_standardize(struct fp_img *img)
+{
+}
+
+gboolean fpi_img_is_sane(struct fp_img *img)
+{
+	return TRUE;
+}
+
+int fpi_img_check_quality(struct fp_img *img)
+{
+	return 0;
+}
+
+int fpi_img_to_print_data(struct fp_img_dev *imgdev, struct fp_img *img,
+	struct fp_print_data **ret)
+{
+	return -EINVAL;
+}
+
+int fpi_img_compare_print_data(struct fp_print_data *enrolled_print,
+	struct fp_print_data *new_print)
+{
+	return 0;
+}
+
+int fpi_img_compare_print_data_to_gallery(struct fp_print_data *print,
+	struct fp_print_data **gallery, int match_threshold, size_t *match_offset)
+{
+	return 0;
+}
+
+/* The driver, which completes nothing by itself */
+static struct fp_img_dev *imgdev;
+
+static int drv_open(struct fp_img_dev *dev, unsigned long driver_data)
+{
+	imgdev = dev;
+	return 0;
+}
+
+static void drv_close(struct fp_img_dev *dev)
+{
+	event("CLOSE");
+	imgdev = NULL;
+	fpi_imgdev_close_complete(dev);
+}
+
+static int drv_activate(struct fp_img_dev *dev, enum fp_imgdev_state state)
+{
+	event("ACTIVATE");
+	return 0;
+}
+
+static void drv_deactivate(struct fp_img_dev *dev)
+{
+	event("DEACTIVATE");
+}
+
+static struct fp_img_driver driver = {
+	.open = drv_open,
+	.close = drv_close,
+	.activate = drv_activate,
+	.deactivate = drv_deactivate,
+};
+
+static void open_dev(unsigned int warm_timeout)
+{
+	test_dev.drv = &driver.driver;
+	driver.driver.open(&test_dev, 0);
+	if (warm_timeout)
+		fpi_imgdev_set_warm_timeout(imgdev, warm_timeout);
+	events[0] = '\0';
+}
+
+static void start(void)
+{
+	driver.driver.verify_start(&test_dev);
+}
+
+static void stop(void)
+{
+	driver.driver.verify_stop(&test_dev, FALSE);
+}
+
+static void start_activated(void)
+{
+	start();
+	fpi_imgdev_activate_complete(imgdev, 0);
+	events[0] = '\0';
+}
+
+static void test_cold(void)
+{
+	open_dev(0);
+	start();
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	expect("started ");
+	stop();
+	expect("DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("stopped ");
+	driver.driver.close(&test_dev);
+	expect("CLOSE closed ");
+}
+
+/* stopping leaves the device idle, and starting again skips activation */
+static void test_idle(void)
+{
+	open_dev(500);
+	start_activated();
+	stop();
+	expect("timer500 stopped ");
+	start();
+	expect("cancel started ");
+	stop();
+	expect("timer500 stopped ");
+
+	/* the next action may start from the stopped callback */
+	start();
+	events[0] = '\0';
+	stopped_cb = start;
+	stop();
+	expect("timer500 stopped cancel started ");
+
+	/* a changed timeout restarts the wait, and 0 ends the session */
+	stop();
+	expect("timer500 stopped ");
+	fpi_imgdev_set_warm_timeout(imgdev, 900);
+	expect("cancel timer900 ");
+	fpi_imgdev_set_warm_timeout(imgdev, 0);
+	expect("cancel DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("");
+
+	fpi_imgdev_set_warm_timeout(imgdev, 500);
+	start();
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	expect("started ");
+
+	/* a failed session is not kept warm */
+	fpi_imgdev_session_error(imgdev, -EIO);
+	expect("result-5 ");
+	stop();
+	expect("DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("stopped ");
+
+	driver.driver.close(&test_dev);
+	expect("CLOSE closed ");
+}
+
+/* the idle timeout deactivates the device, and actions started meanwhile
+ * wait for that to finish */
+static void test_cooling(void)
+{
+	open_dev(500);
+	start_activated();
+	stop();
+	expect("timer500 stopped ");
+	fire_timer();
+	expect("fire DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("");
+
+	start();
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	expect("started ");
+	stop();
+	expect("timer500 stopped ");
+	fire_timer();
+	expect("fire DEACTIVATE ");
+	start();
+	expect("");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	expect("started ");
+
+	/* started and stopped again before the device was deactivated */
+	stop();
+	expect("timer500 stopped ");
+	fire_timer();
+	expect("fire DEACTIVATE ");
+	start();
+	stop();
+	expect("");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("stopped ");
+
+	/* errors while cooling down are not reported to anyone, and an
+	 * action started meanwhile activates the device afresh */
+	start_activated();
+	stop();
+	fire_timer();
+	expect("timer500 stopped fire DEACTIVATE ");
+	fpi_imgdev_session_error(imgdev, -EIO);
+	expect("");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("");
+
+	start_activated();
+	stop();
+	fire_timer();
+	expect("timer500 stopped fire DEACTIVATE ");
+	start();
+	fpi_imgdev_session_error(imgdev, -EIO);
+	expect("");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	expect("started ");
+	stop();
+	expect("timer500 stopped ");
+
+	driver.driver.close(&test_dev);
+	expect("cancel DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("CLOSE closed ");
+}
+
+/* closing a warm device deactivates it first */
+static void test_close(void)
+{
+	open_dev(500);
+	start_activated();
+	stop();
+	expect("timer500 stopped ");
+	driver.driver.close(&test_dev);
+	expect("cancel DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("CLOSE closed ");
+
+	open_dev(500);
+	start_activated();
+	stop();
+	fire_timer();
+	expect("timer500 stopped fire DEACTIVATE ");
+	driver.driver.close(&test_dev);
+	expect("");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("CLOSE closed ");
+}
+
+/* the driver hands over images it captured, also ones that are ignored */
+static void test_ignored_images(void)
+{
+	struct fp_img img;
+
+	memset(&img, 0, sizeof(img));
+	open_dev(500);
+	start_activated();
+	stop();
+	expect("timer500 stopped ");
+	fpi_imgdev_image_captured(imgdev, &img);
+	expect("free-img ");
+
+	start();
+	fpi_imgdev_report_finger_status(imgdev, TRUE);
+	imgdev->action_result = FP_VERIFY_RETRY;
+	events[0] = '\0';
+	fpi_imgdev_image_captured(imgdev, &img);
+	expect("free-img ");
+	imgdev->action_result = 0;
+
+	stop();
+	fpi_imgdev_deactivate_complete(imgdev);
+	driver.driver.close(&test_dev);
+	expect("DEACTIVATE stopped CLOSE closed ");
+}
+
+/* a device stopped while it waits for an image is not left capturing */
+static void test_stop_capturing(void)
+{
+	struct fp_img img;
+
+	memset(&img, 0, sizeof(img));
+	img.width = 1;
+	img.height = 1;
+	open_dev(500);
+	start_activated();
+	fpi_imgdev_report_finger_status(imgdev, TRUE);
+	stop();
+	expect("DEACTIVATE ");
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("stopped ");
+
+	/* once the image is in, the device is kept warm again */
+	start();
+	expect("ACTIVATE ");
+	fpi_imgdev_activate_complete(imgdev, 0);
+	fpi_imgdev_report_finger_status(imgdev, TRUE);
+	fpi_imgdev_image_captured(imgdev, &img);
+	expect("started ");
+	stop();
+	expect("timer500 free-img stopped ");
+
+	driver.driver.close(&test_dev);
+	fpi_imgdev_deactivate_complete(imgdev);
+	expect("cancel DEACTIVATE CLOSE closed ");
+}
+
+int main(void)
+{
+	fpi_img_driver_setup(&driver);
+
+	test_cold();
+	test_idle();
+	test_cooling();
+	test_close();
+	test_ignored_images();
+	test_stop_capturing();
+
+	if (failures) {
+		fprintf(stderr, "%u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * Check the mindtct minutia reliabilities against the neighborhood
+ * statistics as they were taken from a histogram
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* get_neighborhood_stats() is static, so take quality.c in whole */
+#include "nbis/mindtct/quality.c"
+
+#include <stdarg.h>
+
+#define BLOCKSIZE 8
+#define PPMM 19.69
+
+static unsigned int failures;
+
+#ifdef ENABLE_NBIS_LOG
+/* NBIS error reports go to libfprint's log, which the test leaves out */
+void nbis_err(const char *file, const char *function, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+#endif
+
+/* combined_minutia_quality() needs this from maps.c, which needs most of
+ * the rest of mindtct. The test images are whole blocks wide and high. */
+int pixelize_map(int **omap, const int iw, const int ih,
+	int *imap, const int mw, const int mh, const int blocksize)
+{
+	int *pmap = malloc(iw * ih * sizeof(int));
+	int x, y;
+
+	for (y = 0; y < ih; y++)
+		for (x = 0; x < iw; x++)
+			pmap[y * iw + x] = imap[(y / blocksize) * mw + x / blocksize];
+	*omap = pmap;
+	return 0;
+}
+
+/* get_neighborhood_stats() as it was, filling a histogram first */
+static void ref_neighborhood_stats(double *mean, double *stdev, int x, int y,
+	unsigned char *idata, int iw, int ih, int radius_pix)
+{
+	int i, rows, cols;
+	int n = 0, sumX = 0, sumXX = 0;
+	int histogram[256];
+
+	memset(histogram, 0, 256 * sizeof(int));
+
+	if ((x < radius_pix) || (x > iw - radius_pix - 1) ||
+			(y < radius_pix) || (y > ih - radius_pix - 1)) {
+		*mean = 0.0;
+		*stdev = 0.0;
+		return;
+	}
+
+	for (rows = y - radius_pix; rows <= y + radius_pix; rows++)
+		for (cols = x - radius_pix; cols <= x + radius_pix; cols++)
+			histogram[*(idata + (rows * iw) + cols)]++;
+
+	for (i = 0; i < 256; i++) {
+		if (histogram[i]) {
+			sumX += (i * histogram[i]);
+			sumXX += (i * i * histogram[i]);
+			n += histogram[i];
+		}
+	}
+
+	*mean = sumX / (double)n;
+	*stdev = sqrt((sumXX / (double)n) - ((*mean) * (*mean)));
+}
+
+static double ref_reliability(int x, int y, int qmap_value,
+	unsigned char *idata, int iw, int ih, int radius_pix)
+{
+	double mean, stdev, gs;
+
+	ref_neighborhood_stats(&mean, &stdev, x, y, idata, iw, ih, radius_pix);
+	gs = min((stdev > IDEALSTDEV ? 1.0 : stdev / (double)IDEALSTDEV),
+		(1.0 - (fabs(mean - IDEALMEAN) / (double)IDEALMEAN)));
+
+	switch (qmap_value) {
+	case 4:
+		return 0.50 + (0.49 * gs);
+	case 3:
+		return 0.25 + (0.24 * gs);
+	case 2:
+		return 0.10 + (0.14 * gs);
+	case 1:
+		return 0.05 + (0.04 * gs);
+	default:
+		return 0.01;
+	}
+}
+
+/* Pixels of the test images: noise, ridges and flat areas. */
+static void fill_image(unsigned char *idata, int iw, int ih, int kind)
+{
+	int x, y;
+
+	for (y = 0; y < ih; y++) {
+		for (x = 0; x < iw; x++) {
+			unsigned char *p = &idata[y * iw + x];
+
+			switch (kind) {
+			case 0:
+				*p = rand();
+				break;
+			case 1:
+				*p = 128 + 127 * sin((x + y / 2) / 1.5);
+				break;
+			case 2:
+				*p = (x < iw / 2) ? 255 : 0;
+				break;
+			default:
+				*p = 200 + rand() % 4;
+				break;
+			}
+		}
+	}
+}
+
+static void check_stats(unsigned char *idata, int iw, int ih)
+{
+	static const int radii[] = { 0, 1, 5, 11, 20 };
+	double ref_mean, ref_stdev, mean, stdev;
+	unsigned int r;
+	int x, y;
+
+	for (r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+		for (y = 0; y < ih; y += 3) {
+			for (x = 0; x < iw; x += 2) {
+				ref_neighborhood_stats(&ref_mean, &ref_stdev, x, y,
+					idata, iw, ih, radii[r]);
+				get_neighborhood_stats(&mean, &stdev, x, y,
+					idata, iw, ih, radii[r]);
+				if (mean != ref_mean || stdev != ref_stdev) {
+					fprintf(stderr, "stats mismatch at %d,%d radius %d\n",
+						x, y, radii[r]);
+					failures++;
+				}
+			}
+		}
+	}
+}
+
+static void check_reliabilities(unsigned char *idata, int iw, int ih)
+{
+	int mw = iw / BLOCKSIZE, mh = ih / BLOCKSIZE;
+	int radius_pix = sround(RADIUS_MM * PPMM);
+	int *qmap = malloc(mw * mh * sizeof(int));
+	int xs[200], ys[200];
+	double reliability[200];
+	struct fp_minutiae minutiae;
+	int i;
+
+	for (i = 0; i < mw * mh; i++)
+		qmap[i] = rand() % 5;
+
+	memset(&minutiae, 0, sizeof(minutiae));
+	minutiae.num = 200;
+	minutiae.x = xs;
+	minutiae.y = ys;
+	minutiae.reliability = reliability;
+	for (i = 0; i < minutiae.num; i++) {
+		xs[i] = rand() % iw;
+		ys[i] = rand() % ih;
+	}
+
+	if (combined_minutia_quality(&minutiae, qmap, mw, mh, BLOCKSIZE,
+			idata, iw, ih, 8, PPMM) != 0) {
+		fprintf(stderr, "combined_minutia_quality failed\n");
+		failures++;
+	} else {
+		for (i = 0; i < minutiae.num; i++) {
+			int q = qmap[(ys[i] / BLOCKSIZE) * mw + xs[i] / BLOCKSIZE];
+
+			if (reliability[i] != ref_reliability(xs[i], ys[i], q,
+					idata, iw, ih, radius_pix)) {
+				fprintf(stderr, "reliability mismatch at %d,%d\n",
+					xs[i], ys[i]);
+				failures++;
+			}
+		}
+	}
+	free(qmap);
+}
+
+int main(void)
+{
+	static const int sizes[][2] = { { 64, 48 }, { 192, 160 }, { 256, 256 } };
+	unsigned int s;
+	int kind;
+
+	srand(2000);
+	for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		int iw = sizes[s][0], ih = sizes[s][1];
+		unsigned char *idata = malloc(iw * ih);
+
+		for (kind = 0; kind < 4; kind++) {
+			fill_image(idata, iw, ih, kind);
+			check_stats(idata, iw, ih);
+			check_reliabilities(idata, iw, ih);
+		}
+		free(idata);
+	}
+
+	if (failures) {
+		fprintf(stderr, "%u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Check the mindtct sorts that replaced bubble sorts against the bubble
+ * sorts, including the order that equal ranks are left in
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lfs.h"
+
+#define MAX_LEN 2000
+
+static unsigned int failures;
+
+#ifdef ENABLE_NBIS_LOG
+/* NBIS error reports go to libfprint's log, which the test leaves out */
+void nbis_err(const char *file, const char *function, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+#endif
+
+/* Items are the original positions, so equal ranks only compare equal if
+ * both sorts left them in the same order. */
+static void init_items(int *items, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		items[i] = i;
+}
+
+static void check_int_inc(const int *input, int len)
+{
+	int ref_ranks[MAX_LEN], ref_items[MAX_LEN];
+	int ranks[MAX_LEN], items[MAX_LEN];
+
+	memcpy(ref_ranks, input, len * sizeof(int));
+	memcpy(ranks, input, len * sizeof(int));
+	init_items(ref_items, len);
+	init_items(items, len);
+
+	bubble_sort_int_inc_2(ref_ranks, ref_items, len);
+	if (radix_sort_int_inc_2(ranks, items, len) != 0
+			|| memcmp(ref_ranks, ranks, len * sizeof(int)) != 0
+			|| memcmp(ref_items, items, len * sizeof(int)) != 0) {
+		fprintf(stderr, "radix_sort_int_inc_2 mismatch: %d ranks\n", len);
+		failures++;
+	}
+}
+
+static void check_double_inc(const double *input, int len)
+{
+	double ref_ranks[MAX_LEN], ranks[MAX_LEN];
+	int ref_items[MAX_LEN], items[MAX_LEN];
+
+	memcpy(ref_ranks, input, len * sizeof(double));
+	memcpy(ranks, input, len * sizeof(double));
+	init_items(ref_items, len);
+	init_items(items, len);
+
+	bubble_sort_double_inc_2(ref_ranks, ref_items, len);
+	insertion_sort_double_inc_2(ranks, items, len);
+	if (memcmp(ref_ranks, ranks, len * sizeof(double)) != 0
+			|| memcmp(ref_items, items, len * sizeof(int)) != 0) {
+		fprintf(stderr, "insertion_sort_double_inc_2 mismatch: %d ranks\n",
+			len);
+		failures++;
+	}
+}
+
+static void check_double_dec(const double *input, int len)
+{
+	double ref_ranks[MAX_LEN], ranks[MAX_LEN];
+	int ref_items[MAX_LEN], items[MAX_LEN];
+
+	memcpy(ref_ranks, input, len * sizeof(double));
+	memcpy(ranks, input, len * sizeof(double));
+	init_items(ref_items, len);
+	init_items(items, len);
+
+	bubble_sort_double_dec_2(ref_ranks, ref_items, len);
+	network_sort_double_dec_2(ranks, items, len);
+	if (memcmp(ref_ranks, ranks, len * sizeof(double)) != 0
+			|| memcmp(ref_items, items, len * sizeof(int)) != 0) {
+		fprintf(stderr, "network_sort_double_dec_2 mismatch: %d ranks\n",
+			len);
+		failures++;
+	}
+}
+
+/* Random ranks out of range distinct values, so that small ranges give
+ * plenty of ties. */
+static void random_ints(int *ranks, int len, int range)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		ranks[i] = rand() % range - range / 2;
+}
+
+static void random_doubles(double *ranks, int len, int range)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		ranks[i] = (rand() % range) / 4.0;
+}
+
+int main(void)
+{
+	static const int ranges[] = { 1, 2, 3, 10, 1000, INT_MAX };
+	int ints[MAX_LEN];
+	double doubles[MAX_LEN];
+	unsigned int r;
+	int len, i, code;
+
+	srand(1999);
+
+	/* both sides of the switch to radix sorting, and the lengths the
+	 * minutiae sorts see */
+	for (r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+		for (len = 0; len < 300; len++) {
+			random_ints(ints, len, ranges[r]);
+			check_int_inc(ints, len);
+		}
+		for (len = 300; len <= MAX_LEN; len += 283) {
+			random_ints(ints, len, ranges[r]);
+			check_int_inc(ints, len);
+		}
+	}
+
+	/* ranks that differ only in the top or bottom digit */
+	for (len = 0; len < MAX_LEN; len++)
+		ints[len] = (len % 3 == 0) ? INT_MIN + len % 7
+			: (len % 3 == 1) ? INT_MAX - len % 5 : (len % 11) << 24;
+	check_int_inc(ints, MAX_LEN);
+
+	for (r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+		for (len = 0; len < 100; len++) {
+			random_doubles(doubles, len, ranges[r]);
+			check_double_inc(doubles, len);
+			check_double_dec(doubles, len);
+		}
+	}
+
+	/* every list of up to 5 ranks out of 4 values, which covers all the
+	 * sorting networks and the fallback for longer lists */
+	for (len = 0; len <= 5; len++) {
+		int combinations = 1;
+
+		for (i = 0; i < len; i++)
+			combinations *= 4;
+		for (code = 0; code < combinations; code++) {
+			int c = code;
+
+			for (i = 0; i < len; i++, c /= 4)
+				doubles[i] = c % 4;
+			check_double_inc(doubles, len);
+			check_double_dec(doubles, len);
+		}
+	}
+
+	if (failures) {
+		fprintf(stderr, "%u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
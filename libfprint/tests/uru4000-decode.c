@@ -0,0 +1,138 @@
+/*
+ * Check the table driven uru4000 descrambler against the reference
+ * bit-by-bit implementation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drivers/uru4000_decode.h"
+
+#define IMAGE_WIDTH 384
+#define IMAGE_HEIGHT 290
+
+/* The decoder as it was before it went table driven. */
+static uint32_t ref_decode(uint8_t *data, int num_bytes, uint32_t key)
+{
+	uint8_t xorbyte;
+	int i;
+
+	for (i = 0; i < num_bytes - 1; i++) {
+		/* calculate xor byte and update key */
+		xorbyte  = ((key >>  4) & 1) << 0;
+		xorbyte |= ((key >>  8) & 1) << 1;
+		xorbyte |= ((key >> 11) & 1) << 2;
+		xorbyte |= ((key >> 14) & 1) << 3;
+		xorbyte |= ((key >> 18) & 1) << 4;
+		xorbyte |= ((key >> 21) & 1) << 5;
+		xorbyte |= ((key >> 24) & 1) << 6;
+		xorbyte |= ((key >> 29) & 1) << 7;
+		key = uru4000_update_key(key);
+
+		/* decrypt data */
+		data[i] = data[i+1] ^ xorbyte;
+	}
+
+	/* the final byte is implictly zero */
+	data[i] = 0;
+	return uru4000_update_key(key);
+}
+
+/* Contents of REG_SCRAMBLE_DATA_KEY and the seed written with the key
+ * index, from which the driver derives the key (see IMAGING_DECODE). */
+static const struct {
+	uint8_t reg[4];
+	uint32_t seed;
+} key_pairs[] = {
+	{ { 0x00, 0x00, 0x00, 0x00 }, 0x00000000 },
+	{ { 0xff, 0xff, 0xff, 0xff }, 0x00000000 },
+	{ { 0x00, 0x00, 0x00, 0x00 }, 0xffffffff },
+	{ { 0x01, 0x00, 0x00, 0x00 }, 0x00000000 },
+	{ { 0x00, 0x00, 0x00, 0x80 }, 0x00000000 },
+	{ { 0x78, 0x56, 0x34, 0x12 }, 0x00000000 },
+	{ { 0x4d, 0x14, 0x48, 0x92 }, 0x6b8b4567 },
+	{ { 0xa3, 0x1f, 0x7c, 0x05 }, 0x327b23c6 },
+	{ { 0x5e, 0xc9, 0x02, 0xd8 }, 0x643c9869 },
+	{ { 0x9b, 0x60, 0xe1, 0x3a }, 0x66334873 },
+};
+
+static unsigned int failures;
+
+static void check(const uint8_t *input, int num_bytes, uint32_t key)
+{
+	uint8_t *ref = malloc(num_bytes);
+	uint8_t *out = malloc(num_bytes);
+	uint32_t ref_key, out_key;
+
+	memcpy(ref, input, num_bytes);
+	memcpy(out, input, num_bytes);
+	ref_key = ref_decode(ref, num_bytes, key);
+	out_key = uru4000_decode(out, num_bytes, key);
+
+	if (ref_key != out_key || memcmp(ref, out, num_bytes) != 0) {
+		fprintf(stderr, "mismatch: key %08x, %d bytes\n", key, num_bytes);
+		failures++;
+	}
+	free(ref);
+	free(out);
+}
+
+int main(void)
+{
+	uint8_t *input;
+	unsigned int i;
+	int len;
+
+	input = malloc(IMAGE_WIDTH * IMAGE_HEIGHT);
+	srand(4000);
+	for (i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+		input[i] = rand();
+
+	for (i = 0; i < sizeof(key_pairs) / sizeof(key_pairs[0]); i++) {
+		uint32_t key;
+
+		key  = key_pairs[i].reg[0];
+		key |= key_pairs[i].reg[1] << 8;
+		key |= key_pairs[i].reg[2] << 16;
+		key |= (uint32_t) key_pairs[i].reg[3] << 24;
+		key ^= key_pairs[i].seed;
+
+		/* every tail length around the 8 byte steps */
+		for (len = 1; len < 100; len++)
+			check(input, len, key);
+		/* whole blocks of lines, as the driver decodes them */
+		for (len = IMAGE_WIDTH; len <= IMAGE_WIDTH * IMAGE_HEIGHT;
+				len += IMAGE_WIDTH * 17)
+			check(input, len, key);
+	}
+
+	for (i = 0; i < 1000; i++) {
+		uint32_t key = ((uint32_t) rand() << 16) ^ rand();
+
+		/* random lengths at unaligned offsets */
+		len = 1 + rand() % (IMAGE_WIDTH * IMAGE_HEIGHT - 8);
+		check(input + rand() % 8, len, key);
+	}
+
+	free(input);
+	if (failures) {
+		fprintf(stderr, "%u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * Record a short USB transfer sequence from a mock device, replay it, and
+ * check that every transfer sees the same data and status both times
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <libusb.h>
+
+#include "fp_internal.h"
+
+#define NR_TRANSFERS 8
+#define BUF_LEN 16
+
+static unsigned int failures;
+
+/* what a transfer was completed with, as the driver saw it */
+struct result {
+	int completions;
+	int status;
+	int actual_length;
+	unsigned char data[BUF_LEN];
+};
+
+/***** the mock device, which answers while recording *****/
+
+/* what the device answers each submission with, in submission order. A
+ * transfer with no_reply is only completed once it is cancelled. */
+static const struct reply {
+	int status;
+	int length;
+	const char *data;
+	gboolean no_reply;
+} replies[] = {
+	{ LIBUSB_TRANSFER_COMPLETED, 5, NULL, FALSE },
+	{ LIBUSB_TRANSFER_COMPLETED, 3, "abc", FALSE },
+	{ LIBUSB_TRANSFER_CANCELLED, 0, NULL, TRUE },
+	{ LIBUSB_TRANSFER_STALL, 0, NULL, FALSE },
+	{ LIBUSB_TRANSFER_COMPLETED, 2, "ok", FALSE },
+	{ LIBUSB_TRANSFER_COMPLETED, 4, "late", FALSE },
+};
+
+static struct libusb_transfer *device_queue[NR_TRANSFERS];
+static const struct reply *device_replies[NR_TRANSFERS];
+static int nr_submitted, nr_queued;
+
+int libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+	device_replies[nr_queued] = &replies[nr_submitted++];
+	device_queue[nr_queued++] = transfer;
+	return 0;
+}
+
+int libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	static const struct reply cancelled = {
+		LIBUSB_TRANSFER_CANCELLED, 0, NULL, FALSE };
+	int i;
+
+	for (i = 0; i < nr_queued; i++)
+		if (device_queue[i] == transfer && device_replies[i]->no_reply) {
+			device_replies[i] = &cancelled;
+			return 0;
+		}
+	return LIBUSB_ERROR_NOT_FOUND;
+}
+
+/* complete what the device has an answer for */
+static void device_run(void)
+{
+	int i, j;
+
+	for (i = 0; i < nr_queued; i++) {
+		struct libusb_transfer *transfer = device_queue[i];
+		const struct reply *reply = device_replies[i];
+		unsigned char *data = transfer->buffer;
+
+		if (reply->no_reply)
+			continue;
+		for (j = i; j < nr_queued - 1; j++) {
+			device_queue[j] = device_queue[j + 1];
+			device_replies[j] = device_replies[j + 1];
+		}
+		nr_queued--;
+		i--;
+
+		if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL)
+			data += LIBUSB_CONTROL_SETUP_SIZE;
+		if (reply->data)
+			memcpy(data, reply->data, reply->length);
+		transfer->status = reply->status;
+		transfer->actual_length = reply->length;
+		transfer->callback(transfer);
+	}
+}
+
+int libusb_bulk_transfer(libusb_device_handle *dev_handle,
+	unsigned char endpoint, unsigned char *data, int length,
+	int *transferred, unsigned int timeout)
+{
+	memcpy(data, "wxyz", 4);
+	*transferred = 4;
+	return 0;
+}
+
+int libusb_control_transfer(libusb_device_handle *dev_handle,
+	uint8_t request_type, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+	unsigned char *data, uint16_t wLength, unsigned int timeout)
+{
+	data[0] = 0x12;
+	data[1] = 0x34;
+	return 2;
+}
+
+int libusb_get_device_descriptor(libusb_device *dev,
+	struct libusb_device_descriptor *desc)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->idVendor = 0x1234;
+	desc->idProduct = 0x5678;
+	return 0;
+}
+
+void libusb_free_transfer(struct libusb_transfer *transfer)
+{
+	g_free(transfer);
+}
+
+int libusb_claim_interface(libusb_device_handle *dev_handle, int iface)
+{
+	return 0;
+}
+
+int libusb_release_interface(libusb_device_handle *dev_handle, int iface)
+{
+	return 0;
+}
+
+int libusb_set_configuration(libusb_device_handle *dev_handle, int config)
+{
+	return 0;
+}
+
+int libusb_reset_device(libusb_device_handle *dev_handle)
+{
+	return 0;
+}
+
+/***** the rest of libfprint, which replay completes transfers through *****/
+
+struct fpi_timeout {
+	fpi_timeout_fn callback;
+	void *data;
+};
+
+static GSList *timers;
+
+struct fpi_timeout *fpi_timeout_add(struct fp_dev *dev, unsigned int msec,
+	fpi_timeout_fn callback, void *data)
+{
+	struct fpi_timeout *timeout = g_malloc0(sizeof(*timeout));
+
+	timeout->callback = callback;
+	timeout->data = data;
+	timers = g_slist_append(timers, timeout);
+	return timeout;
+}
+
+void fpi_timeout_cancel(struct fpi_timeout *timeout)
+{
+	timers = g_slist_remove(timers, timeout);
+	g_free(timeout);
+}
+
+static void timers_run(void)
+{
+	while (timers) {
+		struct fpi_timeout *timeout = timers->data;
+
+		timers = g_slist_remove(timers, timeout);
+		timeout->callback(timeout->data);
+		g_free(timeout);
+	}
+}
+
+void fpi_log(enum fpi_log_level level, const char *component,
+	const char *function, const char *format, ...)
+{
+}
+
+/***** the driver *****/
+
+static struct fp_dev test_dev;
+static gboolean replay;
+static struct result results[NR_TRANSFERS];
+static unsigned char buffers[NR_TRANSFERS][LIBUSB_CONTROL_SETUP_SIZE + BUF_LEN];
+static struct libusb_transfer *transfers[NR_TRANSFERS];
+
+static void run_events(void)
+{
+	if (replay)
+		timers_run();
+	else
+		device_run();
+}
+
+static void transfer_cb(struct libusb_transfer *transfer)
+{
+	struct result *result = transfer->user_data;
+	unsigned char *data = transfer->buffer;
+
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL)
+		data += LIBUSB_CONTROL_SETUP_SIZE;
+	result->completions++;
+	result->status = transfer->status;
+	result->actual_length = transfer->actual_length;
+	memcpy(result->data, data, BUF_LEN);
+}
+
+static struct libusb_transfer *submit(int n, unsigned char type,
+	unsigned char endpoint, const char *out)
+{
+	struct libusb_transfer *transfer = g_malloc0(sizeof(*transfer));
+	unsigned char *buffer = buffers[n];
+
+	memset(buffer, 0, sizeof(buffers[n]));
+	transfer->dev_handle = test_dev.udev;
+	transfer->type = type;
+	transfer->endpoint = endpoint;
+	transfer->buffer = buffer;
+	transfer->length = BUF_LEN;
+	if (type == LIBUSB_TRANSFER_TYPE_CONTROL) {
+		libusb_fill_control_setup(buffer, 0xc0, 1, 0, 0, BUF_LEN);
+		transfer->length += LIBUSB_CONTROL_SETUP_SIZE;
+	} else if (out) {
+		memcpy(buffer, out, strlen(out));
+		transfer->length = strlen(out);
+	}
+	transfer->callback = transfer_cb;
+	transfer->user_data = &results[n];
+	transfers[n] = transfer;
+
+	if (fpi_usb_submit_transfer(transfer) != 0) {
+		fprintf(stderr, "transfer %d: submission failed\n", n);
+		failures++;
+	}
+	return transfer;
+}
+
+/* the transfers a driver might make, leaving the last one in flight */
+static void run_driver(void)
+{
+	struct libusb_transfer *transfer;
+	int r, transferred = 0;
+
+	memset(results, 0, sizeof(results));
+
+	submit(0, LIBUSB_TRANSFER_TYPE_BULK, 0x01, "hello");
+	run_events();
+	submit(1, LIBUSB_TRANSFER_TYPE_BULK, 0x82, NULL);
+	run_events();
+
+	/* a finger detection interrupt, cancelled when the session ends */
+	transfer = submit(2, LIBUSB_TRANSFER_TYPE_INTERRUPT, 0x83, NULL);
+	run_events();
+	if (results[2].completions != 0) {
+		fprintf(stderr, "cancelled transfer completed early\n");
+		failures++;
+	}
+	fpi_usb_cancel_transfer(transfer);
+	run_events();
+
+	submit(3, LIBUSB_TRANSFER_TYPE_BULK, 0x82, NULL);
+	run_events();
+
+	r = fpi_usb_bulk_transfer(test_dev.udev, 0x82, buffers[6], BUF_LEN,
+		&transferred, 0);
+	results[6].completions = 1;
+	results[6].status = r;
+	results[6].actual_length = transferred;
+	memcpy(results[6].data, buffers[6], BUF_LEN);
+
+	r = fpi_usb_control_transfer(test_dev.udev, 0xc0, 1, 0, 0, buffers[7],
+		BUF_LEN, 0);
+	results[7].completions = 1;
+	results[7].status = r;
+	memcpy(results[7].data, buffers[7], BUF_LEN);
+
+	submit(4, LIBUSB_TRANSFER_TYPE_CONTROL, 0xc0, NULL);
+	run_events();
+	submit(5, LIBUSB_TRANSFER_TYPE_BULK, 0x82, NULL);
+}
+
+int main(void)
+{
+	struct result recorded[NR_TRANSFERS];
+	struct fp_driver drv = { .id = 7, .name = "mock" };
+	struct fp_dscv_dev ddev = { .drv = &drv, .devtype = 3,
+		.driver_data = 9 };
+	char path[] = "/tmp/libfprint-usbtrace-XXXXXX";
+	uint16_t driver_id;
+	uint32_t devtype;
+	unsigned long driver_data;
+	int fd, i;
+
+	fd = mkstemp(path);
+	if (fd < 0) {
+		perror("mkstemp");
+		return 1;
+	}
+	close(fd);
+
+	test_dev.udev = (libusb_device_handle *) &test_dev;
+
+	/* record from the mock device */
+	g_setenv("LIBFPRINT_USB_RECORD", path, TRUE);
+	fpi_usbtrace_init();
+	fpi_usbtrace_dev_opened(&test_dev, &ddev);
+	run_driver();
+	run_events();
+	fpi_usbtrace_dev_closed(&test_dev);
+	fpi_usbtrace_exit();
+	memcpy(recorded, results, sizeof(results));
+	for (i = 0; i < NR_TRANSFERS; i++)
+		g_free(transfers[i]);
+	g_unsetenv("LIBFPRINT_USB_RECORD");
+
+	/* and play it back */
+	replay = TRUE;
+	g_setenv("LIBFPRINT_USB_REPLAY", path, TRUE);
+	g_setenv("LIBFPRINT_USB_REPLAY_TIMING", "compressed", TRUE);
+	fpi_usbtrace_init();
+	if (!fpi_usb_replaying()
+			|| fpi_usb_replay_get_device(&driver_id, &devtype,
+				&driver_data) != 0
+			|| driver_id != 7 || devtype != 3 || driver_data != 9) {
+		fprintf(stderr, "trace header not replayed\n");
+		failures++;
+	}
+	fpi_usbtrace_dev_opened(&test_dev, &ddev);
+	run_driver();
+
+	/* the last transfer must not complete once the device is closed */
+	fpi_usbtrace_dev_closed(&test_dev);
+	run_events();
+	memset(&recorded[5], 0, sizeof(recorded[5]));
+
+	for (i = 0; i < NR_TRANSFERS; i++) {
+		if (memcmp(&recorded[i], &results[i], sizeof(results[i])) != 0) {
+			fprintf(stderr, "transfer %d: recorded status %d length %d, "
+				"replayed status %d length %d (%d completions)\n", i,
+				recorded[i].status, recorded[i].actual_length,
+				results[i].status, results[i].actual_length,
+				results[i].completions);
+			failures++;
+		}
+		g_free(transfers[i]);
+	}
+	/* and what was replayed is what the device answered */
+	if (results[1].actual_length != 3 || memcmp(results[1].data, "abc", 3)
+			|| results[3].status != LIBUSB_TRANSFER_STALL
+			|| results[2].status != LIBUSB_TRANSFER_CANCELLED
+			|| memcmp(results[4].data, "ok", 2)
+			|| memcmp(results[6].data, "wxyz", 4)
+			|| results[7].status != 2) {
+		fprintf(stderr, "transfers did not get the device's data\n");
+		failures++;
+	}
+
+	fpi_usbtrace_exit();
+	unlink(path);
+
+	if (failures) {
+		fprintf(stderr, "%u mismatches\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * Per-device pools of USB transfers and buffers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "usbpool"
+
+#include <config.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <libusb.h>
+
+#include "fp_internal.h"
+
+/* Drivers tend to allocate a transfer and a buffer for every register
+ * access and every stripe they read, and free both again in the callback.
+ * fpi_usb_alloc_transfer() hands out transfers that already come with a
+ * buffer, and fpi_usb_free_transfer() keeps them around for reuse by the
+ * same device rather than freeing them.
+ *
+ * Buffers are grouped in power of 2 size classes. Where libusb supports
+ * it, they are allocated with libusb_dev_mem_alloc(), which lets the
+ * kernel transfer straight from/to them rather than through a bounce
+ * buffer. Requests bigger than the largest class are not cached.
+ *
+ * A device is only ever operated from one thread, so there is no locking.
+ */
+
+#define POOL_MIN_SHIFT		6	/* 64 bytes */
+#define POOL_NR_CLASSES		12	/* up to 128kb */
+#define POOL_MAX_IDLE		8	/* idle transfers kept per class */
+
+#if defined(LIBUSB_API_VERSION) && LIBUSB_API_VERSION >= 0x01000105
+#define HAVE_DEV_MEM
+#endif
+
+struct pool_entry {
+	struct libusb_transfer *transfer;
+	unsigned char *buffer;
+	size_t size;
+	int size_class;	/* -1 if not cached */
+	gboolean dev_mem;
+};
+
+struct fpi_usb_pool {
+	GSList *idle[POOL_NR_CLASSES];
+	unsigned int nr_idle[POOL_NR_CLASSES];
+	/* transfer -> pool_entry, for transfers handed out */
+	GHashTable *busy;
+};
+
+static int size_to_class(size_t length)
+{
+	int size_class = 0;
+
+	while (((size_t) 1 << (size_class + POOL_MIN_SHIFT)) < length) {
+		if (++size_class == POOL_NR_CLASSES)
+			return -1;
+	}
+	return size_class;
+}
+
+static struct pool_entry *entry_new(struct fp_dev *dev, size_t size,
+	int size_class)
+{
+	struct pool_entry *entry;
+	struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+
+	if (!transfer)
+		return NULL;
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->transfer = transfer;
+	entry->size = size;
+	entry->size_class = size_class;
+#ifdef HAVE_DEV_MEM
+	if (dev->udev) {
+		entry->buffer = libusb_dev_mem_alloc(dev->udev, size);
+		entry->dev_mem = entry->buffer != NULL;
+	}
+#endif
+	if (!entry->buffer)
+		entry->buffer = g_malloc(size);
+	return entry;
+}
+
+static void entry_free(struct fp_dev *dev, struct pool_entry *entry)
+{
+#ifdef HAVE_DEV_MEM
+	if (entry->dev_mem)
+		libusb_dev_mem_free(dev->udev, entry->buffer, entry->size);
+	else
+#endif
+		g_free(entry->buffer);
+	libusb_free_transfer(entry->transfer);
+	g_free(entry);
+}
+
+/* Get a transfer with a buffer of at least length bytes, which remains
+ * the transfer's buffer until fpi_usb_free_transfer(). The transfer must
+ * not have the LIBUSB_TRANSFER_FREE_BUFFER or LIBUSB_TRANSFER_FREE_TRANSFER
+ * flags set. Returns NULL on allocation failure. */
+struct libusb_transfer *fpi_usb_alloc_transfer(struct fp_dev *dev,
+	size_t length)
+{
+	struct fpi_usb_pool *pool = dev->usb_pool;
+	int size_class = size_to_class(length);
+	struct pool_entry *entry = NULL;
+
+	if (!pool) {
+		pool = g_malloc0(sizeof(*pool));
+		pool->busy = g_hash_table_new(g_direct_hash, g_direct_equal);
+		dev->usb_pool = pool;
+	}
+
+	if (size_class >= 0 && pool->idle[size_class]) {
+		entry = pool->idle[size_class]->data;
+		pool->idle[size_class] = g_slist_delete_link(pool->idle[size_class],
+			pool->idle[size_class]);
+		pool->nr_idle[size_class]--;
+	} else {
+		size_t size = length;
+		if (size_class >= 0)
+			size = (size_t) 1 << (size_class + POOL_MIN_SHIFT);
+		entry = entry_new(dev, size, size_class);
+		if (!entry)
+			return NULL;
+	}
+
+	/* hand it out as good as new */
+	entry->transfer->flags = 0;
+	entry->transfer->buffer = entry->buffer;
+	entry->transfer->length = length;
+	g_hash_table_insert(pool->busy, entry->transfer, entry);
+	return entry->transfer;
+}
+
+/* Give a transfer obtained from fpi_usb_alloc_transfer() back to the pool.
+ * Can be called from the transfer's own callback. */
+void fpi_usb_free_transfer(struct fp_dev *dev, struct libusb_transfer *transfer)
+{
+	struct fpi_usb_pool *pool = dev->usb_pool;
+	struct pool_entry *entry;
+
+	if (!transfer)
+		return;
+
+	entry = pool ? g_hash_table_lookup(pool->busy, transfer) : NULL;
+	if (!entry) {
+		fp_err("transfer %p does not come from the pool", transfer);
+		return;
+	}
+	g_hash_table_remove(pool->busy, transfer);
+
+	if (entry->size_class < 0
+			|| pool->nr_idle[entry->size_class] >= POOL_MAX_IDLE) {
+		entry_free(dev, entry);
+		return;
+	}
+
+	pool->idle[entry->size_class] = g_slist_prepend(
+		pool->idle[entry->size_class], entry);
+	pool->nr_idle[entry->size_class]++;
+}
+
+/* Release the pool of a device that is being closed, before its USB handle
+ * goes away. */
+void fpi_usb_pool_exit(struct fp_dev *dev)
+{
+	struct fpi_usb_pool *pool = dev->usb_pool;
+	int i;
+
+	if (!pool)
+		return;
+
+	for (i = 0; i < POOL_NR_CLASSES; i++) {
+		GSList *elem;
+		for (elem = pool->idle[i]; elem; elem = g_slist_next(elem))
+			entry_free(dev, elem->data);
+		g_slist_free(pool->idle[i]);
+	}
+
+	/* the driver closed the device without waiting for these, they can't
+	 * be freed safely */
+	if (g_hash_table_size(pool->busy))
+		fp_err("%d transfers still in use", g_hash_table_size(pool->busy));
+	g_hash_table_destroy(pool->busy);
+
+	g_free(pool);
+	dev->usb_pool = NULL;
+}
@@ -0,0 +1,195 @@
+/*
+ * Pipelined bulk reads for streaming sensors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "usbstream"
+
+#include <config.h>
+#include <errno.h>
+
+#include <glib.h>
+#include <libusb.h>
+
+#include "fp_internal.h"
+
+/* Sensors which push out image data for as long as a finger is swiped
+ * lose frames if there is no read waiting when the data comes in. A stream
+ * keeps a ring of bulk reads queued on an endpoint, and passes their data
+ * to the driver in the order the reads were submitted. Each read is
+ * resubmitted as soon as the driver has seen its data.
+ *
+ * Once the driver has what it needs, or a read fails, the reads still in
+ * flight are cancelled and their data is dropped. The stream is freed
+ * after the driver has been told that it stopped. */
+
+struct stream_slot {
+	struct fpi_usb_stream *stream;
+	struct libusb_transfer *transfer;
+	gboolean flying;
+	gboolean completed;
+};
+
+struct fpi_usb_stream {
+	struct fp_dev *dev;
+	fpi_usb_stream_data_cb data_cb;
+	fpi_usb_stream_stopped_cb stopped_cb;
+	void *user_data;
+	int depth;
+	struct stream_slot *slots;
+	/* next slot to hand to the driver */
+	int head;
+	int num_flying;
+	gboolean stopping;
+	int error;
+};
+
+static void stream_free(struct fpi_usb_stream *stream)
+{
+	int i;
+
+	for (i = 0; i < stream->depth; i++)
+		fpi_usb_free_transfer(stream->dev, stream->slots[i].transfer);
+	g_free(stream->slots);
+	g_free(stream);
+}
+
+static void stream_stop(struct fpi_usb_stream *stream, int error)
+{
+	int i;
+
+	if (stream->stopping)
+		return;
+
+	stream->stopping = TRUE;
+	stream->error = error;
+	for (i = 0; i < stream->depth; i++) {
+		struct stream_slot *slot = &stream->slots[i];
+		int r;
+
+		if (!slot->flying)
+			continue;
+		r = fpi_usb_cancel_transfer(slot->transfer);
+		if (r < 0 && r != LIBUSB_ERROR_NOT_FOUND)
+			fp_dbg("failed to cancel transfer %d: %d", i, r);
+	}
+}
+
+static void stream_transfer_cb(struct libusb_transfer *transfer)
+{
+	struct stream_slot *slot = transfer->user_data;
+	struct fpi_usb_stream *stream = slot->stream;
+
+	slot->flying = FALSE;
+	slot->completed = TRUE;
+	stream->num_flying--;
+
+	if (!stream->stopping && transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		fp_dbg("read failed with status %d", transfer->status);
+		stream_stop(stream, -EIO);
+	}
+
+	/* libusb completes reads on an endpoint in order, but don't rely on it */
+	while (!stream->stopping && stream->slots[stream->head].completed) {
+		struct stream_slot *next = &stream->slots[stream->head];
+		int r;
+
+		r = stream->data_cb(next->transfer->buffer,
+			next->transfer->actual_length, stream->user_data);
+		next->completed = FALSE;
+		stream->head = (stream->head + 1) % stream->depth;
+		if (r != 0) {
+			stream_stop(stream, r < 0 ? r : 0);
+			break;
+		}
+
+		r = fpi_usb_submit_transfer(next->transfer);
+		if (r < 0) {
+			stream_stop(stream, r);
+			break;
+		}
+		next->flying = TRUE;
+		stream->num_flying++;
+	}
+
+	if (stream->stopping && stream->num_flying == 0) {
+		fpi_usb_stream_stopped_cb stopped_cb = stream->stopped_cb;
+		void *user_data = stream->user_data;
+		int error = stream->error;
+
+		stream_free(stream);
+		stopped_cb(error, user_data);
+	}
+}
+
+/* Start reading from a bulk IN endpoint with depth reads of length bytes
+ * in flight. data_cb is called with the data of each completed read, in
+ * order, and returns 0 to carry on reading, 1 to stop, or a negative error
+ * code to abort. Once all reads are back, stopped_cb is called with 0 or
+ * the error that stopped the stream; the stream is gone by then.
+ *
+ * Returns a negative error code, without calling stopped_cb, if the stream
+ * could not be started. */
+int fpi_usb_stream_start(struct fp_dev *dev, unsigned char endpoint,
+	size_t length, int depth, unsigned int timeout,
+	fpi_usb_stream_data_cb data_cb, fpi_usb_stream_stopped_cb stopped_cb,
+	void *user_data)
+{
+	struct fpi_usb_stream *stream;
+	int i;
+	int r;
+
+	stream = g_malloc0(sizeof(*stream));
+	stream->dev = dev;
+	stream->data_cb = data_cb;
+	stream->stopped_cb = stopped_cb;
+	stream->user_data = user_data;
+	stream->depth = depth;
+	stream->slots = g_malloc0(depth * sizeof(*stream->slots));
+
+	for (i = 0; i < depth; i++) {
+		struct stream_slot *slot = &stream->slots[i];
+
+		slot->stream = stream;
+		slot->transfer = fpi_usb_alloc_transfer(dev, length);
+		if (!slot->transfer) {
+			stream_free(stream);
+			return -ENOMEM;
+		}
+		libusb_fill_bulk_transfer(slot->transfer, dev->udev, endpoint,
+			slot->transfer->buffer, length, stream_transfer_cb, slot,
+			timeout);
+	}
+
+	for (i = 0; i < depth; i++) {
+		struct stream_slot *slot = &stream->slots[i];
+
+		r = fpi_usb_submit_transfer(slot->transfer);
+		if (r < 0) {
+			if (i == 0) {
+				stream_free(stream);
+				return r;
+			}
+			/* the reads already queued report back to stopped_cb */
+			stream_stop(stream, r);
+			return 0;
+		}
+		slot->flying = TRUE;
+		stream->num_flying++;
+	}
+
+	return 0;
+}
@@ -0,0 +1,702 @@
+/*
+ * USB traffic recording and replay
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define FP_COMPONENT "usbtrace"
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <libusb.h>
+
+#include "fp_internal.h"
+
+/* Drivers do not talk to libusb directly for I/O, they go through the
+ * fpi_usb_* wrappers below. Normally those are thin pass-throughs, but
+ * two environment variables (read at fp_init() time) change that:
+ *
+ * LIBFPRINT_USB_RECORD=<file>
+ *   Every transfer submission, completion and synchronous transfer of the
+ *   first device opened is appended to <file>, along with the payload
+ *   and a microsecond timestamp.
+ *
+ * LIBFPRINT_USB_REPLAY=<file>
+ *   No USB device is touched. fp_discover_devs() returns a single device
+ *   described by the trace header and the driver's transfers are completed
+ *   from the recording, in submission order. Data sent by the driver is
+ *   compared against the recording and divergences are logged.
+ *   LIBFPRINT_USB_REPLAY_TIMING=compressed completes every transfer as
+ *   soon as the main loop runs instead of honouring the recorded latency.
+ *
+ * Transfers which were cancelled (or never completed) in the recording are
+ * held back in replay until the driver cancels them, which is what happens
+ * to e.g. finger-detection interrupts when a session ends.
+ *
+ * The trace format is a header followed by a stream of records, all
+ * integers little-endian:
+ *   header: "FPU1", driver_id (16), vendor (16), product (16),
+ *           devtype (32), driver_data (32)
+ *   record: kind (8), type (8), endpoint (8), status (8), seq (32),
+ *           timestamp (64), result (32), data_length (32), data
+ */
+
+enum usbtrace_kind {
+	USBTRACE_SUBMIT = 1,
+	USBTRACE_COMPLETE,
+	USBTRACE_SYNC,
+};
+
+struct usbtrace_header {
+	char magic[4];
+	uint16_t driver_id;
+	uint16_t vendor;
+	uint16_t product;
+	uint32_t devtype;
+	uint32_t driver_data;
+} __attribute__((__packed__));
+
+struct usbtrace_record {
+	uint8_t kind;
+	uint8_t type;
+	uint8_t endpoint;
+	uint8_t status;
+	uint32_t seq;
+	uint64_t timestamp;
+	int32_t result;
+	uint32_t data_length;
+	unsigned char data[0];
+} __attribute__((__packed__));
+
+/* a record as loaded for replay, in host byte order */
+struct replay_event {
+	enum usbtrace_kind kind;
+	unsigned char type;
+	unsigned char endpoint;
+	enum libusb_transfer_status status;
+	uint32_t seq;
+	uint64_t timestamp;
+	int result;
+	size_t data_length;
+	unsigned char *data;
+	struct replay_event *completion;
+};
+
+/* a transfer in flight while recording. the driver's callback and data are
+ * stashed here while our own callback is installed in the transfer. */
+struct record_pending {
+	uint32_t seq;
+	libusb_transfer_cb_fn callback;
+	void *user_data;
+};
+
+/* a transfer in flight while replaying */
+struct replay_pending {
+	struct libusb_transfer *transfer;
+	struct replay_event *completion;
+	struct fpi_timeout *timeout;
+};
+
+static FILE *record_file = NULL;
+static struct fp_dev *record_dev = NULL;
+static uint32_t record_seq = 0;
+static gint64 trace_start = 0;
+
+static gboolean replaying = FALSE;
+/* the device being replayed, whose context delivers the completions */
+static struct fp_dev *replay_dev = NULL;
+static gboolean replay_compressed = FALSE;
+static struct usbtrace_header replay_header;
+static struct replay_event *replay_events = NULL;
+static size_t replay_nr_events = 0;
+static size_t replay_pos = 0;
+static GSList *replay_pending_list = NULL;
+
+static uint64_t trace_timestamp(void)
+{
+	return g_get_monotonic_time() - trace_start;
+}
+
+static gboolean transfer_is_in(struct libusb_transfer *transfer)
+{
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL) {
+		struct libusb_control_setup *setup =
+			libusb_control_transfer_get_setup(transfer);
+		return (setup->bmRequestType & LIBUSB_ENDPOINT_IN) != 0;
+	}
+	return (transfer->endpoint & LIBUSB_ENDPOINT_IN) != 0;
+}
+
+/***** RECORDING *****/
+
+static void record_write(enum usbtrace_kind kind, unsigned char type,
+	unsigned char endpoint, int status, uint32_t seq, int result,
+	const unsigned char *data, size_t data_length)
+{
+	struct usbtrace_record rec;
+
+	rec.kind = kind;
+	rec.type = type;
+	rec.endpoint = endpoint;
+	rec.status = status;
+	rec.seq = GUINT32_TO_LE(seq);
+	rec.timestamp = GUINT64_TO_LE(trace_timestamp());
+	rec.result = GINT32_TO_LE(result);
+	rec.data_length = GUINT32_TO_LE(data_length);
+
+	if (fwrite(&rec, sizeof(rec), 1, record_file) != 1
+			|| (data_length
+				&& fwrite(data, data_length, 1, record_file) != 1)) {
+		fp_err("trace write failed, recording stopped");
+		fclose(record_file);
+		record_file = NULL;
+	}
+}
+
+static gboolean recording(libusb_device_handle *udev)
+{
+	return record_file && record_dev && record_dev->udev == udev;
+}
+
+static void record_transfer_cb(struct libusb_transfer *transfer)
+{
+	struct record_pending *pending = transfer->user_data;
+	const unsigned char *data = transfer->buffer;
+	size_t data_length = 0;
+
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL)
+		data += LIBUSB_CONTROL_SETUP_SIZE;
+	if (transfer_is_in(transfer) && transfer->actual_length > 0)
+		data_length = transfer->actual_length;
+
+	if (record_file)
+		record_write(USBTRACE_COMPLETE, transfer->type, transfer->endpoint,
+			transfer->status, pending->seq, transfer->actual_length,
+			data, data_length);
+
+	/* hand the transfer back to the driver untouched */
+	transfer->callback = pending->callback;
+	transfer->user_data = pending->user_data;
+	g_free(pending);
+	transfer->callback(transfer);
+}
+
+static int record_submit(struct libusb_transfer *transfer)
+{
+	struct record_pending *pending = g_malloc(sizeof(*pending));
+	gboolean is_in = transfer_is_in(transfer);
+	size_t data_length;
+	int r;
+
+	/* control transfers always carry their setup packet, other IN
+	 * transfers carry nothing until they complete */
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL)
+		data_length = is_in ? LIBUSB_CONTROL_SETUP_SIZE : transfer->length;
+	else
+		data_length = is_in ? 0 : transfer->length;
+
+	pending->seq = record_seq++;
+	pending->callback = transfer->callback;
+	pending->user_data = transfer->user_data;
+	transfer->callback = record_transfer_cb;
+	transfer->user_data = pending;
+
+	record_write(USBTRACE_SUBMIT, transfer->type, transfer->endpoint, 0,
+		pending->seq, transfer->length, transfer->buffer, data_length);
+
+	r = libusb_submit_transfer(transfer);
+	if (r < 0) {
+		transfer->callback = pending->callback;
+		transfer->user_data = pending->user_data;
+		g_free(pending);
+	}
+	return r;
+}
+
+void fpi_usbtrace_dev_opened(struct fp_dev *dev, struct fp_dscv_dev *ddev)
+{
+	struct libusb_device_descriptor dsc;
+	struct usbtrace_header hdr;
+
+	if (replaying) {
+		replay_dev = dev;
+		return;
+	}
+
+	if (!record_file || record_dev)
+		return;
+
+	if (libusb_get_device_descriptor(ddev->udev, &dsc) < 0) {
+		fp_err("failed to get device descriptor, not recording");
+		return;
+	}
+
+	memcpy(hdr.magic, "FPU1", 4);
+	hdr.driver_id = GUINT16_TO_LE(ddev->drv->id);
+	hdr.vendor = GUINT16_TO_LE(dsc.idVendor);
+	hdr.product = GUINT16_TO_LE(dsc.idProduct);
+	hdr.devtype = GUINT32_TO_LE(ddev->devtype);
+	hdr.driver_data = GUINT32_TO_LE(ddev->driver_data);
+	if (fwrite(&hdr, sizeof(hdr), 1, record_file) != 1) {
+		fp_err("trace header write failed");
+		return;
+	}
+
+	fp_dbg("recording %s %04x:%04x", ddev->drv->name, dsc.idVendor,
+		dsc.idProduct);
+	record_dev = dev;
+	trace_start = g_get_monotonic_time();
+}
+
+static void replay_drop_pending(void);
+
+void fpi_usbtrace_dev_closed(struct fp_dev *dev)
+{
+	if (dev == replay_dev) {
+		replay_drop_pending();
+		replay_dev = NULL;
+	}
+	if (dev != record_dev)
+		return;
+
+	fflush(record_file);
+	record_dev = NULL;
+}
+
+/***** REPLAY *****/
+
+static int replay_load(const char *path)
+{
+	gchar *contents;
+	gsize length;
+	GError *err = NULL;
+	const unsigned char *buf;
+	size_t remaining;
+	size_t i, j;
+
+	if (!g_file_get_contents(path, &contents, &length, &err)) {
+		int r = -EIO;
+		if (err->code == G_FILE_ERROR_NOENT)
+			r = -ENOENT;
+		fp_err("could not read trace %s: %s", path, err->message);
+		g_error_free(err);
+		return r;
+	}
+
+	if (length < sizeof(replay_header)
+			|| memcmp(contents, "FPU1", 4) != 0) {
+		fp_err("%s is not a USB trace", path);
+		g_free(contents);
+		return -EINVAL;
+	}
+
+	memcpy(&replay_header, contents, sizeof(replay_header));
+	replay_header.driver_id = GUINT16_FROM_LE(replay_header.driver_id);
+	replay_header.vendor = GUINT16_FROM_LE(replay_header.vendor);
+	replay_header.product = GUINT16_FROM_LE(replay_header.product);
+	replay_header.devtype = GUINT32_FROM_LE(replay_header.devtype);
+	replay_header.driver_data = GUINT32_FROM_LE(replay_header.driver_data);
+
+	/* first pass counts the records so that they can live in one array */
+	buf = (unsigned char *) contents + sizeof(replay_header);
+	remaining = length - sizeof(replay_header);
+	replay_nr_events = 0;
+	while (remaining >= sizeof(struct usbtrace_record)) {
+		const struct usbtrace_record *rec =
+			(const struct usbtrace_record *) buf;
+		size_t rec_len = sizeof(*rec) + GUINT32_FROM_LE(rec->data_length);
+		if (rec_len > remaining)
+			break;
+		buf += rec_len;
+		remaining -= rec_len;
+		replay_nr_events++;
+	}
+	if (remaining)
+		fp_warn("ignoring %zd bytes of truncated trace", remaining);
+
+	replay_events = g_malloc0(sizeof(*replay_events) * replay_nr_events);
+	buf = (unsigned char *) contents + sizeof(replay_header);
+	for (i = 0; i < replay_nr_events; i++) {
+		const struct usbtrace_record *rec =
+			(const struct usbtrace_record *) buf;
+		struct replay_event *ev = &replay_events[i];
+
+		ev->kind = rec->kind;
+		ev->type = rec->type;
+		ev->endpoint = rec->endpoint;
+		ev->status = rec->status;
+		ev->seq = GUINT32_FROM_LE(rec->seq);
+		ev->timestamp = GUINT64_FROM_LE(rec->timestamp);
+		ev->result = GINT32_FROM_LE(rec->result);
+		ev->data_length = GUINT32_FROM_LE(rec->data_length);
+		ev->data = g_malloc(ev->data_length);
+		memcpy(ev->data, rec->data, ev->data_length);
+		buf += sizeof(*rec) + ev->data_length;
+	}
+	g_free(contents);
+
+	/* link each submission to its completion */
+	for (i = 0; i < replay_nr_events; i++) {
+		if (replay_events[i].kind != USBTRACE_SUBMIT)
+			continue;
+		for (j = i + 1; j < replay_nr_events; j++) {
+			if (replay_events[j].kind == USBTRACE_COMPLETE
+					&& replay_events[j].seq == replay_events[i].seq) {
+				replay_events[i].completion = &replay_events[j];
+				break;
+			}
+		}
+	}
+
+	fp_dbg("loaded %zd events for driver %d (%04x:%04x)", replay_nr_events,
+		replay_header.driver_id, replay_header.vendor,
+		replay_header.product);
+	return 0;
+}
+
+static void replay_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < replay_nr_events; i++)
+		g_free(replay_events[i].data);
+	g_free(replay_events);
+	replay_events = NULL;
+	replay_nr_events = 0;
+	replay_pos = 0;
+}
+
+/* find the next recorded event of the given kind, skipping completions
+ * which are consumed through their submission */
+static struct replay_event *replay_next(enum usbtrace_kind kind)
+{
+	while (replay_pos < replay_nr_events) {
+		struct replay_event *ev = &replay_events[replay_pos++];
+		if (ev->kind == USBTRACE_COMPLETE)
+			continue;
+		if (ev->kind == kind)
+			return ev;
+		fp_warn("driver diverged from trace at event %zd", replay_pos - 1);
+	}
+
+	fp_warn("trace exhausted");
+	return NULL;
+}
+
+static void replay_check_out_data(struct replay_event *ev,
+	const unsigned char *data, size_t length)
+{
+	if (ev->data_length != length || memcmp(ev->data, data, length) != 0)
+		fp_warn("outgoing data on ep %02x differs from trace (seq %d)",
+			ev->endpoint, ev->seq);
+}
+
+static void replay_complete(struct replay_pending *pending,
+	enum libusb_transfer_status status)
+{
+	struct libusb_transfer *transfer = pending->transfer;
+	struct replay_event *ev = pending->completion;
+	unsigned char *buffer = transfer->buffer;
+	int length = transfer->length;
+
+	replay_pending_list = g_slist_remove(replay_pending_list, pending);
+	g_free(pending);
+
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL) {
+		buffer += LIBUSB_CONTROL_SETUP_SIZE;
+		length -= LIBUSB_CONTROL_SETUP_SIZE;
+	}
+	if (length < 0)
+		length = 0;
+
+	transfer->status = status;
+	transfer->actual_length = 0;
+	if (status != LIBUSB_TRANSFER_CANCELLED && ev) {
+		transfer->actual_length = ev->result;
+		if (ev->data_length) {
+			if (ev->data_length > (size_t) length) {
+				fp_warn("recorded data exceeds buffer, truncating");
+				transfer->actual_length = length;
+			}
+			memcpy(buffer, ev->data,
+				MIN(ev->data_length, (size_t) length));
+		}
+	}
+
+	transfer->callback(transfer);
+	if (transfer->flags & LIBUSB_TRANSFER_FREE_TRANSFER)
+		libusb_free_transfer(transfer);
+}
+
+/* the replayed device is going away: its transfers must not complete on
+ * the memory the driver has freed by now */
+static void replay_drop_pending(void)
+{
+	GSList *elem;
+
+	for (elem = replay_pending_list; elem; elem = g_slist_next(elem)) {
+		struct replay_pending *pending = elem->data;
+		if (pending->timeout)
+			fpi_timeout_cancel(pending->timeout);
+		g_free(pending);
+	}
+	g_slist_free(replay_pending_list);
+	replay_pending_list = NULL;
+}
+
+static void replay_timeout_cb(void *data)
+{
+	struct replay_pending *pending = data;
+	pending->timeout = NULL;
+	replay_complete(pending, pending->completion
+		? pending->completion->status : LIBUSB_TRANSFER_CANCELLED);
+}
+
+static int replay_submit(struct libusb_transfer *transfer)
+{
+	struct replay_event *ev = replay_next(USBTRACE_SUBMIT);
+	struct replay_event *completion;
+	struct replay_pending *pending;
+	gboolean is_in;
+
+	if (!ev)
+		return LIBUSB_ERROR_IO;
+
+	if (ev->type != transfer->type || ev->endpoint != transfer->endpoint)
+		fp_warn("transfer type %d ep %02x, trace has type %d ep %02x",
+			transfer->type, transfer->endpoint, ev->type, ev->endpoint);
+
+	is_in = transfer_is_in(transfer);
+	if (transfer->type == LIBUSB_TRANSFER_TYPE_CONTROL)
+		replay_check_out_data(ev, transfer->buffer, is_in
+			? LIBUSB_CONTROL_SETUP_SIZE : transfer->length);
+	else if (!is_in)
+		replay_check_out_data(ev, transfer->buffer, transfer->length);
+
+	pending = g_malloc0(sizeof(*pending));
+	pending->transfer = transfer;
+	pending->completion = completion = ev->completion;
+	replay_pending_list = g_slist_prepend(replay_pending_list, pending);
+
+	/* a transfer that was cancelled in the recording stays pending until
+	 * the driver cancels it here as well */
+	if (!completion || completion->status == LIBUSB_TRANSFER_CANCELLED)
+		return 0;
+
+	pending->timeout = fpi_timeout_add(replay_dev, replay_compressed ? 0
+		: (completion->timestamp - ev->timestamp) / 1000,
+		replay_timeout_cb, pending);
+	return 0;
+}
+
+static int replay_cancel(struct libusb_transfer *transfer)
+{
+	struct replay_pending *pending = NULL;
+	GSList *elem;
+
+	for (elem = replay_pending_list; elem; elem = g_slist_next(elem)) {
+		struct replay_pending *p = elem->data;
+		if (p->transfer == transfer) {
+			pending = p;
+			break;
+		}
+	}
+	if (!pending)
+		return LIBUSB_ERROR_NOT_FOUND;
+
+	if (pending->timeout) {
+		fpi_timeout_cancel(pending->timeout);
+		pending->timeout = NULL;
+	}
+
+	/* libusb reports cancellation through the callback asynchronously */
+	pending->completion = NULL;
+	pending->timeout = fpi_timeout_add(replay_dev, 0, replay_timeout_cb,
+		pending);
+	return 0;
+}
+
+static int replay_sync(unsigned char type, unsigned char endpoint,
+	gboolean is_in, unsigned char *data, int length, int *transferred)
+{
+	struct replay_event *ev = replay_next(USBTRACE_SYNC);
+
+	if (!ev)
+		return LIBUSB_ERROR_IO;
+
+	if (ev->type != type || ev->endpoint != endpoint)
+		fp_warn("sync transfer type %d ep %02x, trace has type %d ep %02x",
+			type, endpoint, ev->type, ev->endpoint);
+
+	if (is_in) {
+		size_t n = MIN(ev->data_length, (size_t) MAX(length, 0));
+		memcpy(data, ev->data, n);
+		if (transferred)
+			*transferred = n;
+	} else {
+		replay_check_out_data(ev, data, length);
+		if (transferred)
+			*transferred = length;
+	}
+
+	return ev->result;
+}
+
+gboolean fpi_usb_replaying(void)
+{
+	return replaying;
+}
+
+int fpi_usb_replay_get_device(uint16_t *driver_id, uint32_t *devtype,
+	unsigned long *driver_data)
+{
+	if (!replaying)
+		return -ENODEV;
+
+	*driver_id = replay_header.driver_id;
+	*devtype = replay_header.devtype;
+	*driver_data = replay_header.driver_data;
+	return 0;
+}
+
+/***** WRAPPERS *****/
+
+int fpi_usb_submit_transfer(struct libusb_transfer *transfer)
+{
+	if (replaying)
+		return replay_submit(transfer);
+	if (recording(transfer->dev_handle))
+		return record_submit(transfer);
+	return libusb_submit_transfer(transfer);
+}
+
+int fpi_usb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	if (replaying)
+		return replay_cancel(transfer);
+	return libusb_cancel_transfer(transfer);
+}
+
+int fpi_usb_bulk_transfer(libusb_device_handle *udev, unsigned char endpoint,
+	unsigned char *data, int length, int *transferred, unsigned int timeout)
+{
+	gboolean is_in = (endpoint & LIBUSB_ENDPOINT_IN) != 0;
+	int r;
+
+	if (replaying)
+		return replay_sync(LIBUSB_TRANSFER_TYPE_BULK, endpoint, is_in, data,
+			length, transferred);
+
+	r = libusb_bulk_transfer(udev, endpoint, data, length, transferred,
+		timeout);
+	if (recording(udev)) {
+		size_t n = is_in ? (r == 0 ? *transferred : 0) : length;
+		record_write(USBTRACE_SYNC, LIBUSB_TRANSFER_TYPE_BULK, endpoint, 0,
+			record_seq++, r, data, n);
+	}
+	return r;
+}
+
+int fpi_usb_control_transfer(libusb_device_handle *udev, uint8_t request_type,
+	uint8_t request, uint16_t value, uint16_t index, unsigned char *data,
+	uint16_t length, unsigned int timeout)
+{
+	gboolean is_in = (request_type & LIBUSB_ENDPOINT_IN) != 0;
+	int r;
+
+	if (replaying)
+		return replay_sync(LIBUSB_TRANSFER_TYPE_CONTROL, request_type, is_in,
+			data, length, NULL);
+
+	r = libusb_control_transfer(udev, request_type, request, value, index,
+		data, length, timeout);
+	if (recording(udev))
+		record_write(USBTRACE_SYNC, LIBUSB_TRANSFER_TYPE_CONTROL,
+			request_type, 0, record_seq++, r, data,
+			is_in ? MAX(r, 0) : length);
+	return r;
+}
+
+int fpi_usb_claim_interface(libusb_device_handle *udev, int iface)
+{
+	if (replaying)
+		return 0;
+	return libusb_claim_interface(udev, iface);
+}
+
+int fpi_usb_release_interface(libusb_device_handle *udev, int iface)
+{
+	if (replaying)
+		return 0;
+	return libusb_release_interface(udev, iface);
+}
+
+int fpi_usb_set_configuration(libusb_device_handle *udev, int config)
+{
+	if (replaying)
+		return 0;
+	return libusb_set_configuration(udev, config);
+}
+
+int fpi_usb_reset_device(libusb_device_handle *udev)
+{
+	if (replaying)
+		return 0;
+	return libusb_reset_device(udev);
+}
+
+void fpi_usbtrace_init(void)
+{
+	const char *record_path = g_getenv("LIBFPRINT_USB_RECORD");
+	const char *replay_path = g_getenv("LIBFPRINT_USB_REPLAY");
+	const char *timing = g_getenv("LIBFPRINT_USB_REPLAY_TIMING");
+
+	if (replay_path) {
+		if (replay_load(replay_path) == 0) {
+			replaying = TRUE;
+			replay_compressed = timing && !strcmp(timing, "compressed");
+		}
+		/* never record a replayed session */
+		return;
+	}
+
+	if (record_path) {
+		record_file = fopen(record_path, "wb");
+		if (!record_file)
+			fp_err("could not open %s for recording, errno=%d",
+				record_path, errno);
+	}
+}
+
+void fpi_usbtrace_exit(void)
+{
+	if (record_file) {
+		fclose(record_file);
+		record_file = NULL;
+	}
+	record_dev = NULL;
+	record_seq = 0;
+	replay_dev = NULL;
+
+	/* any timeouts went away with their context */
+	g_slist_free_full(replay_pending_list, g_free);
+	replay_pending_list = NULL;
+	replay_free();
+	replaying = FALSE;
+}